@@ -0,0 +1,397 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @fileoverview This file contains the runtime of the
+ * deserializeBinaryBatch() generated with the `batch` option of
+ * protoc-gen-js, which decodes many independent messages of one type on a
+ * pool of Node.js worker_threads or Web Workers.
+ *
+ * The workers run a script that loads the generated code of the message
+ * types to decode and calls jspb.BinaryBatchPool.serve():
+ *
+ *   // worker.js
+ *   jspb.BinaryBatchPool.serve(require('worker_threads').parentPort,
+ *                              {'my.pkg.MyMessage': proto.my.pkg.MyMessage});
+ *
+ *   // main thread
+ *   var pool = new jspb.BinaryBatchPool(workers);
+ *   proto.my.pkg.MyMessage.deserializeBinaryBatch(buffers, {workers: pool})
+ *       .then(function(messages) { ... });
+ *
+ * A batch is split into chunks that idle workers take from a shared queue,
+ * so that a worker that is done early takes on more of the batch. The bytes
+ * of a chunk are copied once into a single ArrayBuffer, which is transferred
+ * to the worker and back rather than cloned. Workers send back the internal
+ * array of each message (see jspb.Message#toArray), from which the messages
+ * are rebuilt through their constructor without decoding again, or with the
+ * `objects` option the result of toObject().
+ *
+ * When a worker fails, the batches of the chunks it was decoding are
+ * rejected. Once no worker is left, so are those of the queued chunks, and
+ * later batches are decoded on the calling thread.
+ */
+
+goog.provide('jspb.BinaryBatchOptions');
+goog.provide('jspb.BinaryBatchPool');
+
+
+/**
+ * Options of deserializeBinaryBatch():
+ *  - workers: the pool to decode on. Without one, the batch is decoded on
+ *    the calling thread.
+ *  - objects: whether to return the toObject() form of the messages instead
+ *    of messages.
+ *  - chunkSize: the number of messages sent to a worker at once. By default
+ *    a batch is split into about four chunks per worker.
+ * @typedef {{
+ *   workers: (!jspb.BinaryBatchPool|undefined),
+ *   objects: (boolean|undefined),
+ *   chunkSize: (number|undefined)
+ * }}
+ */
+jspb.BinaryBatchOptions;
+
+
+/**
+ * A pool of workers decoding batches of messages. Each worker must be running
+ * jspb.BinaryBatchPool.serve() with the types of the messages it is given.
+ * @param {!Array<?>} workers Node.js worker_threads Workers or Web Workers.
+ * @constructor
+ * @struct
+ * @final
+ * @export
+ */
+jspb.BinaryBatchPool = function(workers) {
+  /**
+   * The workers that have not failed.
+   * @private {!Array<?>}
+   */
+  this.workers_ = workers;
+
+  /**
+   * The workers waiting for a chunk.
+   * @private {!Array<?>}
+   */
+  this.idle_ = workers.slice();
+
+  /**
+   * The chunks not yet sent to a worker, oldest first.
+   * @private {!Array<!jspb.BinaryBatchPool.Chunk_>}
+   */
+  this.queue_ = [];
+
+  /**
+   * The chunks being decoded, by request id.
+   * @private {!Object<number, !jspb.BinaryBatchPool.Chunk_>}
+   */
+  this.running_ = {};
+
+  /** @private {number} */
+  this.nextId_ = 0;
+
+  for (var i = 0; i < workers.length; i++) {
+    this.listen_(workers[i]);
+  }
+};
+
+
+/**
+ * A batch being decoded.
+ * @typedef {{
+ *   ctor: function(new:?, !Array=),
+ *   type: string,
+ *   objects: boolean,
+ *   results: !Array<?>,
+ *   remaining: number,
+ *   resolve: function(!Array<?>),
+ *   reject: function(*),
+ *   failed: boolean
+ * }}
+ * @private
+ */
+jspb.BinaryBatchPool.Batch_;
+
+
+/**
+ * A part of a batch, decoded by one worker.
+ * @typedef {{
+ *   batch: !jspb.BinaryBatchPool.Batch_,
+ *   buffers: !Array<!Uint8Array>,
+ *   start: number,
+ *   worker: ?
+ * }}
+ * @private
+ */
+jspb.BinaryBatchPool.Chunk_;
+
+
+/**
+ * Calls `callback` with the data of each message received by a worker or a
+ * message port.
+ * @param {?} target
+ * @param {function(?)} callback
+ * @private
+ */
+jspb.BinaryBatchPool.onMessage_ = function(target, callback) {
+  if (typeof target.on == 'function') {
+    // Node.js worker_threads.
+    target.on('message', callback);
+  } else {
+    target.addEventListener('message', function(event) {
+      callback(event.data);
+    });
+  }
+};
+
+
+/**
+ * Decodes the messages sent by a pool on the given worker port, e.g. the
+ * parentPort of worker_threads or the global scope of a Web Worker.
+ * @param {?} port
+ * @param {!Object<string, !Function>} typeRegistry The message constructors
+ *     by full type name (e.g. 'google.protobuf.Duration').
+ * @export
+ */
+jspb.BinaryBatchPool.serve = function(port, typeRegistry) {
+  jspb.BinaryBatchPool.onMessage_(port, function(request) {
+    var response;
+    try {
+      var ctor = typeRegistry[request.type];
+      if (!ctor) {
+        throw new Error('Unknown message type: ' + request.type);
+      }
+      var bytes = new Uint8Array(request.data);
+      var ends = request.ends;
+      var results = new Array(ends.length);
+      var start = 0;
+      for (var i = 0; i < ends.length; i++) {
+        var message = /** @type {?} */ (ctor).deserializeBinary(
+            bytes.subarray(start, ends[i]));
+        results[i] = request.objects ? message.toObject() : message.toArray();
+        start = ends[i];
+      }
+      response = {id: request.id, results: results};
+    } catch (e) {
+      response = {id: request.id, error: String(e && e.message || e)};
+    }
+    // Bytes fields are views of the request data, so handing it back saves
+    // cloning it along with them.
+    port.postMessage(response, [request.data]);
+  });
+};
+
+
+/**
+ * Decodes a batch of messages of one type; see deserializeBinaryBatch().
+ * @param {function(new:T, !Array=)} ctor The constructor of the message type.
+ * @param {string} type The full name of the message type.
+ * @param {!Array<!Uint8Array>} buffers The serialized messages.
+ * @param {!jspb.BinaryBatchOptions=} opt_options
+ * @return {!Promise<!Array<T|!Object>>}
+ * @template T
+ * @export
+ */
+jspb.BinaryBatchPool.deserialize = function(ctor, type, buffers, opt_options) {
+  var options = opt_options || {};
+  var objects = !!options.objects;
+  var pool = options.workers;
+  if (!pool || !pool.workers_.length || !buffers.length) {
+    return new Promise(function(resolve) {
+      var results = new Array(buffers.length);
+      for (var i = 0; i < buffers.length; i++) {
+        var message = /** @type {?} */ (ctor).deserializeBinary(buffers[i]);
+        results[i] = objects ? message.toObject() : message;
+      }
+      resolve(results);
+    });
+  }
+  var chunkSize = options.chunkSize ||
+      Math.ceil(buffers.length / (4 * pool.workers_.length));
+  return new Promise(function(resolve, reject) {
+    var batch = {
+      ctor: ctor,
+      type: type,
+      objects: objects,
+      results: new Array(buffers.length),
+      remaining: buffers.length,
+      resolve: resolve,
+      reject: reject,
+      failed: false
+    };
+    for (var start = 0; start < buffers.length; start += chunkSize) {
+      pool.queue_.push({
+        batch: batch,
+        buffers: buffers.slice(start, start + chunkSize),
+        start: start,
+        worker: null
+      });
+    }
+    pool.dispatch_();
+  });
+};
+
+
+/**
+ * Sends queued chunks to the idle workers.
+ * @private
+ */
+jspb.BinaryBatchPool.prototype.dispatch_ = function() {
+  while (this.idle_.length && this.queue_.length) {
+    var chunk = this.queue_.shift();
+    if (chunk.batch.failed) {
+      continue;
+    }
+    var length = 0;
+    for (var i = 0; i < chunk.buffers.length; i++) {
+      length += chunk.buffers[i].length;
+    }
+    var data = new Uint8Array(length);
+    var ends = new Array(chunk.buffers.length);
+    var offset = 0;
+    for (var i = 0; i < chunk.buffers.length; i++) {
+      data.set(chunk.buffers[i], offset);
+      offset += chunk.buffers[i].length;
+      ends[i] = offset;
+    }
+
+    var id = this.nextId_++;
+    chunk.worker = this.idle_.pop();
+    this.running_[id] = chunk;
+    chunk.worker.postMessage(
+        {
+          id: id,
+          type: chunk.batch.type,
+          objects: chunk.batch.objects,
+          data: data.buffer,
+          ends: ends
+        },
+        [data.buffer]);
+  }
+};
+
+
+/**
+ * Handles the responses and errors of a worker.
+ * @param {?} worker
+ * @private
+ */
+jspb.BinaryBatchPool.prototype.listen_ = function(worker) {
+  var pool = this;
+  jspb.BinaryBatchPool.onMessage_(worker, function(response) {
+    var chunk = pool.running_[response.id];
+    delete pool.running_[response.id];
+    pool.idle_.push(worker);
+    pool.complete_(chunk, response);
+    pool.dispatch_();
+  });
+  var onError = function(error) {
+    // The worker is gone, along with the chunk it was decoding.
+    var isOther = function(w) {
+      return w !== worker;
+    };
+    pool.workers_ = pool.workers_.filter(isOther);
+    pool.idle_ = pool.idle_.filter(isOther);
+    for (var id in pool.running_) {
+      var chunk = pool.running_[id];
+      if (chunk.worker === worker) {
+        delete pool.running_[id];
+        pool.fail_(chunk.batch, error);
+      }
+    }
+    if (!pool.workers_.length) {
+      // No worker is left to decode the queued chunks. Later batches are
+      // decoded on the calling thread.
+      for (var i = 0; i < pool.queue_.length; i++) {
+        pool.fail_(pool.queue_[i].batch, error);
+      }
+      pool.queue_ = [];
+    }
+  };
+  if (typeof worker.on == 'function') {
+    worker.on('error', onError);
+  } else {
+    worker.addEventListener('error', onError);
+  }
+};
+
+
+/**
+ * Stores the results of a chunk, and resolves its batch once it is complete.
+ * @param {!jspb.BinaryBatchPool.Chunk_} chunk
+ * @param {{results: (!Array<?>|undefined), error: (string|undefined)}}
+ *     response
+ * @private
+ */
+jspb.BinaryBatchPool.prototype.complete_ = function(chunk, response) {
+  var batch = chunk.batch;
+  if (batch.failed) {
+    return;
+  }
+  if (response.error !== undefined) {
+    this.fail_(batch, new Error(response.error));
+    return;
+  }
+  var results = response.results;
+  for (var i = 0; i < results.length; i++) {
+    batch.results[chunk.start + i] =
+        batch.objects ? results[i] : new batch.ctor(results[i]);
+  }
+  batch.remaining -= results.length;
+  if (batch.remaining == 0) {
+    batch.resolve(batch.results);
+  }
+};
+
+
+/**
+ * Rejects a batch, dropping its chunks that have not been sent yet.
+ * @param {!jspb.BinaryBatchPool.Batch_} batch
+ * @param {*} error
+ * @private
+ */
+jspb.BinaryBatchPool.prototype.fail_ = function(batch, error) {
+  if (!batch.failed) {
+    batch.failed = true;
+    batch.reject(error);
+  }
+};
+
+
+/**
+ * Terminates the workers of the pool.
+ * @export
+ */
+jspb.BinaryBatchPool.prototype.terminate = function() {
+  for (var i = 0; i < this.workers_.length; i++) {
+    this.workers_[i].terminate();
+  }
+  this.idle_ = [];
+};
@@ -0,0 +1,192 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Test suite is written using Jasmine -- see http://jasmine.github.io/
+goog.require('jspb.BinaryBatchPool');
+
+// CommonJS-LoadFromFile: ../protos/testbinary_pb proto.jspb.test
+goog.require('proto.jspb.test.ForeignMessage');
+goog.require('proto.jspb.test.TestAllTypes');
+
+
+/**
+ * A worker running jspb.BinaryBatchPool.serve() on the calling thread, with
+ * the asynchronous message passing of real workers.
+ */
+class FakeWorker {
+  constructor() {
+    this.listeners_ = {message: [], error: []};
+    this.dead_ = false;
+    this.port_ = {
+      listeners_: [],
+      on(event, callback) {
+        this.listeners_.push(callback);
+      },
+      postMessage: (data) => {
+        setTimeout(() => {
+          if (!this.dead_) {
+            this.emit_('message', data);
+          }
+        }, 0);
+      },
+    };
+    jspb.BinaryBatchPool.serve(
+        this.port_,
+        {'jspb.test.TestAllTypes': proto.jspb.test.TestAllTypes});
+  }
+
+  on(event, callback) {
+    this.listeners_[event].push(callback);
+  }
+
+  postMessage(data) {
+    setTimeout(() => {
+      for (const callback of this.port_.listeners_) {
+        callback(data);
+      }
+    }, 0);
+  }
+
+  emit_(event, data) {
+    for (const callback of this.listeners_[event]) {
+      callback(data);
+    }
+  }
+
+  /**
+   * Fails like a worker whose thread died, dropping its pending responses.
+   * @param {!Error} error
+   */
+  crash_(error) {
+    this.dead_ = true;
+    this.emit_('error', error);
+  }
+
+  terminate() {}
+}
+
+
+/**
+ * @param {number} count
+ * @return {!Array<!Uint8Array>}
+ */
+function createBuffers(count) {
+  const buffers = [];
+  for (let i = 0; i < count; i++) {
+    const msg = new proto.jspb.test.TestAllTypes();
+    msg.setOptionalInt32(i);
+    msg.setOptionalString('message ' + i);
+    msg.setOptionalBytes(new Uint8Array([i & 0xff, 1, 2]));
+    const child = new proto.jspb.test.ForeignMessage();
+    child.setC(-i);
+    msg.setOptionalForeignMessage(child);
+    buffers.push(msg.serializeBinary());
+  }
+  return buffers;
+}
+
+
+describe('binaryBatchTest', () => {
+  it('decodes on the calling thread without workers', async () => {
+    const messages = await proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        createBuffers(3));
+    expect(messages.length).toEqual(3);
+    expect(messages[2].getOptionalInt32()).toEqual(2);
+    expect(messages[2].getOptionalForeignMessage().getC()).toEqual(-2);
+  });
+
+  it('decodes across workers in order', async () => {
+    const pool = new jspb.BinaryBatchPool(
+        [new FakeWorker(), new FakeWorker(), new FakeWorker()]);
+    const buffers = createBuffers(100);
+    const messages = await proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        buffers, {workers: pool, chunkSize: 7});
+    expect(messages.length).toEqual(100);
+    for (let i = 0; i < 100; i++) {
+      expect(messages[i] instanceof proto.jspb.test.TestAllTypes).toBe(true);
+      expect(messages[i].getOptionalInt32()).toEqual(i);
+      expect(messages[i].getOptionalString()).toEqual('message ' + i);
+      expect(messages[i].getOptionalBytes_asU8())
+          .toEqual(new Uint8Array([i & 0xff, 1, 2]));
+      expect(messages[i].getOptionalForeignMessage().getC()).toEqual(-i);
+    }
+    // The buffers of the caller are copied, not transferred.
+    expect(buffers[0].length).toBeGreaterThan(0);
+  });
+
+  it('returns objects with the objects option', async () => {
+    const pool = new jspb.BinaryBatchPool([new FakeWorker()]);
+    const objects = await proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        createBuffers(5), {workers: pool, objects: true});
+    expect(objects[4].optionalInt32).toEqual(4);
+    expect(objects[4].optionalForeignMessage.c).toEqual(-4);
+  });
+
+  it('rejects a batch with a message that fails to decode', async () => {
+    const pool = new jspb.BinaryBatchPool([new FakeWorker(), new FakeWorker()]);
+    const buffers = createBuffers(10);
+    // A field header with an invalid wire type.
+    buffers[6] = new Uint8Array([0x0f]);
+    await expectAsync(proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+                          buffers, {workers: pool, chunkSize: 2}))
+        .toBeRejected();
+
+    // The pool keeps working.
+    const messages = await proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        createBuffers(4), {workers: pool});
+    expect(messages.length).toEqual(4);
+  });
+
+  it('rejects the batches of workers that die', async () => {
+    const first = new FakeWorker();
+    const second = new FakeWorker();
+    const pool = new jspb.BinaryBatchPool([first, second]);
+    const error = new Error('worker died');
+    const batch = proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        createBuffers(10), {workers: pool, chunkSize: 2});
+    first.crash_(error);
+    await expectAsync(batch).toBeRejectedWith(error);
+
+    // The other worker keeps decoding.
+    let messages = await proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        createBuffers(4), {workers: pool});
+    expect(messages.length).toEqual(4);
+
+    // Once no worker is left, the queued chunks fail too, and later batches
+    // are decoded on the calling thread.
+    const queued = proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        createBuffers(10), {workers: pool, chunkSize: 2});
+    second.crash_(error);
+    await expectAsync(queued).toBeRejectedWith(error);
+    messages = await proto.jspb.test.TestAllTypes.deserializeBinaryBatch(
+        createBuffers(3), {workers: pool});
+    expect(messages[2].getOptionalInt32()).toEqual(2);
+  });
+});
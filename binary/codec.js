@@ -0,0 +1,832 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @fileoverview This file contains the table-driven binary codec used by
+ * messages generated with the `codec=table` option of protoc-gen-js.
+ *
+ * Instead of an unrolled serializeBinaryToWriter() and
+ * deserializeBinaryFromReader() per message, such messages only describe their
+ * fields in a jspb.BinaryCodec.Table, and share the encode and decode loops
+ * below. Each field of the table is written by the generator as an array
+ *
+ *   [number, type, flags, index, getter, setter, extra]
+ *
+ * where:
+ *  - number is the field number,
+ *  - type is the jspb.BinaryConstants.FieldType of the field,
+ *  - flags is a combination of jspb.BinaryCodec.Flag,
+ *  - index is the index of the field in the message array,
+ *  - getter is the prototype method returning the value to serialize (getFoo,
+ *    or getFooU8 for bytes fields), or null if the raw value is read with
+ *    jspb.Message.getField() instead,
+ *  - setter is the prototype method storing a decoded value (setFoo, or
+ *    addFoo for repeated fields), or null for map fields,
+ *  - extra is the constructor of message and group fields, or for map fields
+ *    an array [keyType, keyFlags, valueType, valueFlags, keyDefault,
+ *    valueDefault], where valueDefault is the value constructor if values are
+ *    messages.
+ */
+
+goog.provide('jspb.BinaryCodec');
+
+goog.require('jspb.BinaryConstants');
+goog.require('jspb.BinaryInstrumentation');
+goog.require('jspb.BinaryReader');
+goog.require('jspb.BinaryWriter');
+goog.require('jspb.Map');
+goog.require('jspb.Message');
+
+
+/**
+ * Flags describing a field of a jspb.BinaryCodec.Table.
+ * @enum {number}
+ */
+jspb.BinaryCodec.Flag = {
+  // The field is repeated.
+  REPEATED: 1,
+  // The field is repeated and written in packed form.
+  PACKED: 2,
+  // The field is repeated and may be read in packed or unpacked form.
+  PACKABLE: 4,
+  // The field is a map; see the file comment for its extra spec.
+  MAP: 8,
+  // The field has explicit presence: it is written whenever it is set.
+  PRESENCE: 16,
+  // The field is a 64-bit integer represented as a decimal string.
+  STRING: 32,
+  // The field is packable and decoded into a typed array when packed.
+  TYPED_ARRAY: 64,
+  // The field is decoded lazily; see jspb.Message.readLazyField().
+  LAZY: 128,
+  // The field is a 64-bit integer represented as a BigInt.
+  BIGINT: 256,
+  // The field is a message field decoded into the submessages set aside by
+  // clear(); see jspb.Message.reuseWrapperField().
+  REUSE: 512
+};
+
+
+/**
+ * How a serialized value is tested for being written on the wire.
+ * @enum {number}
+ * @private
+ */
+jspb.BinaryCodec.Check_ = {
+  // Write if != null.
+  PRESENT: 0,
+  // Write if it has a non-zero length (repeated, string and bytes fields).
+  LENGTH: 1,
+  // Write if it is a non-empty jspb.Map.
+  MAP: 2,
+  // Write if !== 0.
+  NONZERO: 3,
+  // Write if it is a decimal string of a non-zero number.
+  NONZERO_STRING: 4,
+  // Write if truthy.
+  TRUE: 5
+};
+
+
+/**
+ * The field table of a message type. The table is built from its field specs
+ * (see the file comment) on first use, since the specs refer to prototype
+ * methods and constructors that are defined after the table itself.
+ *
+ * @param {function():!Array<!Array<?>>} specsFn Returns the field specs.
+ * @param {?Object<number, !jspb.ExtensionFieldBinaryInfo>=} opt_extensions
+ *     The binary extensions object of the message type, if it is extendable.
+ * @constructor
+ * @struct
+ * @final
+ * @export
+ */
+jspb.BinaryCodec.Table = function(specsFn, opt_extensions) {
+  /** @private {?function():!Array<!Array<?>>} */
+  this.specsFn_ = specsFn;
+
+  /** @const {?Object<number, !jspb.ExtensionFieldBinaryInfo>} */
+  this.extensions = opt_extensions || null;
+
+  /**
+   * The fields, in declaration order.
+   * @private {!Array<!jspb.BinaryCodec.Field_>}
+   */
+  this.fields_ = [];
+
+  /**
+   * The fields, indexed by field number.
+   * @private {!Object<number, !jspb.BinaryCodec.Field_>}
+   */
+  this.fieldsByNumber_ = {};
+
+  var table = this;
+  /**
+   * Decodes into a message with this table, for lazy fields.
+   * @const {function(?, !jspb.BinaryReader)}
+   */
+  this.decode = function(msg, reader) {
+    jspb.BinaryCodec.deserialize(msg, reader, table);
+  };
+};
+
+
+/**
+ * Builds the fields of the table if that was not done yet.
+ * @private
+ */
+jspb.BinaryCodec.Table.prototype.init_ = function() {
+  if (this.specsFn_ == null) {
+    return;
+  }
+  var specs = this.specsFn_();
+  this.specsFn_ = null;
+  for (var i = 0; i < specs.length; i++) {
+    var field = new jspb.BinaryCodec.Field_(specs[i]);
+    this.fields_.push(field);
+    this.fieldsByNumber_[field.number] = field;
+  }
+};
+
+
+/**
+ * @return {!Array<!jspb.BinaryCodec.Field_>} The fields of the table, in
+ *     declaration order.
+ */
+jspb.BinaryCodec.Table.prototype.getFields = function() {
+  this.init_();
+  return this.fields_;
+};
+
+
+/**
+ * @param {number} number
+ * @return {?jspb.BinaryCodec.Field_} The field with the given number, if any.
+ */
+jspb.BinaryCodec.Table.prototype.getField = function(number) {
+  this.init_();
+  return this.fieldsByNumber_[number] || null;
+};
+
+
+/**
+ * A field of a jspb.BinaryCodec.Table, with its reader and writer methods
+ * resolved.
+ * @param {!Array<?>} spec The field spec, see the file comment.
+ * @constructor
+ * @struct
+ * @final
+ * @private
+ */
+jspb.BinaryCodec.Field_ = function(spec) {
+  var Flag = jspb.BinaryCodec.Flag;
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var Check = jspb.BinaryCodec.Check_;
+
+  var type = /** @type {number} */ (spec[1]);
+  var flags = /** @type {number} */ (spec[2]);
+  var isMessage = !(flags & Flag.MAP) &&
+      (type == FieldType.MESSAGE || type == FieldType.GROUP);
+  var ctor = isMessage ? /** @type {?} */ (spec[6]) : null;
+
+  var read = null;
+  var readUnpacked = null;
+  var write = null;
+  var writeCallback = undefined;
+  var check = Check.PRESENT;
+  var mapKeyWriter = null;
+
+  if (flags & Flag.MAP) {
+    var mapSpec = /** @type {!Array<?>} */ (spec[6]);
+    var keyType = /** @type {number} */ (mapSpec[0]);
+    var valueType = /** @type {number} */ (mapSpec[2]);
+    check = Check.MAP;
+    read = jspb.BinaryCodec.mapEntryReader_(mapSpec);
+    mapKeyWriter = jspb.BinaryCodec.writerFor_(
+        keyType, /** @type {number} */ (mapSpec[1]));
+    write = jspb.BinaryCodec.writerFor_(
+        valueType, /** @type {number} */ (mapSpec[3]));
+    if (valueType == FieldType.MESSAGE) {
+      writeCallback = /** @type {?} */ (mapSpec[5]).serializeBinaryToWriter;
+    }
+  } else {
+    if (isMessage) {
+      read = ctor.deserializeBinaryFromReader;
+      writeCallback = ctor.serializeBinaryToWriter;
+    } else if (flags & Flag.TYPED_ARRAY) {
+      read = jspb.BinaryCodec.typedArrayReaderFor_(type);
+      readUnpacked = jspb.BinaryCodec.readerFor_(type, flags);
+    } else if (flags & Flag.PACKABLE) {
+      read = jspb.BinaryCodec.packedReaderFor_(type, flags);
+      readUnpacked = jspb.BinaryCodec.readerFor_(type, flags);
+    } else {
+      read = jspb.BinaryCodec.readerFor_(type, flags);
+    }
+
+    if (flags & Flag.PACKED) {
+      check = Check.LENGTH;
+      write = jspb.BinaryCodec.packedWriterFor_(type, flags);
+    } else if (flags & Flag.REPEATED) {
+      check = Check.LENGTH;
+      write = jspb.BinaryCodec.repeatedWriterFor_(type, flags);
+    } else {
+      write = jspb.BinaryCodec.writerFor_(type, flags);
+      if (!(flags & Flag.PRESENCE)) {
+        check = jspb.BinaryCodec.implicitPresenceCheck_(type, flags);
+      }
+    }
+  }
+
+  /** @const {number} */
+  this.number = /** @type {number} */ (spec[0]);
+  /** @const {number} */
+  this.type = type;
+  /** @const {number} */
+  this.flags = flags;
+  /** @const {number} */
+  this.index = /** @type {number} */ (spec[3]);
+  /** @const {?Function} */
+  this.getter = /** @type {?Function} */ (spec[4]);
+  /** @const {?Function} */
+  this.setter = /** @type {?Function} */ (spec[5]);
+  /**
+   * The constructor of message and group fields.
+   * @const {?function(new:jspb.Message)}
+   */
+  this.ctor = ctor;
+  /**
+   * Reads one value of the field. For message and group fields, this is the
+   * deserializeBinaryFromReader() of the field's type; for packable fields,
+   * this reads all the values of a packed field; for map fields, this reads
+   * one map entry into a jspb.Map.
+   * @const {?Function}
+   */
+  this.read = read;
+  /**
+   * Reads one value of a packable field written in unpacked form.
+   * @const {?Function}
+   */
+  this.readUnpacked = readUnpacked;
+  /**
+   * Writes the field, or for map fields, a map value.
+   * @const {?Function}
+   */
+  this.write = write;
+  /**
+   * The serializeBinaryToWriter() of message and group fields, or of maps
+   * with message values.
+   * @const {function(?,!jspb.BinaryWriter)|undefined}
+   */
+  this.writeCallback = writeCallback;
+  /**
+   * Writes a map key.
+   * @const {?Function}
+   */
+  this.mapKeyWriter = mapKeyWriter;
+  /** @const {!jspb.BinaryCodec.Check_} */
+  this.check = check;
+};
+
+
+/**
+ * Returns how a field without explicit presence is tested for being non-default
+ * (and thus written on the wire).
+ * @param {number} type
+ * @param {number} flags The jspb.BinaryCodec.Flag of the field.
+ * @return {!jspb.BinaryCodec.Check_}
+ * @private
+ */
+jspb.BinaryCodec.implicitPresenceCheck_ = function(type, flags) {
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var Check = jspb.BinaryCodec.Check_;
+  switch (type) {
+    case FieldType.BOOL:
+      return Check.TRUE;
+    case FieldType.STRING:
+    case FieldType.BYTES:
+      return Check.LENGTH;
+    default:
+      if (flags & jspb.BinaryCodec.Flag.STRING) {
+        return Check.NONZERO_STRING;
+      }
+      // 0n is the only falsy BigInt.
+      return (flags & jspb.BinaryCodec.Flag.BIGINT) ? Check.TRUE :
+                                                      Check.NONZERO;
+  }
+};
+
+
+/**
+ * Returns the function reading one map entry into a jspb.Map, for the given
+ * map spec.
+ * @param {!Array<?>} mapSpec
+ * @return {function(!jspb.Map, !jspb.BinaryReader)}
+ * @private
+ */
+jspb.BinaryCodec.mapEntryReader_ = function(mapSpec) {
+  var keyReader = jspb.BinaryCodec.readerFor_(
+      /** @type {number} */ (mapSpec[0]), /** @type {number} */ (mapSpec[1]));
+  var keyDefault = mapSpec[4];
+  if (mapSpec[2] == jspb.BinaryConstants.FieldType.MESSAGE) {
+    var valueCtor = /** @type {?} */ (mapSpec[5]);
+    var valueReaderCallback = valueCtor.deserializeBinaryFromReader;
+    return function(map, reader) {
+      jspb.Map.deserializeBinary(
+          map, reader, keyReader, jspb.BinaryReader.prototype.readMessage,
+          valueReaderCallback, keyDefault);
+    };
+  }
+  var valueReader = jspb.BinaryCodec.readerFor_(
+      /** @type {number} */ (mapSpec[2]), /** @type {number} */ (mapSpec[3]));
+  var valueDefault = mapSpec[5];
+  return function(map, reader) {
+    jspb.Map.deserializeBinary(
+        map, reader, keyReader, valueReader, null, keyDefault, valueDefault);
+  };
+};
+
+
+/**
+ * Returns the Number, decimal string or BigInt variant of a 64-bit integer
+ * reader or writer method, depending on the STRING and BIGINT flags.
+ * @param {number} flags The jspb.BinaryCodec.Flag of the field.
+ * @param {!Function} numberFn
+ * @param {!Function} stringFn
+ * @param {!Function} bigIntFn
+ * @return {!Function}
+ * @private
+ */
+jspb.BinaryCodec.select64_ = function(flags, numberFn, stringFn, bigIntFn) {
+  if (flags & jspb.BinaryCodec.Flag.STRING) return stringFn;
+  if (flags & jspb.BinaryCodec.Flag.BIGINT) return bigIntFn;
+  return numberFn;
+};
+
+
+/**
+ * Returns the BinaryReader method reading one value of the given type.
+ * @param {number} type
+ * @param {number} flags The jspb.BinaryCodec.Flag of the field.
+ * @return {!Function}
+ * @private
+ */
+jspb.BinaryCodec.readerFor_ = function(type, flags) {
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var select64 = jspb.BinaryCodec.select64_;
+  var proto = jspb.BinaryReader.prototype;
+  switch (type) {
+    case FieldType.DOUBLE:
+      return proto.readDouble;
+    case FieldType.FLOAT:
+      return proto.readFloat;
+    case FieldType.INT64:
+      return select64(flags, proto.readInt64, proto.readInt64String,
+                      proto.readInt64BigInt);
+    case FieldType.UINT64:
+      return select64(flags, proto.readUint64, proto.readUint64String,
+                      proto.readUint64BigInt);
+    case FieldType.INT32:
+      return proto.readInt32;
+    case FieldType.FIXED64:
+      return select64(flags, proto.readFixed64, proto.readFixed64String,
+                      proto.readFixed64BigInt);
+    case FieldType.FIXED32:
+      return proto.readFixed32;
+    case FieldType.BOOL:
+      return proto.readBool;
+    case FieldType.STRING:
+      return proto.readString;
+    case FieldType.BYTES:
+      return proto.readBytes;
+    case FieldType.UINT32:
+      return proto.readUint32;
+    case FieldType.ENUM:
+      return proto.readEnum;
+    case FieldType.SFIXED32:
+      return proto.readSfixed32;
+    case FieldType.SFIXED64:
+      return select64(flags, proto.readSfixed64, proto.readSfixed64String,
+                      proto.readSfixed64BigInt);
+    case FieldType.SINT32:
+      return proto.readSint32;
+    case FieldType.SINT64:
+      return select64(flags, proto.readSint64, proto.readSint64String,
+                      proto.readSint64BigInt);
+  }
+  throw new Error('Unexpected field type: ' + type);
+};
+
+/**
+ * Returns the BinaryReader method reading packed values of the given type.
+ * @param {number} type
+ * @param {number} flags The jspb.BinaryCodec.Flag of the field.
+ * @return {!Function}
+ * @private
+ */
+jspb.BinaryCodec.packedReaderFor_ = function(type, flags) {
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var select64 = jspb.BinaryCodec.select64_;
+  var proto = jspb.BinaryReader.prototype;
+  switch (type) {
+    case FieldType.DOUBLE:
+      return proto.readPackedDouble;
+    case FieldType.FLOAT:
+      return proto.readPackedFloat;
+    case FieldType.INT64:
+      return select64(flags, proto.readPackedInt64, proto.readPackedInt64String,
+                      proto.readPackedInt64BigInt);
+    case FieldType.UINT64:
+      return select64(flags, proto.readPackedUint64,
+                      proto.readPackedUint64String,
+                      proto.readPackedUint64BigInt);
+    case FieldType.INT32:
+      return proto.readPackedInt32;
+    case FieldType.FIXED64:
+      return select64(flags, proto.readPackedFixed64,
+                      proto.readPackedFixed64String,
+                      proto.readPackedFixed64BigInt);
+    case FieldType.FIXED32:
+      return proto.readPackedFixed32;
+    case FieldType.BOOL:
+      return proto.readPackedBool;
+    case FieldType.UINT32:
+      return proto.readPackedUint32;
+    case FieldType.ENUM:
+      return proto.readPackedEnum;
+    case FieldType.SFIXED32:
+      return proto.readPackedSfixed32;
+    case FieldType.SFIXED64:
+      return select64(flags, proto.readPackedSfixed64,
+                      proto.readPackedSfixed64String,
+                      proto.readPackedSfixed64BigInt);
+    case FieldType.SINT32:
+      return proto.readPackedSint32;
+    case FieldType.SINT64:
+      return select64(flags, proto.readPackedSint64,
+                      proto.readPackedSint64String,
+                      proto.readPackedSint64BigInt);
+  }
+  throw new Error('Unexpected field type: ' + type);
+};
+
+/**
+ * Returns the BinaryReader method reading packed values of the given type into
+ * a typed array.
+ * @param {number} type
+ * @return {!Function}
+ * @private
+ */
+jspb.BinaryCodec.typedArrayReaderFor_ = function(type) {
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var proto = jspb.BinaryReader.prototype;
+  switch (type) {
+    case FieldType.DOUBLE:
+      return proto.readPackedDoubleTypedArray;
+    case FieldType.FLOAT:
+      return proto.readPackedFloatTypedArray;
+    case FieldType.INT32:
+      return proto.readPackedInt32TypedArray;
+    case FieldType.FIXED32:
+      return proto.readPackedFixed32TypedArray;
+    case FieldType.UINT32:
+      return proto.readPackedUint32TypedArray;
+    case FieldType.SFIXED32:
+      return proto.readPackedSfixed32TypedArray;
+    case FieldType.SINT32:
+      return proto.readPackedSint32TypedArray;
+  }
+  throw new Error('Unexpected field type: ' + type);
+};
+
+
+/**
+ * Returns the BinaryWriter method writing one value of the given type.
+ * @param {number} type
+ * @param {number} flags The jspb.BinaryCodec.Flag of the field.
+ * @return {!Function}
+ * @private
+ */
+jspb.BinaryCodec.writerFor_ = function(type, flags) {
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var select64 = jspb.BinaryCodec.select64_;
+  var proto = jspb.BinaryWriter.prototype;
+  switch (type) {
+    case FieldType.DOUBLE:
+      return proto.writeDouble;
+    case FieldType.FLOAT:
+      return proto.writeFloat;
+    case FieldType.INT64:
+      return select64(flags, proto.writeInt64, proto.writeInt64String,
+                      proto.writeInt64BigInt);
+    case FieldType.UINT64:
+      return select64(flags, proto.writeUint64, proto.writeUint64String,
+                      proto.writeUint64BigInt);
+    case FieldType.INT32:
+      return proto.writeInt32;
+    case FieldType.FIXED64:
+      return select64(flags, proto.writeFixed64, proto.writeFixed64String,
+                      proto.writeFixed64BigInt);
+    case FieldType.FIXED32:
+      return proto.writeFixed32;
+    case FieldType.BOOL:
+      return proto.writeBool;
+    case FieldType.STRING:
+      return proto.writeString;
+    case FieldType.GROUP:
+      return proto.writeGroup;
+    case FieldType.MESSAGE:
+      return proto.writeMessage;
+    case FieldType.BYTES:
+      return proto.writeBytes;
+    case FieldType.UINT32:
+      return proto.writeUint32;
+    case FieldType.ENUM:
+      return proto.writeEnum;
+    case FieldType.SFIXED32:
+      return proto.writeSfixed32;
+    case FieldType.SFIXED64:
+      return select64(flags, proto.writeSfixed64, proto.writeSfixed64String,
+                      proto.writeSfixed64BigInt);
+    case FieldType.SINT32:
+      return proto.writeSint32;
+    case FieldType.SINT64:
+      return select64(flags, proto.writeSint64, proto.writeSint64String,
+                      proto.writeSint64BigInt);
+  }
+  throw new Error('Unexpected field type: ' + type);
+};
+
+/**
+ * Returns the BinaryWriter method writing repeated values of the given type.
+ * @param {number} type
+ * @param {number} flags The jspb.BinaryCodec.Flag of the field.
+ * @return {!Function}
+ * @private
+ */
+jspb.BinaryCodec.repeatedWriterFor_ = function(type, flags) {
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var select64 = jspb.BinaryCodec.select64_;
+  var proto = jspb.BinaryWriter.prototype;
+  switch (type) {
+    case FieldType.DOUBLE:
+      return proto.writeRepeatedDouble;
+    case FieldType.FLOAT:
+      return proto.writeRepeatedFloat;
+    case FieldType.INT64:
+      return select64(flags, proto.writeRepeatedInt64,
+                      proto.writeRepeatedInt64String,
+                      proto.writeRepeatedInt64BigInt);
+    case FieldType.UINT64:
+      return select64(flags, proto.writeRepeatedUint64,
+                      proto.writeRepeatedUint64String,
+                      proto.writeRepeatedUint64BigInt);
+    case FieldType.INT32:
+      return proto.writeRepeatedInt32;
+    case FieldType.FIXED64:
+      return select64(flags, proto.writeRepeatedFixed64,
+                      proto.writeRepeatedFixed64String,
+                      proto.writeRepeatedFixed64BigInt);
+    case FieldType.FIXED32:
+      return proto.writeRepeatedFixed32;
+    case FieldType.BOOL:
+      return proto.writeRepeatedBool;
+    case FieldType.STRING:
+      return proto.writeRepeatedString;
+    case FieldType.GROUP:
+      return proto.writeRepeatedGroup;
+    case FieldType.MESSAGE:
+      return proto.writeRepeatedMessage;
+    case FieldType.BYTES:
+      return proto.writeRepeatedBytes;
+    case FieldType.UINT32:
+      return proto.writeRepeatedUint32;
+    case FieldType.ENUM:
+      return proto.writeRepeatedEnum;
+    case FieldType.SFIXED32:
+      return proto.writeRepeatedSfixed32;
+    case FieldType.SFIXED64:
+      return select64(flags, proto.writeRepeatedSfixed64,
+                      proto.writeRepeatedSfixed64String,
+                      proto.writeRepeatedSfixed64BigInt);
+    case FieldType.SINT32:
+      return proto.writeRepeatedSint32;
+    case FieldType.SINT64:
+      return select64(flags, proto.writeRepeatedSint64,
+                      proto.writeRepeatedSint64String,
+                      proto.writeRepeatedSint64BigInt);
+  }
+  throw new Error('Unexpected field type: ' + type);
+};
+
+/**
+ * Returns the BinaryWriter method writing packed values of the given type.
+ * @param {number} type
+ * @param {number} flags The jspb.BinaryCodec.Flag of the field.
+ * @return {!Function}
+ * @private
+ */
+jspb.BinaryCodec.packedWriterFor_ = function(type, flags) {
+  var FieldType = jspb.BinaryConstants.FieldType;
+  var select64 = jspb.BinaryCodec.select64_;
+  var proto = jspb.BinaryWriter.prototype;
+  switch (type) {
+    case FieldType.DOUBLE:
+      return proto.writePackedDouble;
+    case FieldType.FLOAT:
+      return proto.writePackedFloat;
+    case FieldType.INT64:
+      return select64(flags, proto.writePackedInt64,
+                      proto.writePackedInt64String,
+                      proto.writePackedInt64BigInt);
+    case FieldType.UINT64:
+      return select64(flags, proto.writePackedUint64,
+                      proto.writePackedUint64String,
+                      proto.writePackedUint64BigInt);
+    case FieldType.INT32:
+      return proto.writePackedInt32;
+    case FieldType.FIXED64:
+      return select64(flags, proto.writePackedFixed64,
+                      proto.writePackedFixed64String,
+                      proto.writePackedFixed64BigInt);
+    case FieldType.FIXED32:
+      return proto.writePackedFixed32;
+    case FieldType.BOOL:
+      return proto.writePackedBool;
+    case FieldType.UINT32:
+      return proto.writePackedUint32;
+    case FieldType.ENUM:
+      return proto.writePackedEnum;
+    case FieldType.SFIXED32:
+      return proto.writePackedSfixed32;
+    case FieldType.SFIXED64:
+      return select64(flags, proto.writePackedSfixed64,
+                      proto.writePackedSfixed64String,
+                      proto.writePackedSfixed64BigInt);
+    case FieldType.SINT32:
+      return proto.writePackedSint32;
+    case FieldType.SINT64:
+      return select64(flags, proto.writePackedSint64,
+                      proto.writePackedSint64String,
+                      proto.writePackedSint64BigInt);
+  }
+  throw new Error('Unexpected field type: ' + type);
+};
+
+
+/**
+ * Deserializes binary data from the given reader into the given message, as
+ * described by the message's field table.
+ * @param {!T} msg The message object to deserialize into.
+ * @param {!jspb.BinaryReader} reader The BinaryReader to use.
+ * @param {!jspb.BinaryCodec.Table} table The field table of the message.
+ * @param {!jspb.BinaryProjection=} opt_projection If set, only the fields it
+ *     selects are decoded, and the others are skipped.
+ * @return {!T}
+ * @template T
+ * @export
+ */
+jspb.BinaryCodec.deserialize = function(msg, reader, table, opt_projection) {
+  var Flag = jspb.BinaryCodec.Flag;
+  var message = /** @type {?} */ (msg);
+  while (reader.nextField()) {
+    if (reader.isEndGroup()) {
+      break;
+    }
+    if (opt_projection && !opt_projection.has(reader.getFieldNumber())) {
+      reader.skipField();
+      continue;
+    }
+    var field = table.getField(reader.getFieldNumber());
+    if (field == null) {
+      if (table.extensions) {
+        jspb.Message.readBinaryExtension(
+            message, reader, table.extensions, message.getExtension,
+            message.setExtension);
+      } else {
+        if (jspb.BinaryInstrumentation.ENABLED) {
+          jspb.BinaryInstrumentation.countUnknownField();
+        }
+        reader.skipField();
+      }
+      continue;
+    }
+
+    var flags = field.flags;
+    if ((flags & Flag.LAZY) &&
+        jspb.Message.readLazyField(
+            message, reader, table.decode, (flags & Flag.REPEATED) != 0)) {
+      continue;
+    }
+    var value;
+    if (flags & Flag.MAP) {
+      reader.readMessage(field.getter.call(message), field.read);
+      continue;
+    } else if (field.ctor) {
+      value = (flags & Flag.REUSE) ?
+          jspb.Message.reuseWrapperField(message, field.index, field.ctor) :
+          new field.ctor();
+      var child = opt_projection && opt_projection.child(field.number);
+      if (field.type == jspb.BinaryConstants.FieldType.GROUP) {
+        reader.readGroup(field.number, value, field.read, child);
+      } else {
+        reader.readMessage(value, field.read, child);
+      }
+    } else if (flags & Flag.PACKABLE) {
+      if (reader.isDelimited()) {
+        jspb.Message.addAllToRepeatedField(
+            message, field.index, field.read.call(reader));
+        continue;
+      }
+      value = field.readUnpacked.call(reader);
+    } else {
+      value = field.read.call(reader);
+    }
+    field.setter.call(message, value);
+  }
+  return msg;
+};
+
+
+/**
+ * Serializes the given message to binary data (in protobuf wire format),
+ * writing to the given BinaryWriter, as described by the message's field table.
+ * @param {!jspb.Message} msg
+ * @param {!jspb.BinaryWriter} writer
+ * @param {!jspb.BinaryCodec.Table} table The field table of the message.
+ * @export
+ */
+jspb.BinaryCodec.serialize = function(msg, writer, table) {
+  var Check = jspb.BinaryCodec.Check_;
+  var message = /** @type {?} */ (msg);
+  var fields = table.getFields();
+  for (var i = 0; i < fields.length; i++) {
+    var field = fields[i];
+    if ((field.flags & jspb.BinaryCodec.Flag.LAZY) &&
+        jspb.Message.serializeLazyField(message, field.number, writer)) {
+      continue;
+    }
+    var f;
+    if (field.check == Check.MAP) {
+      // No lazy creation for maps containers -- fastpath the empty case.
+      f = field.getter.call(message, true);
+      if (f && f.getLength() > 0) {
+        f.serializeBinary(
+            field.number, writer, field.mapKeyWriter, field.write,
+            field.writeCallback);
+      }
+      continue;
+    }
+
+    f = field.getter ? field.getter.call(message) :
+                       jspb.Message.getField(message, field.index);
+    switch (field.check) {
+      case Check.PRESENT:
+        if (f == null) continue;
+        break;
+      case Check.LENGTH:
+        if (!(f.length > 0)) continue;
+        break;
+      case Check.NONZERO:
+        if (f === 0) continue;
+        break;
+      case Check.NONZERO_STRING:
+        if (parseInt(f, 10) === 0) continue;
+        break;
+      case Check.TRUE:
+        if (!f) continue;
+        break;
+    }
+    field.write.call(writer, field.number, f, field.writeCallback);
+  }
+  if (table.extensions) {
+    jspb.Message.serializeBinaryExtensions(
+        message, writer, table.extensions, message.getExtension);
+  }
+};
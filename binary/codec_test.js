@@ -0,0 +1,310 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Test suite is written using Jasmine -- see http://jasmine.github.io/
+
+goog.require('jspb.BinaryCodec');
+goog.require('jspb.BinaryConstants');
+goog.require('jspb.BinaryReader');
+goog.require('jspb.BinaryWriter');
+
+// CommonJS-LoadFromFile: ../protos/testbinary_pb proto.jspb.test
+goog.require('proto.jspb.test.ForeignMessage');
+goog.require('proto.jspb.test.MapValueMessage');
+goog.require('proto.jspb.test.TestAllTypes');
+goog.require('proto.jspb.test.TestMapFields');
+
+// CommonJS-LoadFromFile: ../protos/proto3_test_pb proto.jspb.test
+goog.require('proto.jspb.test.TestProto3');
+
+
+/**
+ * Returns a field table for a part of TestAllTypes, written the way
+ * protoc-gen-js writes it with codec=table.
+ * @return {!jspb.BinaryCodec.Table}
+ */
+function createTestAllTypesTable() {
+  const Flag = jspb.BinaryCodec.Flag;
+  const FieldType = jspb.BinaryConstants.FieldType;
+  const prototype = proto.jspb.test.TestAllTypes.prototype;
+  return new jspb.BinaryCodec.Table(() => [
+    [1, FieldType.INT32, Flag.PRESENCE, 1, null, prototype.setOptionalInt32],
+    [2, FieldType.INT64, Flag.PRESENCE, 2, null, prototype.setOptionalInt64],
+    [
+      14, FieldType.STRING, Flag.PRESENCE, 14, null,
+      prototype.setOptionalString
+    ],
+    [15, FieldType.BYTES, Flag.PRESENCE, 15, null, prototype.setOptionalBytes],
+    [
+      16, FieldType.GROUP, Flag.PRESENCE, 16, prototype.getOptionalGroup,
+      prototype.setOptionalGroup, proto.jspb.test.TestAllTypes.OptionalGroup
+    ],
+    [
+      19, FieldType.MESSAGE, Flag.PRESENCE, 19,
+      prototype.getOptionalForeignMessage,
+      prototype.setOptionalForeignMessage, proto.jspb.test.ForeignMessage
+    ],
+    [
+      31, FieldType.INT32, Flag.REPEATED | Flag.PACKABLE, 31,
+      prototype.getRepeatedInt32List, prototype.addRepeatedInt32
+    ],
+    [
+      44, FieldType.STRING, Flag.REPEATED, 44, prototype.getRepeatedStringList,
+      prototype.addRepeatedString
+    ],
+    [
+      49, FieldType.MESSAGE, Flag.REPEATED, 49,
+      prototype.getRepeatedForeignMessageList,
+      prototype.addRepeatedForeignMessage,
+      proto.jspb.test.ForeignMessage
+    ],
+    [
+      62, FieldType.INT64, Flag.REPEATED | Flag.PACKED | Flag.PACKABLE, 62,
+      prototype.getPackedRepeatedInt64List, prototype.addPackedRepeatedInt64
+    ],
+    [
+      73, FieldType.BOOL, Flag.REPEATED | Flag.PACKED | Flag.PACKABLE, 73,
+      prototype.getPackedRepeatedBoolList, prototype.addPackedRepeatedBool
+    ],
+    [114, FieldType.BYTES, Flag.PRESENCE, 114, null, prototype.setOneofBytes]
+  ]);
+}
+
+
+/**
+ * @param {!jspb.Message} msg
+ * @param {!jspb.BinaryCodec.Table} table
+ * @return {!Uint8Array} msg serialized with jspb.BinaryCodec.
+ */
+function serializeWithTable(msg, table) {
+  const writer = new jspb.BinaryWriter();
+  jspb.BinaryCodec.serialize(msg, writer, table);
+  return writer.getResultBuffer();
+}
+
+
+describe('binaryCodecTest', () => {
+  it('testSerializeMatchesGeneratedCode', () => {
+    const msg = new proto.jspb.test.TestAllTypes();
+    msg.setOptionalInt32(-42);
+    msg.setOptionalInt64(0x123456789);
+    msg.setOptionalString('hello');
+    msg.setOptionalBytes(new Uint8Array([1, 2, 3]));
+    msg.setOptionalGroup(new proto.jspb.test.TestAllTypes.OptionalGroup());
+    msg.getOptionalGroup().setA(100);
+    msg.setOptionalForeignMessage(new proto.jspb.test.ForeignMessage());
+    msg.getOptionalForeignMessage().setC(16);
+    msg.setRepeatedInt32List([-1, 0, 1]);
+    msg.setRepeatedStringList(['a', '', 'b']);
+    msg.addRepeatedForeignMessage(new proto.jspb.test.ForeignMessage());
+    msg.addRepeatedForeignMessage(new proto.jspb.test.ForeignMessage());
+    msg.getRepeatedForeignMessageList()[1].setC(2);
+    msg.setPackedRepeatedInt64List([-0x123456789, 0, 1]);
+    msg.setPackedRepeatedBoolList([true, false, true]);
+    msg.setOneofBytes(new Uint8Array([4, 5]));
+
+    const table = createTestAllTypesTable();
+    expect(serializeWithTable(msg, table)).toEqual(msg.serializeBinary());
+  });
+
+  it('testDeserializeRoundTrip', () => {
+    const msg = new proto.jspb.test.TestAllTypes();
+    msg.setOptionalInt32(7);
+    msg.setOptionalString('');
+    msg.setOptionalGroup(new proto.jspb.test.TestAllTypes.OptionalGroup());
+    msg.getOptionalGroup().setA(-3);
+    msg.setRepeatedInt32List([3, 2, 1]);
+    msg.addRepeatedForeignMessage(new proto.jspb.test.ForeignMessage());
+    msg.setPackedRepeatedBoolList([false, true]);
+
+    const table = createTestAllTypesTable();
+    const decoded = jspb.BinaryCodec.deserialize(
+        new proto.jspb.test.TestAllTypes(),
+        new jspb.BinaryReader(msg.serializeBinary()), table);
+    expect(decoded.toObject()).toEqual(msg.toObject());
+    expect(serializeWithTable(decoded, table)).toEqual(msg.serializeBinary());
+  });
+
+  it('testPackableFieldsAcceptBothForms', () => {
+    const writer = new jspb.BinaryWriter();
+    writer.writePackedInt32(31, [1, 2]);
+    writer.writeRepeatedInt32(31, [3]);
+    writer.writeRepeatedInt64(62, [4, 5]);
+    writer.writePackedInt64(62, [6]);
+
+    const decoded = jspb.BinaryCodec.deserialize(
+        new proto.jspb.test.TestAllTypes(),
+        new jspb.BinaryReader(writer.getResultBuffer()),
+        createTestAllTypesTable());
+    expect(decoded.getRepeatedInt32List()).toEqual([1, 2, 3]);
+    expect(decoded.getPackedRepeatedInt64List()).toEqual([4, 5, 6]);
+  });
+
+  it('testUnknownFieldsAreSkipped', () => {
+    const msg = new proto.jspb.test.TestAllTypes();
+    msg.setOptionalInt32(1);
+    msg.setOptionalUint32(2);
+    msg.setOptionalDouble(3.5);
+    msg.setOptionalString('four');
+
+    const decoded = jspb.BinaryCodec.deserialize(
+        new proto.jspb.test.TestAllTypes(),
+        new jspb.BinaryReader(msg.serializeBinary()),
+        createTestAllTypesTable());
+    expect(decoded.getOptionalInt32()).toEqual(1);
+    expect(decoded.hasOptionalUint32()).toBe(false);
+    expect(decoded.hasOptionalDouble()).toBe(false);
+    expect(decoded.getOptionalString()).toEqual('four');
+  });
+
+  it('testImplicitPresence', () => {
+    const FieldType = jspb.BinaryConstants.FieldType;
+    const prototype = proto.jspb.test.TestProto3.prototype;
+    const table = new jspb.BinaryCodec.Table(() => [
+      [
+        1, FieldType.INT32, 0, 1, prototype.getSingularInt32,
+        prototype.setSingularInt32
+      ],
+      [
+        2, FieldType.INT64, jspb.BinaryCodec.Flag.STRING, 2,
+        prototype.getSingularInt64, prototype.setSingularInt64
+      ],
+      [
+        11, FieldType.FLOAT, 0, 11, prototype.getSingularFloat,
+        prototype.setSingularFloat
+      ],
+      [
+        13, FieldType.BOOL, 0, 13, prototype.getSingularBool,
+        prototype.setSingularBool
+      ],
+      [
+        14, FieldType.STRING, 0, 14, prototype.getSingularString,
+        prototype.setSingularString
+      ],
+      [
+        15, FieldType.BYTES, 0, 15, prototype.getSingularBytes_asU8,
+        prototype.setSingularBytes
+      ]
+    ]);
+
+    const msg = new proto.jspb.test.TestProto3();
+    expect(serializeWithTable(msg, table).length).toEqual(0);
+
+    msg.setSingularInt32(-1);
+    msg.setSingularFloat(0.5);
+    msg.setSingularBool(true);
+    msg.setSingularString('x');
+    msg.setSingularBytes(new Uint8Array([0]));
+    expect(serializeWithTable(msg, table)).toEqual(msg.serializeBinary());
+  });
+
+  it('testMapFields', () => {
+    const Flag = jspb.BinaryCodec.Flag;
+    const FieldType = jspb.BinaryConstants.FieldType;
+    const prototype = proto.jspb.test.TestMapFields.prototype;
+    const table = new jspb.BinaryCodec.Table(() => [
+      [
+        2, FieldType.MESSAGE, Flag.MAP, 2, prototype.getMapStringInt32Map, null,
+        [FieldType.STRING, 0, FieldType.INT32, 0, '', 0]
+      ],
+      [
+        7, FieldType.MESSAGE, Flag.MAP, 7, prototype.getMapStringMsgMap, null, [
+          FieldType.STRING, 0, FieldType.MESSAGE, 0, '',
+          proto.jspb.test.MapValueMessage
+        ]
+      ],
+      [
+        9, FieldType.MESSAGE, Flag.MAP, 9, prototype.getMapInt64StringMap, null,
+        [FieldType.INT64, 0, FieldType.STRING, 0, 0, '']
+      ]
+    ]);
+
+    const msg = new proto.jspb.test.TestMapFields();
+    msg.getMapStringInt32Map().set('a', 1).set('b', -2);
+    msg.getMapStringMsgMap().set('c', new proto.jspb.test.MapValueMessage());
+    msg.getMapStringMsgMap().get('c').setFoo(3);
+    msg.getMapInt64StringMap().set(0x123456789, 'd');
+
+    const encoded = serializeWithTable(msg, table);
+    expect(encoded).toEqual(msg.serializeBinary());
+
+    const decoded = jspb.BinaryCodec.deserialize(
+        new proto.jspb.test.TestMapFields(), new jspb.BinaryReader(encoded),
+        table);
+    expect(decoded.toObject()).toEqual(msg.toObject());
+  });
+
+  it('testLazyFields', () => {
+    const Flag = jspb.BinaryCodec.Flag;
+    const FieldType = jspb.BinaryConstants.FieldType;
+    const prototype = proto.jspb.test.TestAllTypes.prototype;
+    const table = new jspb.BinaryCodec.Table(() => [
+      [
+        19, FieldType.MESSAGE, Flag.PRESENCE | Flag.LAZY, 19,
+        prototype.getOptionalForeignMessage,
+        prototype.setOptionalForeignMessage, proto.jspb.test.ForeignMessage
+      ],
+      [
+        62, FieldType.INT64,
+        Flag.REPEATED | Flag.PACKED | Flag.PACKABLE | Flag.LAZY, 62,
+        prototype.getPackedRepeatedInt64List, prototype.addPackedRepeatedInt64
+      ]
+    ]);
+    // Field 19 holds {c: 16} and an unknown field, field 62 holds [0, 1] with
+    // an overlong encoding of 0. Both only survive re-serialization if the
+    // fields were never decoded.
+    const encoded = new Uint8Array([
+      0x9a, 0x01, 0x04, 0x08, 0x10, 0x28, 0x07,  // field 19
+      0xf2, 0x03, 0x03, 0x80, 0x00, 0x01         // field 62
+    ]);
+
+    const decoded = jspb.BinaryCodec.deserialize(
+        new proto.jspb.test.TestAllTypes(), new jspb.BinaryReader(encoded),
+        table);
+    expect(serializeWithTable(decoded, table)).toEqual(encoded);
+
+    expect(decoded.getOptionalForeignMessage().getC()).toEqual(16);
+    expect(decoded.getPackedRepeatedInt64List()).toEqual([0, 1]);
+    expect(serializeWithTable(decoded, table)).toEqual(new Uint8Array([
+      0x9a, 0x01, 0x02, 0x08, 0x10,  // field 19
+      0xf2, 0x03, 0x02, 0x00, 0x01   // field 62
+    ]));
+
+    const replaced = jspb.BinaryCodec.deserialize(
+        new proto.jspb.test.TestAllTypes(), new jspb.BinaryReader(encoded),
+        table);
+    replaced.setPackedRepeatedInt64List([5]);
+    expect(replaced.toObject().optionalForeignMessage).toEqual({c: 16});
+    expect(serializeWithTable(replaced, table)).toEqual(new Uint8Array([
+      0x9a, 0x01, 0x02, 0x08, 0x10,  // field 19
+      0xf2, 0x03, 0x01, 0x05         // field 62
+    ]));
+  });
+});
@@ -505,6 +505,36 @@ jspb.BinaryDecoder.prototype.readUnsignedVarint32 = function() {
 };
 
 
+/**
+ * Reads an unsigned varint from the binary stream if it has the given value,
+ * which must be below 2^14, i.e. encoded in at most two bytes. Otherwise the
+ * cursor is left as is. This lets callers test for an expected field header
+ * without decoding it.
+ *
+ * @param {number} value The expected value.
+ * @return {boolean} Whether the varint was read.
+ * @export
+ */
+jspb.BinaryDecoder.prototype.readUnsignedVarint32If = function(value) {
+  jspb.asserts.assert(value >= 0 && value < 16384);
+  var bytes = this.bytes_;
+  var cursor = this.cursor_;
+  if (value < 128) {
+    if (cursor < this.end_ && bytes[cursor] === value) {
+      this.cursor_ = cursor + 1;
+      return true;
+    }
+    return false;
+  }
+  if (cursor + 1 < this.end_ && bytes[cursor] === ((value & 0x7F) | 0x80) &&
+      bytes[cursor + 1] === (value >>> 7)) {
+    this.cursor_ = cursor + 2;
+    return true;
+  }
+  return false;
+};
+
+
 /**
  * Coerces the output of readUnsignedVarint32 to an int32.
  *
@@ -670,6 +700,61 @@ jspb.BinaryDecoder.prototype.readZigzagVarint64String = function() {
 };
 
 
+/**
+ * Reads an unsigned 64-bit varint from the binary stream and returns the value
+ * as a BigInt, without loss of precision. Single-byte varints are converted
+ * directly.
+ *
+ * @return {bigint} The decoded unsigned varint as a BigInt.
+ * @export
+ */
+jspb.BinaryDecoder.prototype.readUnsignedVarint64BigInt = function() {
+  var temp = this.bytes_[this.cursor_];
+  if (temp < 128) {
+    this.cursor_++;
+    return BigInt(temp);
+  }
+  return this.readSplitVarint64(jspb.utils.joinUint64BigInt);
+};
+
+
+/**
+ * Reads a signed 64-bit varint from the binary stream and returns the value as
+ * a BigInt, without loss of precision. Single-byte varints are converted
+ * directly.
+ *
+ * @return {bigint} The decoded signed varint as a BigInt.
+ * @export
+ */
+jspb.BinaryDecoder.prototype.readSignedVarint64BigInt = function() {
+  var temp = this.bytes_[this.cursor_];
+  if (temp < 128) {
+    this.cursor_++;
+    return BigInt(temp);
+  }
+  return this.readSplitVarint64(jspb.utils.joinInt64BigInt);
+};
+
+
+/**
+ * Reads a signed, zigzag-encoded 64-bit varint from the binary stream and
+ * returns its value as a BigInt, without loss of precision. Single-byte
+ * varints are converted directly.
+ *
+ * @return {bigint} The decoded signed, zigzag-encoded 64-bit varint as a
+ *     BigInt.
+ * @export
+ */
+jspb.BinaryDecoder.prototype.readZigzagVarint64BigInt = function() {
+  var temp = this.bytes_[this.cursor_];
+  if (temp < 128) {
+    this.cursor_++;
+    return BigInt((temp >>> 1) ^ -(temp & 1));
+  }
+  return this.readSplitZigzagVarint64(jspb.utils.joinInt64BigInt);
+};
+
+
 /**
  * Reads a raw unsigned 8-bit integer from the binary stream.
  *
@@ -747,6 +832,20 @@ jspb.BinaryDecoder.prototype.readUint64String = function() {
 };
 
 
+/**
+ * Reads a raw unsigned 64-bit integer from the binary stream and returns it as
+ * a BigInt, without loss of precision.
+ *
+ * @return {bigint} The unsigned 64-bit integer read from the binary stream.
+ * @export
+ */
+jspb.BinaryDecoder.prototype.readUint64BigInt = function() {
+  var bitsLow = this.readUint32();
+  var bitsHigh = this.readUint32();
+  return jspb.utils.joinUint64BigInt(bitsLow, bitsHigh);
+};
+
+
 /**
  * Reads a raw signed 8-bit integer from the binary stream.
  *
@@ -824,6 +923,20 @@ jspb.BinaryDecoder.prototype.readInt64String = function() {
 };
 
 
+/**
+ * Reads a raw signed 64-bit integer from the binary stream and returns it as a
+ * BigInt, without loss of precision.
+ *
+ * @return {bigint} The signed 64-bit integer read from the binary stream.
+ * @export
+ */
+jspb.BinaryDecoder.prototype.readInt64BigInt = function() {
+  var bitsLow = this.readUint32();
+  var bitsHigh = this.readUint32();
+  return jspb.utils.joinInt64BigInt(bitsLow, bitsHigh);
+};
+
+
 /**
  * Reads a 32-bit floating-point number from the binary stream, using the
  * temporary buffer to realign the data.
@@ -36,6 +36,8 @@
  */
 
 goog.provide('jspb.BinaryEncoder');
+goog.provide('jspb.BinaryFixedEncoder');
+goog.provide('jspb.BinarySizeEncoder');
 
 goog.require('jspb.asserts');
 goog.require('jspb.BinaryConstants');
@@ -249,6 +251,51 @@ jspb.BinaryEncoder.prototype.writeZigzagVarint64String = function(value) {
 };
 
 
+/**
+ * Encodes a 64-bit unsigned BigInt into its wire-format varint representation
+ * and stores it in the buffer. Unlike the string variants, the value is split
+ * into its two 32-bit halves without going through a decimal or hash string.
+ * @param {bigint} value The integer to convert.
+ * @export
+ */
+jspb.BinaryEncoder.prototype.writeUnsignedVarint64BigInt = function(value) {
+  jspb.asserts.assert(
+      (value >= 0) && (value < jspb.BinaryConstants.TWO_TO_64));
+  jspb.utils.splitBigInt(value);
+  this.writeSplitVarint64(jspb.utils.getSplit64Low(), jspb.utils.getSplit64High());
+};
+
+
+/**
+ * Encodes a 64-bit signed BigInt into its wire-format varint representation
+ * and stores it in the buffer.
+ * @param {bigint} value The integer to convert.
+ * @export
+ */
+jspb.BinaryEncoder.prototype.writeSignedVarint64BigInt = function(value) {
+  jspb.asserts.assert(
+      (value >= -jspb.BinaryConstants.TWO_TO_63) &&
+      (value < jspb.BinaryConstants.TWO_TO_63));
+  jspb.utils.splitBigInt(value);
+  this.writeSplitVarint64(jspb.utils.getSplit64Low(), jspb.utils.getSplit64High());
+};
+
+
+/**
+ * Encodes a 64-bit signed BigInt into its wire-format, zigzag-encoded varint
+ * representation and stores it in the buffer.
+ * @param {bigint} value The integer to convert.
+ * @export
+ */
+jspb.BinaryEncoder.prototype.writeZigzagVarint64BigInt = function(value) {
+  jspb.asserts.assert(
+      (value >= -jspb.BinaryConstants.TWO_TO_63) &&
+      (value < jspb.BinaryConstants.TWO_TO_63));
+  jspb.utils.splitZigzagBigInt(value);
+  this.writeSplitVarint64(jspb.utils.getSplit64Low(), jspb.utils.getSplit64High());
+};
+
+
 /**
  * Writes a 64-bit hash string (8 characters @ 8 bits of data each) to the
  * buffer as a zigzag varint.
@@ -325,6 +372,19 @@ jspb.BinaryEncoder.prototype.writeUint64 = function(value) {
 };
 
 
+/**
+ * Writes a 64-bit unsigned BigInt to the buffer as a fixed64.
+ * @param {bigint} value The value to write.
+ * @export
+ */
+jspb.BinaryEncoder.prototype.writeUint64BigInt = function(value) {
+  jspb.asserts.assert(
+      (value >= 0) && (value < jspb.BinaryConstants.TWO_TO_64));
+  jspb.utils.splitBigInt(value);
+  this.writeSplitFixed64(jspb.utils.getSplit64Low(), jspb.utils.getSplit64High());
+};
+
+
 /**
  * Writes an 8-bit integer to the buffer. Numbers outside the range
  * [-2^7,2^7) will be truncated.
@@ -402,6 +462,20 @@ jspb.BinaryEncoder.prototype.writeInt64String = function(value) {
 };
 
 
+/**
+ * Writes a 64-bit signed BigInt to the buffer as a sfixed64.
+ * @param {bigint} value The value to write.
+ * @export
+ */
+jspb.BinaryEncoder.prototype.writeInt64BigInt = function(value) {
+  jspb.asserts.assert(
+      (value >= -jspb.BinaryConstants.TWO_TO_63) &&
+      (value < jspb.BinaryConstants.TWO_TO_63));
+  jspb.utils.splitBigInt(value);
+  this.writeSplitFixed64(jspb.utils.getSplit64Low(), jspb.utils.getSplit64High());
+};
+
+
 /**
  * Writes a single-precision floating point value to the buffer. Numbers
  * requiring more than 32 bits of precision will be truncated.
@@ -544,3 +618,342 @@ jspb.BinaryEncoder.prototype.writeString = function(value) {
   var length = this.buffer_.length - oldLength;
   return length;
 };
+
+
+
+/**
+ * BinarySizeEncoder only counts the bytes that a BinaryEncoder would write,
+ * without storing them. It is used to compute serialized sizes.
+ *
+ * @constructor
+ * @extends {jspb.BinaryEncoder}
+ * @struct
+ * @final
+ */
+jspb.BinarySizeEncoder = function() {
+  jspb.BinaryEncoder.call(this);
+
+  /** @private {number} */
+  this.length_ = 0;
+};
+goog.inherits(jspb.BinarySizeEncoder, jspb.BinaryEncoder);
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.length = function() {
+  return this.length_;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.end = function() {
+  this.length_ = 0;
+  return [];
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeSplitVarint64 = function(
+    lowBits, highBits) {
+  jspb.asserts.assert(lowBits == Math.floor(lowBits));
+  jspb.asserts.assert(highBits == Math.floor(highBits));
+  while (highBits > 0 || lowBits > 127) {
+    lowBits = ((lowBits >>> 7) | (highBits << 25)) >>> 0;
+    highBits = highBits >>> 7;
+    this.length_++;
+  }
+  this.length_++;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeUnsignedVarint32 = function(value) {
+  jspb.asserts.assert(value == Math.floor(value));
+  jspb.asserts.assert(
+      (value >= 0) && (value < jspb.BinaryConstants.TWO_TO_32));
+  this.length_ += value < 0x80       ? 1 :
+                  value < 0x4000     ? 2 :
+                  value < 0x200000   ? 3 :
+                  value < 0x10000000 ? 4 :
+                                       5;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeSignedVarint32 = function(value) {
+  jspb.asserts.assert(value == Math.floor(value));
+  jspb.asserts.assert(
+      (value >= -jspb.BinaryConstants.TWO_TO_31) &&
+      (value < jspb.BinaryConstants.TWO_TO_31));
+  if (value >= 0) {
+    this.writeUnsignedVarint32(value);
+  } else {
+    // Negative values are sign-extended to 64 bits.
+    this.length_ += 10;
+  }
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeUint8 = function(value) {
+  this.length_ += 1;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeUint16 = function(value) {
+  this.length_ += 2;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeUint32 = function(value) {
+  this.length_ += 4;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeInt8 = function(value) {
+  this.length_ += 1;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeInt16 = function(value) {
+  this.length_ += 2;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeInt32 = function(value) {
+  this.length_ += 4;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeBool = function(value) {
+  jspb.asserts.assert(
+      typeof value === 'boolean' || typeof value === 'number');
+  this.length_ += 1;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeBytes = function(bytes) {
+  this.length_ += bytes.length;
+};
+
+
+/** @override */
+jspb.BinarySizeEncoder.prototype.writeString = function(value) {
+  // Protect against non-string values being silently ignored.
+  jspb.asserts.assertString(value);
+
+  // Mirrors the UTF-8 encoding of jspb.BinaryEncoder.prototype.writeString,
+  // including its handling of unpaired surrogates.
+  var length = 0;
+  for (var i = 0; i < value.length; i++) {
+    var c = value.charCodeAt(i);
+    if (c < 128) {
+      length += 1;
+    } else if (c < 2048) {
+      length += 2;
+    } else if (c >= 0xD800 && c <= 0xDBFF && i + 1 < value.length) {
+      var second = value.charCodeAt(i + 1);
+      if (second >= 0xDC00 && second <= 0xDFFF) {
+        length += 4;
+        i++;
+      }
+    } else {
+      length += 3;
+    }
+  }
+  this.length_ += length;
+  return length;
+};
+
+
+
+/**
+ * BinaryFixedEncoder writes directly into a preallocated buffer, which must be
+ * large enough for everything written to it. It is used to serialize messages
+ * whose size was computed with a BinarySizeEncoder.
+ *
+ * @param {!Uint8Array} buffer The buffer to write to.
+ * @param {number} offset The offset in the buffer to start writing at.
+ * @constructor
+ * @extends {jspb.BinaryEncoder}
+ * @struct
+ * @final
+ */
+jspb.BinaryFixedEncoder = function(buffer, offset) {
+  jspb.BinaryEncoder.call(this);
+
+  /** @private {!Uint8Array} */
+  this.bytes_ = buffer;
+
+  /** @private {number} */
+  this.cursor_ = offset;
+};
+goog.inherits(jspb.BinaryFixedEncoder, jspb.BinaryEncoder);
+
+
+/**
+ * Makes the encoder write into the given buffer, so that it can be reused.
+ * @param {!Uint8Array} buffer The buffer to write to.
+ * @param {number} offset The offset in the buffer to start writing at.
+ */
+jspb.BinaryFixedEncoder.prototype.reset = function(buffer, offset) {
+  this.bytes_ = buffer;
+  this.cursor_ = offset;
+};
+
+
+/**
+ * @return {!Uint8Array} The buffer being written to.
+ */
+jspb.BinaryFixedEncoder.prototype.getBuffer = function() {
+  return this.bytes_;
+};
+
+
+/**
+ * @return {number} The offset in the buffer after the last byte written.
+ */
+jspb.BinaryFixedEncoder.prototype.getCursor = function() {
+  return this.cursor_;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.length = function() {
+  return this.cursor_;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.end = function() {
+  return [];
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeSplitVarint64 = function(
+    lowBits, highBits) {
+  while (highBits > 0 || lowBits > 127) {
+    this.bytes_[this.cursor_++] = (lowBits & 0x7f) | 0x80;
+    lowBits = ((lowBits >>> 7) | (highBits << 25)) >>> 0;
+    highBits = highBits >>> 7;
+  }
+  this.bytes_[this.cursor_++] = lowBits;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeUnsignedVarint32 = function(value) {
+  while (value > 127) {
+    this.bytes_[this.cursor_++] = (value & 0x7f) | 0x80;
+    value = value >>> 7;
+  }
+  this.bytes_[this.cursor_++] = value;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeSignedVarint32 = function(value) {
+  if (value >= 0) {
+    this.writeUnsignedVarint32(value);
+    return;
+  }
+  for (var i = 0; i < 9; i++) {
+    this.bytes_[this.cursor_++] = (value & 0x7f) | 0x80;
+    value = value >> 7;
+  }
+  this.bytes_[this.cursor_++] = 1;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeUint8 = function(value) {
+  this.bytes_[this.cursor_++] = value;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeUint16 = function(value) {
+  this.bytes_[this.cursor_++] = value;
+  this.bytes_[this.cursor_++] = value >>> 8;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeUint32 = function(value) {
+  var bytes = this.bytes_;
+  var cursor = this.cursor_;
+  bytes[cursor] = value;
+  bytes[cursor + 1] = value >>> 8;
+  bytes[cursor + 2] = value >>> 16;
+  bytes[cursor + 3] = value >>> 24;
+  this.cursor_ = cursor + 4;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeInt8 =
+    jspb.BinaryFixedEncoder.prototype.writeUint8;
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeInt16 =
+    jspb.BinaryFixedEncoder.prototype.writeUint16;
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeInt32 =
+    jspb.BinaryFixedEncoder.prototype.writeUint32;
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeBool = function(value) {
+  this.bytes_[this.cursor_++] = value ? 1 : 0;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeBytes = function(bytes) {
+  this.bytes_.set(bytes, this.cursor_);
+  this.cursor_ += bytes.length;
+};
+
+
+/** @override */
+jspb.BinaryFixedEncoder.prototype.writeString = function(value) {
+  var bytes = this.bytes_;
+  var start = this.cursor_;
+  var cursor = start;
+  for (var i = 0; i < value.length; i++) {
+    var c = value.charCodeAt(i);
+    if (c < 128) {
+      bytes[cursor++] = c;
+    } else if (c < 2048) {
+      bytes[cursor++] = (c >> 6) | 192;
+      bytes[cursor++] = (c & 63) | 128;
+    } else if (c >= 0xD800 && c <= 0xDBFF && i + 1 < value.length) {
+      var second = value.charCodeAt(i + 1);
+      if (second >= 0xDC00 && second <= 0xDFFF) {
+        c = (c - 0xD800) * 0x400 + second - 0xDC00 + 0x10000;
+        bytes[cursor++] = (c >> 18) | 240;
+        bytes[cursor++] = ((c >> 12) & 63) | 128;
+        bytes[cursor++] = ((c >> 6) & 63) | 128;
+        bytes[cursor++] = (c & 63) | 128;
+        i++;
+      }
+    } else {
+      bytes[cursor++] = (c >> 12) | 224;
+      bytes[cursor++] = ((c >> 6) & 63) | 128;
+      bytes[cursor++] = (c & 63) | 128;
+    }
+  }
+  this.cursor_ = cursor;
+  return cursor - start;
+};
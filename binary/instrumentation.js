@@ -0,0 +1,302 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @fileoverview This file contains the hooks that messages generated with the
+ * `instrument` option of protoc-gen-js call from their
+ * deserializeBinaryFromReader() and serializeBinaryToWriter(), to count the
+ * messages of each type that are decoded and encoded.
+ *
+ * The hooks are only called if jspb.BinaryInstrumentation.ENABLED is set at
+ * compile time (or through CLOSURE_UNCOMPILED_DEFINES); otherwise the compiler
+ * removes them, and the generated code is as fast as without the option. They
+ * report to the sink passed to jspb.BinaryInstrumentation.setSink(), e.g. a
+ * jspb.BinaryInstrumentation.Counters:
+ *
+ *   var counters = new jspb.BinaryInstrumentation.Counters();
+ *   jspb.BinaryInstrumentation.setSink(counters, true);
+ *   ...
+ *   console.log(counters.getStats());
+ *
+ * The bytes of a message are those of its fields, without its own tag and
+ * length, and include the bytes of its submessages, which are reported
+ * separately as well. Unknown fields are counted for the message they were
+ * skipped in. Sizing passes, as in computeSerializedSize() and the first pass
+ * of serializeBinaryTo(), are not reported.
+ */
+
+goog.provide('jspb.BinaryInstrumentation');
+goog.provide('jspb.BinaryInstrumentation.Counters');
+goog.provide('jspb.BinaryInstrumentation.Sink');
+goog.provide('jspb.BinaryInstrumentation.Stats');
+
+goog.require('jspb.BinarySizingWriter');
+
+
+/**
+ * Whether the generated code reports to the instrumentation sink.
+ * @define {boolean}
+ */
+jspb.BinaryInstrumentation.ENABLED =
+    goog.define('jspb.BinaryInstrumentation.ENABLED', false);
+
+
+/**
+ * Receives the decode and encode events of instrumented messages.
+ * @record
+ */
+jspb.BinaryInstrumentation.Sink = function() {};
+
+
+/**
+ * Called when a message has been decoded.
+ * @param {string} typeName The full name of the message type.
+ * @param {number} bytes The number of bytes decoded.
+ * @param {number} unknownFields The number of unknown fields skipped.
+ * @param {number} elapsedMs The time taken, or 0 if not timed.
+ */
+jspb.BinaryInstrumentation.Sink.prototype.onDecode = function(
+    typeName, bytes, unknownFields, elapsedMs) {};
+
+
+/**
+ * Called when a message has been encoded.
+ * @param {string} typeName The full name of the message type.
+ * @param {number} bytes The number of bytes encoded.
+ * @param {number} elapsedMs The time taken, or 0 if not timed.
+ */
+jspb.BinaryInstrumentation.Sink.prototype.onEncode = function(
+    typeName, bytes, elapsedMs) {};
+
+
+/**
+ * @private {?jspb.BinaryInstrumentation.Sink}
+ */
+jspb.BinaryInstrumentation.sink_ = null;
+
+
+/**
+ * @private {boolean}
+ */
+jspb.BinaryInstrumentation.timed_ = false;
+
+
+/**
+ * The number of unknown fields skipped so far in the message being decoded.
+ * @private {number}
+ */
+jspb.BinaryInstrumentation.unknownFields_ = 0;
+
+
+/**
+ * Sets the sink of the instrumentation events, or removes it.
+ * @param {?jspb.BinaryInstrumentation.Sink} sink
+ * @param {boolean=} opt_timed Whether to time each decode and encode, which
+ *     adds two clock reads to each.
+ * @export
+ */
+jspb.BinaryInstrumentation.setSink = function(sink, opt_timed) {
+  jspb.BinaryInstrumentation.sink_ = sink;
+  jspb.BinaryInstrumentation.timed_ = !!opt_timed;
+};
+
+
+/**
+ * @return {number} The current time in milliseconds if decodes and encodes are
+ *     timed, or 0.
+ * @export
+ */
+jspb.BinaryInstrumentation.now = function() {
+  if (!jspb.BinaryInstrumentation.timed_) {
+    return 0;
+  }
+  var performance = goog.global['performance'];
+  return performance ? performance.now() : goog.now();
+};
+
+
+/**
+ * Starts counting the unknown fields of a message being decoded.
+ * @return {number} The count of the enclosing message, to be passed to
+ *     endDecode().
+ * @export
+ */
+jspb.BinaryInstrumentation.beginDecode = function() {
+  var outer = jspb.BinaryInstrumentation.unknownFields_;
+  jspb.BinaryInstrumentation.unknownFields_ = 0;
+  return outer;
+};
+
+
+/**
+ * Counts an unknown field skipped by the message being decoded.
+ * @export
+ */
+jspb.BinaryInstrumentation.countUnknownField = function() {
+  jspb.BinaryInstrumentation.unknownFields_++;
+};
+
+
+/**
+ * Reports a decoded message to the sink.
+ * @param {string} typeName The full name of the message type.
+ * @param {number} bytes The number of bytes decoded.
+ * @param {number} startTime The value of now() before decoding.
+ * @param {number} outerUnknownFields The value returned by beginDecode().
+ * @export
+ */
+jspb.BinaryInstrumentation.endDecode = function(
+    typeName, bytes, startTime, outerUnknownFields) {
+  var unknownFields = jspb.BinaryInstrumentation.unknownFields_;
+  jspb.BinaryInstrumentation.unknownFields_ = outerUnknownFields;
+  var sink = jspb.BinaryInstrumentation.sink_;
+  if (sink) {
+    sink.onDecode(
+        typeName, bytes, unknownFields,
+        jspb.BinaryInstrumentation.timed_ ?
+            jspb.BinaryInstrumentation.now() - startTime :
+            0);
+  }
+};
+
+
+/**
+ * Reports an encoded message to the sink, unless the writer only computes
+ * sizes.
+ * @param {string} typeName The full name of the message type.
+ * @param {!jspb.BinaryWriter} writer The writer the message was written to.
+ * @param {number} bytes The number of bytes encoded.
+ * @param {number} startTime The value of now() before encoding.
+ * @export
+ */
+jspb.BinaryInstrumentation.endEncode = function(
+    typeName, writer, bytes, startTime) {
+  var sink = jspb.BinaryInstrumentation.sink_;
+  if (sink && !(writer instanceof jspb.BinarySizingWriter)) {
+    sink.onEncode(
+        typeName, bytes,
+        jspb.BinaryInstrumentation.timed_ ?
+            jspb.BinaryInstrumentation.now() - startTime :
+            0);
+  }
+};
+
+
+/**
+ * The counts of one message type collected by a Counters sink.
+ * @typedef {{
+ *   decodeCalls: number,
+ *   decodeBytes: number,
+ *   unknownFields: number,
+ *   decodeMs: number,
+ *   encodeCalls: number,
+ *   encodeBytes: number,
+ *   encodeMs: number
+ * }}
+ */
+jspb.BinaryInstrumentation.Stats;
+
+
+/**
+ * A sink adding up the events of each message type.
+ * @constructor
+ * @implements {jspb.BinaryInstrumentation.Sink}
+ * @struct
+ * @final
+ * @export
+ */
+jspb.BinaryInstrumentation.Counters = function() {
+  /**
+   * @private {!Object<string, !jspb.BinaryInstrumentation.Stats>}
+   */
+  this.stats_ = {};
+};
+
+
+/**
+ * @param {string} typeName
+ * @return {!jspb.BinaryInstrumentation.Stats}
+ * @private
+ */
+jspb.BinaryInstrumentation.Counters.prototype.get_ = function(typeName) {
+  var stats = this.stats_[typeName];
+  if (!stats) {
+    stats = this.stats_[typeName] = {
+      decodeCalls: 0,
+      decodeBytes: 0,
+      unknownFields: 0,
+      decodeMs: 0,
+      encodeCalls: 0,
+      encodeBytes: 0,
+      encodeMs: 0
+    };
+  }
+  return stats;
+};
+
+
+/** @override */
+jspb.BinaryInstrumentation.Counters.prototype.onDecode = function(
+    typeName, bytes, unknownFields, elapsedMs) {
+  var stats = this.get_(typeName);
+  stats.decodeCalls++;
+  stats.decodeBytes += bytes;
+  stats.unknownFields += unknownFields;
+  stats.decodeMs += elapsedMs;
+};
+
+
+/** @override */
+jspb.BinaryInstrumentation.Counters.prototype.onEncode = function(
+    typeName, bytes, elapsedMs) {
+  var stats = this.get_(typeName);
+  stats.encodeCalls++;
+  stats.encodeBytes += bytes;
+  stats.encodeMs += elapsedMs;
+};
+
+
+/**
+ * @return {!Object<string, !jspb.BinaryInstrumentation.Stats>} The counts
+ *     so far by full message type name.
+ * @export
+ */
+jspb.BinaryInstrumentation.Counters.prototype.getStats = function() {
+  return this.stats_;
+};
+
+
+/**
+ * Clears the counts.
+ * @export
+ */
+jspb.BinaryInstrumentation.Counters.prototype.reset = function() {
+  this.stats_ = {};
+};
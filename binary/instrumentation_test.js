@@ -0,0 +1,106 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Test suite is written using Jasmine -- see http://jasmine.github.io/
+goog.require('jspb.BinaryInstrumentation');
+goog.require('jspb.BinarySizingWriter');
+goog.require('jspb.BinaryWriter');
+
+
+describe('binaryInstrumentationTest', () => {
+  afterEach(() => {
+    jspb.BinaryInstrumentation.setSink(null);
+  });
+
+  it('adds up the events of each type', () => {
+    const counters = new jspb.BinaryInstrumentation.Counters();
+    jspb.BinaryInstrumentation.setSink(counters);
+
+    const outer = jspb.BinaryInstrumentation.beginDecode();
+    jspb.BinaryInstrumentation.countUnknownField();
+    jspb.BinaryInstrumentation.endDecode(
+        'pkg.A', 10, jspb.BinaryInstrumentation.now(), outer);
+    jspb.BinaryInstrumentation.endEncode(
+        'pkg.A', new jspb.BinaryWriter(), 7, jspb.BinaryInstrumentation.now());
+
+    expect(counters.getStats()).toEqual({
+      'pkg.A': {
+        decodeCalls: 1,
+        decodeBytes: 10,
+        unknownFields: 1,
+        decodeMs: 0,
+        encodeCalls: 1,
+        encodeBytes: 7,
+        encodeMs: 0,
+      },
+    });
+    counters.reset();
+    expect(counters.getStats()).toEqual({});
+  });
+
+  it('counts unknown fields for the message they were skipped in', () => {
+    const counters = new jspb.BinaryInstrumentation.Counters();
+    jspb.BinaryInstrumentation.setSink(counters);
+
+    const outer = jspb.BinaryInstrumentation.beginDecode();
+    jspb.BinaryInstrumentation.countUnknownField();
+    const inner = jspb.BinaryInstrumentation.beginDecode();
+    jspb.BinaryInstrumentation.countUnknownField();
+    jspb.BinaryInstrumentation.countUnknownField();
+    jspb.BinaryInstrumentation.endDecode('pkg.Inner', 2, 0, inner);
+    jspb.BinaryInstrumentation.countUnknownField();
+    jspb.BinaryInstrumentation.endDecode('pkg.Outer', 5, 0, outer);
+
+    expect(counters.getStats()['pkg.Inner'].unknownFields).toEqual(2);
+    expect(counters.getStats()['pkg.Outer'].unknownFields).toEqual(2);
+  });
+
+  it('ignores sizing passes', () => {
+    const counters = new jspb.BinaryInstrumentation.Counters();
+    jspb.BinaryInstrumentation.setSink(counters);
+
+    jspb.BinaryInstrumentation.endEncode(
+        'pkg.A', new jspb.BinarySizingWriter(), 7, 0);
+
+    expect(counters.getStats()).toEqual({});
+  });
+
+  it('times events when asked to', () => {
+    const counters = new jspb.BinaryInstrumentation.Counters();
+    jspb.BinaryInstrumentation.setSink(counters, true);
+
+    const start = jspb.BinaryInstrumentation.now();
+    expect(start).toBeGreaterThan(0);
+    jspb.BinaryInstrumentation.endEncode(
+        'pkg.A', new jspb.BinaryWriter(), 1, start);
+
+    expect(counters.getStats()['pkg.A'].encodeMs).toBeGreaterThanOrEqual(0);
+  });
+});
@@ -32,6 +32,7 @@
 
 goog.require('goog.crypt.base64');
 
+goog.require('jspb.BinaryBufferWriter');
 goog.require('jspb.BinaryWriter');
 goog.require('jspb.Message');
 
@@ -41,6 +42,9 @@ goog.require('proto.jspb.test.ForeignEnum');
 goog.require('proto.jspb.test.ForeignMessage');
 goog.require('proto.jspb.test.TestAllTypes');
 goog.require('proto.jspb.test.TestExtendable');
+goog.require('proto.jspb.test.TestLazyInner');
+goog.require('proto.jspb.test.TestLazyLeaf');
+goog.require('proto.jspb.test.TestLazyOuter');
 goog.require('proto.jspb.test.extendOptionalBool');
 goog.require('proto.jspb.test.extendOptionalBytes');
 goog.require('proto.jspb.test.extendOptionalDouble');
@@ -409,6 +413,84 @@ describe('protoBinaryTest', () => {
     checkAllFields(msg, decoded);
   });
 
+  /**
+   * Tests serializing into a preallocated buffer.
+   */
+  it('testSerializeBinaryTo', () => {
+    const msg = new proto.jspb.test.TestAllTypes();
+    fillAllFields(msg);
+    const encoded = msg.serializeBinary();
+    expect(msg.computeSerializedSize()).toEqual(encoded.length);
+
+    const buffer = new Uint8Array(encoded.length + 1);
+    expect(msg.serializeBinaryTo(buffer, 1)).toEqual(buffer.length);
+    expect(bytesCompare(buffer.subarray(1), encoded)).toBeTrue();
+    expect(() => msg.serializeBinaryTo(buffer, 2)).toThrow();
+  });
+
+  it('testSerializeBinaryWith', () => {
+    const msg = new proto.jspb.test.TestAllTypes();
+    fillAllFields(msg);
+    const encoded = msg.serializeBinary();
+    const writer = new jspb.BinaryBufferWriter(16);
+    expect(bytesCompare(msg.serializeBinaryWith(writer), encoded)).toBeTrue();
+    expect(bytesCompare(msg.serializeBinaryWith(writer), encoded)).toBeTrue();
+    expect(bytesCompare(
+               msg.serializeBinaryWith(new jspb.BinaryWriter()), encoded))
+        .toBeTrue();
+  });
+
+  /**
+   * Tests decoding a stream of length-prefixed messages, split into chunks
+   * across their length prefixes, with deserializeDelimitedStream().
+   */
+  it('testDelimitedStream', async () => {
+    const first = new proto.jspb.test.TestAllTypes();
+    fillAllFields(first);
+    const second = new proto.jspb.test.TestAllTypes();
+    second.setOptionalString('x'.repeat(200));
+    const empty = new proto.jspb.test.TestAllTypes();
+    const parts = [
+      first.serializeDelimited(),
+      second.serializeDelimited(new jspb.BinaryBufferWriter(4)),
+      empty.serializeDelimited(),
+    ];
+    // The first two messages have a length prefix of more than one byte.
+    expect(parts[0][0] & 0x80).toEqual(0x80);
+    expect(parts[1][0] & 0x80).toEqual(0x80);
+    const stream = new Uint8Array(
+        parts.reduce((length, part) => length + part.length, 0));
+    for (let i = 0, offset = 0; i < parts.length; i++) {
+      stream.set(parts[i], offset);
+      offset += parts[i].length;
+    }
+
+    const check = (decoded) => {
+      expect(decoded.length).toEqual(3);
+      checkAllFields(first, decoded[0]);
+      expect(decoded[1].toObject()).toEqual(second.toObject());
+      expect(decoded[2].toObject()).toEqual(empty.toObject());
+    };
+    for (const size of [1, parts[0].length + 1, stream.length]) {
+      const chunks = [];
+      for (let offset = 0; offset < stream.length; offset += size) {
+        chunks.push(stream.subarray(offset, offset + size));
+      }
+      check(Array.from(
+          proto.jspb.test.TestAllTypes.deserializeDelimitedStream(chunks)));
+
+      const asyncChunks = async function*() {
+        yield* chunks;
+      };
+      const decoded = [];
+      for await (const msg of proto.jspb.test.TestAllTypes
+                     .deserializeDelimitedStream(asyncChunks())) {
+        decoded.push(msg);
+      }
+      check(decoded);
+    }
+  });
+
   /**
    * Test that base64 string and Uint8Array are interchangeable in bytes fields.
    */
@@ -614,4 +696,69 @@ describe('protoBinaryTest', () => {
 
     checkAllFields(msg, msg2);
   });
+
+  /**
+   * Tests decoding fields written out of order, with repeated fields split
+   * up and unknown fields in between, which the decoder generated with the
+   * expected_tags option must not mistake for the fields it expects next.
+   */
+  it('testOutOfOrderAndUnknownFields', () => {
+    const foreign = new proto.jspb.test.ForeignMessage();
+    foreign.setC(7);
+
+    const writer = new jspb.BinaryWriter();
+    writer.writeString(14, 'hello');
+    writer.writeInt32(1000, 5);
+    writer.writeInt32(31, 1);
+    writer.writeInt32(1, 42);
+    writer.writeInt32(31, 2);
+    writer.writeString(1001, 'unknown');
+    writer.writeInt32(31, 3);
+    writer.writeMessage(
+        19, foreign, proto.jspb.test.ForeignMessage.serializeBinaryToWriter);
+    writer.writeInt32(31, 4);
+    writer.writePackedInt32(61, [5, 6]);
+    writer.writeInt32(61, 7);
+    writer.writeBool(13, true);
+    writer.writeInt32(1, 43);
+    const msg =
+        proto.jspb.test.TestAllTypes.deserializeBinary(writer.getResultBuffer());
+
+    expect(msg.getOptionalInt32()).toEqual(43);
+    expect(msg.getOptionalString()).toEqual('hello');
+    expect(msg.getOptionalBool()).toBeTrue();
+    expect(msg.getOptionalForeignMessage().getC()).toEqual(7);
+    expect(msg.getRepeatedInt32List()).toEqual([1, 2, 3, 4]);
+    expect(msg.getPackedRepeatedInt32List()).toEqual([5, 6, 7]);
+
+    const copy =
+        proto.jspb.test.TestAllTypes.deserializeBinary(msg.serializeBinary());
+    expect(copy.toObject()).toEqual(msg.toObject());
+  });
+
+  /**
+   * Tests that reading a lazily decoded submessage leaves its own lazy fields
+   * undecoded.
+   */
+  it('testNestedLazyFields', () => {
+    // Spy first: with codec=table the decoder is captured on first use.
+    spyOn(proto.jspb.test.TestLazyLeaf, 'deserializeBinaryFromReader')
+        .and.callThrough();
+
+    const inner = new proto.jspb.test.TestLazyInner();
+    inner.setFirst(new proto.jspb.test.TestLazyLeaf().setValue(1));
+    inner.setSecond(new proto.jspb.test.TestLazyLeaf().setValue(2));
+    const bytes =
+        new proto.jspb.test.TestLazyOuter().setInner(inner).serializeBinary();
+
+    const outer = proto.jspb.test.TestLazyOuter.deserializeBinary(bytes);
+    expect(outer.getInner().getFirst().getValue()).toEqual(1);
+    expect(proto.jspb.test.TestLazyLeaf.deserializeBinaryFromReader)
+        .toHaveBeenCalledTimes(1);
+
+    expect(outer.serializeBinary()).toEqual(bytes);
+    expect(outer.getInner().getSecond().getValue()).toEqual(2);
+    expect(proto.jspb.test.TestLazyLeaf.deserializeBinaryFromReader)
+        .toHaveBeenCalledTimes(2);
+  });
 });
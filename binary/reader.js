@@ -45,6 +45,8 @@
  * @author aappleby@google.com (Austin Appleby)
  */
 
+goog.provide('jspb.BinaryDelimitedReader');
+goog.provide('jspb.BinaryProjection');
 goog.provide('jspb.BinaryReader');
 
 goog.require('jspb.asserts');
@@ -143,7 +145,7 @@ jspb.BinaryReader.alloc = function(opt_bytes, opt_start, opt_length) {
   if (jspb.BinaryReader.instanceCache_.length) {
     var newReader = jspb.BinaryReader.instanceCache_.pop();
     if (opt_bytes) {
-      newReader.decoder_.setBlock(opt_bytes, opt_start, opt_length);
+      newReader.reset(opt_bytes, opt_start, opt_length);
     }
     return newReader;
   } else {
@@ -277,11 +279,23 @@ jspb.BinaryReader.prototype.setBlock = function(bytes, start, length) {
 
 /**
  * Rewinds the stream cursor to the beginning of the buffer and resets all
- * internal state.
+ * internal state. If bytes are given, the reader is pointed at them instead,
+ * reusing its decoder, and any error from the previous bytes is cleared.
+ * @param {jspb.ByteSource=} opt_bytes The bytes to read from next.
+ * @param {number=} opt_start The optional offset to start reading at.
+ * @param {number=} opt_length The optional length of the block to read -
+ *     we'll throw an assertion if we go off the end of the block.
  * @export
  */
-jspb.BinaryReader.prototype.reset = function() {
-  this.decoder_.reset();
+jspb.BinaryReader.prototype.reset = function(opt_bytes, opt_start, opt_length) {
+  if (opt_bytes) {
+    this.decoder_.clear();
+    this.decoder_.setBlock(opt_bytes, opt_start, opt_length);
+    this.error_ = false;
+  } else {
+    this.decoder_.reset();
+  }
+  this.fieldCursor_ = this.decoder_.getCursor();
   this.nextField_ = jspb.BinaryConstants.INVALID_FIELD_NUMBER;
   this.nextWireType_ = jspb.BinaryConstants.WireType.INVALID;
 };
@@ -346,6 +360,30 @@ jspb.BinaryReader.prototype.nextField = function() {
 };
 
 
+/**
+ * Advances to the next field, as nextField() does, if its header is the given
+ * tag (the field number shifted left by 3, or'ed with the wire type), which
+ * must be below 2^14. Otherwise the reader is left as is and false is
+ * returned, so that the caller can fall back to nextField(). Generated code
+ * uses this to continue with the field it expects next.
+ *
+ * @param {number} tag The expected field header.
+ * @return {boolean} Whether the reader advanced to the expected field.
+ * @export
+ */
+jspb.BinaryReader.prototype.nextFieldIf = function(tag) {
+  var cursor = this.decoder_.getCursor();
+  if (this.getError() || !this.decoder_.readUnsignedVarint32If(tag)) {
+    return false;
+  }
+  this.fieldCursor_ = cursor;
+  this.nextField_ = tag >>> 3;
+  this.nextWireType_ =
+      /** @type {jspb.BinaryConstants.WireType} */ (tag & 0x7);
+  return true;
+};
+
+
 /**
  * Winds the reader back to just before this field's header.
  * @export
@@ -580,10 +618,13 @@ jspb.BinaryReader.prototype.readAny = function(fieldType) {
  * who is using manual deserialization instead of the code-generated versions.
  * @template T
  * @param {T} message
- * @param {function(T, !jspb.BinaryReader)} reader
+ * @param {function(T, !jspb.BinaryReader, ?=)} reader
+ * @param {?=} opt_context An extra argument for the reader function, such as
+ *     the jspb.BinaryProjection of a partial decode.
  * @export
  */
-jspb.BinaryReader.prototype.readMessage = function(message, reader) {
+jspb.BinaryReader.prototype.readMessage = function(
+    message, reader, opt_context) {
   jspb.asserts.assert(
       this.nextWireType_ == jspb.BinaryConstants.WireType.DELIMITED);
 
@@ -595,7 +636,7 @@ jspb.BinaryReader.prototype.readMessage = function(message, reader) {
   this.decoder_.setEnd(newEnd);
 
   // Deserialize the embedded message.
-  reader(message, this);
+  reader(message, this, opt_context);
 
   // Advance the decoder past the embedded message and restore the endpoint.
   this.decoder_.setCursor(newEnd);
@@ -610,10 +651,13 @@ jspb.BinaryReader.prototype.readMessage = function(message, reader) {
  * @template T
  * @param {number} field
  * @param {T} message
- * @param {function(T, !jspb.BinaryReader)} reader
+ * @param {function(T, !jspb.BinaryReader, ?=)} reader
+ * @param {?=} opt_context An extra argument for the reader function, such as
+ *     the jspb.BinaryProjection of a partial decode.
  * @export
  */
-jspb.BinaryReader.prototype.readGroup = function(field, message, reader) {
+jspb.BinaryReader.prototype.readGroup = function(
+    field, message, reader, opt_context) {
   // Ensure that the wire type is correct.
   jspb.asserts.assert(
       this.nextWireType_ == jspb.BinaryConstants.WireType.START_GROUP);
@@ -621,7 +665,7 @@ jspb.BinaryReader.prototype.readGroup = function(field, message, reader) {
   jspb.asserts.assert(this.nextField_ == field);
 
   // Deserialize the message. The deserialization will stop at an END_GROUP tag.
-  reader(message, this);
+  reader(message, this, opt_context);
 
   if (!this.error_ &&
       this.nextWireType_ != jspb.BinaryConstants.WireType.END_GROUP) {
@@ -932,6 +976,89 @@ jspb.BinaryReader.prototype.readSfixed64String = function() {
 };
 
 
+/**
+ * Reads a signed 64-bit integer field from the binary stream, or throws an
+ * error if the next field in the stream is not of the correct wire type.
+ *
+ * Returns the value as a BigInt.
+ *
+ * @return {bigint} The value of the field as a BigInt.
+ * @export
+ */
+jspb.BinaryReader.prototype.readInt64BigInt = function() {
+  jspb.asserts.assert(
+      this.nextWireType_ == jspb.BinaryConstants.WireType.VARINT);
+  return this.decoder_.readSignedVarint64BigInt();
+};
+
+
+/**
+ * Reads an unsigned 64-bit integer field from the binary stream, or throws an
+ * error if the next field in the stream is not of the correct wire type.
+ *
+ * Returns the value as a BigInt.
+ *
+ * @return {bigint} The value of the field as a BigInt.
+ * @export
+ */
+jspb.BinaryReader.prototype.readUint64BigInt = function() {
+  jspb.asserts.assert(
+      this.nextWireType_ == jspb.BinaryConstants.WireType.VARINT);
+  return this.decoder_.readUnsignedVarint64BigInt();
+};
+
+
+/**
+ * Reads a signed zigzag-encoded 64-bit integer field from the binary stream, or
+ * throws an error if the next field in the stream is not of the correct wire
+ * type.
+ *
+ * Returns the value as a BigInt.
+ *
+ * @return {bigint} The value of the field as a BigInt.
+ * @export
+ */
+jspb.BinaryReader.prototype.readSint64BigInt = function() {
+  jspb.asserts.assert(
+      this.nextWireType_ == jspb.BinaryConstants.WireType.VARINT);
+  return this.decoder_.readZigzagVarint64BigInt();
+};
+
+
+/**
+ * Reads an unsigned 64-bit fixed-length integer field from the binary stream,
+ * or throws an error if the next field in the stream is not of the correct
+ * wire type.
+ *
+ * Returns the value as a BigInt.
+ *
+ * @return {bigint} The value of the field as a BigInt.
+ * @export
+ */
+jspb.BinaryReader.prototype.readFixed64BigInt = function() {
+  jspb.asserts.assert(
+      this.nextWireType_ == jspb.BinaryConstants.WireType.FIXED64);
+  return this.decoder_.readUint64BigInt();
+};
+
+
+/**
+ * Reads a signed 64-bit fixed-length integer field from the binary stream, or
+ * throws an error if the next field in the stream is not of the correct wire
+ * type.
+ *
+ * Returns the value as a BigInt.
+ *
+ * @return {bigint} The value of the field as a BigInt.
+ * @export
+ */
+jspb.BinaryReader.prototype.readSfixed64BigInt = function() {
+  jspb.asserts.assert(
+      this.nextWireType_ == jspb.BinaryConstants.WireType.FIXED64);
+  return this.decoder_.readInt64BigInt();
+};
+
+
 /**
  * Reads a 32-bit floating-point field from the binary stream, or throws an
  * error if the next field in the stream is not of the correct wire type.
@@ -1326,6 +1453,61 @@ jspb.BinaryReader.prototype.readPackedSfixed64String = function() {
 };
 
 
+/**
+ * Reads a packed int64 field, which consists of a length header and a list of
+ * signed varints. Returns a list of BigInts.
+ * @return {!Array<bigint>}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedInt64BigInt = function() {
+  return this.readPackedField_(this.decoder_.readSignedVarint64BigInt);
+};
+
+
+/**
+ * Reads a packed uint64 field, which consists of a length header and a list of
+ * unsigned varints. Returns a list of BigInts.
+ * @return {!Array<bigint>}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedUint64BigInt = function() {
+  return this.readPackedField_(this.decoder_.readUnsignedVarint64BigInt);
+};
+
+
+/**
+ * Reads a packed sint64 field, which consists of a length header and a list of
+ * zigzag varints. Returns a list of BigInts.
+ * @return {!Array<bigint>}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedSint64BigInt = function() {
+  return this.readPackedField_(this.decoder_.readZigzagVarint64BigInt);
+};
+
+
+/**
+ * Reads a packed fixed64 field, which consists of a length header and a list of
+ * 64-bit uints. Returns a list of BigInts.
+ * @return {!Array<bigint>}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedFixed64BigInt = function() {
+  return this.readPackedField_(this.decoder_.readUint64BigInt);
+};
+
+
+/**
+ * Reads a packed sfixed64 field, which consists of a length header and a list
+ * of 64-bit ints. Returns a list of BigInts.
+ * @return {!Array<bigint>}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedSfixed64BigInt = function() {
+  return this.readPackedField_(this.decoder_.readInt64BigInt);
+};
+
+
 /**
  * Reads a packed float field, which consists of a length header and a list of
  * floats.
@@ -1390,3 +1572,509 @@ jspb.BinaryReader.prototype.readPackedVarintHash64 = function() {
 jspb.BinaryReader.prototype.readPackedFixedHash64 = function() {
   return this.readPackedField_(this.decoder_.readFixedHash64);
 };
+
+
+/**
+ * Whether the platform stores multi-byte numbers in little-endian order, like
+ * the wire format does, so that the payload of packed fixed-width fields can
+ * be copied into a typed array as is.
+ * @private @const {boolean}
+ */
+jspb.BinaryReader.LITTLE_ENDIAN_ =
+    new Uint8Array(new Uint16Array([1]).buffer)[0] == 1;
+
+
+/**
+ * Reads a packed fixed-width scalar field into a typed array. On little-endian
+ * platforms the payload is copied into the array in one block, otherwise each
+ * value is decoded with the supplied raw reader function.
+ * @param {function(new:T, (number|!ArrayBuffer))} ctor The typed array
+ *     constructor.
+ * @param {number} width The width of a value in bytes.
+ * @param {function(this:jspb.BinaryDecoder):number} decodeMethod
+ * @return {T}
+ * @template T
+ * @private
+ */
+jspb.BinaryReader.prototype.readPackedFixedTypedArray_ = function(
+    ctor, width, decodeMethod) {
+  jspb.asserts.assert(
+      this.nextWireType_ == jspb.BinaryConstants.WireType.DELIMITED);
+  var length = this.decoder_.readUnsignedVarint32();
+  jspb.asserts.assert(length % width == 0);
+  var count = length / width;
+  if (jspb.BinaryReader.LITTLE_ENDIAN_) {
+    var bytes = this.decoder_.getBuffer();
+    var start = bytes.byteOffset + this.decoder_.getCursor();
+    this.decoder_.advance(length);
+    return new ctor(bytes.buffer.slice(start, start + length));
+  }
+  var result = new ctor(count);
+  for (var i = 0; i < count; i++) {
+    result[i] = decodeMethod.call(this.decoder_);
+  }
+  return result;
+};
+
+
+/**
+ * Reads a packed varint scalar field into a typed array, using the supplied
+ * raw reader function. The values are counted first, so that the array is
+ * allocated once with its final length.
+ * @param {function(new:T, number)} ctor The typed array constructor.
+ * @param {function(this:jspb.BinaryDecoder):number} decodeMethod
+ * @return {T}
+ * @template T
+ * @private
+ */
+jspb.BinaryReader.prototype.readPackedVarintTypedArray_ = function(
+    ctor, decodeMethod) {
+  jspb.asserts.assert(
+      this.nextWireType_ == jspb.BinaryConstants.WireType.DELIMITED);
+  var length = this.decoder_.readUnsignedVarint32();
+  var bytes = this.decoder_.getBuffer();
+  var start = this.decoder_.getCursor();
+  var end = start + length;
+  // Every varint ends with the first byte that has its high bit clear.
+  var count = 0;
+  for (var i = start; i < end; i++) {
+    if (bytes[i] < 128) {
+      count++;
+    }
+  }
+  var result = new ctor(count);
+  for (var i = 0; i < count; i++) {
+    result[i] = decodeMethod.call(this.decoder_);
+  }
+  jspb.asserts.assert(this.decoder_.getCursor() == end);
+  return result;
+};
+
+
+/**
+ * Reads a packed int32 field into an Int32Array.
+ * @return {!Int32Array}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedInt32TypedArray = function() {
+  return this.readPackedVarintTypedArray_(
+      Int32Array, this.decoder_.readSignedVarint32);
+};
+
+
+/**
+ * Reads a packed uint32 field into a Uint32Array.
+ * @return {!Uint32Array}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedUint32TypedArray = function() {
+  return this.readPackedVarintTypedArray_(
+      Uint32Array, this.decoder_.readUnsignedVarint32);
+};
+
+
+/**
+ * Reads a packed sint32 field into an Int32Array.
+ * @return {!Int32Array}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedSint32TypedArray = function() {
+  return this.readPackedVarintTypedArray_(
+      Int32Array, this.decoder_.readZigzagVarint32);
+};
+
+
+/**
+ * Reads a packed fixed32 field into a Uint32Array.
+ * @return {!Uint32Array}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedFixed32TypedArray = function() {
+  return this.readPackedFixedTypedArray_(
+      Uint32Array, 4, this.decoder_.readUint32);
+};
+
+
+/**
+ * Reads a packed sfixed32 field into an Int32Array.
+ * @return {!Int32Array}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedSfixed32TypedArray = function() {
+  return this.readPackedFixedTypedArray_(
+      Int32Array, 4, this.decoder_.readInt32);
+};
+
+
+/**
+ * Reads a packed float field into a Float32Array.
+ * @return {!Float32Array}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedFloatTypedArray = function() {
+  return this.readPackedFixedTypedArray_(
+      Float32Array, 4, this.decoder_.readFloat);
+};
+
+
+/**
+ * Reads a packed double field into a Float64Array.
+ * @return {!Float64Array}
+ * @export
+ */
+jspb.BinaryReader.prototype.readPackedDoubleTypedArray = function() {
+  return this.readPackedFixedTypedArray_(
+      Float64Array, 8, this.decoder_.readDouble);
+};
+
+
+
+/**
+ * BinaryDelimitedReader decodes a stream of length-delimited messages, each
+ * prefixed by its length as a varint, which arrives in chunks of bytes. A
+ * message that lies within one chunk is decoded in place, from that chunk;
+ * only a message split across chunks is first copied to a buffer of its own.
+ *
+ * @param {function(new:T)} ctor The constructor of the message type.
+ * @param {function(T, !jspb.BinaryReader)} readerCallback The generated
+ *     deserializeBinaryFromReader() function of the message type.
+ * @constructor
+ * @struct
+ * @template T
+ * @export
+ */
+jspb.BinaryDelimitedReader = function(ctor, readerCallback) {
+  /** @private @const {function(new:T)} */
+  this.ctor_ = ctor;
+
+  /** @private @const {function(T, !jspb.BinaryReader)} */
+  this.readerCallback_ = readerCallback;
+
+  /**
+   * The chunks that have not been fully decoded yet, oldest first.
+   * @private @const {!Array<!Uint8Array>}
+   */
+  this.chunks_ = [];
+
+  /**
+   * The offset of the first byte that has not been decoded in chunks_[0].
+   * @private {number}
+   */
+  this.offset_ = 0;
+
+  /**
+   * The number of bytes in chunks_ that have not been decoded yet.
+   * @private {number}
+   */
+  this.available_ = 0;
+};
+
+
+/**
+ * Appends a chunk of bytes to the stream. The chunk must not be modified
+ * until all the messages in it have been decoded.
+ * @param {!Uint8Array} chunk
+ * @export
+ */
+jspb.BinaryDelimitedReader.prototype.push = function(chunk) {
+  if (chunk.length) {
+    this.chunks_.push(chunk);
+    this.available_ += chunk.length;
+  }
+};
+
+
+/**
+ * Decodes the next message of the stream.
+ * @return {T|undefined} The message, or undefined if the bytes pushed so far
+ *     do not hold a complete message.
+ * @export
+ */
+jspb.BinaryDelimitedReader.prototype.next = function() {
+  // Decode the length prefix, which may itself be split across chunks.
+  var length = 0;
+  var prefixLength = 0;
+  var chunk = 0;
+  var offset = this.offset_;
+  var b;
+  do {
+    if (prefixLength == this.available_) {
+      return undefined;
+    }
+    if (offset == this.chunks_[chunk].length) {
+      chunk++;
+      offset = 0;
+    }
+    b = this.chunks_[chunk][offset++];
+    length += (b & 0x7f) * Math.pow(2, 7 * prefixLength++);
+  } while (b & 0x80 && prefixLength < 5);
+  if (b & 0x80 || length > 0x7fffffff) {
+    throw new Error('Invalid length prefix in delimited message stream');
+  }
+  if (this.available_ - prefixLength < length) {
+    return undefined;
+  }
+  this.skip_(prefixLength);
+
+  var bytes;
+  var start = this.offset_;
+  if (!length) {
+    bytes = jspb.BinaryDelimitedReader.EMPTY_;
+    start = 0;
+  } else if (this.chunks_[0].length - start >= length) {
+    bytes = this.chunks_[0];
+  } else {
+    bytes = new Uint8Array(length);
+    for (var copied = 0, i = 0; copied < length; i++) {
+      var part = this.chunks_[i].subarray(
+          i ? 0 : start, (i ? 0 : start) + length - copied);
+      bytes.set(part, copied);
+      copied += part.length;
+    }
+    start = 0;
+  }
+
+  var reader = jspb.BinaryReader.alloc(bytes, start, length);
+  var message = new this.ctor_();
+  this.readerCallback_(message, reader);
+  reader.free();
+  this.skip_(length);
+  return message;
+};
+
+
+/**
+ * Advances past the given number of bytes, dropping the chunks that have been
+ * fully decoded.
+ * @param {number} count
+ * @private
+ */
+jspb.BinaryDelimitedReader.prototype.skip_ = function(count) {
+  this.available_ -= count;
+  this.offset_ += count;
+  while (this.chunks_.length && this.offset_ >= this.chunks_[0].length) {
+    this.offset_ -= this.chunks_.shift().length;
+  }
+};
+
+
+/**
+ * Checks that the stream did not end in the middle of a message.
+ * @export
+ */
+jspb.BinaryDelimitedReader.prototype.end = function() {
+  if (this.available_) {
+    throw new Error(
+        'Delimited message stream ends with ' + this.available_ +
+        ' bytes of an incomplete message');
+  }
+};
+
+
+/**
+ * The bytes from which empty messages are decoded.
+ * @private @const {!Uint8Array}
+ */
+jspb.BinaryDelimitedReader.EMPTY_ = new Uint8Array(0);
+
+
+/**
+ * Returns the messages of a stream of length-delimited messages that arrives
+ * as the given chunks of bytes. If the chunks come from an async iterable,
+ * such as a Node.js stream, the messages are returned as an async iterable.
+ * @param {!Iterable<!Uint8Array>|!AsyncIterable<!Uint8Array>} source
+ * @param {function(new:T)} ctor The constructor of the message type.
+ * @param {function(T, !jspb.BinaryReader)} readerCallback The generated
+ *     deserializeBinaryFromReader() function of the message type.
+ * @return {!IteratorIterable<T>|!AsyncIterable<T>}
+ * @template T
+ * @export
+ */
+jspb.BinaryDelimitedReader.iterate = function(source, ctor, readerCallback) {
+  var reader = new jspb.BinaryDelimitedReader(ctor, readerCallback);
+  if (typeof Symbol != 'undefined' && Symbol.asyncIterator &&
+      source[Symbol.asyncIterator]) {
+    return new jspb.BinaryDelimitedReader.AsyncIterator_(
+        reader, source[Symbol.asyncIterator]());
+  }
+  return new jspb.BinaryDelimitedReader.Iterator_(
+      reader, source[Symbol.iterator]());
+};
+
+
+
+/**
+ * Helper: an IteratorIterable over the messages of a stream.
+ * @param {!jspb.BinaryDelimitedReader<T>} reader
+ * @param {!Iterator<!Uint8Array>} chunks
+ * @implements {IteratorIterable<T>}
+ * @constructor @struct
+ * @template T
+ * @private
+ */
+jspb.BinaryDelimitedReader.Iterator_ = function(reader, chunks) {
+  /** @private @const */
+  this.reader_ = reader;
+
+  /** @private @const */
+  this.chunks_ = chunks;
+};
+
+
+/** @override @final */
+jspb.BinaryDelimitedReader.Iterator_.prototype.next = function() {
+  var message;
+  while ((message = this.reader_.next()) === undefined) {
+    var chunk = this.chunks_.next();
+    if (chunk.done) {
+      this.reader_.end();
+      return {done: true, value: undefined};
+    }
+    this.reader_.push(chunk.value);
+  }
+  return {done: false, value: message};
+};
+
+if (typeof(Symbol) != 'undefined') {
+  /** @override */
+  jspb.BinaryDelimitedReader.Iterator_.prototype[Symbol.iterator] = function() {
+    return this;
+  };
+}
+
+
+
+/**
+ * Helper: an AsyncIterable over the messages of a stream.
+ * @param {!jspb.BinaryDelimitedReader<T>} reader
+ * @param {!AsyncIterator<!Uint8Array>} chunks
+ * @constructor @struct
+ * @template T
+ * @private
+ */
+jspb.BinaryDelimitedReader.AsyncIterator_ = function(reader, chunks) {
+  /** @private @const */
+  this.reader_ = reader;
+
+  /** @private @const */
+  this.chunks_ = chunks;
+};
+
+
+/**
+ * @return {!Promise<!IIterableResult<T>>}
+ */
+jspb.BinaryDelimitedReader.AsyncIterator_.prototype.next = function() {
+  var message = this.reader_.next();
+  if (message !== undefined) {
+    return Promise.resolve({done: false, value: message});
+  }
+  var self = this;
+  return this.chunks_.next().then(function(chunk) {
+    if (chunk.done) {
+      self.reader_.end();
+      return {done: true, value: undefined};
+    }
+    self.reader_.push(chunk.value);
+    return self.next();
+  });
+};
+
+if (typeof(Symbol) != 'undefined' && Symbol.asyncIterator) {
+  jspb.BinaryDelimitedReader.AsyncIterator_.prototype[Symbol.asyncIterator] =
+      function() {
+    return this;
+  };
+}
+
+
+
+/**
+ * BinaryProjection selects the fields that a partial decode of a message
+ * reads; the decoder skips all other fields. It holds the numbers of the
+ * selected fields as a bitset, and for each selected message field of which
+ * only some fields are selected, the projection of that submessage.
+ * Projections are compiled from field mask paths by the generated
+ * compileFieldMask() of a message type.
+ * @constructor
+ * @struct
+ * @export
+ */
+jspb.BinaryProjection = function() {
+  /**
+   * The selected field numbers, 32 to an element.
+   * @private @const {!Array<number>}
+   */
+  this.bits_ = [];
+
+  /**
+   * The projections of the partially selected message fields, by number.
+   * @private @const {!Object<number, !jspb.BinaryProjection>}
+   */
+  this.children_ = {};
+};
+
+
+/**
+ * Compiles field mask paths, made of field names separated by dots as in
+ * google.protobuf.FieldMask, into a projection of the given message type.
+ * @param {function(new:jspb.Message)} ctor The constructor of the message type.
+ * @param {!Array<string>} paths
+ * @return {!jspb.BinaryProjection}
+ * @export
+ */
+jspb.BinaryProjection.compile = function(ctor, paths) {
+  var projection = new jspb.BinaryProjection();
+  for (var i = 0; i < paths.length; i++) {
+    projection.add_(ctor, paths[i].split('.'), 0, paths[i]);
+  }
+  return projection;
+};
+
+
+/**
+ * Selects the field named by the given path, from depth on.
+ * @param {function(new:jspb.Message)} ctor The constructor of the message type.
+ * @param {!Array<string>} names The field names of the path.
+ * @param {number} depth The index in names of a field of this message.
+ * @param {string} path The path, for errors.
+ * @private
+ */
+jspb.BinaryProjection.prototype.add_ = function(ctor, names, depth, path) {
+  var fields = /** @type {?} */ (ctor).getFieldMaskFields();
+  var field = fields.hasOwnProperty(names[depth]) ? fields[names[depth]] : null;
+  if (!field || (depth + 1 < names.length && !field[1])) {
+    throw new Error('Field mask path ' + path + ' does not name a field');
+  }
+  var number = field[0];
+  var wholeField = this.has(number) && !this.children_[number];
+  this.bits_[number >>> 5] |= 1 << (number & 31);
+  if (depth + 1 == names.length) {
+    delete this.children_[number];
+  } else if (!wholeField) {
+    var child = this.children_[number] ||
+        (this.children_[number] = new jspb.BinaryProjection());
+    child.add_(field[1], names, depth + 1, path);
+  }
+};
+
+
+/**
+ * @param {number} fieldNumber
+ * @return {boolean} Whether the field is selected.
+ * @export
+ */
+jspb.BinaryProjection.prototype.has = function(fieldNumber) {
+  return ((this.bits_[fieldNumber >>> 5] >>> (fieldNumber & 31)) & 1) != 0;
+};
+
+
+/**
+ * @param {number} fieldNumber The number of a selected message field.
+ * @return {!jspb.BinaryProjection|undefined} The projection of the
+ *     submessage, or undefined if all its fields are selected.
+ * @export
+ */
+jspb.BinaryProjection.prototype.child = function(fieldNumber) {
+  return this.children_[fieldNumber];
+};
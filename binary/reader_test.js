@@ -41,8 +41,11 @@
  * @author aappleby@google.com (Austin Appleby)
  */
 
+goog.require('jspb.BinaryBufferWriter');
 goog.require('jspb.BinaryConstants');
 goog.require('jspb.BinaryDecoder');
+goog.require('jspb.BinaryDelimitedReader');
+goog.require('jspb.BinaryProjection');
 goog.require('jspb.BinaryReader');
 goog.require('jspb.BinaryWriter');
 goog.require('jspb.utils');
@@ -118,6 +121,33 @@ describe('binaryReaderTest', () => {
   });
 
 
+  /**
+   * Tests pointing a reader at new bytes with reset().
+   */
+  it('testResetWithBytes', () => {
+    const writer1 = new jspb.BinaryWriter();
+    writer1.writeInt32(1, 5);
+    const writer2 = new jspb.BinaryWriter();
+    writer2.writeString(2, 'abc');
+
+    const reader = new jspb.BinaryReader(writer1.getResultBuffer());
+    reader.nextField();
+    expect(reader.readInt32()).toEqual(5);
+    expect(reader.nextField()).toEqual(false);
+
+    reader.reset(writer2.getResultBuffer());
+    expect(reader.nextField()).toEqual(true);
+    expect(reader.getFieldNumber()).toEqual(2);
+    expect(reader.readString()).toEqual('abc');
+    expect(reader.nextField()).toEqual(false);
+
+    // Without bytes, reset() rewinds to the start of the current bytes.
+    reader.reset();
+    expect(reader.nextField()).toEqual(true);
+    expect(reader.getFieldNumber()).toEqual(2);
+  });
+
+
   /**
    * @param {number} x
    * @return {number}
@@ -508,6 +538,83 @@ describe('binaryReaderTest', () => {
   });
 
 
+  /**
+   * Tests 64-bit fields that are handled as BigInts, against the string
+   * variants.
+   */
+  it('testBigIntInt64Fields', () => {
+    const testSignedData = [
+      '0', '1', '-1', '63', '-64', '127', '-128', '9007199254740993',
+      '-9007199254740993', '2730538252207801776', '-2688470994844604560',
+      '9223372036854774807', '-9223372036854775808'
+    ];
+    const testUnsignedData = [
+      '0', '1', '127', '128', '9007199254740993', '7822732630241694882',
+      '16948784802625696584', '18446744073709551615'
+    ];
+
+    const stringWriter = new jspb.BinaryWriter();
+    const bigIntWriter = new jspb.BinaryWriter();
+    for (const value of testSignedData) {
+      stringWriter.writeInt64String(1, value);
+      stringWriter.writeSint64String(2, value);
+      stringWriter.writeSfixed64String(3, value);
+      bigIntWriter.writeInt64BigInt(1, BigInt(value));
+      bigIntWriter.writeSint64BigInt(2, BigInt(value));
+      bigIntWriter.writeSfixed64BigInt(3, BigInt(value));
+    }
+    for (const value of testUnsignedData) {
+      stringWriter.writeUint64String(4, value);
+      stringWriter.writeFixed64String(5, value);
+      bigIntWriter.writeUint64BigInt(4, BigInt(value));
+      bigIntWriter.writeFixed64BigInt(5, BigInt(value));
+    }
+    stringWriter.writePackedInt64String(6, testSignedData);
+    stringWriter.writePackedSint64String(7, testSignedData);
+    stringWriter.writePackedSfixed64String(8, testSignedData);
+    stringWriter.writePackedUint64String(9, testUnsignedData);
+    stringWriter.writePackedFixed64String(10, testUnsignedData);
+    bigIntWriter.writePackedInt64BigInt(6, testSignedData.map(BigInt));
+    bigIntWriter.writePackedSint64BigInt(7, testSignedData.map(BigInt));
+    bigIntWriter.writePackedSfixed64BigInt(8, testSignedData.map(BigInt));
+    bigIntWriter.writePackedUint64BigInt(9, testUnsignedData.map(BigInt));
+    bigIntWriter.writePackedFixed64BigInt(10, testUnsignedData.map(BigInt));
+
+    const buffer = bigIntWriter.getResultBuffer();
+    expect(buffer).toEqual(stringWriter.getResultBuffer());
+
+    const reader = jspb.BinaryReader.alloc(buffer);
+    for (const value of testSignedData) {
+      reader.nextField();
+      expect(reader.readInt64BigInt()).toEqual(BigInt(value));
+      reader.nextField();
+      expect(reader.readSint64BigInt()).toEqual(BigInt(value));
+      reader.nextField();
+      expect(reader.readSfixed64BigInt()).toEqual(BigInt(value));
+    }
+    for (const value of testUnsignedData) {
+      reader.nextField();
+      expect(reader.readUint64BigInt()).toEqual(BigInt(value));
+      reader.nextField();
+      expect(reader.readFixed64BigInt()).toEqual(BigInt(value));
+    }
+    reader.nextField();
+    expect(reader.readPackedInt64BigInt()).toEqual(testSignedData.map(BigInt));
+    reader.nextField();
+    expect(reader.readPackedSint64BigInt()).toEqual(testSignedData.map(BigInt));
+    reader.nextField();
+    expect(reader.readPackedSfixed64BigInt())
+        .toEqual(testSignedData.map(BigInt));
+    reader.nextField();
+    expect(reader.readPackedUint64BigInt())
+        .toEqual(testUnsignedData.map(BigInt));
+    reader.nextField();
+    expect(reader.readPackedFixed64BigInt())
+        .toEqual(testUnsignedData.map(BigInt));
+    expect(reader.nextField()).toBe(false);
+  });
+
+
   /**
    * Tests fields that use zigzag encoding.
    */
@@ -697,6 +804,47 @@ describe('binaryReaderTest', () => {
     expect(reader.nextField()).toEqual(false);
   });
 
+  /**
+   * Tests advancing to expected fields with nextFieldIf().
+   */
+  it('testNextFieldIf', () => {
+    const VARINT = jspb.BinaryConstants.WireType.VARINT;
+    const DELIMITED = jspb.BinaryConstants.WireType.DELIMITED;
+    const writer = new jspb.BinaryWriter();
+    writer.writeInt32(1, 10);
+    writer.writeInt32(16, 11);
+    writer.writeString(32, 'a');
+    writer.writeInt32(2, 12);
+
+    const reader = jspb.BinaryReader.alloc(writer.getResultBuffer());
+    expect(reader.nextFieldIf((2 << 3) | VARINT)).toBe(false);
+    expect(reader.nextFieldIf((1 << 3) | DELIMITED)).toBe(false);
+    expect(reader.nextFieldIf((1 << 3) | VARINT)).toBe(true);
+    expect(reader.getFieldNumber()).toEqual(1);
+    expect(reader.getWireType()).toEqual(VARINT);
+    expect(reader.readInt32()).toEqual(10);
+
+    // Two-byte headers.
+    expect(reader.nextFieldIf((16 << 3) | VARINT)).toBe(true);
+    expect(reader.getFieldNumber()).toEqual(16);
+    expect(reader.readInt32()).toEqual(11);
+    // The header of field 16 starts with the same byte as that of field 32.
+    expect(reader.nextFieldIf((16 << 3) | DELIMITED)).toBe(false);
+    expect(reader.nextFieldIf((32 << 3) | DELIMITED)).toBe(true);
+    expect(reader.getFieldNumber()).toEqual(32);
+    expect(reader.getWireType()).toEqual(DELIMITED);
+    expect(reader.readString()).toEqual('a');
+
+    // Falling back to nextField().
+    expect(reader.nextFieldIf((3 << 3) | VARINT)).toBe(false);
+    expect(reader.nextField()).toBe(true);
+    expect(reader.getFieldNumber()).toEqual(2);
+    expect(reader.readInt32()).toEqual(12);
+    expect(reader.nextFieldIf((2 << 3) | VARINT)).toBe(false);
+    expect(reader.nextField()).toBe(false);
+  });
+
+
   /**
    * Tests skipping fields of each type by interleaving them with sentinel
    * values and skipping everything that's not a sentinel.
@@ -888,6 +1036,74 @@ describe('binaryReaderTest', () => {
   });
 
 
+  /**
+   * Tests reading packed fields into typed arrays.
+   */
+  it('testPackedTypedArrayFields', () => {
+    const writer = new jspb.BinaryWriter();
+
+    const unsignedData = [1, 2, 300, 4000000000];
+    const signedData = [-1, 2, -300, 2147483647];
+    const floatData = [1.5, -2.25, 0, 1e10];
+    const doubleData = [1.1, -2.2, 0, Number.MAX_VALUE];
+
+    // A leading varint puts the fixed-width payloads at unaligned offsets.
+    writer.writeInt32(1, 1);
+    writer.writePackedInt32(2, signedData);
+    writer.writePackedUint32(2, unsignedData);
+    writer.writePackedSint32(2, signedData);
+    writer.writePackedFixed32(2, unsignedData);
+    writer.writePackedSfixed32(2, signedData);
+    writer.writePackedFloat(2, floatData);
+    writer.writePackedDouble(2, doubleData);
+    writer.writeInt32(3, 3);
+
+    const reader = jspb.BinaryReader.alloc(writer.getResultBuffer());
+
+    reader.nextField();
+    expect(reader.readInt32()).toEqual(1);
+
+    reader.nextField();
+    let values = reader.readPackedInt32TypedArray();
+    expect(values instanceof Int32Array).toBe(true);
+    expect(Array.from(values)).toEqual(signedData);
+
+    reader.nextField();
+    values = reader.readPackedUint32TypedArray();
+    expect(values instanceof Uint32Array).toBe(true);
+    expect(Array.from(values)).toEqual(unsignedData);
+
+    reader.nextField();
+    values = reader.readPackedSint32TypedArray();
+    expect(values instanceof Int32Array).toBe(true);
+    expect(Array.from(values)).toEqual(signedData);
+
+    reader.nextField();
+    values = reader.readPackedFixed32TypedArray();
+    expect(values instanceof Uint32Array).toBe(true);
+    expect(Array.from(values)).toEqual(unsignedData);
+
+    reader.nextField();
+    values = reader.readPackedSfixed32TypedArray();
+    expect(values instanceof Int32Array).toBe(true);
+    expect(Array.from(values)).toEqual(signedData);
+
+    reader.nextField();
+    values = reader.readPackedFloatTypedArray();
+    expect(values instanceof Float32Array).toBe(true);
+    expect(Array.from(values)).toEqual(floatData.map(truncate));
+
+    reader.nextField();
+    values = reader.readPackedDoubleTypedArray();
+    expect(values instanceof Float64Array).toBe(true);
+    expect(Array.from(values)).toEqual(doubleData);
+
+    reader.nextField();
+    expect(reader.readInt32()).toEqual(3);
+    expect(reader.nextField()).toEqual(false);
+  });
+
+
   /**
    * Byte blobs inside nested messages should always have their byte offset set
    * relative to the start of the outermost blob, not the start of their parent
@@ -990,4 +1206,98 @@ describe('binaryReaderTest', () => {
 
     expect(reader.nextField()).toEqual(false);
   });
+
+
+  /**
+   * Tests decoding a stream of length-delimited messages split into chunks.
+   */
+  it('testDelimitedReader', () => {
+    /** @constructor */
+    const Record = function() {
+      this.value = '';
+    };
+    const write = (record, writer) => {
+      writer.writeString(1, record.value);
+    };
+    const read = (record, reader) => {
+      while (reader.nextField()) {
+        record.value = reader.readString();
+      }
+    };
+
+    const values = ['', 'a', 'x'.repeat(200), 'bc', ''];
+    const parts = [];
+    const bufferWriter = new jspb.BinaryBufferWriter(4);
+    for (let i = 0; i < values.length; i++) {
+      const record = new Record();
+      record.value = values[i];
+      const writer = i % 2 ? bufferWriter : new jspb.BinaryWriter();
+      parts.push(writer.serializeDelimited(record, write));
+    }
+    const stream = new Uint8Array(
+        parts.reduce((length, part) => length + part.length, 0));
+    for (let i = 0, offset = 0; i < parts.length; i++) {
+      stream.set(parts[i], offset);
+      offset += parts[i].length;
+    }
+
+    // Messages and their 2-byte length prefix are split across chunks.
+    for (const size of [1, 3, 64, stream.length]) {
+      const chunks = [];
+      for (let offset = 0; offset < stream.length; offset += size) {
+        chunks.push(stream.subarray(offset, offset + size));
+      }
+      const decoded = [];
+      for (const record of jspb.BinaryDelimitedReader.iterate(
+               chunks, Record, read)) {
+        decoded.push(record.value);
+      }
+      expect(decoded).toEqual(values);
+    }
+
+    // A stream ending in the middle of a message is an error.
+    expect(() => {
+      for (const record of jspb.BinaryDelimitedReader.iterate(
+               [stream.subarray(0, 6)], Record, read)) {
+      }
+    }).toThrow();
+
+    const reader = new jspb.BinaryDelimitedReader(Record, read);
+    reader.push(stream.subarray(0, 3));
+    expect(reader.next().value).toEqual('');
+    expect(reader.next()).toBeUndefined();
+    reader.push(stream.subarray(3));
+    expect(reader.next().value).toEqual('a');
+  });
+
+
+  /**
+   * Tests that field mask paths compile into the selected fields and the
+   * projections of partially selected submessages.
+   */
+  it('testProjection', () => {
+    const Inner = function() {};
+    Inner.getFieldMaskFields = () => ({'a': [1], 'b': [40]});
+    const Outer = function() {};
+    Outer.getFieldMaskFields =
+        () => ({'x': [3], 'inner': [5, Inner], 'other': [70, Inner]});
+
+    const projection = jspb.BinaryProjection.compile(
+        Outer, ['x', 'inner.b', 'other.a', 'other']);
+    expect(projection.has(3)).toEqual(true);
+    expect(projection.has(5)).toEqual(true);
+    expect(projection.has(70)).toEqual(true);
+    expect(projection.has(1)).toEqual(false);
+    expect(projection.has(38)).toEqual(false);
+    expect(projection.child(3)).toBeUndefined();
+    // Selecting a whole field wins over selecting some of its fields.
+    expect(projection.child(70)).toBeUndefined();
+    const inner = projection.child(5);
+    expect(inner.has(40)).toEqual(true);
+    expect(inner.has(1)).toEqual(false);
+
+    expect(() => jspb.BinaryProjection.compile(Outer, ['y'])).toThrow();
+    expect(() => jspb.BinaryProjection.compile(Outer, ['x.a'])).toThrow();
+    expect(() => jspb.BinaryProjection.compile(Outer, ['inner.c'])).toThrow();
+  });
 });
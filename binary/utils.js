@@ -174,6 +174,43 @@ jspb.utils.splitZigzag64 = function(value) {
 };
 
 
+/**
+ * Splits a BigInt into two 32-bit halves of its 64-bit two's complement
+ * representation, and stores it in the temp values above. Values that are
+ * exact as numbers are split without any BigInt arithmetic.
+ * @param {bigint} value The BigInt to split.
+ * @export
+ */
+jspb.utils.splitBigInt = function(value) {
+  if (value >= -jspb.BinaryConstants.TWO_TO_52 &&
+      value <= jspb.BinaryConstants.TWO_TO_52) {
+    jspb.utils.splitInt64(Number(value));
+    return;
+  }
+  jspb.utils.split64Low = Number(BigInt.asUintN(32, value));
+  jspb.utils.split64High = Number(BigInt.asUintN(32, value >> BigInt(32)));
+};
+
+
+/**
+ * Converts a signed BigInt into zigzag format, splits it into two 32-bit
+ * halves, and stores it in the temp values above.
+ * @param {bigint} value The BigInt to split.
+ * @export
+ */
+jspb.utils.splitZigzagBigInt = function(value) {
+  if (value >= -jspb.BinaryConstants.TWO_TO_52 &&
+      value <= jspb.BinaryConstants.TWO_TO_52) {
+    jspb.utils.splitZigzag64(Number(value));
+    return;
+  }
+  // 64-bit math is: (n << 1) ^ (n >> 63)
+  value = BigInt.asIntN(64, value);
+  jspb.utils.splitBigInt(
+      BigInt.asUintN(64, (value << BigInt(1)) ^ (value >> BigInt(63))));
+};
+
+
 /**
  * Converts a floating-point number into 32-bit IEEE representation and stores
  * it in the temp values above.
@@ -371,6 +408,44 @@ jspb.utils.joinInt64 = function(bitsLow, bitsHigh) {
   return sign ? -result : result;
 };
 
+
+/**
+ * Joins two 32-bit values into a 64-bit unsigned BigInt, without loss of
+ * precision.
+ * @param {number} bitsLow
+ * @param {number} bitsHigh
+ * @return {bigint}
+ * @export
+ */
+jspb.utils.joinUint64BigInt = function(bitsLow, bitsHigh) {
+  bitsLow = bitsLow >>> 0;
+  bitsHigh = bitsHigh >>> 0;
+  // Values below 2^53 are exact as numbers, and can be converted at once.
+  if (bitsHigh < 0x200000) {
+    return BigInt(bitsHigh * jspb.BinaryConstants.TWO_TO_32 + bitsLow);
+  }
+  return (BigInt(bitsHigh) << BigInt(32)) | BigInt(bitsLow);
+};
+
+
+/**
+ * Joins two 32-bit values into a 64-bit signed BigInt, without loss of
+ * precision.
+ * @param {number} bitsLow
+ * @param {number} bitsHigh
+ * @return {bigint}
+ * @export
+ */
+jspb.utils.joinInt64BigInt = function(bitsLow, bitsHigh) {
+  var high = bitsHigh | 0;
+  // Values in [-2^53, 2^53) are exact as numbers.
+  if (high >= -0x200000 && high < 0x200000) {
+    return BigInt(high * jspb.BinaryConstants.TWO_TO_32 + (bitsLow >>> 0));
+  }
+  return BigInt.asIntN(64, jspb.utils.joinUint64BigInt(bitsLow, bitsHigh));
+};
+
+
 /**
  * Converts split 64-bit values from standard two's complement encoding to
  * zig-zag encoding. Invokes the provided function to produce final result.
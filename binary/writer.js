@@ -56,6 +56,9 @@
  * @author aappleby@google.com (Austin Appleby)
  */
 
+goog.provide('jspb.BinaryBufferWriter');
+goog.provide('jspb.BinaryPresizedWriter');
+goog.provide('jspb.BinarySizingWriter');
 goog.provide('jspb.BinaryWriter');
 
 goog.require('goog.crypt.base64');
@@ -63,6 +66,8 @@ goog.require('goog.crypt.base64');
 goog.require('jspb.asserts');
 goog.require('jspb.BinaryConstants');
 goog.require('jspb.BinaryEncoder');
+goog.require('jspb.BinaryFixedEncoder');
+goog.require('jspb.BinarySizeEncoder');
 goog.require('jspb.arith.Int64');
 goog.require('jspb.arith.UInt64');
 goog.require('jspb.utils');
@@ -206,6 +211,56 @@ jspb.BinaryWriter.prototype.reset = function() {
 };
 
 
+/**
+ * Serializes a complete message with this writer and returns the result. The
+ * writer is reset first, so that one writer can serialize many messages in
+ * turn; see also jspb.BinaryBufferWriter.
+ * @param {MessageType} value The message to serialize.
+ * @param {function(MessageType, !jspb.BinaryWriter)} writerCallback The
+ *     generated serializeBinaryToWriter() function of the message.
+ * @return {!Uint8Array}
+ * @template MessageType
+ * @export
+ */
+jspb.BinaryWriter.prototype.serialize = function(value, writerCallback) {
+  this.reset();
+  writerCallback(value, this);
+  return this.getResultBuffer();
+};
+
+
+/**
+ * Like serialize(), but prefixes the message with its length as a varint, as
+ * in a stream of length-delimited messages; see jspb.BinaryDelimitedReader.
+ * @param {MessageType} value The message to serialize.
+ * @param {function(MessageType, !jspb.BinaryWriter)} writerCallback The
+ *     generated serializeBinaryToWriter() function of the message.
+ * @return {!Uint8Array}
+ * @template MessageType
+ * @export
+ */
+jspb.BinaryWriter.prototype.serializeDelimited = function(
+    value, writerCallback) {
+  this.reset();
+  // A bookmark as from beginDelimited_(), without a field header.
+  var bookmark = this.encoder_.end();
+  this.blocks_.push(bookmark);
+  bookmark.push(this.totalLength_);
+  writerCallback(value, this);
+  this.endDelimited_(bookmark);
+  return this.getResultBuffer();
+};
+
+
+/**
+ * @return {number} The number of bytes written so far.
+ * @export
+ */
+jspb.BinaryWriter.prototype.getLength = function() {
+  return this.totalLength_ + this.encoder_.length();
+};
+
+
 /**
  * Converts the encoded data into a Uint8Array.
  * @return {!Uint8Array}
@@ -236,6 +291,7 @@ jspb.BinaryWriter.prototype.getResultBuffer = function() {
   // Replace our block list with the flattened block, which lets GC reclaim
   // the temp blocks sooner.
   this.blocks_ = [flat];
+  this.totalLength_ = flat.length;
 
   return flat;
 };
@@ -748,6 +804,76 @@ jspb.BinaryWriter.prototype.writeSfixed64String = function(field, value) {
 };
 
 
+/**
+ * Writes an int64 BigInt field to the buffer. Numbers outside the range
+ * [-2^63,2^63) will be truncated.
+ * @param {number} field The field number.
+ * @param {bigint?} value The value to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeInt64BigInt = function(field, value) {
+  if (value == null) return;
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.VARINT);
+  this.encoder_.writeSignedVarint64BigInt(value);
+};
+
+
+/**
+ * Writes a uint64 BigInt field to the buffer. Numbers outside the range
+ * [0,2^64) will be truncated.
+ * @param {number} field The field number.
+ * @param {bigint?} value The value to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeUint64BigInt = function(field, value) {
+  if (value == null) return;
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.VARINT);
+  this.encoder_.writeUnsignedVarint64BigInt(value);
+};
+
+
+/**
+ * Writes a sint64 BigInt field to the buffer. Numbers outside the range
+ * [-2^63,2^63) will be truncated.
+ * @param {number} field The field number.
+ * @param {bigint?} value The value to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeSint64BigInt = function(field, value) {
+  if (value == null) return;
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.VARINT);
+  this.encoder_.writeZigzagVarint64BigInt(value);
+};
+
+
+/**
+ * Writes a fixed64 BigInt field to the buffer. Numbers outside the range
+ * [0,2^64) will be truncated.
+ * @param {number} field The field number.
+ * @param {bigint?} value The value to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeFixed64BigInt = function(field, value) {
+  if (value == null) return;
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.FIXED64);
+  this.encoder_.writeUint64BigInt(value);
+};
+
+
+/**
+ * Writes a sfixed64 BigInt field to the buffer. Numbers outside the range
+ * [-2^63,2^63) will be truncated.
+ * @param {number} field The field number.
+ * @param {bigint?} value The value to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeSfixed64BigInt = function(field, value) {
+  if (value == null) return;
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.FIXED64);
+  this.encoder_.writeInt64BigInt(value);
+};
+
+
 /**
  * Writes a single-precision floating point field to the buffer. Numbers
  * requiring more than 32 bits of precision will be truncated.
@@ -1320,6 +1446,78 @@ jspb.BinaryWriter.prototype.writeRepeatedSfixed64String = function(
 };
 
 
+/**
+ * Writes an array of BigInts to the buffer as a repeated int64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeRepeatedInt64BigInt = function(field, value) {
+  if (value == null) return;
+  for (var i = 0; i < value.length; i++) {
+    this.writeInt64BigInt(field, value[i]);
+  }
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a repeated uint64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeRepeatedUint64BigInt = function(field, value) {
+  if (value == null) return;
+  for (var i = 0; i < value.length; i++) {
+    this.writeUint64BigInt(field, value[i]);
+  }
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a repeated sint64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeRepeatedSint64BigInt = function(field, value) {
+  if (value == null) return;
+  for (var i = 0; i < value.length; i++) {
+    this.writeSint64BigInt(field, value[i]);
+  }
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a repeated fixed64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeRepeatedFixed64BigInt = function(
+    field, value) {
+  if (value == null) return;
+  for (var i = 0; i < value.length; i++) {
+    this.writeFixed64BigInt(field, value[i]);
+  }
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a repeated sfixed64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writeRepeatedSfixed64BigInt = function(
+    field, value) {
+  if (value == null) return;
+  for (var i = 0; i < value.length; i++) {
+    this.writeSfixed64BigInt(field, value[i]);
+  }
+};
+
+
 /**
  * Writes an array of numbers to the buffer as a repeated float field.
  * @param {number} field The field number.
@@ -1840,6 +2038,86 @@ jspb.BinaryWriter.prototype.writePackedSfixed64String = function(field, value) {
 };
 
 
+/**
+ * Writes an array of BigInts to the buffer as a packed int64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writePackedInt64BigInt = function(field, value) {
+  if (value == null || !value.length) return;
+  var bookmark = this.beginDelimited_(field);
+  for (var i = 0; i < value.length; i++) {
+    this.encoder_.writeSignedVarint64BigInt(value[i]);
+  }
+  this.endDelimited_(bookmark);
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a packed uint64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writePackedUint64BigInt = function(field, value) {
+  if (value == null || !value.length) return;
+  var bookmark = this.beginDelimited_(field);
+  for (var i = 0; i < value.length; i++) {
+    this.encoder_.writeUnsignedVarint64BigInt(value[i]);
+  }
+  this.endDelimited_(bookmark);
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a packed sint64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writePackedSint64BigInt = function(field, value) {
+  if (value == null || !value.length) return;
+  var bookmark = this.beginDelimited_(field);
+  for (var i = 0; i < value.length; i++) {
+    this.encoder_.writeZigzagVarint64BigInt(value[i]);
+  }
+  this.endDelimited_(bookmark);
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a packed fixed64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writePackedFixed64BigInt = function(field, value) {
+  if (value == null || !value.length) return;
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.DELIMITED);
+  this.encoder_.writeUnsignedVarint32(value.length * 8);
+  for (var i = 0; i < value.length; i++) {
+    this.encoder_.writeUint64BigInt(value[i]);
+  }
+};
+
+
+/**
+ * Writes an array of BigInts to the buffer as a packed sfixed64 field.
+ * @param {number} field The field number.
+ * @param {?Array<bigint>} value The array of BigInts to write.
+ * @export
+ */
+jspb.BinaryWriter.prototype.writePackedSfixed64BigInt = function(field, value) {
+  if (value == null || !value.length) return;
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.DELIMITED);
+  this.encoder_.writeUnsignedVarint32(value.length * 8);
+  for (var i = 0; i < value.length; i++) {
+    this.encoder_.writeInt64BigInt(value[i]);
+  }
+};
+
+
 /**
  * Writes an array of numbers to the buffer as a packed float field.
  * @param {number} field The field number.
@@ -1936,3 +2214,303 @@ jspb.BinaryWriter.prototype.writePackedVarintHash64 = function(field, value) {
   }
   this.endDelimited_(bookmark);
 };
+
+
+
+/**
+ * BinarySizingWriter computes the serialized size of everything written to it,
+ * without encoding it. It also records the length of every delimited field, so
+ * that a BinaryPresizedWriter can then write the same data straight into a
+ * buffer of that size, without the intermediate blocks and the length patching
+ * of a BinaryWriter. Once reset, it reuses the storage of earlier uses.
+ *
+ * @constructor
+ * @extends {jspb.BinaryWriter}
+ * @struct
+ * @final
+ * @export
+ */
+jspb.BinarySizingWriter = function() {
+  jspb.BinaryWriter.call(this);
+  this.encoder_ = new jspb.BinarySizeEncoder();
+
+  /**
+   * The lengths of the delimited fields written so far, in the order in which
+   * they were started. Only the first lengthCount_ entries are valid.
+   * @private {!Array<number>}
+   */
+  this.lengths_ = [];
+
+  /** @private {number} */
+  this.lengthCount_ = 0;
+
+  /**
+   * For each delimited field being written, innermost last, the index of its
+   * length in lengths_ and the size before its contents. Only the first
+   * 2 * depth_ entries are valid.
+   * @private {!Array<number>}
+   */
+  this.starts_ = [];
+
+  /** @private {number} */
+  this.depth_ = 0;
+};
+goog.inherits(jspb.BinarySizingWriter, jspb.BinaryWriter);
+
+
+/**
+ * The bookmark returned by the beginDelimited_() methods of writers that keep
+ * track of delimited fields themselves.
+ * @private @const {!Array<number>}
+ */
+jspb.BinaryWriter.NO_BOOKMARK_ = [];
+
+
+/** @override */
+jspb.BinarySizingWriter.prototype.appendUint8Array_ = function(arr) {
+  this.encoder_.writeBytes(arr);
+};
+
+
+/** @override */
+jspb.BinarySizingWriter.prototype.beginDelimited_ = function(field) {
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.DELIMITED);
+  this.starts_[2 * this.depth_] = this.lengthCount_;
+  this.starts_[2 * this.depth_ + 1] = this.encoder_.length();
+  this.depth_++;
+  this.lengths_[this.lengthCount_++] = 0;
+  return jspb.BinaryWriter.NO_BOOKMARK_;
+};
+
+
+/** @override */
+jspb.BinarySizingWriter.prototype.endDelimited_ = function(bookmark) {
+  this.depth_--;
+  var length = this.encoder_.length() - this.starts_[2 * this.depth_ + 1];
+  this.lengths_[this.starts_[2 * this.depth_]] = length;
+  this.encoder_.writeUnsignedVarint32(length);
+};
+
+
+/**
+ * @override
+ * @export
+ */
+jspb.BinarySizingWriter.prototype.getLength = function() {
+  return this.encoder_.length();
+};
+
+
+/**
+ * @override
+ * @export
+ */
+jspb.BinarySizingWriter.prototype.reset = function() {
+  jspb.BinaryWriter.prototype.reset.call(this);
+  this.lengthCount_ = 0;
+  this.depth_ = 0;
+};
+
+
+/**
+ * A BinarySizingWriter only computes sizes; see BinaryPresizedWriter.
+ * @override
+ * @export
+ */
+jspb.BinarySizingWriter.prototype.getResultBuffer = function() {
+  throw new Error('BinarySizingWriter does not encode data');
+};
+
+
+
+/**
+ * BinaryPresizedWriter writes directly into a preallocated buffer. Exactly the
+ * same data must be written to it as was written to the BinarySizingWriter it
+ * is created from, which supplies the lengths of its delimited fields.
+ *
+ * @param {!jspb.BinarySizingWriter} sizer
+ * @param {!Uint8Array} buffer The buffer to write to.
+ * @param {number=} opt_offset The offset in the buffer to start writing at.
+ * @constructor
+ * @extends {jspb.BinaryWriter}
+ * @struct
+ * @final
+ * @export
+ */
+jspb.BinaryPresizedWriter = function(sizer, buffer, opt_offset) {
+  jspb.BinaryWriter.call(this);
+
+  /** @private @const {!jspb.BinaryFixedEncoder} */
+  this.fixedEncoder_ = new jspb.BinaryFixedEncoder(buffer, 0);
+  this.encoder_ = this.fixedEncoder_;
+
+  /** @private {!jspb.BinarySizingWriter} */
+  this.sizer_ = sizer;
+
+  /** @private {number} */
+  this.start_ = 0;
+
+  /** @private {number} */
+  this.end_ = 0;
+
+  /** @private {number} */
+  this.nextLength_ = 0;
+
+  /**
+   * The offsets after the delimited fields being written, innermost last. Only
+   * the first depth_ entries are valid.
+   * @private {!Array<number>}
+   */
+  this.ends_ = [];
+
+  /** @private {number} */
+  this.depth_ = 0;
+
+  this.init_(sizer, buffer, opt_offset || 0);
+};
+goog.inherits(jspb.BinaryPresizedWriter, jspb.BinaryWriter);
+
+
+/**
+ * Prepares the writer for writing into the given buffer.
+ * @param {!jspb.BinarySizingWriter} sizer
+ * @param {!Uint8Array} buffer
+ * @param {number} offset
+ * @private
+ */
+jspb.BinaryPresizedWriter.prototype.init_ = function(sizer, buffer, offset) {
+  var length = sizer.getLength();
+  if (offset < 0 || offset + length > buffer.length) {
+    throw new Error(
+        'Buffer of length ' + buffer.length + ' has no room for ' + length +
+        ' bytes at offset ' + offset);
+  }
+  this.fixedEncoder_.reset(buffer, offset);
+  this.sizer_ = sizer;
+  this.start_ = offset;
+  this.end_ = offset + length;
+  this.nextLength_ = 0;
+  this.depth_ = 0;
+};
+
+
+/** @override */
+jspb.BinaryPresizedWriter.prototype.appendUint8Array_ = function(arr) {
+  this.fixedEncoder_.writeBytes(arr);
+};
+
+
+/** @override */
+jspb.BinaryPresizedWriter.prototype.beginDelimited_ = function(field) {
+  this.writeFieldHeader_(field, jspb.BinaryConstants.WireType.DELIMITED);
+  jspb.asserts.assert(this.nextLength_ < this.sizer_.lengthCount_);
+  var length = this.sizer_.lengths_[this.nextLength_++];
+  this.fixedEncoder_.writeUnsignedVarint32(length);
+  this.ends_[this.depth_++] = this.fixedEncoder_.getCursor() + length;
+  return jspb.BinaryWriter.NO_BOOKMARK_;
+};
+
+
+/** @override */
+jspb.BinaryPresizedWriter.prototype.endDelimited_ = function(bookmark) {
+  jspb.asserts.assert(
+      this.fixedEncoder_.getCursor() == this.ends_[--this.depth_],
+      'Data written differs from the data that was sized.');
+};
+
+
+/**
+ * @return {number} The offset in the buffer after the last byte written.
+ * @export
+ */
+jspb.BinaryPresizedWriter.prototype.getCursor = function() {
+  return this.fixedEncoder_.getCursor();
+};
+
+
+/**
+ * @override
+ * @return {!Uint8Array} A view of the written part of the buffer.
+ * @export
+ */
+jspb.BinaryPresizedWriter.prototype.getResultBuffer = function() {
+  jspb.asserts.assert(this.getCursor() == this.end_);
+  return this.fixedEncoder_.getBuffer().subarray(this.start_, this.end_);
+};
+
+
+
+/**
+ * BinaryBufferWriter is a BinaryWriter for serializing many messages in a
+ * row. Its serialize() sizes each message first, and then writes it into an
+ * internal buffer that grows as needed and is kept for the next message, as
+ * are all other internal arrays. Past the first few messages, the only
+ * allocation per message is then the returned copy of the result.
+ *
+ * @param {number=} opt_initialSize The initial size of the internal buffer.
+ * @constructor
+ * @extends {jspb.BinaryWriter}
+ * @struct
+ * @final
+ * @export
+ */
+jspb.BinaryBufferWriter = function(opt_initialSize) {
+  jspb.BinaryWriter.call(this);
+
+  /** @private @const {!jspb.BinarySizingWriter} */
+  this.sizer_ = new jspb.BinarySizingWriter();
+
+  /** @private {!Uint8Array} */
+  this.buffer_ = new Uint8Array(opt_initialSize || 1024);
+
+  /** @private @const {!jspb.BinaryPresizedWriter} */
+  this.presized_ = new jspb.BinaryPresizedWriter(this.sizer_, this.buffer_);
+};
+goog.inherits(jspb.BinaryBufferWriter, jspb.BinaryWriter);
+
+
+/**
+ * @override
+ * @export
+ */
+jspb.BinaryBufferWriter.prototype.serialize = function(value, writerCallback) {
+  var sizer = this.sizer_;
+  sizer.reset();
+  writerCallback(value, sizer);
+
+  var length = sizer.getLength();
+  if (length > this.buffer_.length) {
+    this.buffer_ = new Uint8Array(Math.max(length, 2 * this.buffer_.length));
+  }
+  this.presized_.init_(sizer, this.buffer_, 0);
+  writerCallback(value, this.presized_);
+  return this.buffer_.slice(0, length);
+};
+
+
+/**
+ * @override
+ * @export
+ */
+jspb.BinaryBufferWriter.prototype.serializeDelimited = function(
+    value, writerCallback) {
+  var sizer = this.sizer_;
+  sizer.reset();
+  writerCallback(value, sizer);
+
+  var length = sizer.getLength();
+  var prefixLength = 1;
+  for (var n = length; n > 127; n >>>= 7) {
+    prefixLength++;
+  }
+  if (prefixLength + length > this.buffer_.length) {
+    this.buffer_ = new Uint8Array(
+        Math.max(prefixLength + length, 2 * this.buffer_.length));
+  }
+  for (var i = 0, bits = length; i < prefixLength; i++, bits >>>= 7) {
+    this.buffer_[i] = i + 1 < prefixLength ? (bits & 0x7f) | 0x80 : bits;
+  }
+  this.presized_.init_(sizer, this.buffer_, prefixLength);
+  writerCallback(value, this.presized_);
+  return this.buffer_.slice(0, prefixLength + length);
+};
@@ -41,8 +41,11 @@
 goog.require('goog.crypt');
 goog.require('goog.crypt.base64');
 
+goog.require('jspb.BinaryBufferWriter');
 goog.require('jspb.BinaryConstants');
+goog.require('jspb.BinaryPresizedWriter');
 goog.require('jspb.BinaryReader');
+goog.require('jspb.BinarySizingWriter');
 goog.require('jspb.BinaryWriter');
 goog.require('jspb.utils');
 
@@ -400,4 +403,85 @@ describe('binaryWriterTest', () => {
       }
     });
   });
+
+  it('writes presized buffers', () => {
+    /** @param {!jspb.BinaryWriter} writer */
+    function write(writer) {
+      writer.writeInt32(1, -1);
+      writer.writeUint32(2, 300);
+      writer.writeInt64(3, -0x123456789);
+      writer.writeSint64String(4, '-9223372036854775808');
+      writer.writeFixed32(5, 0xdeadbeef);
+      writer.writeSfixed32(6, -2);
+      writer.writeDouble(7, Math.PI);
+      writer.writeFloat(8, 1.5);
+      writer.writeBool(9, true);
+      writer.writeString(10, 'a\u00e9\u4e2d\ud83d\ude00');
+      writer.writeBytes(11, new Uint8Array([1, 2, 3]));
+      writer.beginSubMessage(12);
+      writer.writeString(1, 'x'.repeat(200));
+      writer.beginSubMessage(2);
+      writer.writePackedSint32(1, [-1, 0, 1]);
+      writer.endSubMessage();
+      writer.endSubMessage();
+      writer.writePackedDouble(13, [1, 2]);
+      writer.writeGroup(14, {}, (value, writer) => {
+        writer.writeInt32(1, 1);
+      });
+      writer.writeSerializedMessage(new Uint8Array([8, 5]), 0, 2);
+    }
+
+    const writer = new jspb.BinaryWriter();
+    write(writer);
+    const length = writer.getLength();
+    const expected = writer.getResultBuffer();
+    expect(length).toEqual(expected.length);
+    expect(writer.getLength()).toEqual(expected.length);
+
+    const sizer = new jspb.BinarySizingWriter();
+    write(sizer);
+    expect(sizer.getLength()).toEqual(expected.length);
+
+    const buffer = new Uint8Array(expected.length + 3);
+    const presized = new jspb.BinaryPresizedWriter(sizer, buffer, 2);
+    write(presized);
+    expect(presized.getCursor()).toEqual(expected.length + 2);
+    expect(presized.getResultBuffer()).toEqual(expected);
+    expect(buffer[0]).toEqual(0);
+    expect(buffer[buffer.length - 1]).toEqual(0);
+
+    expect(() => {
+      new jspb.BinaryPresizedWriter(sizer, buffer, 4);
+    }).toThrow();
+  });
+
+  it('reuses writers across messages', () => {
+    /**
+     * @param {number} size
+     * @param {!jspb.BinaryWriter} writer
+     */
+    function write(size, writer) {
+      writer.writeString(1, 'x'.repeat(size));
+      writer.beginSubMessage(2);
+      writer.writeInt32(1, size);
+      writer.beginSubMessage(2);
+      writer.writeBytes(1, new Uint8Array(size));
+      writer.endSubMessage();
+      writer.endSubMessage();
+    }
+
+    const plainWriter = new jspb.BinaryWriter();
+    const bufferWriter = new jspb.BinaryBufferWriter(8);
+    // Grow the internal buffer and shrink back, with different nestings.
+    for (const size of [0, 5, 300, 2, 70000, 1]) {
+      const writer = new jspb.BinaryWriter();
+      write(size, writer);
+      const expected = writer.getResultBuffer();
+      expect(plainWriter.serialize(size, write)).toEqual(expected);
+      const result = bufferWriter.serialize(size, write);
+      expect(result).toEqual(expected);
+      // The result is a copy, detached from the internal buffer.
+      expect(result.buffer.byteLength).toEqual(expected.length);
+    }
+  });
 });
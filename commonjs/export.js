@@ -10,10 +10,20 @@ goog.provide('jspb.Export');
 goog.require('goog.object');
 
 goog.require('jspb.debug');
+goog.require('jspb.BinaryBatchPool');
+goog.require('jspb.BinaryBufferWriter');
+goog.require('jspb.BinaryCodec');
+goog.require('jspb.BinaryDelimitedReader');
+goog.require('jspb.BinaryInstrumentation');
+goog.require('jspb.BinaryPresizedWriter');
+goog.require('jspb.BinaryProjection');
 goog.require('jspb.BinaryReader');
+goog.require('jspb.BinarySizingWriter');
 goog.require('jspb.BinaryWriter');
 goog.require('jspb.ExtensionFieldBinaryInfo');
 goog.require('jspb.ExtensionFieldInfo');
+goog.require('jspb.JsonReader');
+goog.require('jspb.JsonWriter');
 goog.require('jspb.Message');
 goog.require('jspb.Map');
 
@@ -23,10 +33,20 @@ if (typeof exports === 'object') {
   exports['Map'] = jspb.Map;
   exports['Message'] = jspb.Message;
 
+  exports['BinaryBatchPool'] = jspb.BinaryBatchPool;
+  exports['BinaryBufferWriter'] = jspb.BinaryBufferWriter;
+  exports['BinaryCodec'] = jspb.BinaryCodec;
+  exports['BinaryDelimitedReader'] = jspb.BinaryDelimitedReader;
+  exports['BinaryInstrumentation'] = jspb.BinaryInstrumentation;
+  exports['BinaryPresizedWriter'] = jspb.BinaryPresizedWriter;
+  exports['BinaryProjection'] = jspb.BinaryProjection;
   exports['BinaryReader'] = jspb.BinaryReader;
+  exports['BinarySizingWriter'] = jspb.BinarySizingWriter;
   exports['BinaryWriter'] = jspb.BinaryWriter;
   exports['ExtensionFieldInfo'] = jspb.ExtensionFieldInfo;
   exports['ExtensionFieldBinaryInfo'] = jspb.ExtensionFieldBinaryInfo;
+  exports['JsonReader'] = jspb.JsonReader;
+  exports['JsonWriter'] = jspb.JsonWriter;
 
   // These are used by generated code but should not be used directly by clients.
   exports['exportSymbol'] = goog.exportSymbol;
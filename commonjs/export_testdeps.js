@@ -13,10 +13,20 @@ goog.require('goog.crypt.base64');
 goog.require('goog.testing.PropertyReplacer');
 
 goog.require('jspb.debug');
+goog.require('jspb.BinaryBatchPool');
+goog.require('jspb.BinaryBufferWriter');
+goog.require('jspb.BinaryCodec');
+goog.require('jspb.BinaryDelimitedReader');
+goog.require('jspb.BinaryInstrumentation');
+goog.require('jspb.BinaryPresizedWriter');
+goog.require('jspb.BinaryProjection');
 goog.require('jspb.BinaryReader');
+goog.require('jspb.BinarySizingWriter');
 goog.require('jspb.BinaryWriter');
 goog.require('jspb.ExtensionFieldBinaryInfo');
 goog.require('jspb.ExtensionFieldInfo');
+goog.require('jspb.JsonReader');
+goog.require('jspb.JsonWriter');
 goog.require('jspb.Message');
 goog.require('jspb.Map');
 
@@ -47,10 +57,20 @@ if (typeof exports === 'object') {
 
   exports['jspb'] = {
     'debug': jspb.debug,
+    'BinaryBatchPool': jspb.BinaryBatchPool,
+    'BinaryBufferWriter': jspb.BinaryBufferWriter,
+    'BinaryCodec': jspb.BinaryCodec,
+    'BinaryDelimitedReader': jspb.BinaryDelimitedReader,
+    'BinaryInstrumentation': jspb.BinaryInstrumentation,
+    'BinaryPresizedWriter': jspb.BinaryPresizedWriter,
+    'BinaryProjection': jspb.BinaryProjection,
     'BinaryReader': jspb.BinaryReader,
+    'BinarySizingWriter': jspb.BinarySizingWriter,
     'BinaryWriter': jspb.BinaryWriter,
     'ExtensionFieldBinaryInfo': jspb.ExtensionFieldBinaryInfo,
     'ExtensionFieldInfo': jspb.ExtensionFieldInfo,
+    'JsonReader': jspb.JsonReader,
+    'JsonWriter': jspb.JsonWriter,
     'Message': jspb.Message,
     'Map': jspb.Map,
   };
@@ -0,0 +1,79 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Test suite is written using Jasmine -- see http://jasmine.github.io/
+//
+// Runs in the lazy_init variant of the CommonJS tests, against test protos
+// that no other suite loads, so that their messages are still lazy.
+
+const googleProtobuf = require('google-protobuf');
+
+const test6_pb = require('./test6/test6_pb');
+const test7_pb = require('./test7/test7_pb');
+
+describe('Lazy init test suite', () => {
+  it('testMessagesInstallOnFirstAccess', () => {
+    let installed = 0;
+    googleProtobuf.Message.onLazyInit(
+        test7_pb, 'FramingMessage', () => installed++);
+    expect(installed).toEqual(0);
+
+    const FramingMessage = test7_pb.FramingMessage;
+    expect(installed).toEqual(1);
+    expect(typeof FramingMessage).toEqual('function');
+    expect(test7_pb.FramingMessage).toBe(FramingMessage);
+    expect(installed).toEqual(1);
+
+    // Callbacks for an installed message run right away.
+    googleProtobuf.Message.onLazyInit(
+        test7_pb, 'FramingMessage', () => installed++);
+    expect(installed).toEqual(2);
+  });
+
+  it('testImportedMessagesInstallWhenUsed', () => {
+    let installed = 0;
+    googleProtobuf.Message.onLazyInit(
+        test6_pb, 'ImportedMessage', () => installed++);
+    const framing = new test7_pb.FramingMessage();
+    expect(installed).toEqual(0);
+
+    const ImportedMessage = test6_pb.ImportedMessage;
+    expect(installed).toEqual(1);
+    framing.setImportedMessage(new ImportedMessage());
+    framing.getImportedMessage().setStringValue('x');
+
+    const copy =
+        test7_pb.FramingMessage.deserializeBinary(framing.serializeBinary());
+    expect(copy.getImportedMessage() instanceof ImportedMessage).toBeTrue();
+    expect(copy.getImportedMessage().getStringValue()).toEqual('x');
+    expect(test6_pb.ImportedMessage).toBe(ImportedMessage);
+    expect(installed).toEqual(1);
+  });
+});
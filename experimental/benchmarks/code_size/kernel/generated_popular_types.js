@@ -0,0 +1,58 @@
+/**
+ * @fileoverview The code size benchmark of code generated with
+ * runtime=kernel for accessing all popular types setter and getter.
+ *
+ * It mirrors popular_types.js, which calls the Kernel through a hand-written
+ * wrapper, with the message classes generated for protos/testbinary.proto.
+ */
+goog.module('protobuf.benchmark.KernelCodeSizeBenchmarkGeneratedPopularTypes');
+
+const Int64 = goog.require('protobuf.Int64');
+const {ForeignEnum, ForeignMessage, TestAllTypes} = goog.require('proto.jspb.test.protos_testbinary_pb');
+const {ensureCommonBaseLine} = goog.require('protobuf.benchmark.codeSize.codeSizeBase');
+
+ensureCommonBaseLine();
+
+
+/**
+ * @return {string}
+ */
+function accessAllTypes() {
+  const message = TestAllTypes.createEmpty();
+  const foreignMessage = ForeignMessage.createEmpty();
+
+  message.addRepeatedForeignMessage(foreignMessage);
+  message.addAllRepeatedForeignMessage([foreignMessage]);
+
+  message.setOptionalString('abc');
+  message.setOptionalInt32(1);
+  message.setOptionalForeignMessage(foreignMessage);
+  message.setOptionalBool(true);
+  message.setOptionalForeignEnum(ForeignEnum.FOREIGN_FOO);
+  message.setOptionalInt64(Int64.fromBits(0, 1));
+  message.setOptionalDouble(1.0);
+  message.setRepeatedForeignMessageElement(0, foreignMessage);
+  message.setRepeatedForeignMessageList([foreignMessage]);
+  message.setOptionalUint64(Int64.fromBits(0, 1));
+
+
+  let s = '';
+  s += message.getOptionalString();
+  s += message.getOptionalInt32();
+  s += message.getOptionalForeignMessage();
+  s += message.getOptionalForeignMessageOrNull();
+  s += message.getOptionalBool();
+  s += message.getOptionalForeignEnum();
+  s += message.getOptionalInt64();
+  s += message.getOptionalDouble();
+  s += message.getRepeatedForeignMessageElement(0);
+  s += message.getRepeatedForeignMessageList();
+  s += message.getRepeatedForeignMessageSize();
+  s += message.getOptionalUint64();
+
+  s += message.serialize();
+
+  return s;
+}
+
+goog.global['__hiddenTest'] += accessAllTypes();
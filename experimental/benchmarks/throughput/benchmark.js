@@ -0,0 +1,171 @@
+/**
+ * @fileoverview Measures the throughput of one operation on one payload, and
+ * prints the results of a run as a table.
+ *
+ * Allocations are measured as the growth of the used heap over a batch of
+ * runs that starts right after a full garbage collection. This needs the
+ * `--expose-gc` flag of Node.js, and a young generation large enough for the
+ * batch not to be collected (`--max-semi-space-size=64`); without `gc()` the
+ * allocations are not reported.
+ */
+goog.module('protobuf.benchmark.throughput.benchmark');
+
+/**
+ * The result of measuring an operation.
+ * @typedef {{
+ *   runtime: string,
+ *   payload: string,
+ *   operation: string,
+ *   opsPerSecond: number,
+ *   bytesPerSecond: number,
+ *   allocatedBytesPerOp: ?number,
+ * }}
+ */
+let Result;
+
+/**
+ * The minimum time each operation is timed for.
+ * @const {number}
+ */
+const MIN_TIME_MS = 500;
+
+/**
+ * The most memory a batch for measuring allocations is estimated to use.
+ * @const {number}
+ */
+const MAX_ALLOCATION_BATCH_BYTES = 16 * 1024 * 1024;
+
+/** @return {number} */
+function now() {
+  return goog.global['performance'].now();
+}
+
+/** @return {?function()} */
+function getGc() {
+  const gc = goog.global['gc'];
+  return typeof gc == 'function' ? gc : null;
+}
+
+/** @return {?number} */
+function heapUsed() {
+  const process = goog.global['process'];
+  return process && process.memoryUsage ? process.memoryUsage().heapUsed :
+                                          null;
+}
+
+/**
+ * Runs fn the given number of times, returning the sum of its results so
+ * the calls can't be optimized away.
+ * @param {function():*} fn
+ * @param {number} runs
+ * @return {number}
+ */
+function repeat(fn, runs) {
+  let sink = 0;
+  for (let i = 0; i < runs; i++) {
+    sink += fn() ? 1 : 0;
+  }
+  return sink;
+}
+
+/**
+ * @param {function():*} fn
+ * @return {?number}
+ */
+function measureAllocations(fn) {
+  const gc = getGc();
+  if (!gc || heapUsed() === null) {
+    return null;
+  }
+  gc();
+  let before = heapUsed();
+  repeat(fn, 1);
+  const estimate = Math.max(heapUsed() - before, 1);
+  const runs = Math.max(
+      1, Math.min(100, Math.floor(MAX_ALLOCATION_BATCH_BYTES / estimate)));
+  gc();
+  before = heapUsed();
+  repeat(fn, runs);
+  return Math.max(heapUsed() - before, 0) / runs;
+}
+
+/**
+ * Measures an operation.
+ * @param {string} runtime
+ * @param {string} payload
+ * @param {string} operation
+ * @param {number} payloadBytes The size of the payload in the wire format.
+ * @param {function():*} fn Runs the operation once.
+ * @return {!Result}
+ */
+function measure(runtime, payload, operation, payloadBytes, fn) {
+  // Warm up, so that the optimized code is measured.
+  let runs = 1;
+  const warmUpEnd = now() + MIN_TIME_MS / 5;
+  while (now() < warmUpEnd) {
+    repeat(fn, runs);
+    runs *= 2;
+  }
+
+  let total = 0;
+  let elapsed = 0;
+  runs = 1;
+  while (elapsed < MIN_TIME_MS) {
+    const start = now();
+    repeat(fn, runs);
+    elapsed += now() - start;
+    total += runs;
+    runs *= 2;
+  }
+  const opsPerSecond = total / (elapsed / 1000);
+  return {
+    runtime,
+    payload,
+    operation,
+    opsPerSecond,
+    bytesPerSecond: opsPerSecond * payloadBytes,
+    allocatedBytesPerOp: measureAllocations(fn),
+  };
+}
+
+/**
+ * @param {number} value
+ * @param {number} digits
+ * @return {string}
+ */
+function formatNumber(value, digits) {
+  return value.toFixed(digits).replace(/\B(?=(\d{3})+(?!\d))/g, ',');
+}
+
+/**
+ * Prints results as a table.
+ * @param {!Array<!Result>} results
+ */
+function printResults(results) {
+  const rows = [[
+    'runtime', 'payload', 'operation', 'ops/s', 'MB/s', 'alloc bytes/op'
+  ]];
+  for (const result of results) {
+    rows.push([
+      result.runtime,
+      result.payload,
+      result.operation,
+      formatNumber(result.opsPerSecond, 0),
+      formatNumber(result.bytesPerSecond / 1e6, 1),
+      result.allocatedBytesPerOp === null ?
+          '-' :
+          formatNumber(result.allocatedBytesPerOp, 0),
+    ]);
+  }
+  const widths = rows[0].map(
+      (unused, column) => Math.max(...rows.map((row) => row[column].length)));
+  for (const row of rows) {
+    // Left-align the text columns and right-align the numbers.
+    const cells = row.map(
+        (cell, column) => column < 3 ? cell.padEnd(widths[column]) :
+                                       cell.padStart(widths[column]));
+    console.log(cells.join('  '));
+  }
+}
+
+exports = {Result, measure, printResults};
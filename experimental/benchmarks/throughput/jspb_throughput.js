@@ -0,0 +1,363 @@
+/**
+ * @fileoverview The throughput benchmark of the classic jspb.Message runtime,
+ * on the classes generated for throughput.proto with the `binary` option.
+ *
+ * Messages are built from the payloads with their setters, as applications
+ * do.
+ */
+goog.module('protobuf.benchmark.throughput.jspbThroughput');
+
+const BigMaps = goog.require('proto.protobuf.benchmark.throughput.BigMaps');
+const DeepNesting = goog.require('proto.protobuf.benchmark.throughput.DeepNesting');
+const MapValue = goog.require('proto.protobuf.benchmark.throughput.MapValue');
+const OneofHeavy = goog.require('proto.protobuf.benchmark.throughput.OneofHeavy');
+const PackedArrays = goog.require('proto.protobuf.benchmark.throughput.PackedArrays');
+const StringHeavy = goog.require('proto.protobuf.benchmark.throughput.StringHeavy');
+const WideScalars = goog.require('proto.protobuf.benchmark.throughput.WideScalars');
+const {Result, measure} = goog.require('protobuf.benchmark.throughput.benchmark');
+const Message = goog.requireType('jspb.Message');
+const {Payload} = goog.requireType('protobuf.benchmark.throughput.payloads');
+
+/**
+ * @param {!Object} object
+ * @return {!WideScalars}
+ */
+function buildWideScalars(object) {
+  const message = new WideScalars();
+  message.setInt32Field(object.int32Field);
+  message.setInt64Field(object.int64Field);
+  message.setUint32Field(object.uint32Field);
+  message.setUint64Field(object.uint64Field);
+  message.setSint32Field(object.sint32Field);
+  message.setSint64Field(object.sint64Field);
+  message.setFixed32Field(object.fixed32Field);
+  message.setFixed64Field(object.fixed64Field);
+  message.setSfixed32Field(object.sfixed32Field);
+  message.setSfixed64Field(object.sfixed64Field);
+  message.setFloatField(object.floatField);
+  message.setDoubleField(object.doubleField);
+  message.setBoolField(object.boolField);
+  message.setStringField(object.stringField);
+  message.setBytesField(object.bytesField);
+  message.setInt32Field2(object.int32Field2);
+  message.setInt64Field2(object.int64Field2);
+  message.setUint32Field2(object.uint32Field2);
+  message.setDoubleField2(object.doubleField2);
+  message.setFloatField2(object.floatField2);
+  message.setBoolField2(object.boolField2);
+  message.setStringField2(object.stringField2);
+  message.setSint32Field2(object.sint32Field2);
+  message.setFixed32Field2(object.fixed32Field2);
+  return message;
+}
+
+/**
+ * @param {!WideScalars} message
+ * @return {number}
+ */
+function readWideScalars(message) {
+  return message.getInt32Field() + message.getInt64Field() +
+      message.getUint32Field() + message.getUint64Field() +
+      message.getSint32Field() + message.getSint64Field() +
+      message.getFixed32Field() + message.getFixed64Field() +
+      message.getSfixed32Field() + message.getSfixed64Field() +
+      message.getFloatField() + message.getDoubleField() +
+      Number(message.getBoolField()) + message.getStringField().length +
+      message.getBytesField_asU8().length + message.getInt32Field2() +
+      message.getInt64Field2() + message.getUint32Field2() +
+      message.getDoubleField2() + message.getFloatField2() +
+      Number(message.getBoolField2()) + message.getStringField2().length +
+      message.getSint32Field2() + message.getFixed32Field2();
+}
+
+/**
+ * @param {!Object} object
+ * @return {!DeepNesting}
+ */
+function buildDeepNesting(object) {
+  const message = new DeepNesting();
+  message.setDepth(object.depth);
+  message.setLabel(object.label);
+  if (object.child) {
+    message.setChild(buildDeepNesting(object.child));
+  }
+  return message;
+}
+
+/**
+ * @param {!DeepNesting} message
+ * @return {number}
+ */
+function readDeepNesting(message) {
+  let sum = 0;
+  for (let m = message; m; m = m.getChild()) {
+    sum += m.getDepth() + m.getLabel().length;
+  }
+  return sum;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!PackedArrays}
+ */
+function buildPackedArrays(object) {
+  const message = new PackedArrays();
+  message.setInt32ValuesList(object.int32ValuesList.slice());
+  message.setSint64ValuesList(object.sint64ValuesList.slice());
+  message.setFixed32ValuesList(object.fixed32ValuesList.slice());
+  message.setDoubleValuesList(object.doubleValuesList.slice());
+  message.setFloatValuesList(object.floatValuesList.slice());
+  message.setBoolValuesList(object.boolValuesList.slice());
+  return message;
+}
+
+/**
+ * @param {!Iterable<number|boolean>} values
+ * @return {number}
+ */
+function sum(values) {
+  let result = 0;
+  for (const value of values) {
+    result += Number(value);
+  }
+  return result;
+}
+
+/**
+ * @param {!PackedArrays} message
+ * @return {number}
+ */
+function readPackedArrays(message) {
+  return sum(message.getInt32ValuesList()) +
+      sum(message.getSint64ValuesList()) +
+      sum(message.getFixed32ValuesList()) +
+      sum(message.getDoubleValuesList()) + sum(message.getFloatValuesList()) +
+      sum(message.getBoolValuesList());
+}
+
+/**
+ * @param {!Object} object
+ * @return {!MapValue}
+ */
+function buildMapValue(object) {
+  const message = new MapValue();
+  message.setName(object.name);
+  message.setCount(object.count);
+  return message;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!BigMaps}
+ */
+function buildBigMaps(object) {
+  const message = new BigMaps();
+  const stringToInt32 = message.getStringToInt32Map();
+  for (const [key, value] of object.stringToInt32Map) {
+    stringToInt32.set(key, value);
+  }
+  const int32ToString = message.getInt32ToStringMap();
+  for (const [key, value] of object.int32ToStringMap) {
+    int32ToString.set(key, value);
+  }
+  const stringToMessage = message.getStringToMessageMap();
+  for (const [key, value] of object.stringToMessageMap) {
+    stringToMessage.set(key, buildMapValue(value));
+  }
+  return message;
+}
+
+/**
+ * @param {!BigMaps} message
+ * @return {number}
+ */
+function readBigMaps(message) {
+  let result = 0;
+  message.getStringToInt32Map().forEach((value, key) => {
+    result += key.length + value;
+  });
+  message.getInt32ToStringMap().forEach((value, key) => {
+    result += key + value.length;
+  });
+  message.getStringToMessageMap().forEach((value, key) => {
+    result += key.length + value.getName().length + value.getCount();
+  });
+  return result;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!OneofHeavy}
+ */
+function buildOneofHeavy(object) {
+  const message = new OneofHeavy();
+  for (const eventObject of object.eventsList) {
+    const event = new OneofHeavy.Event();
+    if ('int32Value' in eventObject) {
+      event.setInt32Value(eventObject.int32Value);
+    } else if ('int64Value' in eventObject) {
+      event.setInt64Value(eventObject.int64Value);
+    } else if ('doubleValue' in eventObject) {
+      event.setDoubleValue(eventObject.doubleValue);
+    } else if ('boolValue' in eventObject) {
+      event.setBoolValue(eventObject.boolValue);
+    } else if ('stringValue' in eventObject) {
+      event.setStringValue(eventObject.stringValue);
+    } else if ('bytesValue' in eventObject) {
+      event.setBytesValue(eventObject.bytesValue);
+    } else if ('messageValue' in eventObject) {
+      event.setMessageValue(buildMapValue(eventObject.messageValue));
+    } else {
+      event.setSint32Value(eventObject.sint32Value);
+    }
+    message.addEvents(event);
+  }
+  return message;
+}
+
+/**
+ * @param {!OneofHeavy} message
+ * @return {number}
+ */
+function readOneofHeavy(message) {
+  const PayloadCase = OneofHeavy.Event.PayloadCase;
+  let result = 0;
+  for (const event of message.getEventsList()) {
+    switch (event.getPayloadCase()) {
+      case PayloadCase.INT32_VALUE:
+        result += event.getInt32Value();
+        break;
+      case PayloadCase.INT64_VALUE:
+        result += event.getInt64Value();
+        break;
+      case PayloadCase.DOUBLE_VALUE:
+        result += event.getDoubleValue();
+        break;
+      case PayloadCase.BOOL_VALUE:
+        result += Number(event.getBoolValue());
+        break;
+      case PayloadCase.STRING_VALUE:
+        result += event.getStringValue().length;
+        break;
+      case PayloadCase.BYTES_VALUE:
+        result += event.getBytesValue_asU8().length;
+        break;
+      case PayloadCase.MESSAGE_VALUE:
+        result += event.getMessageValue().getCount();
+        break;
+      case PayloadCase.SINT32_VALUE:
+        result += event.getSint32Value();
+        break;
+    }
+  }
+  return result;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!StringHeavy}
+ */
+function buildStringHeavy(object) {
+  const message = new StringHeavy();
+  message.setTitle(object.title);
+  message.setParagraphsList(object.paragraphsList.slice());
+  message.setAsciiWordsList(object.asciiWordsList.slice());
+  message.setBlobsList(object.blobsList.slice());
+  return message;
+}
+
+/**
+ * @param {!StringHeavy} message
+ * @return {number}
+ */
+function readStringHeavy(message) {
+  let result = message.getTitle().length;
+  for (const paragraph of message.getParagraphsList()) {
+    result += paragraph.length;
+  }
+  for (const word of message.getAsciiWordsList()) {
+    result += word.length;
+  }
+  for (const blob of message.getBlobsList_asU8()) {
+    result += blob.length;
+  }
+  return result;
+}
+
+/**
+ * The class, builder and reader of each message of the payloads.
+ * @const {!Object<string, {
+ *   messageClass: !Function,
+ *   build: function(!Object): !Message,
+ *   read: function(?): number,
+ * }>}
+ */
+const MESSAGES = {
+  'WideScalars': {
+    messageClass: WideScalars,
+    build: buildWideScalars,
+    read: readWideScalars,
+  },
+  'DeepNesting': {
+    messageClass: DeepNesting,
+    build: buildDeepNesting,
+    read: readDeepNesting,
+  },
+  'PackedArrays': {
+    messageClass: PackedArrays,
+    build: buildPackedArrays,
+    read: readPackedArrays,
+  },
+  'BigMaps': {
+    messageClass: BigMaps,
+    build: buildBigMaps,
+    read: readBigMaps,
+  },
+  'OneofHeavy': {
+    messageClass: OneofHeavy,
+    build: buildOneofHeavy,
+    read: readOneofHeavy,
+  },
+  'StringHeavy': {
+    messageClass: StringHeavy,
+    build: buildStringHeavy,
+    read: readStringHeavy,
+  },
+};
+
+/**
+ * Returns the wire format of a payload, as encoded by jspb. The Kernel
+ * benchmark decodes the same bytes.
+ * @param {!Payload} payload
+ * @return {!Uint8Array}
+ */
+function encodePayload(payload) {
+  return MESSAGES[payload.message].build(payload.object).serializeBinary();
+}
+
+/**
+ * Measures the jspb operations on each payload.
+ * @param {!Array<!Payload>} payloads
+ * @return {!Array<!Result>}
+ */
+function run(payloads) {
+  const results = [];
+  for (const payload of payloads) {
+    const {messageClass, build, read} = MESSAGES[payload.message];
+    const bytes = encodePayload(payload);
+    const message = messageClass.deserializeBinary(bytes);
+    const add = (operation, fn) => {
+      results.push(
+          measure('jspb', payload.name, operation, bytes.length, fn));
+    };
+    add('deserialize', () => messageClass.deserializeBinary(bytes));
+    add('deserialize+read',
+        () => read(messageClass.deserializeBinary(bytes)));
+    add('serialize', () => message.serializeBinary());
+    add('toObject', () => message.toObject());
+    add('build', () => build(payload.object));
+  }
+  return results;
+}
+
+exports = {encodePayload, run};
@@ -0,0 +1,376 @@
+/**
+ * @fileoverview The throughput benchmark of the binary Kernel runtime, on
+ * the classes generated for throughput.proto with `runtime=kernel`.
+ *
+ * The Kernel only indexes the wire format on deserialize() and decodes each
+ * field on first access, so decoding is measured both alone and followed by
+ * reading every field. The Kernel classes have no toObject(); map fields are
+ * repeated entry messages.
+ */
+goog.module('protobuf.benchmark.throughput.kernelThroughput');
+
+const ByteString = goog.require('protobuf.ByteString');
+const Int64 = goog.require('protobuf.Int64');
+const {BigMaps, DeepNesting, MapValue, OneofHeavy, PackedArrays, StringHeavy, WideScalars} = goog.require('proto.protobuf.benchmark.throughput.experimental_benchmarks_throughput_throughput_pb');
+const {Result, measure} = goog.require('protobuf.benchmark.throughput.benchmark');
+const {encodePayload} = goog.require('protobuf.benchmark.throughput.jspbThroughput');
+const {Payload} = goog.requireType('protobuf.benchmark.throughput.payloads');
+
+/**
+ * @param {!Uint8Array} bytes
+ * @return {!ByteString}
+ */
+function toByteString(bytes) {
+  return ByteString.fromArrayBufferView(bytes);
+}
+
+/**
+ * @param {!Object} object
+ * @return {!WideScalars}
+ */
+function buildWideScalars(object) {
+  const message = WideScalars.createEmpty();
+  message.setInt32Field(object.int32Field);
+  message.setInt64Field(Int64.fromNumber(object.int64Field));
+  message.setUint32Field(object.uint32Field);
+  message.setUint64Field(Int64.fromNumber(object.uint64Field));
+  message.setSint32Field(object.sint32Field);
+  message.setSint64Field(Int64.fromNumber(object.sint64Field));
+  message.setFixed32Field(object.fixed32Field);
+  message.setFixed64Field(Int64.fromNumber(object.fixed64Field));
+  message.setSfixed32Field(object.sfixed32Field);
+  message.setSfixed64Field(Int64.fromNumber(object.sfixed64Field));
+  message.setFloatField(object.floatField);
+  message.setDoubleField(object.doubleField);
+  message.setBoolField(object.boolField);
+  message.setStringField(object.stringField);
+  message.setBytesField(toByteString(object.bytesField));
+  message.setInt32Field2(object.int32Field2);
+  message.setInt64Field2(Int64.fromNumber(object.int64Field2));
+  message.setUint32Field2(object.uint32Field2);
+  message.setDoubleField2(object.doubleField2);
+  message.setFloatField2(object.floatField2);
+  message.setBoolField2(object.boolField2);
+  message.setStringField2(object.stringField2);
+  message.setSint32Field2(object.sint32Field2);
+  message.setFixed32Field2(object.fixed32Field2);
+  return message;
+}
+
+/**
+ * @param {!WideScalars} message
+ * @return {number}
+ */
+function readWideScalars(message) {
+  return message.getInt32Field() + message.getInt64Field().asNumber() +
+      message.getUint32Field() + message.getUint64Field().asNumber() +
+      message.getSint32Field() + message.getSint64Field().asNumber() +
+      message.getFixed32Field() + message.getFixed64Field().asNumber() +
+      message.getSfixed32Field() + message.getSfixed64Field().asNumber() +
+      message.getFloatField() + message.getDoubleField() +
+      Number(message.getBoolField()) + message.getStringField().length +
+      Number(message.getBytesField().isEmpty()) + message.getInt32Field2() +
+      message.getInt64Field2().asNumber() + message.getUint32Field2() +
+      message.getDoubleField2() + message.getFloatField2() +
+      Number(message.getBoolField2()) + message.getStringField2().length +
+      message.getSint32Field2() + message.getFixed32Field2();
+}
+
+/**
+ * @param {!Object} object
+ * @return {!DeepNesting}
+ */
+function buildDeepNesting(object) {
+  const message = DeepNesting.createEmpty();
+  message.setDepth(object.depth);
+  message.setLabel(object.label);
+  if (object.child) {
+    message.setChild(buildDeepNesting(object.child));
+  }
+  return message;
+}
+
+/**
+ * @param {!DeepNesting} message
+ * @return {number}
+ */
+function readDeepNesting(message) {
+  let sum = 0;
+  for (let m = message; m; m = m.getChildOrNull()) {
+    sum += m.getDepth() + m.getLabel().length;
+  }
+  return sum;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!PackedArrays}
+ */
+function buildPackedArrays(object) {
+  const message = PackedArrays.createEmpty();
+  message.setInt32ValuesList(object.int32ValuesList);
+  message.setSint64ValuesList(object.sint64ValuesList.map(Int64.fromNumber));
+  message.setFixed32ValuesList(object.fixed32ValuesList);
+  message.setDoubleValuesList(object.doubleValuesList);
+  message.setFloatValuesList(object.floatValuesList);
+  message.setBoolValuesList(object.boolValuesList);
+  return message;
+}
+
+/**
+ * @param {!Iterable<number|boolean>} values
+ * @return {number}
+ */
+function sum(values) {
+  let result = 0;
+  for (const value of values) {
+    result += Number(value);
+  }
+  return result;
+}
+
+/**
+ * @param {!PackedArrays} message
+ * @return {number}
+ */
+function readPackedArrays(message) {
+  let sint64Sum = 0;
+  for (const value of message.getSint64ValuesList()) {
+    sint64Sum += value.asNumber();
+  }
+  return sum(message.getInt32ValuesList()) + sint64Sum +
+      sum(message.getFixed32ValuesList()) +
+      sum(message.getDoubleValuesList()) + sum(message.getFloatValuesList()) +
+      sum(message.getBoolValuesList());
+}
+
+/**
+ * @param {!Object} object
+ * @return {!MapValue}
+ */
+function buildMapValue(object) {
+  const message = MapValue.createEmpty();
+  message.setName(object.name);
+  message.setCount(object.count);
+  return message;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!BigMaps}
+ */
+function buildBigMaps(object) {
+  const message = BigMaps.createEmpty();
+  message.setStringToInt32MapList(
+      object.stringToInt32Map.map(([key, value]) => {
+        const entry = BigMaps.StringToInt32Entry.createEmpty();
+        entry.setKey(key);
+        entry.setValue(value);
+        return entry;
+      }));
+  message.setInt32ToStringMapList(
+      object.int32ToStringMap.map(([key, value]) => {
+        const entry = BigMaps.Int32ToStringEntry.createEmpty();
+        entry.setKey(key);
+        entry.setValue(value);
+        return entry;
+      }));
+  message.setStringToMessageMapList(
+      object.stringToMessageMap.map(([key, value]) => {
+        const entry = BigMaps.StringToMessageEntry.createEmpty();
+        entry.setKey(key);
+        entry.setValue(buildMapValue(value));
+        return entry;
+      }));
+  return message;
+}
+
+/**
+ * @param {!BigMaps} message
+ * @return {number}
+ */
+function readBigMaps(message) {
+  let result = 0;
+  for (const entry of message.getStringToInt32MapList()) {
+    result += entry.getKey().length + entry.getValue();
+  }
+  for (const entry of message.getInt32ToStringMapList()) {
+    result += entry.getKey() + entry.getValue().length;
+  }
+  for (const entry of message.getStringToMessageMapList()) {
+    const value = entry.getValue();
+    result += entry.getKey().length + value.getName().length +
+        value.getCount();
+  }
+  return result;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!OneofHeavy}
+ */
+function buildOneofHeavy(object) {
+  const message = OneofHeavy.createEmpty();
+  message.setEventsList(object.eventsList.map((eventObject) => {
+    const event = OneofHeavy.Event.createEmpty();
+    if ('int32Value' in eventObject) {
+      event.setInt32Value(eventObject.int32Value);
+    } else if ('int64Value' in eventObject) {
+      event.setInt64Value(Int64.fromNumber(eventObject.int64Value));
+    } else if ('doubleValue' in eventObject) {
+      event.setDoubleValue(eventObject.doubleValue);
+    } else if ('boolValue' in eventObject) {
+      event.setBoolValue(eventObject.boolValue);
+    } else if ('stringValue' in eventObject) {
+      event.setStringValue(eventObject.stringValue);
+    } else if ('bytesValue' in eventObject) {
+      event.setBytesValue(toByteString(eventObject.bytesValue));
+    } else if ('messageValue' in eventObject) {
+      event.setMessageValue(buildMapValue(eventObject.messageValue));
+    } else {
+      event.setSint32Value(eventObject.sint32Value);
+    }
+    return event;
+  }));
+  return message;
+}
+
+/**
+ * @param {!OneofHeavy} message
+ * @return {number}
+ */
+function readOneofHeavy(message) {
+  const PayloadCase = OneofHeavy.Event.PayloadCase;
+  let result = 0;
+  for (const event of message.getEventsList()) {
+    switch (event.getPayloadCase()) {
+      case PayloadCase.INT32_VALUE:
+        result += event.getInt32Value();
+        break;
+      case PayloadCase.INT64_VALUE:
+        result += event.getInt64Value().asNumber();
+        break;
+      case PayloadCase.DOUBLE_VALUE:
+        result += event.getDoubleValue();
+        break;
+      case PayloadCase.BOOL_VALUE:
+        result += Number(event.getBoolValue());
+        break;
+      case PayloadCase.STRING_VALUE:
+        result += event.getStringValue().length;
+        break;
+      case PayloadCase.BYTES_VALUE:
+        result += Number(event.getBytesValue().isEmpty());
+        break;
+      case PayloadCase.MESSAGE_VALUE:
+        result += event.getMessageValue().getCount();
+        break;
+      case PayloadCase.SINT32_VALUE:
+        result += event.getSint32Value();
+        break;
+    }
+  }
+  return result;
+}
+
+/**
+ * @param {!Object} object
+ * @return {!StringHeavy}
+ */
+function buildStringHeavy(object) {
+  const message = StringHeavy.createEmpty();
+  message.setTitle(object.title);
+  message.setParagraphsList(object.paragraphsList);
+  message.setAsciiWordsList(object.asciiWordsList);
+  message.setBlobsList(object.blobsList.map(toByteString));
+  return message;
+}
+
+/**
+ * @param {!StringHeavy} message
+ * @return {number}
+ */
+function readStringHeavy(message) {
+  let result = message.getTitle().length;
+  for (const paragraph of message.getParagraphsList()) {
+    result += paragraph.length;
+  }
+  for (const word of message.getAsciiWordsList()) {
+    result += word.length;
+  }
+  for (const blob of message.getBlobsList()) {
+    result += Number(blob.isEmpty());
+  }
+  return result;
+}
+
+/**
+ * The class, builder and reader of each message of the payloads.
+ * @const {!Object<string, {
+ *   messageClass: ?,
+ *   build: function(!Object): ?,
+ *   read: function(?): number,
+ * }>}
+ */
+const MESSAGES = {
+  'WideScalars': {
+    messageClass: WideScalars,
+    build: buildWideScalars,
+    read: readWideScalars,
+  },
+  'DeepNesting': {
+    messageClass: DeepNesting,
+    build: buildDeepNesting,
+    read: readDeepNesting,
+  },
+  'PackedArrays': {
+    messageClass: PackedArrays,
+    build: buildPackedArrays,
+    read: readPackedArrays,
+  },
+  'BigMaps': {
+    messageClass: BigMaps,
+    build: buildBigMaps,
+    read: readBigMaps,
+  },
+  'OneofHeavy': {
+    messageClass: OneofHeavy,
+    build: buildOneofHeavy,
+    read: readOneofHeavy,
+  },
+  'StringHeavy': {
+    messageClass: StringHeavy,
+    build: buildStringHeavy,
+    read: readStringHeavy,
+  },
+};
+
+/**
+ * Measures the Kernel operations on each payload.
+ * @param {!Array<!Payload>} payloads
+ * @return {!Array<!Result>}
+ */
+function run(payloads) {
+  const results = [];
+  for (const payload of payloads) {
+    const {messageClass, build, read} = MESSAGES[payload.message];
+    const encoded = encodePayload(payload);
+    // The messages only read the bytes, so they can all share them.
+    const bytes = encoded.buffer.slice(
+        encoded.byteOffset, encoded.byteOffset + encoded.byteLength);
+    const decoded = messageClass.deserialize(bytes);
+    const built = build(payload.object);
+    const add = (operation, fn) => {
+      results.push(
+          measure('kernel', payload.name, operation, bytes.byteLength, fn));
+    };
+    add('deserialize', () => messageClass.deserialize(bytes));
+    add('deserialize+read', () => read(messageClass.deserialize(bytes)));
+    add('serialize', () => decoded.serialize());
+    add('serialize (built)', () => built.serialize());
+    add('build', () => build(payload.object));
+  }
+  return results;
+}
+
+exports = {run};
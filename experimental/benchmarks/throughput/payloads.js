@@ -0,0 +1,280 @@
+/**
+ * @fileoverview The payloads of the throughput benchmark, one per message
+ * shape of throughput.proto, in the object form of jspb's toObject().
+ *
+ * The payloads are generated from a fixed seed, so every run and every
+ * runtime measures the same data.
+ */
+goog.module('protobuf.benchmark.throughput.payloads');
+
+/**
+ * A payload: the name of its message in throughput.proto and its fields.
+ * @typedef {{
+ *   name: string,
+ *   message: string,
+ *   object: !Object,
+ * }}
+ */
+let Payload;
+
+/**
+ * A small deterministic pseudo-random generator (xorshift32).
+ */
+class Random {
+  /** @param {number} seed */
+  constructor(seed) {
+    /** @private {number} */
+    this.state_ = seed | 0 || 1;
+  }
+
+  /** @return {number} A random int32. */
+  int32() {
+    let x = this.state_;
+    x ^= x << 13;
+    x ^= x >>> 17;
+    x ^= x << 5;
+    return this.state_ = x;
+  }
+
+  /**
+   * @param {number} bound
+   * @return {number} A random integer in [0, bound).
+   */
+  below(bound) {
+    return (this.int32() >>> 0) % bound;
+  }
+
+  /** @return {number} A random double in [0, 1). */
+  double() {
+    return (this.int32() >>> 0) / 4294967296;
+  }
+
+  /**
+   * @param {number} length
+   * @param {!Array<string>} alphabet The characters to pick from.
+   * @return {string}
+   */
+  string(length, alphabet) {
+    let result = '';
+    for (let i = 0; i < length; i++) {
+      result += alphabet[this.below(alphabet.length)];
+    }
+    return result;
+  }
+
+  /**
+   * @param {number} length
+   * @return {!Uint8Array}
+   */
+  bytes(length) {
+    const result = new Uint8Array(length);
+    for (let i = 0; i < length; i++) {
+      result[i] = this.below(256);
+    }
+    return result;
+  }
+}
+
+/** @const {!Array<string>} */
+const ASCII = Array.from(
+    'abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789');
+
+/**
+ * Latin, Greek, Cyrillic and CJK text, and an emoji outside the BMP.
+ * @const {!Array<string>}
+ */
+const UNICODE =
+    ASCII.concat(Array.from(' àéîõü ΑΒΓαβγ АБВабв 日本語中文한국어 😀'));
+
+/**
+ * @param {!Random} random
+ * @return {!Object}
+ */
+function wideScalars(random) {
+  return {
+    int32Field: random.int32(),
+    int64Field: random.int32() * 65536 + random.below(65536),
+    uint32Field: random.int32() >>> 0,
+    uint64Field: (random.int32() >>> 0) * 1024,
+    sint32Field: random.int32(),
+    sint64Field: -random.below(1 << 30) * 4096,
+    fixed32Field: random.int32() >>> 0,
+    fixed64Field: (random.int32() >>> 0) * 512,
+    sfixed32Field: random.int32(),
+    sfixed64Field: random.int32() * 256,
+    floatField: Math.fround(random.double() * 1000),
+    doubleField: random.double() * 1e9,
+    boolField: true,
+    stringField: random.string(24, ASCII),
+    bytesField: random.bytes(32),
+    int32Field2: random.below(128),
+    int64Field2: random.below(1 << 20),
+    uint32Field2: random.below(1 << 14),
+    doubleField2: random.double(),
+    floatField2: Math.fround(random.double()),
+    boolField2: true,
+    stringField2: random.string(8, UNICODE),
+    sint32Field2: -random.below(64),
+    fixed32Field2: random.int32() >>> 0,
+  };
+}
+
+/**
+ * @param {!Random} random
+ * @param {number} depth
+ * @return {!Object}
+ */
+function deepNesting(random, depth) {
+  let result = {depth: 0, label: random.string(8, ASCII)};
+  for (let i = 1; i <= depth; i++) {
+    result = {depth: i, label: random.string(8, ASCII), child: result};
+  }
+  return result;
+}
+
+/**
+ * @param {!Random} random
+ * @param {number} length
+ * @return {!Object}
+ */
+function packedArrays(random, length) {
+  const result = {
+    int32ValuesList: [],
+    sint64ValuesList: [],
+    fixed32ValuesList: [],
+    doubleValuesList: [],
+    floatValuesList: [],
+    boolValuesList: [],
+  };
+  for (let i = 0; i < length; i++) {
+    // Mostly small values, as in counters and ids, with some large ones.
+    result.int32ValuesList.push(
+        i % 8 ? random.below(1000) : random.int32());
+    result.sint64ValuesList.push(
+        (random.below(2) ? -1 : 1) * random.below(1 << 30) * 64);
+    result.fixed32ValuesList.push(random.int32() >>> 0);
+    result.doubleValuesList.push(random.double() * 100);
+    result.floatValuesList.push(Math.fround(random.double()));
+    result.boolValuesList.push(random.below(2) == 1);
+  }
+  return result;
+}
+
+/**
+ * @param {!Random} random
+ * @param {number} size
+ * @return {!Object}
+ */
+function bigMaps(random, size) {
+  const result = {
+    stringToInt32Map: [],
+    int32ToStringMap: [],
+    stringToMessageMap: [],
+  };
+  for (let i = 0; i < size; i++) {
+    result.stringToInt32Map.push(['key' + i, random.int32()]);
+    result.int32ToStringMap.push([i * 7, random.string(12, ASCII)]);
+    result.stringToMessageMap.push([
+      'entry' + i,
+      {name: random.string(10, ASCII), count: random.below(1000)},
+    ]);
+  }
+  return result;
+}
+
+/**
+ * @param {!Random} random
+ * @param {number} length
+ * @return {!Object}
+ */
+function oneofHeavy(random, length) {
+  const events = [];
+  for (let i = 0; i < length; i++) {
+    switch (random.below(8)) {
+      case 0:
+        events.push({int32Value: random.int32()});
+        break;
+      case 1:
+        events.push({int64Value: random.int32() * 1024});
+        break;
+      case 2:
+        events.push({doubleValue: random.double()});
+        break;
+      case 3:
+        events.push({boolValue: true});
+        break;
+      case 4:
+        events.push({stringValue: random.string(16, ASCII)});
+        break;
+      case 5:
+        events.push({bytesValue: random.bytes(16)});
+        break;
+      case 6:
+        events.push({
+          messageValue: {name: random.string(6, ASCII), count: i},
+        });
+        break;
+      default:
+        events.push({sint32Value: -random.below(1 << 20)});
+    }
+  }
+  return {eventsList: events};
+}
+
+/**
+ * @param {!Random} random
+ * @param {number} paragraphs
+ * @return {!Object}
+ */
+function stringHeavy(random, paragraphs) {
+  const result = {
+    title: random.string(40, UNICODE),
+    paragraphsList: [],
+    asciiWordsList: [],
+    blobsList: [],
+  };
+  for (let i = 0; i < paragraphs; i++) {
+    result.paragraphsList.push(random.string(400, UNICODE));
+    result.asciiWordsList.push(random.string(1 + random.below(12), ASCII));
+    result.blobsList.push(random.bytes(64));
+  }
+  return result;
+}
+
+/**
+ * Returns the payloads of the benchmark.
+ * @return {!Array<!Payload>}
+ */
+function createPayloads() {
+  const random = new Random(20240229);
+  return [
+    {name: 'wide scalars', message: 'WideScalars', object: wideScalars(random)},
+    {
+      name: 'deep nesting (64 levels)',
+      message: 'DeepNesting',
+      object: deepNesting(random, 64),
+    },
+    {
+      name: 'packed arrays (6 x 10000)',
+      message: 'PackedArrays',
+      object: packedArrays(random, 10000),
+    },
+    {
+      name: 'big maps (3 x 2000)',
+      message: 'BigMaps',
+      object: bigMaps(random, 2000),
+    },
+    {
+      name: 'oneof heavy (2000 events)',
+      message: 'OneofHeavy',
+      object: oneofHeavy(random, 2000),
+    },
+    {
+      name: 'string heavy (200 paragraphs)',
+      message: 'StringHeavy',
+      object: stringHeavy(random, 200),
+    },
+  ];
+}
+
+exports = {Payload, createPayloads};
@@ -0,0 +1,40 @@
+/**
+ * @fileoverview Runs the throughput benchmark under Node.js, on the
+ * uncompiled runtimes with goog.DEBUG off.
+ *
+ * `gulp benchmark_throughput` generates the classes for throughput.proto for
+ * both runtimes and the Closure dependencies into benchmark_out/, then runs
+ * this script with `node --expose-gc --max-semi-space-size=64`. Arguments
+ * select the runtimes to measure, `jspb` and/or `kernel`; by default both
+ * are measured.
+ */
+global.CLOSURE_UNCOMPILED_DEFINES = {
+  'goog.DEBUG': false,
+};
+require('../../../node_modules/google-closure-library/closure/goog/bootstrap/nodejs.js');
+require('../../../node_loader.js');
+require('../../../benchmark_out/deps.js');
+
+goog.require('protobuf.benchmark.throughput.benchmark');
+goog.require('protobuf.benchmark.throughput.jspbThroughput');
+goog.require('protobuf.benchmark.throughput.kernelThroughput');
+goog.require('protobuf.benchmark.throughput.payloads');
+
+const {printResults} = goog.module.get('protobuf.benchmark.throughput.benchmark');
+const {createPayloads} = goog.module.get('protobuf.benchmark.throughput.payloads');
+const benchmarks = {
+  'jspb': goog.module.get('protobuf.benchmark.throughput.jspbThroughput'),
+  'kernel': goog.module.get('protobuf.benchmark.throughput.kernelThroughput'),
+};
+
+const runtimes = process.argv.length > 2 ? process.argv.slice(2) :
+                                           Object.keys(benchmarks);
+const payloads = createPayloads();
+let results = [];
+for (const runtime of runtimes) {
+  if (!benchmarks[runtime]) {
+    throw new Error('Unknown runtime: ' + runtime);
+  }
+  results = results.concat(benchmarks[runtime].run(payloads));
+}
+printResults(results);
@@ -0,0 +1,156 @@
+/**
+ * @fileoverview Tests for the classes generated for testbinary.proto with
+ * `runtime=kernel`, against the classes generated for it with the default
+ * runtime.
+ *
+ * Unlike the other tests of the Kernel, this test runs under Node.js with the
+ * Closure test suites (see jasmine.json), which load it as a script: the
+ * generated module is taken with goog.module.get().
+ */
+goog.require('proto.jspb.test.TestAllTypes');
+goog.require('proto.jspb.test.protos_testbinary_pb');
+goog.require('protobuf.ByteString');
+goog.require('protobuf.Int64');
+
+describe('Kernel generated classes', () => {
+  const {ForeignEnum, ForeignMessage, TestAllTypes} =
+      goog.module.get('proto.jspb.test.protos_testbinary_pb');
+  const ByteString = goog.module.get('protobuf.ByteString');
+  const Int64 = goog.module.get('protobuf.Int64');
+
+  /**
+   * @return {!TestAllTypes}
+   */
+  function createKernelMessage() {
+    const foreign = ForeignMessage.createEmpty();
+    foreign.setC(7);
+    const group = TestAllTypes.OptionalGroup.createEmpty();
+    group.setA(8);
+
+    const msg = TestAllTypes.createEmpty();
+    msg.setOptionalInt32(-42);
+    msg.setOptionalInt64(Int64.fromInt(-0x7fffffff));
+    msg.setOptionalUint64(Int64.fromDecimalString('1234567890123'));
+    msg.setOptionalSint32(-3);
+    msg.setOptionalFixed32(1234);
+    msg.setOptionalFloat(1.5);
+    msg.setOptionalDouble(-1.25);
+    msg.setOptionalBool(true);
+    msg.setOptionalString('hello');
+    msg.setOptionalBytes(
+        ByteString.fromArrayBufferView(new Uint8Array([1, 2, 3])));
+    msg.setOptionalGroup(group);
+    msg.setOptionalForeignMessage(foreign);
+    msg.setOptionalForeignEnum(ForeignEnum.FOREIGN_BAR);
+    msg.addRepeatedInt32(1);
+    msg.addRepeatedInt32(2);
+    msg.addRepeatedString('a');
+    msg.addRepeatedString('b');
+    msg.addAllPackedRepeatedSint32([-1, 0, 1]);
+    msg.setOneofString('oneof');
+    return msg;
+  }
+
+  /**
+   * @param {!ArrayBuffer|!Uint8Array} bytes
+   * @return {!Array<number>}
+   */
+  function toArray(bytes) {
+    return Array.from(new Uint8Array(bytes));
+  }
+
+  it('reads back the fields it sets', () => {
+    const msg = createKernelMessage();
+
+    expect(msg.getOptionalInt32()).toEqual(-42);
+    expect(msg.getOptionalInt64().toSignedDecimalString())
+        .toEqual('-2147483647');
+    expect(msg.getOptionalUint64().toUnsignedDecimalString())
+        .toEqual('1234567890123');
+    expect(msg.getOptionalSint32()).toEqual(-3);
+    expect(msg.getOptionalFixed32()).toEqual(1234);
+    expect(msg.getOptionalFloat()).toEqual(1.5);
+    expect(msg.getOptionalDouble()).toEqual(-1.25);
+    expect(msg.getOptionalBool()).toBeTrue();
+    expect(msg.getOptionalString()).toEqual('hello');
+    expect(toArray(msg.getOptionalBytes().toArrayBuffer())).toEqual([1, 2, 3]);
+    expect(msg.getOptionalGroup().getA()).toEqual(8);
+    expect(msg.getOptionalForeignMessage().getC()).toEqual(7);
+    expect(msg.getOptionalForeignEnum()).toEqual(ForeignEnum.FOREIGN_BAR);
+    expect(Array.from(msg.getRepeatedInt32List())).toEqual([1, 2]);
+    expect(msg.getRepeatedStringSize()).toEqual(2);
+    expect(msg.getRepeatedStringElement(1)).toEqual('b');
+    expect(Array.from(msg.getPackedRepeatedSint32List())).toEqual([-1, 0, 1]);
+    expect(msg.getOneofString()).toEqual('oneof');
+    expect(msg.getOneofFieldCase())
+        .toEqual(TestAllTypes.OneofFieldCase.ONEOF_STRING);
+  });
+
+  it('reports the presence of fields', () => {
+    const msg = TestAllTypes.createEmpty();
+    expect(msg.hasOptionalInt32()).toBeFalse();
+    expect(msg.getOptionalInt32()).toEqual(0);
+    expect(msg.getOptionalForeignMessageOrNull()).toBeNull();
+
+    msg.setOptionalInt32(0);
+    expect(msg.hasOptionalInt32()).toBeTrue();
+    msg.clearOptionalInt32();
+    expect(msg.hasOptionalInt32()).toBeFalse();
+  });
+
+  it('clears the other fields of a oneof', () => {
+    const msg = TestAllTypes.createEmpty();
+    expect(msg.getOneofFieldCase())
+        .toEqual(TestAllTypes.OneofFieldCase.ONEOF_FIELD_NOT_SET);
+
+    msg.setOneofString('oneof');
+    msg.setOneofUint32(5);
+    expect(msg.hasOneofString()).toBeFalse();
+    expect(msg.getOneofUint32()).toEqual(5);
+    expect(msg.getOneofFieldCase())
+        .toEqual(TestAllTypes.OneofFieldCase.ONEOF_UINT32);
+  });
+
+  it('serializes to what the default runtime reads', () => {
+    const classic = proto.jspb.test.TestAllTypes.deserializeBinary(
+        new Uint8Array(createKernelMessage().serialize()));
+
+    expect(classic.getOptionalInt32()).toEqual(-42);
+    expect(classic.getOptionalInt64()).toEqual(-0x7fffffff);
+    expect(classic.getOptionalUint64()).toEqual(1234567890123);
+    expect(classic.getOptionalSint32()).toEqual(-3);
+    expect(classic.getOptionalFixed32()).toEqual(1234);
+    expect(classic.getOptionalFloat()).toEqual(1.5);
+    expect(classic.getOptionalDouble()).toEqual(-1.25);
+    expect(classic.getOptionalBool()).toBeTrue();
+    expect(classic.getOptionalString()).toEqual('hello');
+    expect(toArray(classic.getOptionalBytes_asU8())).toEqual([1, 2, 3]);
+    expect(classic.getOptionalGroup().getA()).toEqual(8);
+    expect(classic.getOptionalForeignMessage().getC()).toEqual(7);
+    expect(classic.getOptionalForeignEnum())
+        .toEqual(proto.jspb.test.ForeignEnum.FOREIGN_BAR);
+    expect(classic.getRepeatedInt32List()).toEqual([1, 2]);
+    expect(classic.getRepeatedStringList()).toEqual(['a', 'b']);
+    expect(classic.getPackedRepeatedSint32List()).toEqual([-1, 0, 1]);
+    expect(classic.getOneofString()).toEqual('oneof');
+  });
+
+  it('deserializes what the default runtime writes', () => {
+    const classic = proto.jspb.test.TestAllTypes.deserializeBinary(
+        new Uint8Array(createKernelMessage().serialize()));
+    const bytes = classic.serializeBinary();
+
+    const msg = TestAllTypes.deserialize(new Uint8Array(bytes).buffer);
+    expect(msg.getOptionalInt64().toSignedDecimalString())
+        .toEqual('-2147483647');
+    expect(msg.getOptionalGroup().getA()).toEqual(8);
+    expect(msg.getOptionalForeignMessage().getC()).toEqual(7);
+    expect(Array.from(msg.getPackedRepeatedSint32List())).toEqual([-1, 0, 1]);
+    expect(msg.getOneofFieldCase())
+        .toEqual(TestAllTypes.OneofFieldCase.ONEOF_STRING);
+
+    const copy = proto.jspb.test.TestAllTypes.deserializeBinary(
+        new Uint8Array(msg.serialize()));
+    expect(copy.toObject()).toEqual(classic.toObject());
+  });
+});
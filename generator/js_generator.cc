@@ -29,22 +29,34 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <assert.h>
+#include "generator/generator_digest.h"
 #include "generator/well_known_types_embed.h"
 #include <google/protobuf/compiler/scc.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/printer.h>
 #include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <google/protobuf/stubs/common.h>
 #include <google/protobuf/stubs/logging.h>
 #include <google/protobuf/stubs/stringprintf.h>
 #include <google/protobuf/stubs/strutil.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -74,6 +86,193 @@ const char* kKeyword[] = {
 
 static const int kNumKeyword = sizeof(kKeyword) / sizeof(char*);
 
+// Per-run table of the names and type annotations that the generator derives
+// from descriptors. Each of them is needed many times per field (by the
+// accessors, toObject(), fromObject() and the binary serialization code), so
+// they are computed once, up front, by AddFile(). The table is not modified
+// while code is generated, so it can be shared by generator threads.
+class NamingContext {
+ public:
+  // The names derived from a single field.
+  struct FieldNames {
+    // JSGetterName() for each BytesMode.
+    std::string getter_name[3];
+    // JSGetterName() with drop_list set.
+    std::string getter_name_drop_list;
+    // JSObjectFieldName().
+    std::string object_field_name;
+    // JSFieldIndex().
+    std::string field_index;
+    // SubmessageTypeRef(), or empty if this is not a message field.
+    std::string submessage_type_ref;
+    // JSFieldTypeAnnotation() of getters, of getters that force presence and
+    // of setter arguments, in the default bytes mode.
+    std::string getter_type;
+    std::string present_getter_type;
+    std::string setter_type;
+  };
+
+  // Adds the names of all messages, enums and fields in `file`, and the paths
+  // of all types in its transitive dependencies. `options` must not refer to a
+  // NamingContext already.
+  void AddFile(const GeneratorOptions& options, const FileDescriptor* file);
+
+  // Returns the names of `field`, or nullptr if they were not added.
+  const FieldNames* FindField(const FieldDescriptor* field) const {
+    auto it = field_indices_.find(field);
+    return it == field_indices_.end() ? nullptr : &fields_[it->second];
+  }
+
+  // Returns the path of a message or enum descriptor, or nullptr if it was not
+  // added.
+  const std::string* FindPath(const void* descriptor) const {
+    auto it = path_indices_.find(descriptor);
+    return it == path_indices_.end() ? nullptr : &paths_[it->second];
+  }
+
+ private:
+  void AddTypes(const GeneratorOptions& options, const FileDescriptor* file,
+                bool add_fields);
+  void AddMessage(const GeneratorOptions& options, const Descriptor* desc,
+                  bool add_fields);
+  void AddEnum(const GeneratorOptions& options, const EnumDescriptor* desc);
+  void AddField(const GeneratorOptions& options, const FieldDescriptor* field);
+
+  // Dense tables of names, indexed through the descriptor maps below.
+  std::vector<FieldNames> fields_;
+  std::unordered_map<const FieldDescriptor*, size_t> field_indices_;
+  std::vector<std::string> paths_;
+  std::unordered_map<const void*, size_t> path_indices_;
+  // The files added so far, and whether their fields were added too.
+  std::map<const FileDescriptor*, bool> files_;
+};
+
+// Interns the names used in goog.provide(), goog.require() and
+// goog.forwardDeclare() statements. The characters of all names are stored
+// back to back in a single buffer, and every distinct name gets a dense id,
+// found through an open-addressing hash table.
+class SymbolTable {
+ public:
+  SymbolTable() : slots_(16, -1) {}
+
+  // Returns the id of `name`, adding it to the table if needed.
+  int Intern(const std::string& name) {
+    uint64_t hash = Hash(name);
+    size_t slot = FindSlot(name, hash);
+    if (slots_[slot] >= 0) {
+      return slots_[slot];
+    }
+    int id = size();
+    offsets_.push_back(chars_.size());
+    lengths_.push_back(name.size());
+    hashes_.push_back(hash);
+    chars_.append(name);
+    slots_[slot] = id;
+    // Keep the load factor below 1/2.
+    if (2 * offsets_.size() > slots_.size()) {
+      Grow();
+    }
+    return id;
+  }
+
+  int size() const { return static_cast<int>(offsets_.size()); }
+
+  std::string name(int id) const {
+    return chars_.substr(offsets_[id], lengths_[id]);
+  }
+
+  // Returns whether the name of symbol `a` sorts before the name of symbol
+  // `b`, in the order of std::string comparison.
+  bool Less(int a, int b) const {
+    return chars_.compare(offsets_[a], lengths_[a], chars_, offsets_[b],
+                          lengths_[b]) < 0;
+  }
+
+ private:
+  static uint64_t Hash(const std::string& name) {
+    // FNV-1a.
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : name) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  // Returns the slot holding `name`, or the empty slot it belongs in.
+  size_t FindSlot(const std::string& name, uint64_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+      int id = slots_[slot];
+      if (id < 0 || (hashes_[id] == hash &&
+                     chars_.compare(offsets_[id], lengths_[id], name) == 0)) {
+        return slot;
+      }
+    }
+  }
+
+  void Grow() {
+    std::vector<int> slots(slots_.size() * 2, -1);
+    size_t mask = slots.size() - 1;
+    for (int id = 0; id < size(); id++) {
+      size_t slot = hashes_[id] & mask;
+      while (slots[slot] >= 0) {
+        slot = (slot + 1) & mask;
+      }
+      slots[slot] = id;
+    }
+    slots_.swap(slots);
+  }
+
+  std::string chars_;
+  std::vector<size_t> offsets_;
+  std::vector<size_t> lengths_;
+  std::vector<uint64_t> hashes_;
+  std::vector<int> slots_;
+};
+
+// A set of names interned in a SymbolTable. Membership is tracked per symbol
+// id, so adding and looking up names does not compare strings, and the names
+// are only sorted once, when the set is printed.
+class SymbolSet {
+ public:
+  explicit SymbolSet(SymbolTable* table) : table_(table) {}
+
+  SymbolTable* table() const { return table_; }
+
+  void Insert(const std::string& name) {
+    int id = table_->Intern(name);
+    if (id >= static_cast<int>(members_.size())) {
+      members_.resize(table_->size());
+    }
+    if (!members_[id]) {
+      members_[id] = true;
+      ids_.push_back(id);
+    }
+  }
+
+  bool Contains(int id) const {
+    return id < static_cast<int>(members_.size()) && members_[id];
+  }
+
+  bool empty() const { return ids_.empty(); }
+
+  // Returns the ids of the names in the set, sorted by name.
+  std::vector<int> SortedIds() const {
+    std::vector<int> ids = ids_;
+    std::sort(ids.begin(), ids.end(),
+              [this](int a, int b) { return table_->Less(a, b); });
+    return ids;
+  }
+
+ private:
+  SymbolTable* table_;
+  // The members of the set, in insertion order.
+  std::vector<int> ids_;
+  // Indexed by symbol id.
+  std::vector<bool> members_;
+};
+
 namespace {
 
 // The mode of operation for bytes fields. Historically JSPB always carried
@@ -202,6 +401,12 @@ std::string GetMessagePathPrefix(const GeneratorOptions& options,
 // message descriptor.
 std::string GetMessagePath(const GeneratorOptions& options,
                            const Descriptor* descriptor) {
+  if (options.naming != nullptr) {
+    const std::string* path = options.naming->FindPath(descriptor);
+    if (path != nullptr) {
+      return *path;
+    }
+  }
   return GetMessagePathPrefix(options, descriptor) + descriptor->name();
 }
 
@@ -217,6 +422,12 @@ std::string GetEnumPathPrefix(const GeneratorOptions& options,
 // enumeration descriptor.
 std::string GetEnumPath(const GeneratorOptions& options,
                         const EnumDescriptor* enum_descriptor) {
+  if (options.naming != nullptr) {
+    const std::string* path = options.naming->FindPath(enum_descriptor);
+    if (path != nullptr) {
+      return *path;
+    }
+  }
   return GetEnumPathPrefix(options, enum_descriptor) + enum_descriptor->name();
 }
 
@@ -240,6 +451,12 @@ std::string MaybeCrossFileRef(const GeneratorOptions& options,
 std::string SubmessageTypeRef(const GeneratorOptions& options,
                               const FieldDescriptor* field) {
   GOOGLE_CHECK(field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE);
+  if (options.naming != nullptr) {
+    const NamingContext::FieldNames* names = options.naming->FindField(field);
+    if (names != nullptr) {
+      return names->submessage_type_ref;
+    }
+  }
   return MaybeCrossFileRef(options, field->file(), field->message_type());
 }
 
@@ -483,6 +700,12 @@ std::string JSIdent(const GeneratorOptions& options,
 
 std::string JSObjectFieldName(const GeneratorOptions& options,
                               const FieldDescriptor* field) {
+  if (options.naming != nullptr) {
+    const NamingContext::FieldNames* names = options.naming->FindField(field);
+    if (names != nullptr) {
+      return names->object_field_name;
+    }
+  }
   std::string name = JSIdent(options, field,
                              /* is_upper_camel = */ false,
                              /* is_map = */ false,
@@ -513,6 +736,15 @@ std::string JSGetterName(const GeneratorOptions& options,
                          const FieldDescriptor* field,
                          BytesMode bytes_mode = BYTES_DEFAULT,
                          bool drop_list = false) {
+  if (options.naming != nullptr) {
+    const NamingContext::FieldNames* names = options.naming->FindField(field);
+    if (names != nullptr && !drop_list) {
+      return names->getter_name[bytes_mode];
+    }
+    if (names != nullptr && bytes_mode == BYTES_DEFAULT) {
+      return names->getter_name_drop_list;
+    }
+  }
   std::string name = JSIdent(options, field,
                              /* is_upper_camel = */ true,
                              /* is_map = */ false, drop_list);
@@ -535,7 +767,14 @@ std::string JSOneofName(const OneofDescriptor* oneof) {
 
 // Returns the index corresponding to this field in the JSPB array (underlying
 // data storage array).
-std::string JSFieldIndex(const FieldDescriptor* field) {
+std::string JSFieldIndex(const GeneratorOptions& options,
+                         const FieldDescriptor* field) {
+  if (options.naming != nullptr) {
+    const NamingContext::FieldNames* names = options.naming->FindField(field);
+    if (names != nullptr) {
+      return names->field_index;
+    }
+  }
   // Determine whether this field is a member of a group. Group fields are a bit
   // wonky: their "containing type" is a message type created just for the
   // group, and that type's parent type has a field with the group-message type
@@ -797,31 +1036,57 @@ bool IsIntegralFieldWithStringJSType(const FieldDescriptor* field) {
   }
 }
 
-std::string MaybeNumberString(const FieldDescriptor* field,
+// Return true if this is an integral field that should be represented as
+// BigInt in JS, i.e. a 64-bit field without a jstype when the bigint option is
+// set.
+bool IsIntegralFieldWithBigIntJSType(const GeneratorOptions& options,
+                                     const FieldDescriptor* field) {
+  if (!options.bigint) {
+    return false;
+  }
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return field->options().jstype() == FieldOptions::JS_NORMAL;
+    default:
+      return false;
+  }
+}
+
+std::string MaybeNumberString(const GeneratorOptions& options,
+                              const FieldDescriptor* field,
                               const std::string& orig) {
+  if (IsIntegralFieldWithBigIntJSType(options, field)) {
+    return orig + "n";
+  }
   return IsIntegralFieldWithStringJSType(field) ? ("\"" + orig + "\"") : orig;
 }
 
-std::string JSFieldDefault(const FieldDescriptor* field) {
+std::string JSFieldDefault(const GeneratorOptions& options,
+                           const FieldDescriptor* field) {
   if (field->is_repeated()) {
     return "[]";
   }
 
   switch (field->cpp_type()) {
     case FieldDescriptor::CPPTYPE_INT32:
-      return MaybeNumberString(field, StrCat(field->default_value_int32()));
+      return MaybeNumberString(options, field,
+                               StrCat(field->default_value_int32()));
     case FieldDescriptor::CPPTYPE_UINT32:
       // The original codegen is in Java, and Java protobufs store unsigned
       // integer values as signed integer values. In order to exactly match the
       // output, we need to reinterpret as base-2 signed. Ugh.
       return MaybeNumberString(
-          field, StrCat(static_cast<int32_t>(field->default_value_uint32())));
+          options, field,
+          StrCat(static_cast<int32_t>(field->default_value_uint32())));
     case FieldDescriptor::CPPTYPE_INT64:
-      return MaybeNumberString(field, StrCat(field->default_value_int64()));
+      return MaybeNumberString(options, field,
+                               StrCat(field->default_value_int64()));
     case FieldDescriptor::CPPTYPE_UINT64:
       // See above note for uint32 -- reinterpreting as signed.
       return MaybeNumberString(
-          field, StrCat(static_cast<int64_t>(field->default_value_uint64())));
+          options, field,
+          StrCat(static_cast<int64_t>(field->default_value_uint64())));
     case FieldDescriptor::CPPTYPE_ENUM:
       return StrCat(field->default_value_enum()->number());
     case FieldDescriptor::CPPTYPE_BOOL:
@@ -896,7 +1161,11 @@ std::string ProtoTypeName(const GeneratorOptions& options,
   }
 }
 
-std::string JSIntegerTypeName(const FieldDescriptor* field) {
+std::string JSIntegerTypeName(const GeneratorOptions& options,
+                              const FieldDescriptor* field) {
+  if (IsIntegralFieldWithBigIntJSType(options, field)) {
+    return "bigint";
+  }
   return IsIntegralFieldWithStringJSType(field) ? "string" : "number";
 }
 
@@ -924,13 +1193,13 @@ std::string JSTypeName(const GeneratorOptions& options,
     case FieldDescriptor::CPPTYPE_BOOL:
       return "boolean";
     case FieldDescriptor::CPPTYPE_INT32:
-      return JSIntegerTypeName(field);
+      return JSIntegerTypeName(options, field);
     case FieldDescriptor::CPPTYPE_INT64:
-      return JSIntegerTypeName(field);
+      return JSIntegerTypeName(options, field);
     case FieldDescriptor::CPPTYPE_UINT32:
-      return JSIntegerTypeName(field);
+      return JSIntegerTypeName(options, field);
     case FieldDescriptor::CPPTYPE_UINT64:
-      return JSIntegerTypeName(field);
+      return JSIntegerTypeName(options, field);
     case FieldDescriptor::CPPTYPE_FLOAT:
       return "number";
     case FieldDescriptor::CPPTYPE_DOUBLE:
@@ -1015,7 +1284,50 @@ bool SetterAcceptsNull(const GeneratorOptions& options,
 // The style guide requires that we omit "!" in this case.
 bool IsPrimitive(const std::string& type) {
   return type == "undefined" || type == "string" || type == "number" ||
-         type == "boolean";
+         type == "bigint" || type == "boolean";
+}
+
+// Returns the typed array type that a packable field is decoded into with the
+// typed_arrays option, or "" if it is always a plain Array. Extensions are
+// decoded by jspb.Message.readBinaryExtension() and always use Arrays.
+std::string JSTypedArrayType(const GeneratorOptions& options,
+                             const FieldDescriptor* field) {
+  if (!options.typed_arrays || !field->is_packable() ||
+      field->is_extension()) {
+    return "";
+  }
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_DOUBLE:
+      return "Float64Array";
+    case FieldDescriptor::TYPE_FLOAT:
+      return "Float32Array";
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_SINT32:
+    case FieldDescriptor::TYPE_SFIXED32:
+      return "Int32Array";
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_FIXED32:
+      return "Uint32Array";
+    default:
+      return "";
+  }
+}
+
+// Returns true if the field is decoded lazily with the lazy option: only
+// singular message fields and packable repeated fields qualify, as they are the
+// fields whose wire bytes can be kept and decoded later in isolation.
+bool IsLazyField(const GeneratorOptions& options,
+                 const FieldDescriptor* field) {
+  if (options.lazy == GeneratorOptions::kLazyNone || field->is_extension() ||
+      InRealOneof(field)) {
+    return false;
+  }
+  const bool singular_message =
+      !field->is_repeated() && field->type() == FieldDescriptor::TYPE_MESSAGE;
+  if (!singular_message && !field->is_packable()) {
+    return false;
+  }
+  return options.lazy == GeneratorOptions::kLazyAll || field->options().lazy();
 }
 
 std::string JSFieldTypeAnnotation(const GeneratorOptions& options,
@@ -1024,6 +1336,15 @@ std::string JSFieldTypeAnnotation(const GeneratorOptions& options,
                                   bool singular_if_not_packed,
                                   BytesMode bytes_mode = BYTES_DEFAULT,
                                   bool force_singular = false) {
+  if (options.naming != nullptr && !singular_if_not_packed &&
+      bytes_mode == BYTES_DEFAULT && !force_singular) {
+    const NamingContext::FieldNames* names = options.naming->FindField(field);
+    if (names != nullptr) {
+      return is_setter_argument ? names->setter_type
+             : force_present    ? names->present_getter_type
+                                : names->getter_type;
+    }
+  }
   std::string jstype = JSTypeName(options, field, bytes_mode);
 
   if (!force_singular && field->is_repeated() &&
@@ -1036,6 +1357,10 @@ std::string JSFieldTypeAnnotation(const GeneratorOptions& options,
         jstype = "!" + jstype;
       }
       jstype = "Array<" + jstype + ">";
+      std::string typed_array = JSTypedArrayType(options, field);
+      if (!is_setter_argument && !typed_array.empty()) {
+        jstype = "(" + jstype + "|" + typed_array + ")";
+      }
     }
   }
 
@@ -1067,17 +1392,22 @@ std::string JSFieldTypeAnnotation(const GeneratorOptions& options,
   return jstype;
 }
 
-std::string JSBinaryReaderMethodType(const FieldDescriptor* field) {
+std::string JSBinaryReaderMethodType(const GeneratorOptions& options,
+                                     const FieldDescriptor* field) {
   std::string name = field->type_name();
   if (name[0] >= 'a' && name[0] <= 'z') {
     name[0] = (name[0] - 'a') + 'A';
   }
+  if (IsIntegralFieldWithBigIntJSType(options, field)) {
+    return name + "BigInt";
+  }
   return IsIntegralFieldWithStringJSType(field) ? (name + "String") : name;
 }
 
-std::string JSBinaryReadWriteMethodName(const FieldDescriptor* field,
+std::string JSBinaryReadWriteMethodName(const GeneratorOptions& options,
+                                        const FieldDescriptor* field,
                                         bool is_writer) {
-  std::string name = JSBinaryReaderMethodType(field);
+  std::string name = JSBinaryReaderMethodType(options, field);
   if (field->is_packed()) {
     name = "Packed" + name;
   } else if (is_writer && field->is_repeated()) {
@@ -1089,7 +1419,7 @@ std::string JSBinaryReadWriteMethodName(const FieldDescriptor* field,
 std::string JSBinaryReaderMethodName(const GeneratorOptions& options,
                                      const FieldDescriptor* field) {
   return "jspb.BinaryReader.prototype.read" +
-         JSBinaryReadWriteMethodName(field, /* is_writer = */ false);
+         JSBinaryReadWriteMethodName(options, field, /* is_writer = */ false);
 }
 
 std::string JSBinaryWriterMethodName(const GeneratorOptions& options,
@@ -1099,10 +1429,11 @@ std::string JSBinaryWriterMethodName(const GeneratorOptions& options,
     return "jspb.BinaryWriter.prototype.writeMessageSet";
   }
   return "jspb.BinaryWriter.prototype.write" +
-         JSBinaryReadWriteMethodName(field, /* is_writer = */ true);
+         JSBinaryReadWriteMethodName(options, field, /* is_writer = */ true);
 }
 
-std::string JSTypeTag(const FieldDescriptor* desc) {
+std::string JSTypeTag(const GeneratorOptions& options,
+                      const FieldDescriptor* desc) {
   switch (desc->type()) {
     case FieldDescriptor::TYPE_DOUBLE:
     case FieldDescriptor::TYPE_FLOAT:
@@ -1119,6 +1450,8 @@ std::string JSTypeTag(const FieldDescriptor* desc) {
     case FieldDescriptor::TYPE_SFIXED64:
       if (IsIntegralFieldWithStringJSType(desc)) {
         return "StringInt";
+      } else if (IsIntegralFieldWithBigIntJSType(options, desc)) {
+        return "BigInt";
       } else {
         return "Int";
       }
@@ -1136,6 +1469,23 @@ std::string JSTypeTag(const FieldDescriptor* desc) {
   return "";
 }
 
+// Returns the default value that the jspb.Message.setProto3*Field() function
+// named by JSTypeTag() clears the field for.
+std::string JSTypeTagDefault(const GeneratorOptions& options,
+                             const FieldDescriptor* desc) {
+  const std::string tag = JSTypeTag(options, desc);
+  if (tag == "Boolean") {
+    return "false";
+  } else if (tag == "String" || tag == "Bytes") {
+    return "''";
+  } else if (tag == "StringInt") {
+    return "'0'";
+  } else if (tag == "BigInt") {
+    return "0n";
+  }
+  return "0";
+}
+
 bool HasRepeatedFields(const GeneratorOptions& options,
                        const Descriptor* desc) {
   for (int i = 0; i < desc->field_count(); i++) {
@@ -1178,13 +1528,14 @@ std::string RepeatedFieldNumberList(const GeneratorOptions& options,
   std::vector<std::string> numbers;
   for (int i = 0; i < desc->field_count(); i++) {
     if (desc->field(i)->is_repeated() && !desc->field(i)->is_map()) {
-      numbers.push_back(JSFieldIndex(desc->field(i)));
+      numbers.push_back(JSFieldIndex(options, desc->field(i)));
     }
   }
   return "[" + Join(numbers, ",") + "]";
 }
 
-std::string OneofGroupList(const Descriptor* desc) {
+std::string OneofGroupList(const GeneratorOptions& options,
+                           const Descriptor* desc) {
   // List of arrays (one per oneof), each of which is a list of field indices
   std::vector<std::string> oneof_entries;
   for (int i = 0; i < desc->oneof_decl_count(); i++) {
@@ -1198,7 +1549,7 @@ std::string OneofGroupList(const Descriptor* desc) {
       if (IgnoreField(oneof->field(j))) {
         continue;
       }
-      oneof_fields.push_back(JSFieldIndex(oneof->field(j)));
+      oneof_fields.push_back(JSFieldIndex(options, oneof->field(j)));
     }
     oneof_entries.push_back("[" + Join(oneof_fields, ",") + "]");
   }
@@ -1313,6 +1664,42 @@ bool ShouldGenerateExtension(const FieldDescriptor* field) {
   return field->is_extension() && !IgnoreField(field);
 }
 
+// Returns whether a top-level message, a top-level enum or a file-level
+// extension is generated, i.e. whether it is reachable from options.roots.
+bool IsReachable(const GeneratorOptions& options, const void* desc) {
+  return options.reachable == nullptr || options.reachable->count(desc) > 0;
+}
+
+bool HasReachableMessages(const GeneratorOptions& options,
+                          const FileDescriptor* file) {
+  for (int i = 0; i < file->message_type_count(); i++) {
+    if (IsReachable(options, file->message_type(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Appends the extensions generated inside desc and its nested messages.
+void FindNestedExtensions(const Descriptor* desc,
+                          std::vector<const FieldDescriptor*>* extensions) {
+  for (int i = 0; i < desc->extension_count(); i++) {
+    if (ShouldGenerateExtension(desc->extension(i))) {
+      extensions->push_back(desc->extension(i));
+    }
+  }
+  for (int i = 0; i < desc->nested_type_count(); i++) {
+    if (!IgnoreMessage(desc->nested_type(i))) {
+      FindNestedExtensions(desc->nested_type(i), extensions);
+    }
+  }
+}
+
+// Returns the function that copies the exports of a generated file.
+std::string ExtendFunction(const GeneratorOptions& options) {
+  return options.lazy_init ? "jspb.Message.extendLazy" : "goog.object.extend";
+}
+
 bool HasExtensions(const Descriptor* desc) {
   for (int i = 0; i < desc->extension_count(); i++) {
     if (ShouldGenerateExtension(desc->extension(i))) {
@@ -1327,14 +1714,17 @@ bool HasExtensions(const Descriptor* desc) {
   return false;
 }
 
-bool HasExtensions(const FileDescriptor* file) {
+bool HasExtensions(const GeneratorOptions& options,
+                   const FileDescriptor* file) {
   for (int i = 0; i < file->extension_count(); i++) {
-    if (ShouldGenerateExtension(file->extension(i))) {
+    if (ShouldGenerateExtension(file->extension(i)) &&
+        IsReachable(options, file->extension(i))) {
       return true;
     }
   }
   for (int i = 0; i < file->message_type_count(); i++) {
-    if (HasExtensions(file->message_type(i))) {
+    if (IsReachable(options, file->message_type(i)) &&
+        HasExtensions(file->message_type(i))) {
       return true;
     }
   }
@@ -1357,7 +1747,8 @@ bool HasMap(const GeneratorOptions& options, const Descriptor* desc) {
 
 bool FileHasMap(const GeneratorOptions& options, const FileDescriptor* desc) {
   for (int i = 0; i < desc->message_type_count(); i++) {
-    if (HasMap(options, desc->message_type(i))) {
+    if (IsReachable(options, desc->message_type(i)) &&
+        HasMap(options, desc->message_type(i))) {
       return true;
     }
   }
@@ -1369,8 +1760,8 @@ bool IsExtendable(const Descriptor* desc) {
 }
 
 // Returns the max index in the underlying data storage array beyond which the
-// extension object is used.
-std::string GetPivot(const Descriptor* desc) {
+// extension object is used, or -1 if the message has no extension object.
+int GetPivotNumber(const Descriptor* desc) {
   static const int kDefaultPivot = 500;
 
   // Find the max field number
@@ -1388,7 +1779,87 @@ std::string GetPivot(const Descriptor* desc) {
                                                      : kDefaultPivot;
   }
 
-  return StrCat(pivot);
+  return pivot;
+}
+
+std::string GetPivot(const Descriptor* desc) {
+  return StrCat(GetPivotNumber(desc));
+}
+
+// Returns the index in the underlying array of a message at which generated
+// code may read and write the given field directly, or -1 if the field must be
+// accessed through the jspb.Message helpers. These are map, message and
+// extension fields, fields from the pivot on, which may be stored in the
+// extension object, and group fields whose relative index is not positive.
+int DirectArrayIndex(const GeneratorOptions& options,
+                     const FieldDescriptor* field) {
+  if (field->is_extension() || field->is_map() ||
+      field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    return -1;
+  }
+  int32_t field_index;
+  if (!safe_strto32(JSFieldIndex(options, field), &field_index) ||
+      field_index < 1) {
+    return -1;
+  }
+  const Descriptor* desc = field->containing_type();
+  const int pivot = GetPivotNumber(desc);
+  if (pivot > -1 && field->number() >= pivot) {
+    return -1;
+  }
+  // Messages without a message id do not reserve the first array element.
+  const bool has_message_id = !GetMessageId(desc).empty() || IsResponse(desc);
+  return has_message_id ? field_index : field_index - 1;
+}
+
+// Returns the array index that the direct_object option reads and writes the
+// field at in toObject() and fromObject(), or -1.
+int DirectObjectIndex(const GeneratorOptions& options,
+                      const FieldDescriptor* field) {
+  return options.direct_object ? DirectArrayIndex(options, field) : -1;
+}
+
+// Returns the array index that the accessors of the field read and write
+// directly with the inline_accessors option, or -1. Only singular scalar
+// fields of messages that are not extendable are inlined.
+int InlineAccessorIndex(const GeneratorOptions& options,
+                        const FieldDescriptor* field) {
+  if (!options.inline_accessors || field->is_repeated() ||
+      IsExtendable(field->containing_type())) {
+    return -1;
+  }
+  return DirectArrayIndex(options, field);
+}
+
+// Returns `value` coerced like the jspb.Message getters coerce the raw value of
+// the scalar field, for a value known not to be null.
+std::string DirectFieldValue(const FieldDescriptor* field,
+                             const std::string& value) {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return "!!" + value;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return "+" + value;
+    default:
+      return value;
+  }
+}
+
+// Returns true if toObject() reads the field directly from the underlying
+// array with the direct_object option. Bytes fields and repeated boolean and
+// floating point fields are still converted by their jspb.Message helpers.
+bool IsDirectToObjectField(const GeneratorOptions& options,
+                           const FieldDescriptor* field) {
+  if (DirectObjectIndex(options, field) < 0 ||
+      field->type() == FieldDescriptor::TYPE_BYTES) {
+    return false;
+  }
+  const bool is_float_or_double =
+      field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT ||
+      field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE;
+  const bool is_boolean = field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL;
+  return !field->is_repeated() || !(is_float_or_double || is_boolean);
 }
 
 // Whether this field represents presence.  For fields with presence, we
@@ -1400,6 +1871,143 @@ bool HasFieldPresence(const GeneratorOptions& options,
   return field->has_presence();
 }
 
+// Flags of a field in the accessor tables emitted for the compact option.
+// These must match jspb.Message.AccessorFlags in message.js.
+enum AccessorFlag {
+  kAccessorRepeated = 1,
+  kAccessorFloatingPoint = 2,
+  kAccessorBoolean = 4,
+  kAccessorWithDefault = 8,
+  kAccessorPresence = 16,
+};
+
+// Returns whether the accessors of the field are installed from the accessor
+// table of its message with the compact option, rather than generated.
+bool IsTableAccessorField(const GeneratorOptions& options,
+                          const FieldDescriptor* field) {
+  return options.compact && !field->is_map() &&
+         field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE &&
+         field->type() != FieldDescriptor::TYPE_BYTES &&
+         !InRealOneof(field) && InlineAccessorIndex(options, field) < 0;
+}
+
+// Flags of a field in the tables emitted for codec=table. These must match
+// jspb.BinaryCodec.Flag in binary/codec.js.
+enum BinaryCodecFlag {
+  kBinaryCodecRepeated = 1,
+  kBinaryCodecPacked = 2,
+  kBinaryCodecPackable = 4,
+  kBinaryCodecMap = 8,
+  kBinaryCodecPresence = 16,
+  kBinaryCodecString = 32,
+  kBinaryCodecTypedArray = 64,
+  kBinaryCodecLazy = 128,
+  kBinaryCodecBigInt = 256,
+  kBinaryCodecReuse = 512,
+};
+
+int BinaryCodecFlags(const GeneratorOptions& options,
+                     const FieldDescriptor* field) {
+  int flags = 0;
+  if (field->is_map()) {
+    flags |= kBinaryCodecMap;
+  } else if (field->is_repeated()) {
+    flags |= kBinaryCodecRepeated;
+  }
+  if (field->is_packed()) {
+    flags |= kBinaryCodecPacked;
+  }
+  if (field->is_packable()) {
+    flags |= kBinaryCodecPackable;
+  }
+  if (HasFieldPresence(options, field)) {
+    flags |= kBinaryCodecPresence;
+  }
+  if (IsIntegralFieldWithStringJSType(field)) {
+    flags |= kBinaryCodecString;
+  }
+  if (IsIntegralFieldWithBigIntJSType(options, field)) {
+    flags |= kBinaryCodecBigInt;
+  }
+  if (!JSTypedArrayType(options, field).empty()) {
+    flags |= kBinaryCodecTypedArray;
+  }
+  if (IsLazyField(options, field)) {
+    flags |= kBinaryCodecLazy;
+  }
+  if (options.reuse && !field->is_map() &&
+      field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    flags |= kBinaryCodecReuse;
+  }
+  return flags;
+}
+
+// Returns the fields of the message in the order given by the field_order
+// and field_profile options, in which the binary serialization code handles
+// them.
+std::vector<const FieldDescriptor*> OrderedFields(
+    const GeneratorOptions& options, const Descriptor* desc) {
+  std::vector<const FieldDescriptor*> fields;
+  for (int i = 0; i < desc->field_count(); i++) {
+    fields.push_back(desc->field(i));
+  }
+  if (options.field_order == GeneratorOptions::kFieldOrderNumber) {
+    std::stable_sort(fields.begin(), fields.end(),
+                     [](const FieldDescriptor* a, const FieldDescriptor* b) {
+                       return a->number() < b->number();
+                     });
+  }
+  if (!options.field_counts.empty()) {
+    auto count = [&options](const FieldDescriptor* field) -> int64_t {
+      auto it = options.field_counts.find(field->full_name());
+      return it == options.field_counts.end() ? 0 : it->second;
+    };
+    std::stable_sort(fields.begin(), fields.end(),
+                     [&count](const FieldDescriptor* a,
+                              const FieldDescriptor* b) {
+                       return count(a) > count(b);
+                     });
+  }
+  return fields;
+}
+
+// Returns the tag (field number and wire type) that the field is written
+// with, for the expected_tags option, or -1 if it is not encoded in at most
+// two bytes, which jspb.BinaryReader.prototype.nextFieldIf() requires.
+int ExpectedTag(const FieldDescriptor* field) {
+  if (field->number() >= 2048) {
+    return -1;
+  }
+  int wire_type = 0;  // VARINT
+  if (field->is_packed()) {
+    wire_type = 2;  // DELIMITED
+  } else {
+    switch (field->type()) {
+      case FieldDescriptor::TYPE_DOUBLE:
+      case FieldDescriptor::TYPE_FIXED64:
+      case FieldDescriptor::TYPE_SFIXED64:
+        wire_type = 1;  // FIXED64
+        break;
+      case FieldDescriptor::TYPE_FLOAT:
+      case FieldDescriptor::TYPE_FIXED32:
+      case FieldDescriptor::TYPE_SFIXED32:
+        wire_type = 5;  // FIXED32
+        break;
+      case FieldDescriptor::TYPE_STRING:
+      case FieldDescriptor::TYPE_BYTES:
+      case FieldDescriptor::TYPE_MESSAGE:
+        wire_type = 2;  // DELIMITED
+        break;
+      case FieldDescriptor::TYPE_GROUP:
+        wire_type = 3;  // START_GROUP
+        break;
+      default:
+        break;
+    }
+  }
+  return (field->number() << 3) | wire_type;
+}
+
 // We use this to implement the semantics that same file can be generated
 // multiple times, but only the last one keep the short name. Others all use
 // long name with extra information to distinguish (For message and enum, the
@@ -1527,6 +2135,107 @@ struct DepsGenerator {
   }
 };
 
+// Collects the descriptors reachable from the roots, for options.reachable.
+class ReachabilityFinder {
+ public:
+  explicit ReachabilityFinder(std::set<const void*>* reachable)
+      : reachable_(reachable) {}
+
+  void AddMessage(const Descriptor* desc) {
+    if (desc != nullptr && reachable_->insert(desc).second) {
+      pending_.push_back(desc);
+    }
+  }
+
+  void AddEnum(const EnumDescriptor* enumdesc) {
+    if (enumdesc != nullptr && reachable_->insert(enumdesc).second) {
+      AddMessage(enumdesc->containing_type());
+    }
+  }
+
+  void AddExtension(const FieldDescriptor* field) {
+    if (reachable_->insert(field).second) {
+      AddMessage(field->extension_scope());
+      AddFieldTypes(field);
+    }
+  }
+
+  // Follows the DepsGenerator edges and the enum types of fields from the
+  // added messages, until no new descriptors are found.
+  void Close() {
+    while (!pending_.empty()) {
+      const Descriptor* desc = pending_.back();
+      pending_.pop_back();
+      for (auto dep : DepsGenerator()(desc)) {
+        AddMessage(dep);
+      }
+      for (int i = 0; i < desc->field_count(); i++) {
+        if (!IgnoreField(desc->field(i))) {
+          AddEnum(desc->field(i)->enum_type());
+        }
+      }
+      for (int i = 0; i < desc->extension_count(); i++) {
+        AddEnum(desc->extension(i)->enum_type());
+      }
+      for (int i = 0; i < desc->enum_type_count(); i++) {
+        AddEnum(desc->enum_type(i));
+      }
+    }
+  }
+
+ private:
+  void AddFieldTypes(const FieldDescriptor* field) {
+    AddMessage(field->containing_type());
+    AddMessage(field->message_type());
+    AddEnum(field->enum_type());
+  }
+
+  std::set<const void*>* reachable_;
+  std::vector<const Descriptor*> pending_;
+};
+
+// Computes the set of descriptors reachable from options.roots; see
+// GeneratorOptions::roots.
+bool FindReachableDescriptors(const GeneratorOptions& options,
+                              const std::vector<const FileDescriptor*>& files,
+                              std::set<const void*>* reachable,
+                              std::string* error) {
+  ReachabilityFinder finder(reachable);
+  for (const auto& root : options.roots) {
+    const DescriptorPool* pool = files.empty() ? nullptr : files[0]->pool();
+    if (pool != nullptr && pool->FindMessageTypeByName(root) != nullptr) {
+      finder.AddMessage(pool->FindMessageTypeByName(root));
+    } else if (pool != nullptr && pool->FindEnumTypeByName(root) != nullptr) {
+      finder.AddEnum(pool->FindEnumTypeByName(root));
+    } else if (pool != nullptr &&
+               pool->FindExtensionByName(root) != nullptr) {
+      finder.AddExtension(pool->FindExtensionByName(root));
+    } else {
+      *error = "No message, enum or extension named " + root + " for roots";
+      return false;
+    }
+  }
+
+  // A file-level extension is reachable if the message it extends is; it
+  // can then bring in more messages, and with them more extensions.
+  bool changed = true;
+  while (changed) {
+    finder.Close();
+    changed = false;
+    for (auto file : files) {
+      for (int i = 0; i < file->extension_count(); i++) {
+        const FieldDescriptor* extension = file->extension(i);
+        if (reachable->count(extension) == 0 &&
+            reachable->count(extension->containing_type()) > 0) {
+          finder.AddExtension(extension);
+          changed = true;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 bool GenerateJspbAllowedMap(const GeneratorOptions& options,
                             const std::vector<const FileDescriptor*>& files,
                             std::map<const void*, std::string>* allowed_set,
@@ -1540,6 +2249,9 @@ bool GenerateJspbAllowedMap(const GeneratorOptions& options,
   for (auto file : files_ordered) {
     for (int j = 0; j < file->message_type_count(); j++) {
       const Descriptor* desc = file->message_type(j);
+      if (!IsReachable(options, desc)) {
+        continue;
+      }
       if (added.insert(analyzer->GetSCC(desc)).second &&
           !dedup.AddFile(
               std::make_pair(
@@ -1551,6 +2263,9 @@ bool GenerateJspbAllowedMap(const GeneratorOptions& options,
     }
     for (int j = 0; j < file->enum_type_count(); j++) {
       const EnumDescriptor* desc = file->enum_type(j);
+      if (!IsReachable(options, desc)) {
+        continue;
+      }
       if (!dedup.AddFile(std::make_pair(GetEnumFileName(options, desc, false),
                                         GetEnumFileName(options, desc, true)),
                          desc)) {
@@ -1562,7 +2277,8 @@ bool GenerateJspbAllowedMap(const GeneratorOptions& options,
     bool has_extension = false;
 
     for (int j = 0; j < file->extension_count(); j++) {
-      if (ShouldGenerateExtension(file->extension(j))) {
+      if (ShouldGenerateExtension(file->extension(j)) &&
+          IsReachable(options, file->extension(j))) {
         has_extension = true;
       }
     }
@@ -1598,708 +2314,2195 @@ void EmbedCodeAnnotations(const GeneratedCodeInfo& annotations,
   printer->Print("\n// $encoded_proto$\n", "encoded_proto", meta_64);
 }
 
+// Writes the annotations of the printed code to a stream as they are added,
+// for annotate_code=sidecar. Each one is written as an `annotation` field of
+// GeneratedCodeInfo, so that the stream as a whole is a serialized
+// GeneratedCodeInfo, without ever holding all the annotations in memory.
+class StreamingAnnotationCollector : public io::AnnotationCollector {
+ public:
+  explicit StreamingAnnotationCollector(io::ZeroCopyOutputStream* output)
+      : output_(output), count_(0) {}
+
+  using io::AnnotationCollector::AddAnnotation;
+
+  void AddAnnotation(size_t begin_offset, size_t end_offset,
+                     const std::string& file_path,
+                     const std::vector<int>& path) override {
+    GeneratedCodeInfo::Annotation annotation;
+    for (int index : path) {
+      annotation.add_path(index);
+    }
+    annotation.set_source_file(file_path);
+    annotation.set_begin(begin_offset);
+    annotation.set_end(end_offset);
+    annotation.SerializeToString(&buffer_);
+    // Field 1 (GeneratedCodeInfo.annotation), length-delimited.
+    output_.WriteTag((GeneratedCodeInfo::kAnnotationFieldNumber << 3) | 2);
+    output_.WriteVarint32(buffer_.size());
+    output_.WriteString(buffer_);
+    count_++;
+  }
+
+  bool failed() const { return output_.HadError(); }
+  int count() const { return count_; }
+
+ private:
+  io::CodedOutputStream output_;
+  // Reused for each annotation.
+  std::string buffer_;
+  int count_;
+};
+
 bool IsWellKnownTypeFile(const FileDescriptor* file) {
   return HasPrefixString(file->name(), "google/protobuf/");
 }
 
-}  // anonymous namespace
-
-void Generator::GenerateHeader(const GeneratorOptions& options,
-                               const FileDescriptor* file,
-                               io::Printer* printer) const {
-  if (file != nullptr) {
-    printer->Print("// source: $filename$\n", "filename", file->name());
+// Returns the name of the output file holding all the generated code of the
+// given .proto file. If use_short_name is true, the name is built from the
+// file's base name only, without its directory.
+std::string GetFileOutputName(const GeneratorOptions& options,
+                              const FileDescriptor* file,
+                              bool use_short_name) {
+  return options.output_dir + "/" +
+         GetJSFilename(options,
+                       use_short_name
+                           ? file->name().substr(file->name().rfind('/'))
+                           : file->name());
+}
+
+// Version of the generation cache. Entries are also keyed by
+// JS_GENERATOR_DIGEST, a checksum of the generator sources computed at build
+// time, so that changes to the generated code or to the cache entry format
+// never replay entries of another build.
+const char kGeneratorCacheVersion[] = "protoc-gen-js 3.21.2 cache 2";
+
+// Appends a length-prefixed value to a cache key, so that the boundaries
+// between adjacent values are unambiguous.
+void AppendToCacheKey(const std::string& value, std::string* key) {
+  StrAppend(key, value.size(), ":", value, ";");
+}
+
+// Adds the file-level properties that affect the code generated for any
+// descriptor in `file`.
+void AddFileToCacheKey(const FileDescriptor* file, std::string* key) {
+  AppendToCacheKey(file->name(), key);
+  AppendToCacheKey(file->package(), key);
+  AppendToCacheKey(FileDescriptor::SyntaxName(file->syntax()), key);
+  AppendToCacheKey(file->options().SerializeAsString(), key);
+}
+
+// Adds everything the generated code for `field` may depend on outside of
+// its own FieldDescriptorProto: the names and files of the types it refers
+// to, and the full definition of its enum type (needed for default values).
+void AddFieldTypesToCacheKey(const FieldDescriptor* field, std::string* key) {
+  const Descriptor* types[] = {
+      field->containing_type(),
+      field->is_extension() ? field->extension_scope() : nullptr,
+      field->message_type()};
+  for (const Descriptor* type : types) {
+    if (type == nullptr) {
+      AppendToCacheKey("", key);
+      continue;
+    }
+    AppendToCacheKey(type->full_name(), key);
+    AppendToCacheKey(type->file()->name(), key);
+    AppendToCacheKey(type->file()->package(), key);
+    AppendToCacheKey(type->options().SerializeAsString(), key);
+  }
+  if (field->enum_type() != nullptr) {
+    EnumDescriptorProto proto;
+    field->enum_type()->CopyTo(&proto);
+    AppendToCacheKey(field->enum_type()->full_name(), key);
+    AppendToCacheKey(field->enum_type()->file()->name(), key);
+    AppendToCacheKey(field->enum_type()->file()->package(), key);
+    AppendToCacheKey(proto.SerializeAsString(), key);
+  }
+}
+
+// Returns the cache key shared by all jobs of a run: the generator version
+// and every option that can change the generated code.
+std::string GetOptionsCacheKey(
+    const GeneratorOptions& options,
+    const std::vector<std::pair<std::string, std::string> >& option_pairs) {
+  std::string key;
+  AppendToCacheKey(kGeneratorCacheVersion, &key);
+  AppendToCacheKey(JS_GENERATOR_DIGEST, &key);
+  for (const auto& option : option_pairs) {
+    // These only affect how the output is produced, not what it contains.
+    if (option.first == "cache_dir" || option.first == "parallel") {
+      continue;
+    }
+    AppendToCacheKey(option.first, &key);
+    AppendToCacheKey(option.second, &key);
   }
-  printer->Print(
-      "/**\n"
-      " * @fileoverview\n"
-      " * @enhanceable\n"
-      // TODO(b/152440355): requireType/requires diverged from internal version.
-      " * @suppress {missingRequire} reports error on implicit type usages.\n"
-      " * @suppress {messageConventions} JS Compiler reports an "
-      "error if a variable or\n"
-      " *     field starts with 'MSG_' and isn't a translatable "
-      "message.\n"
-      " * @public\n"
-      " */\n"
-      "// GENERATED CODE -- DO NOT EDIT!\n"
-      "/* eslint-disable */\n"
-      "// @ts-nocheck\n"
-      "\n");
+  // The output depends on the contents of the field_profile file, not only
+  // on its name.
+  for (const auto& count : options.field_counts) {
+    AppendToCacheKey(count.first, &key);
+    AppendToCacheKey(StrCat(count.second), &key);
+  }
+  return key;
 }
 
-void Generator::FindProvidesForFile(const GeneratorOptions& options,
-                                    io::Printer* printer,
-                                    const FileDescriptor* file,
-                                    std::set<std::string>* provided) const {
-  for (int i = 0; i < file->message_type_count(); i++) {
-    FindProvidesForMessage(options, printer, file->message_type(i), provided);
-  }
-  for (int i = 0; i < file->enum_type_count(); i++) {
-    FindProvidesForEnum(options, printer, file->enum_type(i), provided);
+// Adds the generated top-level types of the files to the cache key, as with
+// roots, the output of a file also depends on the files importing it.
+void AddReachableToCacheKey(const GeneratorOptions& options,
+                            const std::vector<const FileDescriptor*>& files,
+                            std::string* key) {
+  for (auto file : files) {
+    for (int i = 0; i < file->message_type_count(); i++) {
+      if (IsReachable(options, file->message_type(i))) {
+        AppendToCacheKey(file->message_type(i)->full_name(), key);
+      }
+    }
+    for (int i = 0; i < file->enum_type_count(); i++) {
+      if (IsReachable(options, file->enum_type(i))) {
+        AppendToCacheKey(file->enum_type(i)->full_name(), key);
+      }
+    }
+    for (int i = 0; i < file->extension_count(); i++) {
+      if (IsReachable(options, file->extension(i))) {
+        AppendToCacheKey(file->extension(i)->full_name(), key);
+      }
+    }
   }
 }
 
-void Generator::FindProvides(const GeneratorOptions& options,
-                             io::Printer* printer,
-                             const std::vector<const FileDescriptor*>& files,
-                             std::set<std::string>* provided) const {
+// Returns the cache key of the file generated for one SCC of messages.
+std::string GetSCCCacheKey(const std::string& options_key,
+                           const std::string& filename,
+                           const FileDescriptor* file, const SCC* scc) {
+  std::string key = options_key;
+  AppendToCacheKey(filename, &key);
+  AddFileToCacheKey(file, &key);
+  for (auto desc : scc->descriptors) {
+    DescriptorProto proto;
+    desc->CopyTo(&proto);
+    // The index is part of the annotation paths.
+    AppendToCacheKey(StrCat(desc->index()), &key);
+    AppendToCacheKey(proto.SerializeAsString(), &key);
+    for (int i = 0; i < desc->field_count(); i++) {
+      AddFieldTypesToCacheKey(desc->field(i), &key);
+    }
+    for (int i = 0; i < desc->extension_count(); i++) {
+      AddFieldTypesToCacheKey(desc->extension(i), &key);
+    }
+  }
+  return key;
+}
+
+// Returns the cache key of the file generated for a top-level enum.
+std::string GetEnumCacheKey(const std::string& options_key,
+                            const std::string& filename,
+                            const EnumDescriptor* enumdesc) {
+  std::string key = options_key;
+  AppendToCacheKey(filename, &key);
+  AddFileToCacheKey(enumdesc->file(), &key);
+  EnumDescriptorProto proto;
+  enumdesc->CopyTo(&proto);
+  AppendToCacheKey(StrCat(enumdesc->index()), &key);
+  AppendToCacheKey(proto.SerializeAsString(), &key);
+  return key;
+}
+
+// Returns the cache key of the file generated for the top-level extensions
+// of a file.
+std::string GetExtensionsCacheKey(
+    const std::string& options_key, const std::string& filename,
+    const FileDescriptor* file,
+    const std::vector<const FieldDescriptor*>& fields) {
+  std::string key = options_key;
+  AppendToCacheKey(filename, &key);
+  AddFileToCacheKey(file, &key);
+  for (auto field : fields) {
+    FieldDescriptorProto proto;
+    field->CopyTo(&proto);
+    AppendToCacheKey(StrCat(field->index()), &key);
+    AppendToCacheKey(proto.SerializeAsString(), &key);
+    AddFieldTypesToCacheKey(field, &key);
+  }
+  return key;
+}
+
+// Returns the cache key of a file generated from whole .proto files. Since
+// such a file may refer to anything in its imports, the key covers `files`
+// and all of their transitive dependencies.
+std::string GetFilesCacheKey(const std::string& options_key,
+                             const std::string& filename,
+                             const std::vector<const FileDescriptor*>& files) {
+  std::string key = options_key;
+  AppendToCacheKey(filename, &key);
   for (auto file : files) {
-    FindProvidesForFile(options, printer, file, provided);
+    AppendToCacheKey(file->name(), &key);
+  }
+  std::set<const FileDescriptor*> seen;
+  std::vector<const FileDescriptor*> stack(files.begin(), files.end());
+  std::map<std::string, const FileDescriptor*> all_files;
+  while (!stack.empty()) {
+    const FileDescriptor* file = stack.back();
+    stack.pop_back();
+    if (!seen.insert(file).second) {
+      continue;
+    }
+    all_files[file->name()] = file;
+    for (int i = 0; i < file->dependency_count(); i++) {
+      stack.push_back(file->dependency(i));
+    }
+  }
+  for (const auto& entry : all_files) {
+    FileDescriptorProto proto;
+    entry.second->CopyTo(&proto);
+    AppendToCacheKey(proto.SerializeAsString(), &key);
   }
+  return key;
+}
 
-  printer->Print("\n");
+// Returns the path of the cache entry for `key`, named after its 64-bit
+// FNV-1a hash. The entry itself stores the whole key, so hash collisions are
+// detected when it is read back.
+std::string GetCacheEntryPath(const GeneratorOptions& options,
+                              const std::string& key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return options.cache_dir + "/" +
+         StringPrintf("%016llx", static_cast<unsigned long long>(hash)) +
+         ".jscache";
 }
 
-void FindProvidesForOneOfEnum(const GeneratorOptions& options,
-                              const OneofDescriptor* oneof,
-                              std::set<std::string>* provided) {
-  std::string name = GetMessagePath(options, oneof->containing_type()) + "." +
-                     JSOneofName(oneof) + "Case";
-  provided->insert(name);
+// Looks up the output cached for `key`. Returns false on a cache miss.
+bool ReadCacheEntry(const GeneratorOptions& options, const std::string& key,
+                    std::string* output) {
+  std::ifstream in(GetCacheEntryPath(options, key),
+                   std::ios::in | std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  std::string entry((std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>());
+  std::string header;
+  AppendToCacheKey(key, &header);
+  if (in.bad() || entry.compare(0, header.size(), header) != 0) {
+    return false;
+  }
+  output->assign(entry, header.size(), std::string::npos);
+  return true;
 }
 
-void FindProvidesForOneOfEnums(const GeneratorOptions& options,
-                               io::Printer* printer, const Descriptor* desc,
-                               std::set<std::string>* provided) {
-  if (HasOneofFields(desc)) {
-    for (int i = 0; i < desc->oneof_decl_count(); i++) {
-      if (IgnoreOneof(desc->oneof_decl(i))) {
-        continue;
-      }
-      FindProvidesForOneOfEnum(options, desc->oneof_decl(i), provided);
+// Returns the cache key of the .meta file written with annotate_code=sidecar
+// next to the output cached for `key`.
+std::string GetMetaCacheKey(const std::string& key) {
+  std::string meta_key = key;
+  AppendToCacheKey(".meta", &meta_key);
+  return meta_key;
+}
+
+// Stores `output` as the cached result for `key`. The entry is written to a
+// temporary file first and then renamed into place, so concurrent protoc
+// runs sharing a cache never observe partially written entries. Failing to
+// write the cache is not an error.
+void WriteCacheEntry(const GeneratorOptions& options, const std::string& key,
+                     const std::string& output) {
+  std::string path = GetCacheEntryPath(options, key);
+  std::string temp_path =
+      StrCat(path, ".",
+             std::hash<std::thread::id>()(std::this_thread::get_id()), ".",
+             std::chrono::steady_clock::now().time_since_epoch().count(),
+             ".tmp");
+  {
+    std::ofstream out(temp_path,
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+    std::string header;
+    AppendToCacheKey(key, &header);
+    out.write(header.data(), header.size());
+    out.write(output.data(), output.size());
+    out.close();
+    if (!out) {
+      GOOGLE_LOG(WARNING) << "Unable to write generation cache entry "
+                          << temp_path;
+      std::remove(temp_path.c_str());
+      return;
     }
   }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+  }
 }
 
-void Generator::FindProvidesForMessage(const GeneratorOptions& options,
-                                       io::Printer* printer,
-                                       const Descriptor* desc,
-                                       std::set<std::string>* provided) const {
-  if (IgnoreMessage(desc)) {
-    return;
+// Reads the field frequency profile of the field_profile option: one
+// "<full field name> <count>" pair per line.
+bool ReadFieldProfile(const std::string& path,
+                      std::map<std::string, int64_t>* counts,
+                      std::string* error) {
+  std::ifstream in(path);
+  if (!in) {
+    *error = "Unable to read field_profile " + path;
+    return false;
+  }
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    line_number++;
+    StripWhitespace(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<std::string> parts = Split(line, " \t", true);
+    int64_t count;
+    if (parts.size() != 2 || !safe_strto64(parts[1], &count) || count < 0) {
+      *error = StrCat("Expected a field name and a count on line ",
+                      line_number, " of field_profile ", path);
+      return false;
+    }
+    (*counts)[parts[0]] += count;
   }
+  return true;
+}
 
-  std::string name = GetMessagePath(options, desc);
-  provided->insert(name);
+// Phases of code generation timed by the profile=<path> option. Phases nest
+// (e.g. accessors are generated as part of a class), and the time of a phase
+// includes that of the phases nested in it.
+enum ProfilePhase {
+  kProfileHeader,
+  kProfileProvides,
+  kProfileRequires,
+  kProfileConstructors,
+  kProfileClasses,
+  kProfileFieldInfo,
+  kProfileToObject,
+  kProfileFromObject,
+  kProfileAccessors,
+  kProfileDeserializeBinary,
+  kProfileSerializeBinary,
+  kProfileExtensions,
+  kProfileEnums,
+  kProfileAnnotations,
+  kNumProfilePhases,
+};
 
-  for (int i = 0; i < desc->enum_type_count(); i++) {
-    FindProvidesForEnum(options, printer, desc->enum_type(i), provided);
-  }
+const char* const kProfilePhaseNames[kNumProfilePhases] = {
+    "header",
+    "provides",
+    "requires",
+    "constructors",
+    "classes",
+    "field_info",
+    "to_object",
+    "from_object",
+    "accessors",
+    "deserialize_binary",
+    "serialize_binary",
+    "extensions",
+    "enums",
+    "annotations",
+};
 
-  FindProvidesForOneOfEnums(options, printer, desc, provided);
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Timings and counters of one output file.
+struct OutputProfile {
+  OutputProfile()
+      : depth(), calls(), milliseconds(), total_milliseconds(0), bytes(0),
+        annotations(0), cached(false) {}
+
+  // Number of active ScopedProfilePhases per phase.
+  int depth[kNumProfilePhases];
+  int64_t calls[kNumProfilePhases];
+  double milliseconds[kNumProfilePhases];
+  double total_milliseconds;
+  int64_t bytes;
+  int annotations;
+  bool cached;
+};
 
-  for (int i = 0; i < desc->nested_type_count(); i++) {
-    FindProvidesForMessage(options, printer, desc->nested_type(i), provided);
-  }
-}
-void Generator::FindProvidesForEnum(const GeneratorOptions& options,
-                                    io::Printer* printer,
-                                    const EnumDescriptor* enumdesc,
-                                    std::set<std::string>* provided) const {
-  std::string name = GetEnumPath(options, enumdesc);
-  provided->insert(name);
-}
+// The profile of the output file being generated by the current thread, or
+// nullptr if profiling is disabled.
+thread_local OutputProfile* current_profile = nullptr;
 
-void Generator::FindProvidesForFields(
-    const GeneratorOptions& options, io::Printer* printer,
-    const std::vector<const FieldDescriptor*>& fields,
-    std::set<std::string>* provided) const {
-  for (auto field : fields) {
-    if (IgnoreField(field)) {
-      continue;
+// Adds the time spent in its scope to a phase of the current profile. Nested
+// scopes of the same phase (from recursive calls) are only counted once.
+class ScopedProfilePhase {
+ public:
+  explicit ScopedProfilePhase(ProfilePhase phase)
+      : profile_(current_profile), phase_(phase) {
+    if (profile_ != nullptr) {
+      profile_->calls[phase_]++;
+      if (profile_->depth[phase_]++ == 0) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+  }
+  ~ScopedProfilePhase() {
+    if (profile_ != nullptr && --profile_->depth[phase_] == 0) {
+      profile_->milliseconds[phase_] += MillisecondsSince(start_);
     }
-
-    std::string name = GetNamespace(options, field->file()) + "." +
-                       JSObjectFieldName(options, field);
-    provided->insert(name);
   }
-}
 
-void Generator::GenerateProvides(const GeneratorOptions& options,
-                                 io::Printer* printer,
-                                 std::set<std::string>* provided) const {
-  for (std::set<std::string>::iterator it = provided->begin();
-       it != provided->end(); ++it) {
-    if (options.import_style == GeneratorOptions::kImportClosure) {
-      printer->Print("goog.provide('$name$');\n", "name", *it);
-    } else {
-      // We aren't using Closure's import system, but we use goog.exportSymbol()
-      // to construct the expected tree of objects, eg.
-      //
-      //   goog.exportSymbol('foo.bar.Baz', null, this);
-      //
-      //   // Later generated code expects foo.bar = {} to exist:
-      //   foo.bar.Baz = function() { /* ... */ }
+ private:
+  OutputProfile* profile_;
+  ProfilePhase phase_;
+  std::chrono::steady_clock::time_point start_;
+};
 
-      // Do not use global scope in strict mode
-      if (options.import_style == GeneratorOptions::kImportCommonJsStrict) {
-        std::string namespaceObject = *it;
-        // Remove "proto." from the namespace object
-        GOOGLE_CHECK_EQ(0, namespaceObject.compare(0, 6, "proto."));
-        namespaceObject.erase(0, 6);
-        printer->Print("goog.exportSymbol('$name$', null, proto);\n", "name",
-                       namespaceObject);
-      } else {
-        printer->Print("goog.exportSymbol('$name$', null, global);\n", "name",
-                       *it);
-      }
+// Timings of the steps of a whole run that are not specific to one output
+// file, in the order they happened.
+typedef std::vector<std::pair<std::string, double> > RunProfile;
+
+// One output file of a multi-file generation run. Jobs are independent of each
+// other, so they may be generated in any order (or concurrently), as long as
+// their results are committed to the GeneratorContext in creation order.
+struct OutputJob {
+  OutputJob(const char* kind, const std::string& source,
+            const std::string& filename,
+            std::function<void(io::Printer*)> generate)
+      : kind(kind),
+        source(source),
+        filename(filename),
+        generate(std::move(generate)),
+        failed(false) {}
+
+  // What the file is generated from, for profiles: the kind of descriptor
+  // ("scc", "enum", "extensions", "file" or "library") and its name.
+  const char* kind;
+  std::string source;
+  // Name of the output file, relative to the GeneratorContext.
+  std::string filename;
+  // Prints the contents of the file.
+  std::function<void(io::Printer*)> generate;
+  // Everything the contents of the file depend on; only set if
+  // options.cache_dir is.
+  std::string cache_key;
+  // Buffered contents of the file, used when generating in parallel or when
+  // caching.
+  std::string output;
+  // Buffered contents of the .meta file of the output with
+  // annotate_code=sidecar, like `output`.
+  std::string meta;
+  // Set if the printer reported an error while generating `output`.
+  bool failed;
+  // Only filled in if options.profile is set.
+  OutputProfile profile;
+};
+
+// Returns whether code[pos] starts one of the line comments kept by
+// StripComments().
+bool IsKeptLineComment(const std::string& code, size_t pos) {
+  static const char* const kKept[] = {"// source:", "// GENERATED CODE",
+                                      "// @ts-nocheck"};
+  for (const char* kept : kKept) {
+    if (code.compare(pos, strlen(kept), kept) == 0) {
+      return true;
     }
   }
+  return false;
 }
 
-void Generator::GenerateRequiresForSCC(const GeneratorOptions& options,
-                                       io::Printer* printer, const SCC* scc,
-                                       std::set<std::string>* provided) const {
-  std::set<std::string> required;
-  std::set<std::string> forwards;
-  bool have_message = false;
-  bool has_extension = false;
-  bool has_map = false;
-  for (auto desc : scc->descriptors) {
-    if (desc->containing_type() == nullptr) {
-      FindRequiresForMessage(options, desc, &required, &forwards,
-                             &have_message);
-      has_extension = (has_extension || HasExtensions(desc));
-      has_map = (has_map || HasMap(options, desc));
+// Removes the JSDoc comments and the line comments from generated code, for
+// the compact option, along with the lines left blank. The source, generated
+// code and @ts-nocheck markers of the header stay, as do /* */ comments such
+// as /* eslint-disable */. The generated code has no regular expression
+// literals, so only string literals need to be skipped.
+std::string StripComments(const std::string& code) {
+  std::string out;
+  out.reserve(code.size());
+  size_t line_start = 0;
+  bool blank = true;
+  for (size_t i = 0; i < code.size(); i++) {
+    char c = code[i];
+    if (c == '\n') {
+      if (blank) {
+        out.resize(line_start);
+      } else {
+        out += c;
+      }
+      line_start = out.size();
+      blank = true;
+    } else if (c == '\'' || c == '"' || c == '`') {
+      size_t end = i + 1;
+      while (end < code.size() && code[end] != c && code[end] != '\n') {
+        end += code[end] == '\\' ? 2 : 1;
+      }
+      end = std::min(end, code.size() - 1);
+      out.append(code, i, end - i + 1);
+      i = end;
+      blank = false;
+    } else if (code.compare(i, 3, "/**") == 0) {
+      size_t end = code.find("*/", i + 3);
+      i = end == std::string::npos ? code.size() : end + 1;
+    } else if (code.compare(i, 2, "//") == 0 &&
+               !(blank && IsKeptLineComment(code, i))) {
+      size_t end = code.find('\n', i);
+      i = (end == std::string::npos ? code.size() : end) - 1;
+      // Drop the whitespace before a trailing comment.
+      while (out.size() > line_start &&
+             (out.back() == ' ' || out.back() == '\t')) {
+        out.pop_back();
+      }
+    } else {
+      out += c;
+      if (c != ' ' && c != '\t') {
+        blank = false;
+      }
     }
   }
-
-  GenerateRequiresImpl(options, printer, &required, &forwards, provided,
-                       /* require_jspb = */ have_message,
-                       /* require_extension = */ has_extension,
-                       /* require_map = */ has_map);
+  return out;
 }
 
-void Generator::GenerateRequiresForLibrary(
-    const GeneratorOptions& options, io::Printer* printer,
-    const std::vector<const FileDescriptor*>& files,
-    std::set<std::string>* provided) const {
-  GOOGLE_CHECK_EQ(options.import_style, GeneratorOptions::kImportClosure);
-  // For Closure imports we need to import every message type individually.
-  std::set<std::string> required;
-  std::set<std::string> forwards;
-  bool have_extensions = false;
-  bool have_map = false;
-  bool have_message = false;
-
-  for (auto file : files) {
-    for (int j = 0; j < file->message_type_count(); j++) {
-      const Descriptor* desc = file->message_type(j);
-      if (!IgnoreMessage(desc)) {
-        FindRequiresForMessage(options, desc, &required, &forwards,
-                               &have_message);
+// Runs a single job, printing its contents to `output`, and with
+// annotate_code=sidecar its annotations to `meta_output`.
+bool GenerateOutputJob(const GeneratorOptions& options, OutputJob* job,
+                       io::ZeroCopyOutputStream* output,
+                       io::ZeroCopyOutputStream* meta_output) {
+  auto start = std::chrono::steady_clock::now();
+  if (!options.profile.empty()) {
+    current_profile = &job->profile;
+  }
+  bool ok = true;
+  // With compact, the code is generated into a buffer first, to be stripped
+  // of its comments.
+  std::string uncompacted;
+  {
+    io::StringOutputStream buffer(&uncompacted);
+    GeneratedCodeInfo annotations;
+    io::AnnotationProtoCollector<GeneratedCodeInfo> annotation_collector(
+        &annotations);
+    std::unique_ptr<StreamingAnnotationCollector> sidecar;
+    io::AnnotationCollector* collector = nullptr;
+    if (options.annotate_code) {
+      if (options.annotations == GeneratorOptions::kAnnotationsSidecar) {
+        sidecar.reset(new StreamingAnnotationCollector(meta_output));
+        collector = sidecar.get();
+      } else {
+        collector = &annotation_collector;
       }
     }
+    io::Printer printer(options.compact ? &buffer : output, '$', collector);
 
-    if (!have_extensions && HasExtensions(file)) {
-      have_extensions = true;
-    }
+    job->generate(&printer);
 
-    if (!have_map && FileHasMap(options, file)) {
-      have_map = true;
+    if (printer.failed()) {
+      ok = false;
+    } else if (sidecar != nullptr) {
+      job->profile.annotations = sidecar->count();
+      ok = !sidecar->failed();
+    } else if (options.annotate_code) {
+      ScopedProfilePhase profile_phase(kProfileAnnotations);
+      job->profile.annotations = annotations.annotation_size();
+      EmbedCodeAnnotations(annotations, &printer);
     }
-
-    for (int j = 0; j < file->extension_count(); j++) {
-      const FieldDescriptor* extension = file->extension(j);
-      if (IgnoreField(extension)) {
-        continue;
+  }
+  if (ok && options.compact) {
+    std::string compacted = StripComments(uncompacted);
+    io::Printer printer(output, '$');
+    printer.WriteRaw(compacted.data(), compacted.size());
+    ok = !printer.failed();
+  }
+  current_profile = nullptr;
+  job->profile.total_milliseconds = MillisecondsSince(start);
+  return ok;
+}
+
+// Generates every job and writes the results to `context`. With
+// options.parallel > 1 the jobs are generated into memory on a pool of worker
+// threads first, and then committed in order, so that the set and order of
+// files opened on the context is the same as for a serial run. With
+// options.cache_dir set, jobs whose output is already in the cache are not
+// generated at all, and the output of the others is added to the cache.
+bool RunOutputJobs(const GeneratorOptions& options,
+                   std::vector<OutputJob>* jobs, GeneratorContext* context,
+                   RunProfile* run_profile) {
+  bool use_cache = !options.cache_dir.empty();
+  bool sidecar = options.annotate_code &&
+                 options.annotations == GeneratorOptions::kAnnotationsSidecar;
+  if (!use_cache && (options.parallel <= 1 || jobs->size() <= 1)) {
+    auto start = std::chrono::steady_clock::now();
+    for (OutputJob& job : *jobs) {
+      std::unique_ptr<io::ZeroCopyOutputStream> output(
+          context->Open(job.filename));
+      GOOGLE_CHECK(output.get());
+      std::unique_ptr<io::ZeroCopyOutputStream> meta_output;
+      if (sidecar) {
+        meta_output.reset(context->Open(job.filename + ".meta"));
+        GOOGLE_CHECK(meta_output.get());
       }
-      if (extension->containing_type()->full_name() !=
-          "google.protobuf.bridge.MessageSet") {
-        required.insert(GetMessagePath(options, extension->containing_type()));
+      if (!GenerateOutputJob(options, &job, output.get(), meta_output.get())) {
+        return false;
       }
-      FindRequiresForField(options, extension, &required, &forwards);
-      have_extensions = true;
+      job.profile.bytes = output->ByteCount();
     }
+    run_profile->emplace_back("generate", MillisecondsSince(start));
+    return true;
   }
 
-  GenerateRequiresImpl(options, printer, &required, &forwards, provided,
-                       /* require_jspb = */ have_message,
-                       /* require_extension = */ have_extensions,
-                       /* require_map = */ have_map);
-}
-
-void Generator::GenerateRequiresForExtensions(
-    const GeneratorOptions& options, io::Printer* printer,
-    const std::vector<const FieldDescriptor*>& fields,
-    std::set<std::string>* provided) const {
-  std::set<std::string> required;
-  std::set<std::string> forwards;
-  for (auto field : fields) {
-    if (IgnoreField(field)) {
-      continue;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<OutputJob*> pending;
+  for (OutputJob& job : *jobs) {
+    if (use_cache && ReadCacheEntry(options, job.cache_key, &job.output) &&
+        (!sidecar ||
+         ReadCacheEntry(options, GetMetaCacheKey(job.cache_key), &job.meta))) {
+      job.profile.cached = true;
+    } else {
+      pending.push_back(&job);
     }
-    FindRequiresForExtension(options, field, &required, &forwards);
+  }
+  if (use_cache) {
+    run_profile->emplace_back("cache_lookup", MillisecondsSince(start));
   }
 
-  GenerateRequiresImpl(options, printer, &required, &forwards, provided,
-                       /* require_jspb = */ false,
-                       /* require_extension = */ fields.size() > 0,
-                       /* require_map = */ false);
-}
+  start = std::chrono::steady_clock::now();
+  std::atomic<size_t> next_job(0);
+  auto worker = [&options, &pending, &next_job]() {
+    for (size_t i = next_job++; i < pending.size(); i = next_job++) {
+      OutputJob* job = pending[i];
+      io::StringOutputStream output(&job->output);
+      io::StringOutputStream meta_output(&job->meta);
+      job->failed = !GenerateOutputJob(options, job, &output, &meta_output);
+    }
+  };
 
-void Generator::GenerateRequiresImpl(const GeneratorOptions& options,
-                                     io::Printer* printer,
-                                     std::set<std::string>* required,
-                                     std::set<std::string>* forwards,
-                                     std::set<std::string>* provided,
-                                     bool require_jspb, bool require_extension,
-                                     bool require_map) const {
-  if (require_jspb) {
-    required->insert("jspb.Message");
-    required->insert("jspb.BinaryReader");
-    required->insert("jspb.BinaryWriter");
-  }
-  if (require_extension) {
-    required->insert("jspb.ExtensionFieldBinaryInfo");
-    required->insert("jspb.ExtensionFieldInfo");
-  }
-  if (require_map) {
-    required->insert("jspb.Map");
+  size_t num_threads =
+      std::min(static_cast<size_t>(options.parallel), pending.size());
+  if (num_threads <= 1) {
+    worker();
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
   }
+  run_profile->emplace_back("generate", MillisecondsSince(start));
 
-  std::set<std::string>::iterator it;
-  for (it = required->begin(); it != required->end(); ++it) {
-    if (provided->find(*it) != provided->end()) {
-      continue;
+  for (OutputJob* job : pending) {
+    if (job->failed) {
+      return false;
     }
-    printer->Print("goog.require('$name$');\n", "name", *it);
+  }
+  if (use_cache) {
+    start = std::chrono::steady_clock::now();
+    for (OutputJob* job : pending) {
+      WriteCacheEntry(options, job->cache_key, job->output);
+      if (sidecar) {
+        WriteCacheEntry(options, GetMetaCacheKey(job->cache_key), job->meta);
+      }
+    }
+    run_profile->emplace_back("cache_store", MillisecondsSince(start));
   }
 
-  printer->Print("\n");
-
-  for (it = forwards->begin(); it != forwards->end(); ++it) {
-    if (provided->find(*it) != provided->end()) {
-      continue;
+  start = std::chrono::steady_clock::now();
+  for (OutputJob& job : *jobs) {
+    std::unique_ptr<io::ZeroCopyOutputStream> output(
+        context->Open(job.filename));
+    GOOGLE_CHECK(output.get());
+    io::Printer printer(output.get(), '$');
+    printer.WriteRaw(job.output.data(), job.output.size());
+    if (printer.failed()) {
+      return false;
+    }
+    job.profile.bytes = job.output.size();
+    // Release the buffer as soon as it has been written out.
+    std::string().swap(job.output);
+    if (sidecar) {
+      std::unique_ptr<io::ZeroCopyOutputStream> meta_output(
+          context->Open(job.filename + ".meta"));
+      GOOGLE_CHECK(meta_output.get());
+      io::Printer meta_printer(meta_output.get(), '$');
+      meta_printer.WriteRaw(job.meta.data(), job.meta.size());
+      if (meta_printer.failed()) {
+        return false;
+      }
+      std::string().swap(job.meta);
     }
-    printer->Print("goog.forwardDeclare('$name$');\n", "name", *it);
   }
+  run_profile->emplace_back("write", MillisecondsSince(start));
+  return true;
 }
 
-bool NamespaceOnly(const Descriptor* desc) { return false; }
-
-void Generator::FindRequiresForMessage(const GeneratorOptions& options,
-                                       const Descriptor* desc,
-                                       std::set<std::string>* required,
-                                       std::set<std::string>* forwards,
-                                       bool* have_message) const {
-  if (!NamespaceOnly(desc)) {
-    *have_message = true;
-    for (int i = 0; i < desc->field_count(); i++) {
-      const FieldDescriptor* field = desc->field(i);
-      if (IgnoreField(field)) {
+// Returns `value` as a quoted JSON string.
+std::string JsonString(const std::string& value) {
+  std::string result = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      result += StringPrintf("\\u%04x", c);
+    } else {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+// Writes the profile of a run as JSON to options.profile, relative to the
+// output location given to protoc.
+bool WriteProfile(const GeneratorOptions& options, const std::string& parameter,
+                  double total_milliseconds, const RunProfile& run_profile,
+                  const std::vector<OutputJob>& jobs,
+                  GeneratorContext* context) {
+  std::unique_ptr<io::ZeroCopyOutputStream> output(
+      context->Open(options.profile));
+  GOOGLE_CHECK(output.get());
+  io::Printer printer(output.get(), '$');
+
+  printer.Print("{\n  \"parameter\": $parameter$,\n", "parameter",
+                JsonString(parameter));
+  printer.Print("  \"total_ms\": $ms$,\n", "ms",
+                StringPrintf("%.3f", total_milliseconds));
+  printer.Print("  \"phases\": {");
+  for (size_t i = 0; i < run_profile.size(); i++) {
+    printer.Print("$sep$\n    $name$: $ms$", "sep", i == 0 ? "" : ",",
+                  "name", JsonString(run_profile[i].first), "ms",
+                  StringPrintf("%.3f", run_profile[i].second));
+  }
+  printer.Print("\n  },\n  \"outputs\": [");
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const OutputJob& job = jobs[i];
+    const OutputProfile& profile = job.profile;
+    printer.Print(
+        "$sep$\n    {\n"
+        "      \"file\": $file$,\n"
+        "      \"kind\": \"$kind$\",\n"
+        "      \"source\": $source$,\n"
+        "      \"cached\": $cached$,\n"
+        "      \"bytes\": $bytes$,\n"
+        "      \"annotations\": $annotations$,\n"
+        "      \"ms\": $ms$,\n"
+        "      \"phases\": {",
+        "sep", i == 0 ? "" : ",", "file", JsonString(job.filename), "kind",
+        job.kind, "source", JsonString(job.source), "cached",
+        profile.cached ? "true" : "false", "bytes", StrCat(profile.bytes),
+        "annotations", StrCat(profile.annotations), "ms",
+        StringPrintf("%.3f", profile.total_milliseconds));
+    bool first = true;
+    for (int phase = 0; phase < kNumProfilePhases; phase++) {
+      if (profile.calls[phase] == 0) {
         continue;
       }
-      FindRequiresForField(options, field, required, forwards);
+      printer.Print(
+          "$sep$\n        \"$name$\": {\"calls\": $calls$, \"ms\": $ms$}",
+          "sep", first ? "" : ",", "name", kProfilePhaseNames[phase], "calls",
+          StrCat(profile.calls[phase]), "ms",
+          StringPrintf("%.3f", profile.milliseconds[phase]));
+      first = false;
     }
+    printer.Print("\n      }\n    }");
   }
+  printer.Print("\n  ]\n}\n");
+  return !printer.failed();
+}
 
-  for (int i = 0; i < desc->extension_count(); i++) {
-    const FieldDescriptor* field = desc->extension(i);
-    if (IgnoreField(field)) {
-      continue;
-    }
-    FindRequiresForExtension(options, field, required, forwards);
-  }
+// Default pivot of the field storage of a Kernel; see Storage.DEFAULT_PIVOT in
+// experimental/runtime/kernel/storage.js.
+const int kKernelDefaultPivot = 24;
 
-  for (int i = 0; i < desc->nested_type_count(); i++) {
-    FindRequiresForMessage(options, desc->nested_type(i), required, forwards,
-                           have_message);
-  }
+// Returns the name of the goog.module generated for the given file with
+// runtime=kernel, e.g. proto.foo.bar_baz_pb for bar/baz.proto in package foo.
+std::string GetKernelModuleName(const GeneratorOptions& options,
+                                const FileDescriptor* file) {
+  return GetNamespace(options, file) + "." + ModuleAlias(file->name());
 }
 
-void Generator::FindRequiresForField(const GeneratorOptions& options,
-                                     const FieldDescriptor* field,
-                                     std::set<std::string>* required,
-                                     std::set<std::string>* forwards) const {
-  if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM &&
-      // N.B.: file-level extensions with enum type do *not* create
-      // dependencies, as per original codegen.
-      !(field->is_extension() && field->extension_scope() == nullptr)) {
-    if (options.add_require_for_enums) {
-      required->insert(GetEnumPath(options, field->enum_type()));
-    } else {
-      forwards->insert(GetEnumPath(options, field->enum_type()));
-    }
-  } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
-    if (!IgnoreMessage(field->message_type())) {
-      required->insert(GetMessagePath(options, field->message_type()));
-    }
+// Returns the expression referring to a message class or enum generated with
+// runtime=kernel from code generated for `from_file`: Outer.Inner within the
+// same file, and module_alias.Outer.Inner otherwise.
+template <typename DescriptorType>
+std::string KernelTypeRef(const FileDescriptor* from_file,
+                          const DescriptorType* desc) {
+  std::string name =
+      StripPrefixString(desc->full_name(), desc->file()->package());
+  if (!name.empty() && name[0] == '.') {
+    name = name.substr(1);
+  }
+  if (desc->file() != from_file) {
+    return ModuleAlias(desc->file()->name()) + "." + name;
   }
+  return name;
 }
 
-void Generator::FindRequiresForExtension(
-    const GeneratorOptions& options, const FieldDescriptor* field,
-    std::set<std::string>* required, std::set<std::string>* forwards) const {
-  if (field->containing_type()->full_name() !=
-      "google.protobuf.bridge.MessageSet") {
-    required->insert(GetMessagePath(options, field->containing_type()));
+// Returns the type name used by the Kernel accessors of the field, e.g.
+// Int32 for Kernel.getInt32WithDefault(). Enums are accessed as int32 fields.
+std::string KernelTypeName(const FieldDescriptor* field) {
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_BOOL:
+      return "Bool";
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_ENUM:
+      return "Int32";
+    case FieldDescriptor::TYPE_UINT32:
+      return "Uint32";
+    case FieldDescriptor::TYPE_SINT32:
+      return "Sint32";
+    case FieldDescriptor::TYPE_FIXED32:
+      return "Fixed32";
+    case FieldDescriptor::TYPE_SFIXED32:
+      return "Sfixed32";
+    case FieldDescriptor::TYPE_INT64:
+      return "Int64";
+    case FieldDescriptor::TYPE_UINT64:
+      return "Uint64";
+    case FieldDescriptor::TYPE_SINT64:
+      return "Sint64";
+    case FieldDescriptor::TYPE_FIXED64:
+      return "Fixed64";
+    case FieldDescriptor::TYPE_SFIXED64:
+      return "Sfixed64";
+    case FieldDescriptor::TYPE_FLOAT:
+      return "Float";
+    case FieldDescriptor::TYPE_DOUBLE:
+      return "Double";
+    case FieldDescriptor::TYPE_STRING:
+      return "String";
+    case FieldDescriptor::TYPE_BYTES:
+      return "Bytes";
+    case FieldDescriptor::TYPE_GROUP:
+      return "Group";
+    case FieldDescriptor::TYPE_MESSAGE:
+      return "Message";
   }
-  FindRequiresForField(options, field, required, forwards);
+  GOOGLE_LOG(FATAL) << "Shouldn't reach here.";
+  return "";
 }
 
-void Generator::GenerateTestOnly(const GeneratorOptions& options,
-                                 io::Printer* printer) const {
-  if (options.testonly) {
-    printer->Print("goog.setTestOnly();\n\n");
+// Returns the Closure type of a single value of the field with
+// runtime=kernel.
+std::string KernelValueType(const FieldDescriptor* field) {
+  const FileDescriptor* file = field->containing_type()->file();
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return "!Int64";
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return "boolean";
+    case FieldDescriptor::CPPTYPE_STRING:
+      return field->type() == FieldDescriptor::TYPE_BYTES ? "!ByteString"
+                                                          : "string";
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return "!" + KernelTypeRef(file, field->enum_type());
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      return "!" + KernelTypeRef(file, field->message_type());
+    default:
+      return "number";
   }
-  printer->Print("\n");
 }
 
-void Generator::GenerateClassesAndEnums(const GeneratorOptions& options,
-                                        io::Printer* printer,
-                                        const FileDescriptor* file) const {
-  for (int i = 0; i < file->message_type_count(); i++) {
-    GenerateClassConstructorAndDeclareExtensionFieldInfo(options, printer,
-                                                         file->message_type(i));
-  }
-  for (int i = 0; i < file->message_type_count(); i++) {
-    GenerateClass(options, printer, file->message_type(i));
+// Returns the default value argument for the Kernel getter of a singular
+// field with an explicit default (", value"), or "" to use the Kernel's own
+// zero default.
+std::string KernelDefaultArgument(const GeneratorOptions& options,
+                                  const FieldDescriptor* field) {
+  if (!field->has_default_value()) {
+    return "";
   }
-  for (int i = 0; i < file->enum_type_count(); i++) {
-    GenerateEnum(options, printer, file->enum_type(i));
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT64: {
+      uint64_t value = field->cpp_type() == FieldDescriptor::CPPTYPE_INT64
+                           ? static_cast<uint64_t>(field->default_value_int64())
+                           : field->default_value_uint64();
+      return StrCat(", Int64.fromBits(", static_cast<int32_t>(value), ", ",
+                    static_cast<int32_t>(value >> 32), ")");
+    }
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return StrCat(", ", field->default_value_uint32());
+    case FieldDescriptor::CPPTYPE_STRING:
+      if (field->type() == FieldDescriptor::TYPE_BYTES) {
+        return ", ByteString.fromBase64String(\"" +
+               EscapeBase64(field->default_value_string()) + "\")";
+      }
+      return ", " + JSFieldDefault(options, field);
+    default:
+      return ", " + JSFieldDefault(options, field);
   }
 }
 
-void Generator::GenerateClass(const GeneratorOptions& options,
-                              io::Printer* printer,
-                              const Descriptor* desc) const {
-  if (IgnoreMessage(desc)) {
-    return;
+// Returns the pivot to create the Kernel of a message with (fields numbered
+// up to the pivot are stored in an array, the others in a map), or "" for the
+// Kernel's default. Messages numbered densely above the default get their
+// highest field number.
+std::string KernelPivot(const Descriptor* desc) {
+  int max_field_number = 0;
+  for (int i = 0; i < desc->field_count(); i++) {
+    max_field_number = std::max(max_field_number, desc->field(i)->number());
   }
-
-  if (!NamespaceOnly(desc)) {
-    printer->Print("\n");
-    GenerateClassFieldInfo(options, printer, desc);
-
-    GenerateClassToObject(options, printer, desc);
-    // These must come *before* the extension-field info generation in
-    // GenerateClassRegistration so that references to the binary
-    // serialization/deserialization functions may be placed in the extension
-    // objects.
-    GenerateClassDeserializeBinary(options, printer, desc);
-    GenerateClassSerializeBinary(options, printer, desc);
+  if (max_field_number <= kKernelDefaultPivot ||
+      max_field_number > 4 * desc->field_count()) {
+    return "";
   }
-
-  // Recurse on nested types. These must come *before* the extension-field
-  // info generation in GenerateClassRegistration so that extensions that
-  // reference nested types proceed the definitions of the nested types.
-  for (int i = 0; i < desc->enum_type_count(); i++) {
-    GenerateEnum(options, printer, desc->enum_type(i));
+  return StrCat(max_field_number);
+}
+
+// Returns the arguments passing the instance creator (and pivot) of the
+// field's message type to a Kernel message accessor.
+std::string KernelInstanceCreatorArguments(const FieldDescriptor* field,
+                                           const std::string& index = "") {
+  std::string pivot = KernelPivot(field->message_type());
+  return KernelTypeRef(field->containing_type()->file(),
+                       field->message_type()) +
+         ".instanceCreator" + (index.empty() ? "" : ", " + index) +
+         (pivot.empty() ? "" : ", " + pivot);
+}
+
+// Returns a statement `head(args)tail;` of a method generated for
+// runtime=kernel, with the arguments on a continuation line if the statement
+// does not fit in 80 columns.
+std::string KernelStatement(const std::string& head, const std::string& args,
+                            const std::string& tail = "") {
+  // Methods are indented by 2 columns in their class, statements by 2 more.
+  // The printer only indents the first line of a variable, so a wrapped
+  // statement spells out the indentation of its continuation line, and the
+  // statement has no trailing newline: it is left to the template, so that
+  // the line after it is indented too.
+  std::string statement = head + "(" + args + ")" + tail + ";";
+  if (4 + statement.size() <= 80) {
+    return "  " + statement;
+  }
+  return "  " + head + "(\n        " + args + ")" + tail + ";";
+}
+
+// Collects the runtime classes and the modules of other files (by alias) that
+// the code generated for the message with runtime=kernel refers to.
+void FindKernelRequires(const GeneratorOptions& options,
+                        const Descriptor* desc,
+                        std::map<std::string, std::string>* requires) {
+  (*requires)["InternalMessage"] = "protobuf.binary.InternalMessage";
+  (*requires)["Kernel"] = "protobuf.runtime.Kernel";
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    const FileDescriptor* type_file = nullptr;
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64 ||
+        field->cpp_type() == FieldDescriptor::CPPTYPE_UINT64) {
+      (*requires)["Int64"] = "protobuf.Int64";
+    } else if (field->type() == FieldDescriptor::TYPE_BYTES) {
+      (*requires)["ByteString"] = "protobuf.ByteString";
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+      type_file = field->enum_type()->file();
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      type_file = field->message_type()->file();
+    }
+    if (type_file != nullptr && type_file != desc->file()) {
+      (*requires)[ModuleAlias(type_file->name())] =
+          GetKernelModuleName(options, type_file);
+    }
   }
   for (int i = 0; i < desc->nested_type_count(); i++) {
-    GenerateClass(options, printer, desc->nested_type(i));
-  }
-
-  if (!NamespaceOnly(desc)) {
-    GenerateClassRegistration(options, printer, desc);
-    GenerateClassFields(options, printer, desc);
+    FindKernelRequires(options, desc->nested_type(i), requires);
+  }
+}
+
+// How messages are written in proto3 JSON: as an object of their fields, or,
+// for some of the well-known types, in a form of their own.
+enum JsonForm {
+  kJsonFields,
+  kJsonAny,        // The message it holds, with its type URL.
+  kJsonDuration,   // E.g. "1.5s".
+  kJsonFieldMask,  // The paths in lowerCamelCase, separated by commas.
+  kJsonListValue,  // An array.
+  kJsonStruct,     // An object of any properties.
+  kJsonTimestamp,  // An RFC 3339 date.
+  kJsonValue,      // Any JSON value.
+  kJsonWrapper,    // The value of the wrappers in wrappers.proto.
+};
 
-    if (options.import_style != GeneratorOptions::kImportClosure) {
-      for (int i = 0; i < desc->extension_count(); i++) {
-        GenerateExtension(options, printer, desc->extension(i));
+JsonForm GetJsonForm(const Descriptor* desc) {
+  static const std::map<std::string, JsonForm>* const kForms =
+      new std::map<std::string, JsonForm>({
+          {"google.protobuf.Any", kJsonAny},
+          {"google.protobuf.Duration", kJsonDuration},
+          {"google.protobuf.FieldMask", kJsonFieldMask},
+          {"google.protobuf.ListValue", kJsonListValue},
+          {"google.protobuf.Struct", kJsonStruct},
+          {"google.protobuf.Timestamp", kJsonTimestamp},
+          {"google.protobuf.Value", kJsonValue},
+      });
+  auto it = kForms->find(desc->full_name());
+  if (it != kForms->end()) {
+    return it->second;
+  }
+  return desc->file()->name() == "google/protobuf/wrappers.proto"
+             ? kJsonWrapper
+             : kJsonFields;
+}
+
+// Returns whether JSON null is a value of the field, rather than meaning that
+// the field is unset: for google.protobuf.Value and NullValue fields.
+bool JsonNullIsValue(const FieldDescriptor* field) {
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+    return field->enum_type()->full_name() == "google.protobuf.NullValue";
+  }
+  return field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+         GetJsonForm(field->message_type()) == kJsonValue;
+}
+
+// Returns the name of the jspb.JsonWriter and jspb.JsonReader methods for the
+// values of the field, without their "write" or "read" prefix. The readers of
+// 64-bit integers have the field's JS type as a suffix, e.g. Int64String.
+std::string JSJsonMethodType(const GeneratorOptions& options,
+                             const FieldDescriptor* field, bool is_reader) {
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_SINT32:
+    case FieldDescriptor::TYPE_SFIXED32:
+      return "Int32";
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_FIXED32:
+      return "Uint32";
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_SINT64:
+    case FieldDescriptor::TYPE_SFIXED64:
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_FIXED64: {
+      std::string name =
+          field->cpp_type() == FieldDescriptor::CPPTYPE_INT64 ? "Int64"
+                                                              : "Uint64";
+      if (!is_reader) {
+        return name;
       }
+      if (IsIntegralFieldWithBigIntJSType(options, field)) {
+        return name + "BigInt";
+      }
+      return IsIntegralFieldWithStringJSType(field) ? name + "String" : name;
     }
+    case FieldDescriptor::TYPE_FLOAT:
+      return "Float";
+    case FieldDescriptor::TYPE_DOUBLE:
+      // Both are read with readFloat().
+      return is_reader ? "Float" : "Double";
+    case FieldDescriptor::TYPE_BOOL:
+      return "Bool";
+    case FieldDescriptor::TYPE_STRING:
+      return "String";
+    case FieldDescriptor::TYPE_BYTES:
+      return "Bytes";
+    case FieldDescriptor::TYPE_ENUM:
+      return JsonNullIsValue(field) ? "NullValue" : "Enum";
+    case FieldDescriptor::TYPE_MESSAGE:
+    case FieldDescriptor::TYPE_GROUP:
+      return "Message";
   }
+  GOOGLE_LOG(FATAL) << "Unknown field type";
+  return "";
 }
 
-void Generator::GenerateClassConstructor(const GeneratorOptions& options,
-                                         io::Printer* printer,
-                                         const Descriptor* desc) const {
-  printer->Print(
-      "/**\n"
-      " * Generated by JsPbCodeGenerator.\n"
-      " * @param {Array=} opt_data Optional initial data array, typically "
-      "from a\n"
-      " * server response, or constructed directly in Javascript. The array "
-      "is used\n"
-      " * in place and becomes part of the constructed object. It is not "
-      "cloned.\n"
-      " * If no data is provided, the constructed object will be empty, but "
-      "still\n"
-      " * valid.\n"
-      " * @extends {jspb.Message}\n"
-      " * @constructor\n"
-      " */\n"
-      "$classprefix$$classname$ = function(opt_data) {\n",
-      "classprefix", GetMessagePathPrefix(options, desc), "classname",
-      desc->name());
-  printer->Annotate("classname", desc);
-  std::string message_id = GetMessageId(desc);
-  printer->Print(
-      "  jspb.Message.initialize(this, opt_data, $messageId$, $pivot$, "
-      "$rptfields$, $oneoffields$);\n",
-      "messageId",
-      !message_id.empty() ? ("'" + message_id + "'")
-                          : (IsResponse(desc) ? "''" : "0"),
-      "pivot", GetPivot(desc), "rptfields",
-      RepeatedFieldsArrayName(options, desc), "oneoffields",
-      OneofFieldsArrayName(options, desc));
-  printer->Print(
-      "};\n"
-      "goog.inherits($classname$, jspb.Message);\n"
-      "if (goog.DEBUG && !COMPILED) {\n"
-      // displayName overrides Function.prototype.displayName
-      // http://google3/javascript/externs/es3.js?l=511
-      "  /**\n"
-      "   * @public\n"
-      "   * @override\n"
-      "   */\n"
-      "  $classname$.displayName = '$classname$';\n"
-      "}\n",
-      "classname", GetMessagePath(options, desc));
+// Returns a reference to the JSON names of the values of an enum, as
+// generated next to it, from code in the given file.
+std::string JSJsonNamesRef(const GeneratorOptions& options,
+                           const FileDescriptor* from_file,
+                           const EnumDescriptor* enum_desc) {
+  if ((options.import_style == GeneratorOptions::kImportCommonJs ||
+       options.import_style == GeneratorOptions::kImportCommonJsStrict) &&
+      from_file != enum_desc->file()) {
+    return ModuleAlias(enum_desc->file()->name()) +
+           GetNestedMessageName(enum_desc->containing_type()) + "." +
+           enum_desc->name() + "$JsonNames";
+  }
+  return GetEnumPath(options, enum_desc) + "$JsonNames";
 }
 
-void Generator::GenerateClassConstructorAndDeclareExtensionFieldInfo(
-    const GeneratorOptions& options, io::Printer* printer,
-    const Descriptor* desc) const {
-  if (!NamespaceOnly(desc)) {
-    GenerateClassConstructor(options, printer, desc);
-    if (IsExtendable(desc) &&
-        desc->full_name() != "google.protobuf.bridge.MessageSet") {
-      GenerateClassExtensionFieldInfo(options, printer, desc);
-    }
+// Returns the arguments of the jspb.JsonWriter method writing a value of the
+// field after the value itself: the enum value names, or the
+// serializeJsonToWriter() of messages.
+std::string JSJsonWriterArgs(const GeneratorOptions& options,
+                             const FieldDescriptor* field) {
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    return ", " + SubmessageTypeRef(options, field) + ".serializeJsonToWriter";
   }
-  for (int i = 0; i < desc->nested_type_count(); i++) {
-    if (!IgnoreMessage(desc->nested_type(i))) {
-      GenerateClassConstructorAndDeclareExtensionFieldInfo(
-          options, printer, desc->nested_type(i));
-    }
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM &&
+      !JsonNullIsValue(field)) {
+    return ", " + JSJsonNamesRef(options, field->file(), field->enum_type());
   }
+  return "";
 }
 
-void Generator::GenerateClassFieldInfo(const GeneratorOptions& options,
-                                       io::Printer* printer,
-                                       const Descriptor* desc) const {
-  if (HasRepeatedFields(options, desc)) {
-    printer->Print(
-        "/**\n"
-        " * List of repeated fields within this message type.\n"
-        " * @private {!Array<number>}\n"
-        " * @const\n"
-        " */\n"
-        "$classname$$rptfieldarray$ = $rptfields$;\n"
-        "\n",
-        "classname", GetMessagePath(options, desc), "rptfieldarray",
-        kRepeatedFieldArrayName, "rptfields",
-        RepeatedFieldNumberList(options, desc));
+// Returns the expression reading the parsed JSON `value` as a value of the
+// field, with the jspb.JsonReader `reader`.
+std::string JSJsonReadExpression(const GeneratorOptions& options,
+                                 const FieldDescriptor* field,
+                                 const std::string& value) {
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    std::string type = SubmessageTypeRef(options, field);
+    return type + ".deserializeJsonFromReader(new " + type + "(), " + value +
+           ", reader)";
   }
-
-  if (HasOneofFields(desc)) {
-    printer->Print(
-        "/**\n"
-        " * Oneof group definitions for this message. Each group defines the "
-        "field\n"
-        " * numbers belonging to that group. When of these fields' value is "
-        "set, all\n"
-        " * other fields in the group are cleared. During deserialization, if "
-        "multiple\n"
-        " * fields are encountered for a group, only the last value seen will "
-        "be kept.\n"
-        " * @private {!Array<!Array<number>>}\n"
-        " * @const\n"
-        " */\n"
-        "$classname$$oneofgrouparray$ = $oneofgroups$;\n"
-        "\n",
-        "classname", GetMessagePath(options, desc), "oneofgrouparray",
-        kOneofGroupArrayName, "oneofgroups", OneofGroupList(desc));
-
-    for (int i = 0; i < desc->oneof_decl_count(); i++) {
-      if (IgnoreOneof(desc->oneof_decl(i))) {
-        continue;
-      }
-      GenerateOneofCaseDefinition(options, printer, desc->oneof_decl(i));
-    }
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM &&
+      !JsonNullIsValue(field)) {
+    return "reader.readEnum(" + value + ", " +
+           JSJsonNamesRef(options, field->file(), field->enum_type()) + ")";
   }
+  return "reader.read" + JSJsonMethodType(options, field,
+                                          /* is_reader = */ true) +
+         "(" + value + ")";
 }
 
-void Generator::GenerateClassXid(const GeneratorOptions& options,
-                                 io::Printer* printer,
-                                 const Descriptor* desc) const {
-  printer->Print(
-      "\n"
-      "\n"
-      "$class$.prototype.messageXid = xid('$class$');\n",
-      "class", GetMessagePath(options, desc));
+// Returns a single-quoted JS string literal of the given name.
+std::string JSJsonNameLiteral(const std::string& name) {
+  std::string escaped;
+  EscapeJSString(name, &escaped);
+  return "'" + escaped + "'";
 }
 
-void Generator::GenerateOneofCaseDefinition(
-    const GeneratorOptions& options, io::Printer* printer,
-    const OneofDescriptor* oneof) const {
-  printer->Print(
-      "/**\n"
-      " * @enum {number}\n"
-      " */\n"
-      "$classname$.$oneof$Case = {\n"
-      "  $upcase$_NOT_SET: 0",
-      "classname", GetMessagePath(options, oneof->containing_type()), "oneof",
-      JSOneofName(oneof), "upcase", ToEnumCase(oneof->name()));
+// Prints the statement reading a field into `f` for serializing it, followed
+// by an `if (condition) {` that evaluates to true if the field is written: if
+// it is set, for fields with presence, and if it is non-empty or non-default
+// otherwise.
+void GenerateSerializedFieldCheck(const GeneratorOptions& options,
+                                  io::Printer* printer,
+                                  const FieldDescriptor* field,
+                                  BytesMode bytes_mode) {
+  if (HasFieldPresence(options, field) &&
+      field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+    std::string typed_annotation =
+        JSFieldTypeAnnotation(options, field,
+                              /* is_setter_argument = */ false,
+                              /* force_present = */ false,
+                              /* singular_if_not_packed = */ false,
+                              /* bytes_mode = */ BYTES_DEFAULT);
+    printer->Print(
+        "  f = /** @type {$type$} */ "
+        "(jspb.Message.getField(message, $index$));\n",
+        "index", JSFieldIndex(options, field), "type", typed_annotation);
+  } else {
+    printer->Print(
+        "  f = message.get$name$($nolazy$);\n", "name",
+        JSGetterName(options, field, bytes_mode),
+        // No lazy creation for maps containers -- fastpath the empty case.
+        "nolazy", field->is_map() ? "true" : "");
+  }
 
-  for (int i = 0; i < oneof->field_count(); i++) {
-    if (IgnoreField(oneof->field(i))) {
-      continue;
+  // Print an `if (condition)` statement that evaluates to true if the field
+  // goes on the wire.
+  if (field->is_map()) {
+    printer->Print("  if (f && f.getLength() > 0) {\n");
+  } else if (field->is_repeated()) {
+    printer->Print("  if (f.length > 0) {\n");
+  } else {
+    if (HasFieldPresence(options, field)) {
+      printer->Print("  if (f != null) {\n");
+    } else {
+      // No field presence: serialize onto the wire only if value is
+      // non-default.  Defaults are documented here:
+      // https://goto.google.com/lhdfm
+      switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+        case FieldDescriptor::CPPTYPE_INT64:
+        case FieldDescriptor::CPPTYPE_UINT32:
+        case FieldDescriptor::CPPTYPE_UINT64: {
+          if (IsIntegralFieldWithStringJSType(field)) {
+            // We can use `parseInt` here even though it will not be precise for
+            // 64-bit quantities because we are only testing for zero/nonzero,
+            // and JS numbers (64-bit floating point values, i.e., doubles) are
+            // integer-precise in the range that includes zero.
+            printer->Print("  if (parseInt(f, 10) !== 0) {\n");
+          } else if (IsIntegralFieldWithBigIntJSType(options, field)) {
+            printer->Print("  if (f !== 0n) {\n");
+          } else {
+            printer->Print("  if (f !== 0) {\n");
+          }
+          break;
+        }
+
+        case FieldDescriptor::CPPTYPE_ENUM:
+        case FieldDescriptor::CPPTYPE_FLOAT:
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+          printer->Print("  if (f !== 0.0) {\n");
+          break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+          printer->Print("  if (f) {\n");
+          break;
+        case FieldDescriptor::CPPTYPE_STRING:
+          printer->Print("  if (f.length > 0) {\n");
+          break;
+        default:
+          assert(false);
+          break;
+      }
     }
+  }
+}
 
-    printer->Print(
-        ",\n"
-        "  $upcase$: $number$",
-        "upcase", ToEnumCase(oneof->field(i)->name()), "number",
-        JSFieldIndex(oneof->field(i)));
-    printer->Annotate("upcase", oneof->field(i));
+// Generates the start of the instrumentation of deserializeBinaryFromReader()
+// for the instrument option.
+void GenerateInstrumentationBeginDecode(const GeneratorOptions& options,
+                                        io::Printer* printer) {
+  if (!options.instrument) {
+    return;
   }
+  printer->Print(
+      "  if (jspb.BinaryInstrumentation.ENABLED) {\n"
+      "    var instrumentationCursor = reader.getCursor();\n"
+      "    var instrumentationTime = jspb.BinaryInstrumentation.now();\n"
+      "    var instrumentationOuter = "
+      "jspb.BinaryInstrumentation.beginDecode();\n"
+      "  }\n");
+}
 
+// Generates the end of the instrumentation of deserializeBinaryFromReader(),
+// reporting the decoded message.
+void GenerateInstrumentationEndDecode(const GeneratorOptions& options,
+                                      io::Printer* printer,
+                                      const Descriptor* desc) {
+  if (!options.instrument) {
+    return;
+  }
   printer->Print(
-      "\n"
-      "};\n"
-      "\n"
-      "/**\n"
-      " * @return {$class$.$oneof$Case}\n"
-      " */\n"
-      "$class$.prototype.get$oneof$Case = function() {\n"
-      "  return /** @type {$class$.$oneof$Case} */(jspb.Message."
-      "computeOneofCase(this, $class$.oneofGroups_[$oneofindex$]));\n"
-      "};\n"
-      "\n",
-      "class", GetMessagePath(options, oneof->containing_type()), "oneof",
-      JSOneofName(oneof), "oneofindex", JSOneofIndex(oneof));
+      "  if (jspb.BinaryInstrumentation.ENABLED) {\n"
+      "    jspb.BinaryInstrumentation.endDecode('$type$',\n"
+      "        reader.getCursor() - instrumentationCursor, "
+      "instrumentationTime,\n"
+      "        instrumentationOuter);\n"
+      "  }\n",
+      "type", desc->full_name());
+}
+
+// Generates the start of the instrumentation of serializeBinaryToWriter().
+void GenerateInstrumentationBeginEncode(const GeneratorOptions& options,
+                                        io::Printer* printer) {
+  if (!options.instrument) {
+    return;
+  }
+  printer->Print(
+      "  if (jspb.BinaryInstrumentation.ENABLED) {\n"
+      "    var instrumentationLength = writer.getLength();\n"
+      "    var instrumentationTime = jspb.BinaryInstrumentation.now();\n"
+      "  }\n");
 }
 
-void Generator::GenerateClassToObject(const GeneratorOptions& options,
+// Generates the end of the instrumentation of serializeBinaryToWriter(),
+// reporting the encoded message.
+void GenerateInstrumentationEndEncode(const GeneratorOptions& options,
                                       io::Printer* printer,
-                                      const Descriptor* desc) const {
+                                      const Descriptor* desc) {
+  if (!options.instrument) {
+    return;
+  }
   printer->Print(
-      "\n"
-      "\n"
-      "if (jspb.Message.GENERATE_TO_OBJECT) {\n"
-      "/**\n"
-      " * Creates an object representation of this proto.\n"
-      " * Field names that are reserved in JavaScript and will be renamed to "
-      "pb_name.\n"
-      " * Optional fields that are not set will be set to undefined.\n"
-      " * To access a reserved field use, foo.pb_<name>, eg, foo.pb_default.\n"
-      " * For the list of reserved names please see:\n"
-      " *     net/proto2/compiler/js/internal/generator.cc#kKeyword.\n"
-      " * @param {boolean=} opt_includeInstance Deprecated. whether to include "
-      "the\n"
-      " *     JSPB instance for transitional soy proto support:\n"
-      " *     http://goto/soy-param-migration\n"
-      " * @return {!Object}\n"
-      " */\n"
-      "$classname$.prototype.toObject = function(opt_includeInstance) {\n"
-      "  return $classname$.toObject(opt_includeInstance, this);\n"
-      "};\n"
-      "\n"
-      "\n"
-      "/**\n"
-      " * Static version of the {@see toObject} method.\n"
-      " * @param {boolean|undefined} includeInstance Deprecated. Whether to "
-      "include\n"
-      " *     the JSPB instance for transitional soy proto support:\n"
-      " *     http://goto/soy-param-migration\n"
-      " * @param {!$classname$} msg The msg instance to transform.\n"
-      " * @return {!Object}\n"
-      " * @suppress {unusedLocalVariables} f is only used for nested messages\n"
-      " */\n"
-      "$classname$.toObject = function(includeInstance, msg) {\n"
-      "  var f, obj = {",
-      "classname", GetMessagePath(options, desc));
+      "  if (jspb.BinaryInstrumentation.ENABLED) {\n"
+      "    jspb.BinaryInstrumentation.endEncode('$type$', writer,\n"
+      "        writer.getLength() - instrumentationLength, "
+      "instrumentationTime);\n"
+      "  }\n",
+      "type", desc->full_name());
+}
 
-  bool first = true;
-  for (int i = 0; i < desc->field_count(); i++) {
-    const FieldDescriptor* field = desc->field(i);
-    if (IgnoreField(field)) {
+}  // anonymous namespace
+
+void NamingContext::AddFile(const GeneratorOptions& options,
+                            const FileDescriptor* file) {
+  GOOGLE_CHECK(options.naming == nullptr);
+  AddTypes(options, file, /* add_fields = */ true);
+
+  // Generated code also refers to the types of imported files by name.
+  std::vector<const FileDescriptor*> stack;
+  for (int i = 0; i < file->dependency_count(); i++) {
+    stack.push_back(file->dependency(i));
+  }
+  while (!stack.empty()) {
+    const FileDescriptor* dep = stack.back();
+    stack.pop_back();
+    if (files_.count(dep)) {
       continue;
     }
-
-    if (!first) {
-      printer->Print(",\n    ");
-    } else {
-      printer->Print("\n    ");
-      first = false;
+    AddTypes(options, dep, /* add_fields = */ false);
+    for (int i = 0; i < dep->dependency_count(); i++) {
+      stack.push_back(dep->dependency(i));
     }
-
-    GenerateClassFieldToObject(options, printer, field);
   }
+}
 
-  if (!first) {
-    printer->Print("\n  };\n\n");
-  } else {
-    printer->Print("\n\n  };\n\n");
+void NamingContext::AddTypes(const GeneratorOptions& options,
+                             const FileDescriptor* file, bool add_fields) {
+  auto it = files_.find(file);
+  if (it != files_.end() && (it->second || !add_fields)) {
+    return;
   }
+  // Paths have already been added if only the fields are missing.
+  bool add_paths = it == files_.end();
+  files_[file] = add_fields;
 
-  if (IsExtendable(desc)) {
-    printer->Print(
-        "  jspb.Message.toObjectExtension(/** @type {!jspb.Message} */ (msg), "
-        "obj,\n"
-        "      $extObject$, $class$.prototype.getExtension,\n"
-        "      includeInstance);\n",
-        "extObject", JSExtensionsObjectName(options, desc->file(), desc),
-        "class", GetMessagePath(options, desc));
+  if (add_paths) {
+    for (int i = 0; i < file->enum_type_count(); i++) {
+      AddEnum(options, file->enum_type(i));
+    }
+  }
+  for (int i = 0; i < file->message_type_count(); i++) {
+    AddMessage(options, file->message_type(i), add_fields);
+  }
+  if (add_fields) {
+    for (int i = 0; i < file->extension_count(); i++) {
+      AddField(options, file->extension(i));
+    }
   }
+}
 
-  printer->Print(
-      "  if (includeInstance) {\n"
-      "    obj.$$jspbMessageInstance = msg;\n"
-      "  }\n"
-      "  return obj;\n"
-      "};\n"
-      "}\n"
-      "\n"
-      "\n",
-      "classname", GetMessagePath(options, desc));
+void NamingContext::AddMessage(const GeneratorOptions& options,
+                               const Descriptor* desc, bool add_fields) {
+  if (path_indices_.emplace(desc, paths_.size()).second) {
+    paths_.push_back(GetMessagePath(options, desc));
+    for (int i = 0; i < desc->enum_type_count(); i++) {
+      AddEnum(options, desc->enum_type(i));
+    }
+  }
+  if (add_fields) {
+    for (int i = 0; i < desc->field_count(); i++) {
+      AddField(options, desc->field(i));
+    }
+    for (int i = 0; i < desc->extension_count(); i++) {
+      AddField(options, desc->extension(i));
+    }
+  }
+  for (int i = 0; i < desc->nested_type_count(); i++) {
+    AddMessage(options, desc->nested_type(i), add_fields);
+  }
 }
 
-void Generator::GenerateFieldValueExpression(io::Printer* printer,
-                                             const char* obj_reference,
-                                             const FieldDescriptor* field,
-                                             bool use_default) const {
-  const bool is_float_or_double =
-      field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT ||
-      field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE;
-  const bool is_boolean = field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL;
+void NamingContext::AddEnum(const GeneratorOptions& options,
+                            const EnumDescriptor* desc) {
+  if (path_indices_.emplace(desc, paths_.size()).second) {
+    paths_.push_back(GetEnumPath(options, desc));
+  }
+}
 
-  const std::string with_default = use_default ? "WithDefault" : "";
-  const std::string default_arg =
-      use_default ? StrCat(", ", JSFieldDefault(field)) : "";
-  const std::string cardinality = field->is_repeated() ? "Repeated" : "";
-  std::string type = "";
-  if (is_float_or_double) {
-    type = "FloatingPoint";
+void NamingContext::AddField(const GeneratorOptions& options,
+                             const FieldDescriptor* field) {
+  if (!field_indices_.emplace(field, fields_.size()).second) {
+    return;
   }
-  if (is_boolean) {
-    type = "Boolean";
+  fields_.emplace_back();
+  FieldNames* names = &fields_.back();
+  for (BytesMode bytes_mode : {BYTES_DEFAULT, BYTES_B64, BYTES_U8}) {
+    names->getter_name[bytes_mode] =
+        JSGetterName(options, field, bytes_mode);
   }
-
-  // Prints the appropriate function, among:
-  // - getField
-  // - getBooleanField
-  // - getFloatingPointField => Replaced by getOptionalFloatingPointField to
-  //   preserve backward compatibility.
-  // - getFieldWithDefault
-  // - getBooleanFieldWithDefault
-  // - getFloatingPointFieldWithDefault
-  // - getRepeatedField
-  // - getRepeatedBooleanField
-  // - getRepeatedFloatingPointField
-  if (is_float_or_double && !field->is_repeated() && !use_default) {
-    printer->Print(
-        "jspb.Message.getOptionalFloatingPointField($obj$, "
-        "$index$$default$)",
-        "obj", obj_reference, "index", JSFieldIndex(field), "default",
-        default_arg);
-  } else {
-    printer->Print(
-        "jspb.Message.get$cardinality$$type$Field$with_default$($obj$, "
-        "$index$$default$)",
-        "cardinality", cardinality, "type", type, "with_default", with_default,
-        "obj", obj_reference, "index", JSFieldIndex(field), "default",
-        default_arg);
+  names->getter_name_drop_list = JSGetterName(options, field, BYTES_DEFAULT,
+                                              /* drop_list = */ true);
+  names->object_field_name = JSObjectFieldName(options, field);
+  names->field_index = JSFieldIndex(options, field);
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    names->submessage_type_ref = SubmessageTypeRef(options, field);
   }
+  names->getter_type =
+      JSFieldTypeAnnotation(options, field,
+                            /* is_setter_argument = */ false,
+                            /* force_present = */ false,
+                            /* singular_if_not_packed = */ false);
+  names->present_getter_type =
+      JSFieldTypeAnnotation(options, field,
+                            /* is_setter_argument = */ false,
+                            /* force_present = */ true,
+                            /* singular_if_not_packed = */ false);
+  names->setter_type =
+      JSFieldTypeAnnotation(options, field,
+                            /* is_setter_argument = */ true,
+                            /* force_present = */ false,
+                            /* singular_if_not_packed = */ false);
 }
 
-void Generator::GenerateClassFieldToObject(const GeneratorOptions& options,
-                                           io::Printer* printer,
+void Generator::GenerateHeader(const GeneratorOptions& options,
+                               const FileDescriptor* file,
+                               io::Printer* printer) const {
+  ScopedProfilePhase profile_phase(kProfileHeader);
+  if (file != nullptr) {
+    printer->Print("// source: $filename$\n", "filename", file->name());
+  }
+  printer->Print(
+      "/**\n"
+      " * @fileoverview\n"
+      " * @enhanceable\n"
+      // TODO(b/152440355): requireType/requires diverged from internal version.
+      " * @suppress {missingRequire} reports error on implicit type usages.\n"
+      " * @suppress {messageConventions} JS Compiler reports an "
+      "error if a variable or\n"
+      " *     field starts with 'MSG_' and isn't a translatable "
+      "message.\n"
+      " * @public\n"
+      " */\n"
+      "// GENERATED CODE -- DO NOT EDIT!\n"
+      "/* eslint-disable */\n"
+      "// @ts-nocheck\n"
+      "\n");
+}
+
+void Generator::FindProvidesForFile(const GeneratorOptions& options,
+                                    io::Printer* printer,
+                                    const FileDescriptor* file,
+                                    SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileProvides);
+  for (int i = 0; i < file->message_type_count(); i++) {
+    if (IsReachable(options, file->message_type(i))) {
+      FindProvidesForMessage(options, printer, file->message_type(i),
+                             provided);
+    }
+  }
+  for (int i = 0; i < file->enum_type_count(); i++) {
+    if (IsReachable(options, file->enum_type(i))) {
+      FindProvidesForEnum(options, printer, file->enum_type(i), provided);
+    }
+  }
+}
+
+void Generator::FindProvides(const GeneratorOptions& options,
+                             io::Printer* printer,
+                             const std::vector<const FileDescriptor*>& files,
+                             SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileProvides);
+  for (auto file : files) {
+    FindProvidesForFile(options, printer, file, provided);
+  }
+
+  printer->Print("\n");
+}
+
+void FindProvidesForOneOfEnum(const GeneratorOptions& options,
+                              const OneofDescriptor* oneof,
+                              SymbolSet* provided) {
+  std::string name = GetMessagePath(options, oneof->containing_type()) + "." +
+                     JSOneofName(oneof) + "Case";
+  provided->Insert(name);
+}
+
+void FindProvidesForOneOfEnums(const GeneratorOptions& options,
+                               io::Printer* printer, const Descriptor* desc,
+                               SymbolSet* provided) {
+  if (HasOneofFields(desc)) {
+    for (int i = 0; i < desc->oneof_decl_count(); i++) {
+      if (IgnoreOneof(desc->oneof_decl(i))) {
+        continue;
+      }
+      FindProvidesForOneOfEnum(options, desc->oneof_decl(i), provided);
+    }
+  }
+}
+
+void Generator::FindProvidesForMessage(const GeneratorOptions& options,
+                                       io::Printer* printer,
+                                       const Descriptor* desc,
+                                       SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileProvides);
+  if (IgnoreMessage(desc)) {
+    return;
+  }
+
+  std::string name = GetMessagePath(options, desc);
+  provided->Insert(name);
+
+  for (int i = 0; i < desc->enum_type_count(); i++) {
+    FindProvidesForEnum(options, printer, desc->enum_type(i), provided);
+  }
+
+  FindProvidesForOneOfEnums(options, printer, desc, provided);
+
+  for (int i = 0; i < desc->nested_type_count(); i++) {
+    FindProvidesForMessage(options, printer, desc->nested_type(i), provided);
+  }
+}
+void Generator::FindProvidesForEnum(const GeneratorOptions& options,
+                                    io::Printer* printer,
+                                    const EnumDescriptor* enumdesc,
+                                    SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileProvides);
+  std::string name = GetEnumPath(options, enumdesc);
+  provided->Insert(name);
+}
+
+void Generator::FindProvidesForFields(
+    const GeneratorOptions& options, io::Printer* printer,
+    const std::vector<const FieldDescriptor*>& fields,
+    SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileProvides);
+  for (auto field : fields) {
+    if (IgnoreField(field)) {
+      continue;
+    }
+
+    std::string name = GetNamespace(options, field->file()) + "." +
+                       JSObjectFieldName(options, field);
+    provided->Insert(name);
+  }
+}
+
+void Generator::GenerateProvides(const GeneratorOptions& options,
+                                 io::Printer* printer,
+                                 SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileProvides);
+  for (int id : provided->SortedIds()) {
+    std::string name = provided->table()->name(id);
+    if (options.import_style == GeneratorOptions::kImportClosure) {
+      printer->Print("goog.provide('$name$');\n", "name", name);
+    } else {
+      // We aren't using Closure's import system, but we use goog.exportSymbol()
+      // to construct the expected tree of objects, eg.
+      //
+      //   goog.exportSymbol('foo.bar.Baz', null, this);
+      //
+      //   // Later generated code expects foo.bar = {} to exist:
+      //   foo.bar.Baz = function() { /* ... */ }
+
+      // Do not use global scope in strict mode
+      if (options.import_style == GeneratorOptions::kImportCommonJsStrict) {
+        std::string namespaceObject = name;
+        // Remove "proto." from the namespace object
+        GOOGLE_CHECK_EQ(0, namespaceObject.compare(0, 6, "proto."));
+        namespaceObject.erase(0, 6);
+        printer->Print("goog.exportSymbol('$name$', null, proto);\n", "name",
+                       namespaceObject);
+      } else {
+        printer->Print("goog.exportSymbol('$name$', null, global);\n", "name",
+                       name);
+      }
+    }
+  }
+}
+
+void Generator::GenerateRequiresForSCC(const GeneratorOptions& options,
+                                       io::Printer* printer, const SCC* scc,
+                                       SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileRequires);
+  SymbolSet required(provided->table());
+  SymbolSet forwards(provided->table());
+  bool have_message = false;
+  bool has_extension = false;
+  bool has_map = false;
+  for (auto desc : scc->descriptors) {
+    if (desc->containing_type() == nullptr) {
+      FindRequiresForMessage(options, desc, &required, &forwards,
+                             &have_message);
+      has_extension = (has_extension || HasExtensions(desc));
+      has_map = (has_map || HasMap(options, desc));
+    }
+  }
+
+  GenerateRequiresImpl(options, printer, &required, &forwards, provided,
+                       /* require_jspb = */ have_message,
+                       /* require_extension = */ has_extension,
+                       /* require_map = */ has_map);
+}
+
+void Generator::GenerateRequiresForLibrary(
+    const GeneratorOptions& options, io::Printer* printer,
+    const std::vector<const FileDescriptor*>& files,
+    SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileRequires);
+  GOOGLE_CHECK_EQ(options.import_style, GeneratorOptions::kImportClosure);
+  // For Closure imports we need to import every message type individually.
+  SymbolSet required(provided->table());
+  SymbolSet forwards(provided->table());
+  bool have_extensions = false;
+  bool have_map = false;
+  bool have_message = false;
+
+  for (auto file : files) {
+    for (int j = 0; j < file->message_type_count(); j++) {
+      const Descriptor* desc = file->message_type(j);
+      if (!IgnoreMessage(desc) && IsReachable(options, desc)) {
+        FindRequiresForMessage(options, desc, &required, &forwards,
+                               &have_message);
+      }
+    }
+
+    if (!have_extensions && HasExtensions(options, file)) {
+      have_extensions = true;
+    }
+
+    if (!have_map && FileHasMap(options, file)) {
+      have_map = true;
+    }
+
+    for (int j = 0; j < file->extension_count(); j++) {
+      const FieldDescriptor* extension = file->extension(j);
+      if (IgnoreField(extension) || !IsReachable(options, extension)) {
+        continue;
+      }
+      if (extension->containing_type()->full_name() !=
+          "google.protobuf.bridge.MessageSet") {
+        required.Insert(GetMessagePath(options, extension->containing_type()));
+      }
+      FindRequiresForField(options, extension, &required, &forwards);
+      have_extensions = true;
+    }
+  }
+
+  GenerateRequiresImpl(options, printer, &required, &forwards, provided,
+                       /* require_jspb = */ have_message,
+                       /* require_extension = */ have_extensions,
+                       /* require_map = */ have_map);
+}
+
+void Generator::GenerateRequiresForExtensions(
+    const GeneratorOptions& options, io::Printer* printer,
+    const std::vector<const FieldDescriptor*>& fields,
+    SymbolSet* provided) const {
+  ScopedProfilePhase profile_phase(kProfileRequires);
+  SymbolSet required(provided->table());
+  SymbolSet forwards(provided->table());
+  for (auto field : fields) {
+    if (IgnoreField(field)) {
+      continue;
+    }
+    FindRequiresForExtension(options, field, &required, &forwards);
+  }
+
+  GenerateRequiresImpl(options, printer, &required, &forwards, provided,
+                       /* require_jspb = */ false,
+                       /* require_extension = */ fields.size() > 0,
+                       /* require_map = */ false);
+}
+
+void Generator::GenerateRequiresImpl(const GeneratorOptions& options,
+                                     io::Printer* printer,
+                                     SymbolSet* required,
+                                     SymbolSet* forwards,
+                                     SymbolSet* provided,
+                                     bool require_jspb, bool require_extension,
+                                     bool require_map) const {
+  ScopedProfilePhase profile_phase(kProfileRequires);
+  if (require_jspb) {
+    required->Insert("jspb.Message");
+    required->Insert("jspb.BinaryReader");
+    required->Insert("jspb.BinaryWriter");
+    if (options.codec == GeneratorOptions::kCodecTable) {
+      required->Insert("jspb.BinaryCodec");
+    }
+    if (options.field_masks) {
+      required->Insert("jspb.BinaryProjection");
+    }
+    if (options.instrument) {
+      required->Insert("jspb.BinaryInstrumentation");
+    }
+    if (options.batch) {
+      required->Insert("jspb.BinaryBatchPool");
+    }
+    if (options.delimited) {
+      required->Insert("jspb.BinaryDelimitedReader");
+    }
+    if (options.sizing) {
+      required->Insert("jspb.BinaryPresizedWriter");
+      required->Insert("jspb.BinarySizingWriter");
+    }
+    if (options.json) {
+      required->Insert("jspb.JsonReader");
+      required->Insert("jspb.JsonWriter");
+    }
+  }
+  if (require_extension) {
+    required->Insert("jspb.ExtensionFieldBinaryInfo");
+    required->Insert("jspb.ExtensionFieldInfo");
+  }
+  if (require_map) {
+    required->Insert("jspb.Map");
+  }
+
+  // All three sets share one SymbolTable, so ids can be compared directly.
+  for (int id : required->SortedIds()) {
+    if (provided->Contains(id)) {
+      continue;
+    }
+    printer->Print("goog.require('$name$');\n", "name",
+                   required->table()->name(id));
+  }
+
+  printer->Print("\n");
+
+  for (int id : forwards->SortedIds()) {
+    if (provided->Contains(id)) {
+      continue;
+    }
+    printer->Print("goog.forwardDeclare('$name$');\n", "name",
+                   forwards->table()->name(id));
+  }
+}
+
+bool NamespaceOnly(const Descriptor* desc) { return false; }
+
+void Generator::FindRequiresForMessage(const GeneratorOptions& options,
+                                       const Descriptor* desc,
+                                       SymbolSet* required,
+                                       SymbolSet* forwards,
+                                       bool* have_message) const {
+  if (!NamespaceOnly(desc)) {
+    *have_message = true;
+    for (int i = 0; i < desc->field_count(); i++) {
+      const FieldDescriptor* field = desc->field(i);
+      if (IgnoreField(field)) {
+        continue;
+      }
+      FindRequiresForField(options, field, required, forwards);
+    }
+  }
+
+  for (int i = 0; i < desc->extension_count(); i++) {
+    const FieldDescriptor* field = desc->extension(i);
+    if (IgnoreField(field)) {
+      continue;
+    }
+    FindRequiresForExtension(options, field, required, forwards);
+  }
+
+  for (int i = 0; i < desc->nested_type_count(); i++) {
+    FindRequiresForMessage(options, desc->nested_type(i), required, forwards,
+                           have_message);
+  }
+}
+
+void Generator::FindRequiresForField(const GeneratorOptions& options,
+                                     const FieldDescriptor* field,
+                                     SymbolSet* required,
+                                     SymbolSet* forwards) const {
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM &&
+      // N.B.: file-level extensions with enum type do *not* create
+      // dependencies, as per original codegen.
+      !(field->is_extension() && field->extension_scope() == nullptr)) {
+    // With json, the enum's value names are used at runtime.
+    if (options.add_require_for_enums || options.json) {
+      required->Insert(GetEnumPath(options, field->enum_type()));
+    } else {
+      forwards->Insert(GetEnumPath(options, field->enum_type()));
+    }
+  } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    if (!IgnoreMessage(field->message_type())) {
+      required->Insert(GetMessagePath(options, field->message_type()));
+    }
+  }
+}
+
+void Generator::FindRequiresForExtension(
+    const GeneratorOptions& options, const FieldDescriptor* field,
+    SymbolSet* required, SymbolSet* forwards) const {
+  if (field->containing_type()->full_name() !=
+      "google.protobuf.bridge.MessageSet") {
+    required->Insert(GetMessagePath(options, field->containing_type()));
+  }
+  FindRequiresForField(options, field, required, forwards);
+}
+
+void Generator::GenerateTestOnly(const GeneratorOptions& options,
+                                 io::Printer* printer) const {
+  if (options.testonly) {
+    printer->Print("goog.setTestOnly();\n\n");
+  }
+  printer->Print("\n");
+}
+
+void Generator::GenerateClassesAndEnums(const GeneratorOptions& options,
+                                        io::Printer* printer,
+                                        const FileDescriptor* file) const {
+  if (options.lazy_init) {
+    for (int i = 0; i < file->message_type_count(); i++) {
+      const Descriptor* desc = file->message_type(i);
+      if (IgnoreMessage(desc) || !IsReachable(options, desc)) {
+        continue;
+      }
+      std::string path = GetMessagePath(options, desc);
+      size_t dot = path.rfind('.');
+      printer->Print(
+          "\n"
+          "jspb.Message.defineLazy($namespace$, '$name$', function() {\n",
+          "namespace", path.substr(0, dot), "name", path.substr(dot + 1));
+      printer->Indent();
+      GenerateClassConstructorAndDeclareExtensionFieldInfo(options, printer,
+                                                           desc);
+      GenerateClass(options, printer, desc);
+      printer->Outdent();
+      printer->Print("});\n");
+    }
+    for (int i = 0; i < file->enum_type_count(); i++) {
+      if (IsReachable(options, file->enum_type(i))) {
+        GenerateEnum(options, printer, file->enum_type(i));
+      }
+    }
+    return;
+  }
+
+  for (int i = 0; i < file->message_type_count(); i++) {
+    if (IsReachable(options, file->message_type(i))) {
+      GenerateClassConstructorAndDeclareExtensionFieldInfo(
+          options, printer, file->message_type(i));
+    }
+  }
+  for (int i = 0; i < file->message_type_count(); i++) {
+    if (IsReachable(options, file->message_type(i))) {
+      GenerateClass(options, printer, file->message_type(i));
+    }
+  }
+  for (int i = 0; i < file->enum_type_count(); i++) {
+    if (IsReachable(options, file->enum_type(i))) {
+      GenerateEnum(options, printer, file->enum_type(i));
+    }
+  }
+}
+
+void Generator::GenerateClass(const GeneratorOptions& options,
+                              io::Printer* printer,
+                              const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileClasses);
+  if (IgnoreMessage(desc)) {
+    return;
+  }
+
+  if (!NamespaceOnly(desc)) {
+    printer->Print("\n");
+    GenerateClassFieldInfo(options, printer, desc);
+
+    GenerateClassToObject(options, printer, desc);
+    // These must come *before* the extension-field info generation in
+    // GenerateClassRegistration so that references to the binary
+    // serialization/deserialization functions may be placed in the extension
+    // objects.
+    GenerateClassDeserializeBinary(options, printer, desc);
+    GenerateClassSerializeBinary(options, printer, desc);
+    if (options.json) {
+      GenerateClassJson(options, printer, desc);
+    }
+  }
+
+  // Recurse on nested types. These must come *before* the extension-field
+  // info generation in GenerateClassRegistration so that extensions that
+  // reference nested types proceed the definitions of the nested types.
+  for (int i = 0; i < desc->enum_type_count(); i++) {
+    GenerateEnum(options, printer, desc->enum_type(i));
+  }
+  for (int i = 0; i < desc->nested_type_count(); i++) {
+    GenerateClass(options, printer, desc->nested_type(i));
+  }
+
+  if (!NamespaceOnly(desc)) {
+    GenerateClassRegistration(options, printer, desc);
+    GenerateClassFields(options, printer, desc);
+
+    if (options.import_style != GeneratorOptions::kImportClosure) {
+      for (int i = 0; i < desc->extension_count(); i++) {
+        GenerateExtension(options, printer, desc->extension(i));
+      }
+    }
+  }
+}
+
+void Generator::GenerateClassConstructor(const GeneratorOptions& options,
+                                         io::Printer* printer,
+                                         const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileConstructors);
+  printer->Print(
+      "/**\n"
+      " * Generated by JsPbCodeGenerator.\n"
+      " * @param {Array=} opt_data Optional initial data array, typically "
+      "from a\n"
+      " * server response, or constructed directly in Javascript. The array "
+      "is used\n"
+      " * in place and becomes part of the constructed object. It is not "
+      "cloned.\n"
+      " * If no data is provided, the constructed object will be empty, but "
+      "still\n"
+      " * valid.\n"
+      " * @extends {jspb.Message}\n"
+      " * @constructor\n"
+      " */\n"
+      "$classprefix$$classname$ = function(opt_data) {\n",
+      "classprefix", GetMessagePathPrefix(options, desc), "classname",
+      desc->name());
+  printer->Annotate("classname", desc);
+  std::string message_id = GetMessageId(desc);
+  printer->Print(
+      "  jspb.Message.initialize(this, opt_data, $messageId$, $pivot$, "
+      "$rptfields$, $oneoffields$);\n",
+      "messageId",
+      !message_id.empty() ? ("'" + message_id + "'")
+                          : (IsResponse(desc) ? "''" : "0"),
+      "pivot", GetPivot(desc), "rptfields",
+      RepeatedFieldsArrayName(options, desc), "oneoffields",
+      OneofFieldsArrayName(options, desc));
+  printer->Print(
+      "};\n"
+      "goog.inherits($classname$, jspb.Message);\n"
+      "if (goog.DEBUG && !COMPILED) {\n"
+      // displayName overrides Function.prototype.displayName
+      // http://google3/javascript/externs/es3.js?l=511
+      "  /**\n"
+      "   * @public\n"
+      "   * @override\n"
+      "   */\n"
+      "  $classname$.displayName = '$classname$';\n"
+      "}\n",
+      "classname", GetMessagePath(options, desc));
+}
+
+void Generator::GenerateClassConstructorAndDeclareExtensionFieldInfo(
+    const GeneratorOptions& options, io::Printer* printer,
+    const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileConstructors);
+  if (!NamespaceOnly(desc)) {
+    GenerateClassConstructor(options, printer, desc);
+    if (IsExtendable(desc) &&
+        desc->full_name() != "google.protobuf.bridge.MessageSet") {
+      GenerateClassExtensionFieldInfo(options, printer, desc);
+    }
+  }
+  for (int i = 0; i < desc->nested_type_count(); i++) {
+    if (!IgnoreMessage(desc->nested_type(i))) {
+      GenerateClassConstructorAndDeclareExtensionFieldInfo(
+          options, printer, desc->nested_type(i));
+    }
+  }
+}
+
+void Generator::GenerateClassFieldInfo(const GeneratorOptions& options,
+                                       io::Printer* printer,
+                                       const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileFieldInfo);
+  if (HasRepeatedFields(options, desc)) {
+    printer->Print(
+        "/**\n"
+        " * List of repeated fields within this message type.\n"
+        " * @private {!Array<number>}\n"
+        " * @const\n"
+        " */\n"
+        "$classname$$rptfieldarray$ = $rptfields$;\n"
+        "\n",
+        "classname", GetMessagePath(options, desc), "rptfieldarray",
+        kRepeatedFieldArrayName, "rptfields",
+        RepeatedFieldNumberList(options, desc));
+  }
+
+  if (HasOneofFields(desc)) {
+    printer->Print(
+        "/**\n"
+        " * Oneof group definitions for this message. Each group defines the "
+        "field\n"
+        " * numbers belonging to that group. When of these fields' value is "
+        "set, all\n"
+        " * other fields in the group are cleared. During deserialization, if "
+        "multiple\n"
+        " * fields are encountered for a group, only the last value seen will "
+        "be kept.\n"
+        " * @private {!Array<!Array<number>>}\n"
+        " * @const\n"
+        " */\n"
+        "$classname$$oneofgrouparray$ = $oneofgroups$;\n"
+        "\n",
+        "classname", GetMessagePath(options, desc), "oneofgrouparray",
+        kOneofGroupArrayName, "oneofgroups", OneofGroupList(options, desc));
+
+    for (int i = 0; i < desc->oneof_decl_count(); i++) {
+      if (IgnoreOneof(desc->oneof_decl(i))) {
+        continue;
+      }
+      GenerateOneofCaseDefinition(options, printer, desc->oneof_decl(i));
+    }
+  }
+}
+
+void Generator::GenerateClassXid(const GeneratorOptions& options,
+                                 io::Printer* printer,
+                                 const Descriptor* desc) const {
+  printer->Print(
+      "\n"
+      "\n"
+      "$class$.prototype.messageXid = xid('$class$');\n",
+      "class", GetMessagePath(options, desc));
+}
+
+void Generator::GenerateOneofCaseDefinition(
+    const GeneratorOptions& options, io::Printer* printer,
+    const OneofDescriptor* oneof) const {
+  printer->Print(
+      "/**\n"
+      " * @enum {number}\n"
+      " */\n"
+      "$classname$.$oneof$Case = {\n"
+      "  $upcase$_NOT_SET: 0",
+      "classname", GetMessagePath(options, oneof->containing_type()), "oneof",
+      JSOneofName(oneof), "upcase", ToEnumCase(oneof->name()));
+
+  for (int i = 0; i < oneof->field_count(); i++) {
+    if (IgnoreField(oneof->field(i))) {
+      continue;
+    }
+
+    printer->Print(
+        ",\n"
+        "  $upcase$: $number$",
+        "upcase", ToEnumCase(oneof->field(i)->name()), "number",
+        JSFieldIndex(options, oneof->field(i)));
+    printer->Annotate("upcase", oneof->field(i));
+  }
+
+  printer->Print(
+      "\n"
+      "};\n"
+      "\n"
+      "/**\n"
+      " * @return {$class$.$oneof$Case}\n"
+      " */\n"
+      "$class$.prototype.get$oneof$Case = function() {\n"
+      "  return /** @type {$class$.$oneof$Case} */(jspb.Message."
+      "computeOneofCase(this, $class$.oneofGroups_[$oneofindex$]));\n"
+      "};\n"
+      "\n",
+      "class", GetMessagePath(options, oneof->containing_type()), "oneof",
+      JSOneofName(oneof), "oneofindex", JSOneofIndex(oneof));
+}
+
+void Generator::GenerateClassToObject(const GeneratorOptions& options,
+                                      io::Printer* printer,
+                                      const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileToObject);
+  printer->Print(
+      "\n"
+      "\n"
+      "if (jspb.Message.GENERATE_TO_OBJECT) {\n"
+      "/**\n"
+      " * Creates an object representation of this proto.\n"
+      " * Field names that are reserved in JavaScript and will be renamed to "
+      "pb_name.\n"
+      " * Optional fields that are not set will be set to undefined.\n"
+      " * To access a reserved field use, foo.pb_<name>, eg, foo.pb_default.\n"
+      " * For the list of reserved names please see:\n"
+      " *     net/proto2/compiler/js/internal/generator.cc#kKeyword.\n"
+      " * @param {boolean=} opt_includeInstance Deprecated. whether to include "
+      "the\n"
+      " *     JSPB instance for transitional soy proto support:\n"
+      " *     http://goto/soy-param-migration\n"
+      " * @return {!Object}\n"
+      " */\n"
+      "$classname$.prototype.toObject = function(opt_includeInstance) {\n"
+      "  return $classname$.toObject(opt_includeInstance, this);\n"
+      "};\n"
+      "\n"
+      "\n"
+      "/**\n"
+      " * Static version of the {@see toObject} method.\n"
+      " * @param {boolean|undefined} includeInstance Deprecated. Whether to "
+      "include\n"
+      " *     the JSPB instance for transitional soy proto support:\n"
+      " *     http://goto/soy-param-migration\n"
+      " * @param {!$classname$} msg The msg instance to transform.\n"
+      " * @return {!Object}\n"
+      " * @suppress {unusedLocalVariables} f is only used for nested messages\n"
+      " */\n"
+      "$classname$.toObject = function(includeInstance, msg) {\n",
+      "classname", GetMessagePath(options, desc));
+
+  int max_direct_index = -1;
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    if (!IgnoreField(field) && IsDirectToObjectField(options, field)) {
+      max_direct_index =
+          std::max(max_direct_index, DirectObjectIndex(options, field));
+    }
+  }
+  if (max_direct_index >= 0) {
+    printer->Print(
+        "  var f, a = jspb.Message.getDirectFieldArray(msg, $max$), obj = {",
+        "max", StrCat(max_direct_index));
+  } else {
+    printer->Print("  var f, obj = {");
+  }
+
+  bool first = true;
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    if (IgnoreField(field)) {
+      continue;
+    }
+
+    if (!first) {
+      printer->Print(",\n    ");
+    } else {
+      printer->Print("\n    ");
+      first = false;
+    }
+
+    GenerateClassFieldToObject(options, printer, field);
+  }
+
+  if (!first) {
+    printer->Print("\n  };\n\n");
+  } else {
+    printer->Print("\n\n  };\n\n");
+  }
+
+  if (IsExtendable(desc)) {
+    printer->Print(
+        "  jspb.Message.toObjectExtension(/** @type {!jspb.Message} */ (msg), "
+        "obj,\n"
+        "      $extObject$, $class$.prototype.getExtension,\n"
+        "      includeInstance);\n",
+        "extObject", JSExtensionsObjectName(options, desc->file(), desc),
+        "class", GetMessagePath(options, desc));
+  }
+
+  if (!options.direct_object || IsExtendable(desc)) {
+    printer->Print(
+        "  if (includeInstance) {\n"
+        "    obj.$$jspbMessageInstance = msg;\n"
+        "  }\n");
+  }
+  printer->Print(
+      "  return obj;\n"
+      "};\n"
+      "}\n"
+      "\n"
+      "\n");
+}
+
+void Generator::GenerateFieldValueExpression(const GeneratorOptions& options,
+                                             io::Printer* printer,
+                                             const char* obj_reference,
+                                             const FieldDescriptor* field,
+                                             bool use_default) const {
+  const bool is_float_or_double =
+      field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT ||
+      field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE;
+  const bool is_boolean = field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL;
+
+  const std::string with_default = use_default ? "WithDefault" : "";
+  const std::string default_arg =
+      use_default ? StrCat(", ", JSFieldDefault(options, field)) : "";
+  const std::string cardinality = field->is_repeated() ? "Repeated" : "";
+  std::string type = "";
+  if (is_float_or_double) {
+    type = "FloatingPoint";
+  }
+  if (is_boolean) {
+    type = "Boolean";
+  }
+
+  // Prints the appropriate function, among:
+  // - getField
+  // - getBooleanField
+  // - getFloatingPointField => Replaced by getOptionalFloatingPointField to
+  //   preserve backward compatibility.
+  // - getFieldWithDefault
+  // - getBooleanFieldWithDefault
+  // - getFloatingPointFieldWithDefault
+  // - getRepeatedField
+  // - getRepeatedBooleanField
+  // - getRepeatedFloatingPointField
+  if (is_float_or_double && !field->is_repeated() && !use_default) {
+    printer->Print(
+        "jspb.Message.getOptionalFloatingPointField($obj$, "
+        "$index$$default$)",
+        "obj", obj_reference, "index", JSFieldIndex(options, field), "default",
+        default_arg);
+  } else {
+    printer->Print(
+        "jspb.Message.get$cardinality$$type$Field$with_default$($obj$, "
+        "$index$$default$)",
+        "cardinality", cardinality, "type", type, "with_default", with_default,
+        "obj", obj_reference, "index", JSFieldIndex(options, field), "default",
+        default_arg);
+  }
+}
+
+void Generator::GenerateClassFieldToObject(const GeneratorOptions& options,
+                                           io::Printer* printer,
                                            const FieldDescriptor* field) const {
   printer->Print("$fieldname$: ", "fieldname",
                  JSObjectFieldName(options, field));
@@ -2360,10 +4563,19 @@ void Generator::GenerateClassFieldToObject(const GeneratorOptions& options,
     // all).  So we want to generate independent code.
     // The accessor for unset optional values without default should return
     // null. Those are converted to undefined in the generated object.
+    if (IsDirectToObjectField(options, field)) {
+      // Reads the element from the array returned by
+      // jspb.Message.getDirectFieldArray().
+      printer->Print("(f = a[$index$]) == null ? $default$ : $value$", "index",
+                     StrCat(DirectObjectIndex(options, field)), "default",
+                     use_default ? JSFieldDefault(options, field) : "undefined",
+                     "value", DirectFieldValue(field, "f"));
+      return;
+    }
     if (!use_default) {
       printer->Print("(f = ");
     }
-    GenerateFieldValueExpression(printer, "msg", field, use_default);
+    GenerateFieldValueExpression(options, printer, "msg", field, use_default);
     if (!use_default) {
       printer->Print(") == null ? undefined : f");
     }
@@ -2404,6 +4616,7 @@ void Generator::GenerateObjectTypedef(const GeneratorOptions& options,
 void Generator::GenerateClassFromObject(const GeneratorOptions& options,
                                         io::Printer* printer,
                                         const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileFromObject);
   printer->Print("if (jspb.Message.GENERATE_FROM_OBJECT) {\n\n");
 
   GenerateObjectTypedef(options, printer, desc);
@@ -2418,6 +4631,15 @@ void Generator::GenerateClassFromObject(const GeneratorOptions& options,
       "$classname$.fromObject = function(obj) {\n"
       "  var msg = new $classname$();\n",
       "classname", GetMessagePath(options, desc));
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    if (!IgnoreField(field) && DirectObjectIndex(options, field) >= 0) {
+      // A new message has no lazy fields, and its pivot is the one computed
+      // by GetPivot(), so fields below it can be assigned in place.
+      printer->Print("  var a = msg.array;\n");
+      break;
+    }
+  }
 
   for (int i = 0; i < desc->field_count(); i++) {
     const FieldDescriptor* field = desc->field(i);
@@ -2445,7 +4667,7 @@ void Generator::GenerateClassFieldFromObject(
           "      msg, $index$, jspb.Map.fromObject(obj.$name$, $fieldclass$, "
           "$fieldclass$.fromObject));\n",
           "name", JSObjectFieldName(options, field), "index",
-          JSFieldIndex(field), "fieldclass",
+          JSFieldIndex(options, field), "fieldclass",
           GetMessagePath(options, value_field->message_type()));
     } else {
       // `msg` is a newly-constructed message object that has not yet built any
@@ -2455,7 +4677,7 @@ void Generator::GenerateClassFieldFromObject(
           "  obj.$name$ && "
           "jspb.Message.setField(msg, $index$, obj.$name$);\n",
           "name", JSObjectFieldName(options, field), "index",
-          JSFieldIndex(field));
+          JSFieldIndex(options, field));
     }
   } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
     // Message field (singular or repeated)
@@ -2467,7 +4689,7 @@ void Generator::GenerateClassFieldFromObject(
             "      msg, $index$, obj.$name$.map(\n"
             "          $fieldclass$.fromObject));\n",
             "name", JSObjectFieldName(options, field), "index",
-            JSFieldIndex(field), "fieldclass",
+            JSFieldIndex(options, field), "fieldclass",
             SubmessageTypeRef(options, field));
       }
     } else {
@@ -2475,21 +4697,27 @@ void Generator::GenerateClassFieldFromObject(
           "  obj.$name$ && jspb.Message.setWrapperField(\n"
           "      msg, $index$, $fieldclass$.fromObject(obj.$name$));\n",
           "name", JSObjectFieldName(options, field), "index",
-          JSFieldIndex(field), "fieldclass", SubmessageTypeRef(options, field));
+          JSFieldIndex(options, field), "fieldclass",
+          SubmessageTypeRef(options, field));
     }
+  } else if (DirectObjectIndex(options, field) >= 0) {
+    printer->Print("  obj.$name$ != null && (a[$index$] = obj.$name$);\n",
+                   "name", JSObjectFieldName(options, field), "index",
+                   StrCat(DirectObjectIndex(options, field)));
   } else {
     // Simple (primitive) field.
     printer->Print(
         "  obj.$name$ != null && jspb.Message.setField(msg, $index$, "
         "obj.$name$);\n",
         "name", JSObjectFieldName(options, field), "index",
-        JSFieldIndex(field));
+        JSFieldIndex(options, field));
   }
 }
 
 void Generator::GenerateClassRegistration(const GeneratorOptions& options,
                                           io::Printer* printer,
                                           const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileExtensions);
   // Register any extensions defined inside this message type.
   for (int i = 0; i < desc->extension_count(); i++) {
     const FieldDescriptor* extension = desc->extension(i);
@@ -2502,9 +4730,61 @@ void Generator::GenerateClassRegistration(const GeneratorOptions& options,
 void Generator::GenerateClassFields(const GeneratorOptions& options,
                                     io::Printer* printer,
                                     const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileAccessors);
+  // With compact, the accessors of the simple fields are installed from a
+  // single table first, and the remaining fields are generated as usual.
+  bool has_table = false;
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    if (IgnoreField(field) || !IsTableAccessorField(options, field)) {
+      continue;
+    }
+
+    // The same accessors as generated by GenerateClassField().
+    int flags = 0;
+    std::string extra = "null";
+    if (field->is_repeated()) {
+      flags |= kAccessorRepeated;
+      extra = "'" +
+              JSGetterName(options, field, BYTES_DEFAULT,
+                           /* drop_list = */ true) +
+              "'";
+    } else if (!ReturnsNullWhenUnset(options, field)) {
+      flags |= kAccessorWithDefault;
+      extra = JSFieldDefault(options, field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT ||
+        field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE) {
+      flags |= kAccessorFloatingPoint;
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+      flags |= kAccessorBoolean;
+    }
+    if (HasFieldPresence(options, field)) {
+      flags |= kAccessorPresence;
+    }
+    std::string setter = "null";
+    if (field->file()->syntax() == FileDescriptor::SYNTAX_PROTO3 &&
+        !field->is_repeated() && !HasFieldPresence(options, field)) {
+      setter = "jspb.Message.setProto3" + JSTypeTag(options, field) + "Field";
+    }
+
+    printer->Print(has_table ? ",\n"
+                             : "jspb.Message.installAccessors($class$, [\n",
+                   "class", GetMessagePath(options, desc));
+    printer->Print("  '$name$', $index$, $flags$, $extra$, $setter$", "name",
+                   JSGetterName(options, field), "index",
+                   JSFieldIndex(options, field), "flags", StrCat(flags),
+                   "extra", extra, "setter", setter);
+    has_table = true;
+  }
+  if (has_table) {
+    printer->Print("\n]);\n\n\n");
+  }
+
   for (int i = 0; i < desc->field_count(); i++) {
-    if (!IgnoreField(desc->field(i))) {
-      GenerateClassField(options, printer, desc->field(i));
+    const FieldDescriptor* field = desc->field(i);
+    if (!IgnoreField(field) && !IsTableAccessorField(options, field)) {
+      GenerateClassField(options, printer, field);
     }
   }
 }
@@ -2574,7 +4854,7 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
     printer->Annotate("gettername", field);
     printer->Print(
         "      jspb.Message.getMapField(this, $index$, opt_noLazyCreate",
-        "index", JSFieldIndex(field));
+        "index", JSFieldIndex(options, field));
 
     if (value_field->type() == FieldDescriptor::TYPE_MESSAGE) {
       printer->Print(
@@ -2624,7 +4904,8 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
                               /* force_present = */ false,
                               /* singular_if_not_packed = */ false),
         "rpt", (field->is_repeated() ? "Repeated" : ""), "index",
-        JSFieldIndex(field), "wrapperclass", SubmessageTypeRef(options, field),
+        JSFieldIndex(options, field), "wrapperclass",
+        SubmessageTypeRef(options, field),
         "required",
         (field->label() == FieldDescriptor::LABEL_REQUIRED ? ", 1" : ""));
     printer->Annotate("gettername", field);
@@ -2651,7 +4932,7 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
         "};\n"
         "\n"
         "\n",
-        "index", JSFieldIndex(field), "oneofgroup",
+        "index", JSFieldIndex(options, field), "oneofgroup",
         (InRealOneof(field) ? (", " + JSOneofArray(options, field)) : ""));
 
     if (field->is_repeated()) {
@@ -2697,6 +4978,12 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
                    "gettername", "get" + JSGetterName(options, field));
     printer->Annotate("gettername", field);
 
+    const int inline_index = InlineAccessorIndex(options, field);
+    if (inline_index >= 0) {
+      printer->Print("  var value = this.array[$index$];\n", "index",
+                     StrCat(inline_index));
+    }
+
     if (untyped) {
       printer->Print("  return ");
     } else {
@@ -2717,7 +5004,20 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
       use_default = false;
     }
 
-    GenerateFieldValueExpression(printer, "this", field, use_default);
+    if (inline_index >= 0) {
+      // Same results as the jspb.Message getters called below otherwise.
+      const std::string value = DirectFieldValue(field, "value");
+      if (use_default || value != "value") {
+        printer->Print("value == null ? $default$ : $value$", "default",
+                       use_default ? JSFieldDefault(options, field) : "value",
+                       "value", value);
+      } else {
+        printer->Print("value");
+      }
+    } else {
+      GenerateFieldValueExpression(options, printer, "this", field,
+                                   use_default);
+    }
 
     if (untyped) {
       printer->Print(
@@ -2751,9 +5051,29 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
                                         /* force_present = */ false,
                                         /* singular_if_not_packed = */ false));
 
-    if (field->file()->syntax() == FileDescriptor::SYNTAX_PROTO3 &&
-        !field->is_repeated() && !field->is_map() &&
-        !HasFieldPresence(options, field)) {
+    if (inline_index >= 0 && !InRealOneof(field)) {
+      // setField() and setProto3*Field(), storing null instead of the proto3
+      // default value.
+      std::string value = "value";
+      if (field->file()->syntax() == FileDescriptor::SYNTAX_PROTO3 &&
+          !HasFieldPresence(options, field)) {
+        value = StrCat("value !== ", JSTypeTagDefault(options, field),
+                       " ? value : null");
+      }
+      printer->Print(
+          "$class$.prototype.$settername$ = function(value) {\n"
+          "  this.array[$index$] = $value$;\n"
+          "  return this;\n"
+          "};\n"
+          "\n"
+          "\n",
+          "class", GetMessagePath(options, field->containing_type()),
+          "settername", "set" + JSGetterName(options, field), "index",
+          StrCat(inline_index), "value", value);
+      printer->Annotate("settername", field);
+    } else if (field->file()->syntax() == FileDescriptor::SYNTAX_PROTO3 &&
+               !field->is_repeated() && !field->is_map() &&
+               !HasFieldPresence(options, field)) {
       // Proto3 non-repeated and non-map fields without presence use the
       // setProto3*Field function.
       printer->Print(
@@ -2766,7 +5086,7 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
           "\n",
           "class", GetMessagePath(options, field->containing_type()),
           "settername", "set" + JSGetterName(options, field), "typetag",
-          JSTypeTag(field), "index", JSFieldIndex(field));
+          JSTypeTag(options, field), "index", JSFieldIndex(options, field));
       printer->Annotate("settername", field);
     } else {
       // Otherwise, use the regular setField function.
@@ -2775,7 +5095,8 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
           "  return jspb.Message.set$oneoftag$Field(this, $index$",
           "class", GetMessagePath(options, field->containing_type()),
           "settername", "set" + JSGetterName(options, field), "oneoftag",
-          (InRealOneof(field) ? "Oneof" : ""), "index", JSFieldIndex(field));
+          (InRealOneof(field) ? "Oneof" : ""), "index",
+          JSFieldIndex(options, field));
       printer->Annotate("settername", field);
       printer->Print(
           "$oneofgroup$, $type$value$rptvalueinit$$typeclose$);\n"
@@ -2847,6 +5168,23 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
         "clearedvalue", (field->is_repeated() ? "[]" : "undefined"));
     // clang-format on
     printer->Annotate("clearername", field);
+  } else if (HasFieldPresence(options, field) &&
+             InlineAccessorIndex(options, field) >= 0 && !InRealOneof(field)) {
+    printer->Print(
+        "/**\n"
+        " * Clears the field making it undefined.\n"
+        " * @return {!$class$} returns this\n"
+        " */\n"
+        "$class$.prototype.$clearername$ = function() {\n"
+        "  this.array[$index$] = undefined;\n"
+        "  return this;\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, field->containing_type()),
+        "clearername", "clear" + JSGetterName(options, field), "index",
+        StrCat(InlineAccessorIndex(options, field)));
+    printer->Annotate("clearername", field);
   } else if (HasFieldPresence(options, field)) {
     // Fields where we can't delegate to the regular setter because it doesn't
     // accept "undefined" as an argument.
@@ -2865,7 +5203,7 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
         "maybeoneofgroup", (InRealOneof(field)
                             ? (", " + JSOneofArray(options, field))
                             : ""),
-        "index", JSFieldIndex(field));
+        "index", JSFieldIndex(options, field));
     // clang-format on
     printer->Annotate("clearername", field);
     printer->Print(
@@ -2876,201 +5214,976 @@ void Generator::GenerateClassField(const GeneratorOptions& options,
         "clearedvalue", (field->is_repeated() ? "[]" : "undefined"));
   }
 
-  if (HasFieldPresence(options, field)) {
+  if (HasFieldPresence(options, field)) {
+    const int inline_index = InlineAccessorIndex(options, field);
+    printer->Print(
+        "/**\n"
+        " * Returns whether this field is set.\n"
+        " * @return {boolean}\n"
+        " */\n"
+        "$class$.prototype.$hasername$ = function() {\n"
+        "  return $value$ != null;\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, field->containing_type()), "hasername",
+        "has" + JSGetterName(options, field), "value",
+        inline_index >= 0
+            ? StrCat("this.array[", inline_index, "]")
+            : StrCat("jspb.Message.getField(this, ",
+                     JSFieldIndex(options, field), ")"));
+    printer->Annotate("hasername", field);
+  }
+}
+
+void Generator::GenerateRepeatedPrimitiveHelperMethods(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field, bool untyped) const {
+  // clang-format off
+  printer->Print(
+      "/**\n"
+      " * @param {$optionaltype$} value\n"
+      " * @param {number=} opt_index\n"
+      " * @return {!$class$} returns this\n"
+      " */\n"
+      "$class$.prototype.$addername$ = function(value, opt_index) {\n"
+      "  return jspb.Message.addToRepeatedField(this, "
+      "$index$",
+      "class", GetMessagePath(options, field->containing_type()), "addername",
+      "add" + JSGetterName(options, field, BYTES_DEFAULT,
+                           /* drop_list = */ true),
+      "optionaltype",
+          JSFieldTypeAnnotation(
+                                options, field,
+                                /* is_setter_argument = */ false,
+                                /* force_present = */ true,
+                                /* singular_if_not_packed = */ false,
+                                BYTES_DEFAULT,
+                                /* force_singular = */ true),
+      "index", JSFieldIndex(options, field));
+  printer->Annotate("addername", field);
+  printer->Print(
+      "$oneofgroup$, $type$value$rptvalueinit$$typeclose$, "
+      "opt_index);\n"
+      "};\n"
+      "\n"
+      "\n",
+      "type", untyped ? "/** @type{string|number|boolean|!Uint8Array} */(" : "",
+      "typeclose", untyped ? ")" : "", "oneofgroup",
+      (InRealOneof(field) ? (", " + JSOneofArray(options, field)) : ""),
+      "rptvalueinit", "");
+  // clang-format on
+}
+
+void Generator::GenerateRepeatedMessageHelperMethods(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field) const {
+  printer->Print(
+      "/**\n"
+      " * @param {!$optionaltype$=} opt_value\n"
+      " * @param {number=} opt_index\n"
+      " * @return {!$optionaltype$}\n"
+      " */\n"
+      "$class$.prototype.$addername$ = function(opt_value, opt_index) {\n"
+      "  return jspb.Message.addTo$repeatedtag$WrapperField(",
+      "optionaltype", JSTypeName(options, field, BYTES_DEFAULT), "class",
+      GetMessagePath(options, field->containing_type()), "addername",
+      "add" + JSGetterName(options, field, BYTES_DEFAULT,
+                           /* drop_list = */ true),
+      "repeatedtag", (field->is_repeated() ? "Repeated" : ""));
+
+  printer->Annotate("addername", field);
+  printer->Print(
+      "this, $index$$oneofgroup$, opt_value, $ctor$, opt_index);\n"
+      "};\n"
+      "\n"
+      "\n",
+      "index", JSFieldIndex(options, field), "oneofgroup",
+      (InRealOneof(field) ? (", " + JSOneofArray(options, field)) : ""), "ctor",
+      GetMessagePath(options, field->message_type()));
+}
+
+void Generator::GenerateClassExtensionFieldInfo(const GeneratorOptions& options,
+                                                io::Printer* printer,
+                                                const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileExtensions);
+  if (IsExtendable(desc)) {
+    printer->Print(
+        "\n"
+        "/**\n"
+        " * The extensions registered with this message class. This is a "
+        "map of\n"
+        " * extension field number to fieldInfo object.\n"
+        " *\n"
+        " * For example:\n"
+        " *     { 123: {fieldIndex: 123, fieldName: {my_field_name: 0}, "
+        "ctor: proto.example.MyMessage} }\n"
+        " *\n"
+        " * fieldName contains the JsCompiler renamed field name property "
+        "so that it\n"
+        " * works in OPTIMIZED mode.\n"
+        " *\n"
+        " * @type {!Object<number, jspb.ExtensionFieldInfo>}\n"
+        " */\n"
+        "$class$.extensions = {};\n"
+        "\n",
+        "class", GetMessagePath(options, desc));
+
+    printer->Print(
+        "\n"
+        "/**\n"
+        " * The extensions registered with this message class. This is a "
+        "map of\n"
+        " * extension field number to fieldInfo object.\n"
+        " *\n"
+        " * For example:\n"
+        " *     { 123: {fieldIndex: 123, fieldName: {my_field_name: 0}, "
+        "ctor: proto.example.MyMessage} }\n"
+        " *\n"
+        " * fieldName contains the JsCompiler renamed field name property "
+        "so that it\n"
+        " * works in OPTIMIZED mode.\n"
+        " *\n"
+        " * @type {!Object<number, jspb.ExtensionFieldBinaryInfo>}\n"
+        " */\n"
+        "$class$.extensionsBinary = {};\n"
+        "\n",
+        "class", GetMessagePath(options, desc));
+  }
+}
+
+void Generator::GenerateClassDeserializeBinary(const GeneratorOptions& options,
+                                               io::Printer* printer,
+                                               const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileDeserializeBinary);
+  // Lazy decoding of message and packed fields is selected with the lazy
+  // option. 'bytes' fields need no lazy mode: the reader already returns them
+  // as views into the input buffer, without copying.
+
+  if (options.codec == GeneratorOptions::kCodecTable) {
+    GenerateClassBinaryCodecTable(options, printer, desc);
+  } else {
+    for (int i = 0; i < desc->field_count(); i++) {
+      if (!IgnoreField(desc->field(i)) && desc->field(i)->is_map()) {
+        GenerateClassMapEntryReader(options, printer, desc->field(i));
+      }
+    }
+  }
+
+  printer->Print(
+      "/**\n"
+      " * Deserializes binary data (in protobuf wire format).\n"
+      " * @param {jspb.ByteSource} bytes The bytes to deserialize.\n"
+      " * @return {!$class$}\n"
+      " */\n"
+      "$class$.deserializeBinary = function(bytes) {\n"
+      "  var reader = new jspb.BinaryReader(bytes);\n"
+      "  var msg = new $class$;\n"
+      "  return $class$.deserializeBinaryFromReader(msg, reader);\n"
+      "};\n"
+      "\n"
+      "\n",
+      "class", GetMessagePath(options, desc));
+
+  if (options.reuse) {
+    printer->Print(
+        "/**\n"
+        " * Clears all fields of the message, keeping its submessages,\n"
+        " * repeated fields and maps to be reused by the next resetFrom().\n"
+        " * @return {!$class$} returns this\n"
+        " */\n"
+        "$class$.prototype.clear = function() {\n"
+        "  jspb.Message.clear(this, $repeatedfields$);\n"
+        "  return this;\n"
+        "};\n"
+        "\n"
+        "\n"
+        "/**\n"
+        " * Replaces the contents of the message with the given binary data\n"
+        " * (in protobuf wire format), reusing its submessages, repeated\n"
+        " * fields and maps as well as a pooled BinaryReader.\n"
+        " * @param {jspb.ByteSource} bytes The bytes to deserialize.\n"
+        " * @return {!$class$} returns this\n"
+        " */\n"
+        "$class$.prototype.resetFrom = function(bytes) {\n"
+        "  var reader = jspb.BinaryReader.alloc(bytes);\n"
+        "  $class$.deserializeBinaryFromReader(this.clear(), reader);\n"
+        "  reader.free();\n"
+        "  jspb.Message.endReuse(this);\n"
+        "  return this;\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, desc), "repeatedfields",
+        RepeatedFieldsArrayName(options, desc));
+  }
+
+  if (options.delimited) {
+    printer->Print(
+        "/**\n"
+        " * Deserializes a stream of messages, each prefixed by its length as\n"
+        " * written by serializeDelimited(), that arrives in the given\n"
+        " * chunks. Messages split across chunks are handled; the others are\n"
+        " * decoded in place from their chunk.\n"
+        " * @param {!Iterable<!Uint8Array>|!AsyncIterable<!Uint8Array>}\n"
+        " *     source The chunks; an async iterable gives an async iterable.\n"
+        " * @return {!IteratorIterable<!$class$>|!AsyncIterable<!$class$>}\n"
+        " */\n"
+        "$class$.deserializeDelimitedStream = function(source) {\n"
+        "  return jspb.BinaryDelimitedReader.iterate(\n"
+        "      source, $class$, $class$.deserializeBinaryFromReader);\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, desc));
+  }
+
+  if (options.batch) {
+    printer->Print(
+        "/**\n"
+        " * Deserializes a batch of independent messages, spread across the\n"
+        " * workers of the jspb.BinaryBatchPool in the options if given.\n"
+        " * @param {!Array<!Uint8Array>} buffers The serialized messages.\n"
+        " * @param {!jspb.BinaryBatchOptions=} opt_options\n"
+        " * @return {!Promise<!Array<!$class$|!Object>>} The messages, or\n"
+        " *     their toObject() form with the objects option.\n"
+        " */\n"
+        "$class$.deserializeBinaryBatch = function(buffers, opt_options) {\n"
+        "  return jspb.BinaryBatchPool.deserialize(\n"
+        "      $class$, '$type$', buffers, opt_options);\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, desc), "type", desc->full_name());
+  }
+
+  if (options.field_masks) {
+    GenerateClassFieldMask(options, printer, desc);
+  }
+
+  printer->Print(
+      "/**\n"
+      " * Deserializes binary data (in protobuf wire format) from the\n"
+      " * given reader into the given message object.\n"
+      " * @param {!$class$} msg The message object to deserialize into.\n"
+      " * @param {!jspb.BinaryReader} reader The BinaryReader to use.\n",
+      "class", GetMessagePath(options, desc));
+  if (options.field_masks) {
+    printer->Print(
+        " * @param {!jspb.BinaryProjection=} opt_projection If set, only the\n"
+        " *     fields it selects are decoded, and the others are skipped.\n"
+        " * @return {!$class$}\n"
+        " */\n"
+        "$class$.deserializeBinaryFromReader = function(msg, reader, "
+        "opt_projection) {\n",
+        "class", GetMessagePath(options, desc));
+  } else {
+    printer->Print(
+        " * @return {!$class$}\n"
+        " */\n"
+        "$class$.deserializeBinaryFromReader = function(msg, reader) {\n",
+        "class", GetMessagePath(options, desc));
+  }
+  GenerateInstrumentationBeginDecode(options, printer);
+  if (options.codec == GeneratorOptions::kCodecTable) {
+    if (options.instrument) {
+      printer->Print(
+          "  jspb.BinaryCodec.deserialize(msg, reader, "
+          "$class$.binaryCodecTable_$projection$);\n",
+          "class", GetMessagePath(options, desc), "projection",
+          options.field_masks ? ", opt_projection" : "");
+      GenerateInstrumentationEndDecode(options, printer, desc);
+      printer->Print(
+          "  return msg;\n"
+          "};\n"
+          "\n"
+          "\n");
+      return;
+    }
+    printer->Print(
+        "  return jspb.BinaryCodec.deserialize(msg, reader, "
+        "$class$.binaryCodecTable_$projection$);\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, desc), "projection",
+        options.field_masks ? ", opt_projection" : "");
+    return;
+  }
+
+  printer->Print(
+      "  while (reader.nextField()) {\n"
+      "    if (reader.isEndGroup()) {\n"
+      "      break;\n"
+      "    }\n"
+      "    var field = reader.getFieldNumber();\n");
+  if (options.field_masks) {
+    printer->Print(
+        "    if (opt_projection && !opt_projection.has(field)) {\n"
+        "      reader.skipField();\n"
+        "      continue;\n"
+        "    }\n");
+  }
+  printer->Print("    switch (field) {\n");
+
+  std::vector<const FieldDescriptor*> fields;
+  for (const FieldDescriptor* field : OrderedFields(options, desc)) {
+    if (!IgnoreField(field)) {
+      fields.push_back(field);
+    }
+  }
+  for (size_t i = 0; i < fields.size(); i++) {
+    GenerateClassDeserializeBinaryField(
+        options, printer, fields[i],
+        i + 1 < fields.size() ? fields[i + 1] : nullptr);
+  }
+
+  printer->Print("    default:\n");
+  if (IsExtendable(desc)) {
     printer->Print(
-        "/**\n"
-        " * Returns whether this field is set.\n"
-        " * @return {boolean}\n"
-        " */\n"
-        "$class$.prototype.$hasername$ = function() {\n"
-        "  return jspb.Message.getField(this, $index$) != null;\n"
-        "};\n"
-        "\n"
-        "\n",
-        "class", GetMessagePath(options, field->containing_type()), "hasername",
-        "has" + JSGetterName(options, field), "index", JSFieldIndex(field));
-    printer->Annotate("hasername", field);
+        "      jspb.Message.readBinaryExtension(msg, reader,\n"
+        "        $extobj$Binary,\n"
+        "        $class$.prototype.getExtension,\n"
+        "        $class$.prototype.setExtension);\n"
+        "      break;\n"
+        "    }\n",
+        "extobj", JSExtensionsObjectName(options, desc->file(), desc), "class",
+        GetMessagePath(options, desc));
+  } else {
+    if (options.instrument) {
+      printer->Print(
+          "      if (jspb.BinaryInstrumentation.ENABLED) {\n"
+          "        jspb.BinaryInstrumentation.countUnknownField();\n"
+          "      }\n");
+    }
+    printer->Print(
+        "      reader.skipField();\n"
+        "      break;\n"
+        "    }\n");
   }
+
+  printer->Print("  }\n");
+  GenerateInstrumentationEndDecode(options, printer, desc);
+  printer->Print(
+      "  return msg;\n"
+      "};\n"
+      "\n"
+      "\n");
 }
 
-void Generator::GenerateRepeatedPrimitiveHelperMethods(
-    const GeneratorOptions& options, io::Printer* printer,
-    const FieldDescriptor* field, bool untyped) const {
-  // clang-format off
+void Generator::GenerateClassBinaryCodecTable(const GeneratorOptions& options,
+                                              io::Printer* printer,
+                                              const Descriptor* desc) const {
   printer->Print(
       "/**\n"
-      " * @param {$optionaltype$} value\n"
-      " * @param {number=} opt_index\n"
-      " * @return {!$class$} returns this\n"
+      " * The field table of this message, used by jspb.BinaryCodec to\n"
+      " * serialize and deserialize it.\n"
+      " * @private @const {!jspb.BinaryCodec.Table}\n"
       " */\n"
-      "$class$.prototype.$addername$ = function(value, opt_index) {\n"
-      "  return jspb.Message.addToRepeatedField(this, "
-      "$index$",
-      "class", GetMessagePath(options, field->containing_type()), "addername",
-      "add" + JSGetterName(options, field, BYTES_DEFAULT,
-                           /* drop_list = */ true),
-      "optionaltype",
-          JSFieldTypeAnnotation(
-                                options, field,
-                                /* is_setter_argument = */ false,
-                                /* force_present = */ true,
-                                /* singular_if_not_packed = */ false,
-                                BYTES_DEFAULT,
-                                /* force_singular = */ true),
-      "index", JSFieldIndex(field));
-  printer->Annotate("addername", field);
+      "$class$.binaryCodecTable_ = new jspb.BinaryCodec.Table(function() {\n"
+      "  return [",
+      "class", GetMessagePath(options, desc));
+
+  bool first = true;
+  for (const FieldDescriptor* field : OrderedFields(options, desc)) {
+    if (IgnoreField(field)) {
+      continue;
+    }
+    printer->Print(first ? "\n" : ",\n");
+    first = false;
+    GenerateClassBinaryCodecTableField(options, printer, field);
+  }
+
+  printer->Print(first ? "];\n}" : "\n  ];\n}");
+  if (IsExtendable(desc)) {
+    printer->Print(", $extobj$Binary", "extobj",
+                   JSExtensionsObjectName(options, desc->file(), desc));
+  }
   printer->Print(
-      "$oneofgroup$, $type$value$rptvalueinit$$typeclose$, "
-      "opt_index);\n"
-      "};\n"
+      ");\n"
       "\n"
-      "\n",
-      "type", untyped ? "/** @type{string|number|boolean|!Uint8Array} */(" : "",
-      "typeclose", untyped ? ")" : "", "oneofgroup",
-      (InRealOneof(field) ? (", " + JSOneofArray(options, field)) : ""),
-      "rptvalueinit", "");
-  // clang-format on
+      "\n");
 }
 
-void Generator::GenerateRepeatedMessageHelperMethods(
+void Generator::GenerateClassBinaryCodecTableField(
     const GeneratorOptions& options, io::Printer* printer,
     const FieldDescriptor* field) const {
+  // The layout of table entries is documented in binary/codec.js. Field types
+  // are written as FieldDescriptor::Type values, which are the values of
+  // jspb.BinaryConstants.FieldType.
+  const std::string classname =
+      GetMessagePath(options, field->containing_type());
+  bool raw_value = HasFieldPresence(options, field) &&
+                   field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE;
+
+  std::string setter = "null";
+  std::string extra;
+  if (field->is_map()) {
+    const FieldDescriptor* key_field = MapFieldKey(field);
+    const FieldDescriptor* value_field = MapFieldValue(field);
+    // Only the String and BigInt flags apply to map keys and values.
+    const int value_flags = kBinaryCodecString | kBinaryCodecBigInt;
+    extra = StrCat(", [", static_cast<int>(key_field->type()), ", ",
+                   BinaryCodecFlags(options, key_field) & value_flags, ", ");
+    StrAppend(&extra, static_cast<int>(value_field->type()), ", ",
+              BinaryCodecFlags(options, value_field) & value_flags, ", ");
+    StrAppend(&extra, JSFieldDefault(options, key_field), ", ");
+    if (value_field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      extra += GetMessagePath(options, value_field->message_type());
+    } else {
+      extra += JSFieldDefault(options, value_field);
+    }
+    extra += "]";
+  } else {
+    if (field->is_repeated()) {
+      setter = StrCat(classname, ".prototype.add",
+                      JSGetterName(options, field, BYTES_DEFAULT,
+                                   /* drop_list = */ true));
+    } else {
+      setter =
+          StrCat(classname, ".prototype.set", JSGetterName(options, field));
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      extra = ", " + SubmessageTypeRef(options, field);
+    }
+  }
+
+  printer->Print(
+      "    [$number$, $type$, $flags$, $index$, $getter$, $setter$$extra$]",
+      "number", StrCat(field->number()), "type",
+      StrCat(static_cast<int>(field->type())),
+      "flags", StrCat(BinaryCodecFlags(options, field)), "index",
+      JSFieldIndex(options, field), "getter",
+      raw_value ? "null"
+                : StrCat(classname, ".prototype.get",
+                         JSGetterName(options, field, BYTES_U8)),
+      "setter", setter, "extra", extra);
+}
+
+void Generator::GenerateClassFieldMask(const GeneratorOptions& options,
+                                       io::Printer* printer,
+                                       const Descriptor* desc) const {
   printer->Print(
       "/**\n"
-      " * @param {!$optionaltype$=} opt_value\n"
-      " * @param {number=} opt_index\n"
-      " * @return {!$optionaltype$}\n"
+      " * Returns the fields of the message by name, for compiling field\n"
+      " * masks: the field number and, for message fields, the message type.\n"
+      " * @return {!Object<string, !Array>}\n"
       " */\n"
-      "$class$.prototype.$addername$ = function(opt_value, opt_index) {\n"
-      "  return jspb.Message.addTo$repeatedtag$WrapperField(",
-      "optionaltype", JSTypeName(options, field, BYTES_DEFAULT), "class",
-      GetMessagePath(options, field->containing_type()), "addername",
-      "add" + JSGetterName(options, field, BYTES_DEFAULT,
-                           /* drop_list = */ true),
-      "repeatedtag", (field->is_repeated() ? "Repeated" : ""));
-
-  printer->Annotate("addername", field);
+      "$class$.getFieldMaskFields = function() {\n"
+      "  return {",
+      "class", GetMessagePath(options, desc));
+  bool first = true;
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    if (IgnoreField(field)) {
+      continue;
+    }
+    printer->Print("$sep$\n    '$name$': [$number$", "sep", first ? "" : ",",
+                   "name", field->name(), "number", StrCat(field->number()));
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+        !field->is_map()) {
+      printer->Print(", $fieldclass$", "fieldclass",
+                     SubmessageTypeRef(options, field));
+    }
+    printer->Print("]");
+    first = false;
+  }
   printer->Print(
-      "this, $index$$oneofgroup$, opt_value, $ctor$, opt_index);\n"
+      "\n"
+      "  };\n"
+      "};\n"
+      "\n"
+      "\n"
+      "/**\n"
+      " * Compiles field mask paths (field names separated by dots, as in\n"
+      " * google.protobuf.FieldMask) for deserializeBinaryPartial().\n"
+      " * @param {!Array<string>} paths\n"
+      " * @return {!jspb.BinaryProjection}\n"
+      " */\n"
+      "$class$.compileFieldMask = function(paths) {\n"
+      "  return jspb.BinaryProjection.compile($class$, paths);\n"
+      "};\n"
+      "\n"
+      "\n"
+      "/**\n"
+      " * Deserializes only the fields selected by the given field mask from\n"
+      " * binary data (in protobuf wire format), skipping all other fields.\n"
+      " * @param {jspb.ByteSource} bytes The bytes to deserialize.\n"
+      " * @param {!jspb.BinaryProjection|!Array<string>} mask The field mask,\n"
+      " *     preferably compiled once with compileFieldMask().\n"
+      " * @return {!$class$}\n"
+      " */\n"
+      "$class$.deserializeBinaryPartial = function(bytes, mask) {\n"
+      "  var reader = new jspb.BinaryReader(bytes);\n"
+      "  var msg = new $class$;\n"
+      "  return $class$.deserializeBinaryFromReader(msg, reader,\n"
+      "      mask instanceof jspb.BinaryProjection ? mask :\n"
+      "                                              "
+      "$class$.compileFieldMask(mask));\n"
       "};\n"
       "\n"
       "\n",
-      "index", JSFieldIndex(field), "oneofgroup",
-      (InRealOneof(field) ? (", " + JSOneofArray(options, field)) : ""), "ctor",
-      GetMessagePath(options, field->message_type()));
+      "class", GetMessagePath(options, desc));
 }
 
-void Generator::GenerateClassExtensionFieldInfo(const GeneratorOptions& options,
-                                                io::Printer* printer,
-                                                const Descriptor* desc) const {
-  if (IsExtendable(desc)) {
+void Generator::GenerateClassJson(const GeneratorOptions& options,
+                                  io::Printer* printer,
+                                  const Descriptor* desc) const {
+  printer->Print(
+      "/**\n"
+      " * Serializes the message to JSON, in the canonical proto3 JSON\n"
+      " * mapping.\n"
+      " * @param {!jspb.JsonOptions=} opt_options The type registry of the\n"
+      " *     options is needed for google.protobuf.Any fields.\n"
+      " * @return {string}\n"
+      " */\n"
+      "$class$.prototype.toJsonString = function(opt_options) {\n"
+      "  var writer = new jspb.JsonWriter(opt_options);\n"
+      "  $class$.serializeJsonToWriter(this, writer);\n"
+      "  return writer.getResultString();\n"
+      "};\n"
+      "\n"
+      "\n"
+      "/**\n"
+      " * Deserializes JSON in the proto3 JSON mapping into a new message.\n"
+      " * @param {string} json The JSON to deserialize.\n"
+      " * @param {!jspb.JsonOptions=} opt_options\n"
+      " * @return {!$class$}\n"
+      " */\n"
+      "$class$.fromJsonString = function(json, opt_options) {\n"
+      "  var msg = new $class$;\n"
+      "  return $class$.deserializeJsonFromReader(\n"
+      "      msg, JSON.parse(json), new jspb.JsonReader(opt_options));\n"
+      "};\n"
+      "\n"
+      "\n"
+      "/**\n"
+      " * Serializes the given message to proto3 JSON, writing to the given\n"
+      " * JsonWriter.\n"
+      " * @param {!$class$} message\n"
+      " * @param {!jspb.JsonWriter} writer\n"
+      " * @suppress {unusedLocalVariables} f is only used for nested messages\n"
+      " */\n"
+      "$class$.serializeJsonToWriter = function(message, writer) {\n",
+      "class", GetMessagePath(options, desc));
+  if (!GenerateClassSerializeJsonWellKnownType(options, printer, desc)) {
     printer->Print(
-        "\n"
-        "/**\n"
-        " * The extensions registered with this message class. This is a "
-        "map of\n"
-        " * extension field number to fieldInfo object.\n"
-        " *\n"
-        " * For example:\n"
-        " *     { 123: {fieldIndex: 123, fieldName: {my_field_name: 0}, "
-        "ctor: proto.example.MyMessage} }\n"
-        " *\n"
-        " * fieldName contains the JsCompiler renamed field name property "
-        "so that it\n"
-        " * works in OPTIMIZED mode.\n"
-        " *\n"
-        " * @type {!Object<number, jspb.ExtensionFieldInfo>}\n"
-        " */\n"
-        "$class$.extensions = {};\n"
-        "\n",
-        "class", GetMessagePath(options, desc));
+        "  var f = undefined;\n"
+        "  writer.beginObject();\n");
+    for (int i = 0; i < desc->field_count(); i++) {
+      if (!IgnoreField(desc->field(i))) {
+        GenerateClassSerializeJsonField(options, printer, desc->field(i));
+      }
+    }
+    printer->Print("  writer.endObject();\n");
+  }
+  printer->Print(
+      "};\n"
+      "\n"
+      "\n"
+      "/**\n"
+      " * Deserializes parsed proto3 JSON into the given message object,\n"
+      " * with the given JsonReader.\n"
+      " * @param {!$class$} msg The message object to deserialize into.\n"
+      " * @param {*} value The parsed JSON.\n"
+      " * @param {!jspb.JsonReader} reader\n"
+      " * @return {!$class$}\n"
+      " * @suppress {unusedLocalVariables} Not all fields use i, k and map\n"
+      " */\n"
+      "$class$.deserializeJsonFromReader = function(msg, value, reader) {\n",
+      "class", GetMessagePath(options, desc));
+  if (!GenerateClassDeserializeJsonWellKnownType(options, printer, desc)) {
+    printer->Print(
+        "  var f, i, k, map;\n"
+        "  reader.checkObject(value);\n"
+        "  for (var key in value) {\n"
+        "    f = value[key];\n"
+        "    switch (key) {\n");
+    for (int i = 0; i < desc->field_count(); i++) {
+      if (!IgnoreField(desc->field(i))) {
+        GenerateClassDeserializeJsonField(options, printer, desc->field(i));
+      }
+    }
+    printer->Print(
+        "    default:\n"
+        "      reader.unknownField(key);\n"
+        "    }\n"
+        "  }\n");
+  }
+  printer->Print(
+      "  return msg;\n"
+      "};\n"
+      "\n"
+      "\n");
+}
 
+void Generator::GenerateClassSerializeJsonField(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field) const {
+  GenerateSerializedFieldCheck(options, printer, field, BYTES_DEFAULT);
+  printer->Print("    writer.writeName($name$);\n", "name",
+                 JSJsonNameLiteral(field->json_name()));
+  if (field->is_map()) {
+    const FieldDescriptor* value_field = MapFieldValue(field);
     printer->Print(
-        "\n"
-        "/**\n"
-        " * The extensions registered with this message class. This is a "
-        "map of\n"
-        " * extension field number to fieldInfo object.\n"
-        " *\n"
-        " * For example:\n"
-        " *     { 123: {fieldIndex: 123, fieldName: {my_field_name: 0}, "
-        "ctor: proto.example.MyMessage} }\n"
-        " *\n"
-        " * fieldName contains the JsCompiler renamed field name property "
-        "so that it\n"
-        " * works in OPTIMIZED mode.\n"
-        " *\n"
-        " * @type {!Object<number, jspb.ExtensionFieldBinaryInfo>}\n"
-        " */\n"
-        "$class$.extensionsBinary = {};\n"
-        "\n",
-        "class", GetMessagePath(options, desc));
+        "    f.serializeJson(\n"
+        "        writer, jspb.JsonWriter.prototype.write$type$$args$);\n",
+        "type", JSJsonMethodType(options, value_field, /* is_reader = */ false),
+        "args", JSJsonWriterArgs(options, value_field));
+  } else if (field->is_repeated()) {
+    printer->Print(
+        "    writer.writeArray(\n"
+        "        f, jspb.JsonWriter.prototype.write$type$$args$);\n",
+        "type", JSJsonMethodType(options, field, /* is_reader = */ false),
+        "args", JSJsonWriterArgs(options, field));
+  } else {
+    printer->Print("    writer.write$type$(f$args$);\n", "type",
+                   JSJsonMethodType(options, field, /* is_reader = */ false),
+                   "args", JSJsonWriterArgs(options, field));
+  }
+  printer->Print("  }\n");
+}
+
+void Generator::GenerateClassDeserializeJsonField(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field) const {
+  // Parsers accept both the JSON name of a field and its name in the .proto.
+  printer->Print("    case $name$:\n", "name",
+                 JSJsonNameLiteral(field->json_name()));
+  if (field->json_name() != field->name()) {
+    printer->Print("    case $name$:\n", "name",
+                   JSJsonNameLiteral(field->name()));
+  }
+  // null stands for the default value, except for Value and NullValue.
+  const bool skip_null = field->is_repeated() || !JsonNullIsValue(field);
+  if (skip_null) {
+    printer->Print("      if (f !== null) {\n");
+    printer->Indent();
+  }
+  if (field->is_map()) {
+    const FieldDescriptor* key_field = MapFieldKey(field);
+    std::string key = "k";
+    if (key_field->type() == FieldDescriptor::TYPE_BOOL) {
+      key = "reader.readBoolKey(k)";
+    } else if (key_field->type() != FieldDescriptor::TYPE_STRING) {
+      key = JSJsonReadExpression(options, key_field, "k");
+    }
+    printer->Print(
+        "      reader.checkObject(f);\n"
+        "      map = msg.get$name$();\n"
+        "      for (k in f) {\n"
+        "        map.set($key$, $value$);\n"
+        "      }\n",
+        "name", JSGetterName(options, field), "key", key, "value",
+        JSJsonReadExpression(options, MapFieldValue(field), "f[k]"));
+  } else if (field->is_repeated()) {
+    printer->Print(
+        "      reader.checkArray(f);\n"
+        "      for (i = 0; i < f.length; i++) {\n"
+        "        msg.add$name$($value$);\n"
+        "      }\n",
+        "name",
+        JSGetterName(options, field, BYTES_DEFAULT, /* drop_list = */ true),
+        "value", JSJsonReadExpression(options, field, "f[i]"));
+  } else {
+    printer->Print("      msg.set$name$($value$);\n", "name",
+                   JSGetterName(options, field), "value",
+                   JSJsonReadExpression(options, field, "f"));
+  }
+  if (skip_null) {
+    printer->Outdent();
+    printer->Print("      }\n");
+  }
+  printer->Print("      break;\n");
+}
+
+bool Generator::GenerateClassSerializeJsonWellKnownType(
+    const GeneratorOptions& options, io::Printer* printer,
+    const Descriptor* desc) const {
+  const FileDescriptor* file = desc->file();
+  switch (GetJsonForm(desc)) {
+    case kJsonFields:
+      return false;
+    case kJsonAny:
+      printer->Print(
+          "  writer.writeAny(message.getTypeUrl(), "
+          "message.getValue_asU8());\n");
+      return true;
+    case kJsonDuration:
+      printer->Print(
+          "  writer.writeDuration(message.getSeconds(), "
+          "message.getNanos());\n");
+      return true;
+    case kJsonFieldMask:
+      printer->Print("  writer.writeFieldMask(message.getPathsList());\n");
+      return true;
+    case kJsonListValue:
+      printer->Print(
+          "  writer.writeArray(\n"
+          "      message.getValuesList(), "
+          "jspb.JsonWriter.prototype.writeMessage,\n"
+          "      $value$.serializeJsonToWriter);\n",
+          "value",
+          GetMessagePath(options, file->FindMessageTypeByName("Value")));
+      return true;
+    case kJsonStruct:
+      printer->Print(
+          "  message.getFieldsMap().serializeJson(\n"
+          "      writer, jspb.JsonWriter.prototype.writeMessage,\n"
+          "      $value$.serializeJsonToWriter);\n",
+          "value",
+          GetMessagePath(options, file->FindMessageTypeByName("Value")));
+      return true;
+    case kJsonTimestamp:
+      printer->Print(
+          "  writer.writeTimestamp(message.getSeconds(), "
+          "message.getNanos());\n");
+      return true;
+    case kJsonValue:
+      printer->Print(
+          "  var kindCase = $class$.KindCase;\n"
+          "  switch (message.getKindCase()) {\n"
+          "  case kindCase.NUMBER_VALUE:\n"
+          "    writer.writeDouble(message.getNumberValue());\n"
+          "    break;\n"
+          "  case kindCase.STRING_VALUE:\n"
+          "    writer.writeString(message.getStringValue());\n"
+          "    break;\n"
+          "  case kindCase.BOOL_VALUE:\n"
+          "    writer.writeBool(message.getBoolValue());\n"
+          "    break;\n"
+          "  case kindCase.STRUCT_VALUE:\n"
+          "    writer.writeMessage(\n"
+          "        message.getStructValue(), $struct$.serializeJsonToWriter);\n"
+          "    break;\n"
+          "  case kindCase.LIST_VALUE:\n"
+          "    writer.writeMessage(\n"
+          "        message.getListValue(), $list$.serializeJsonToWriter);\n"
+          "    break;\n"
+          "  default:\n"
+          "    // NULL_VALUE, and a Value without a kind.\n"
+          "    writer.writeNullValue();\n"
+          "  }\n",
+          "class", GetMessagePath(options, desc), "struct",
+          GetMessagePath(options, file->FindMessageTypeByName("Struct")),
+          "list",
+          GetMessagePath(options, file->FindMessageTypeByName("ListValue")));
+      return true;
+    case kJsonWrapper:
+      printer->Print("  writer.write$type$(message.getValue());\n", "type",
+                     JSJsonMethodType(options, desc->FindFieldByName("value"),
+                                      /* is_reader = */ false));
+      return true;
   }
+  return false;
 }
 
-void Generator::GenerateClassDeserializeBinary(const GeneratorOptions& options,
-                                               io::Printer* printer,
-                                               const Descriptor* desc) const {
-  // TODO(cfallin): Handle lazy decoding when requested by field option and/or
-  // by default for 'bytes' fields and packed repeated fields.
+bool Generator::GenerateClassDeserializeJsonWellKnownType(
+    const GeneratorOptions& options, io::Printer* printer,
+    const Descriptor* desc) const {
+  const FileDescriptor* file = desc->file();
+  JsonForm form = GetJsonForm(desc);
+  switch (form) {
+    case kJsonFields:
+      return false;
+    case kJsonAny:
+      printer->Print(
+          "  var any = reader.readAny(value);\n"
+          "  msg.setTypeUrl(/** @type {string} */ (any[0]));\n"
+          "  msg.setValue(any[1]);\n");
+      return true;
+    case kJsonDuration:
+    case kJsonTimestamp: {
+      // The seconds are read as a number, and stored in the field's JS type.
+      const FieldDescriptor* seconds = desc->FindFieldByName("seconds");
+      std::string value = "time[0]";
+      if (IsIntegralFieldWithBigIntJSType(options, seconds)) {
+        value = "BigInt(time[0])";
+      } else if (IsIntegralFieldWithStringJSType(seconds)) {
+        value = "String(time[0])";
+      }
+      printer->Print(
+          "  var time = reader.read$type$(value);\n"
+          "  msg.setSeconds($seconds$);\n"
+          "  msg.setNanos(time[1]);\n",
+          "type", form == kJsonDuration ? "Duration" : "Timestamp", "seconds",
+          value);
+      return true;
+    }
+    case kJsonFieldMask:
+      printer->Print("  msg.setPathsList(reader.readFieldMask(value));\n");
+      return true;
+    case kJsonListValue:
+      printer->Print(
+          "  reader.checkArray(value);\n"
+          "  for (var i = 0; i < value.length; i++) {\n"
+          "    msg.addValues($value$.deserializeJsonFromReader(\n"
+          "        new $value$(), value[i], reader));\n"
+          "  }\n",
+          "value",
+          GetMessagePath(options, file->FindMessageTypeByName("Value")));
+      return true;
+    case kJsonStruct:
+      printer->Print(
+          "  reader.checkObject(value);\n"
+          "  var map = msg.getFieldsMap();\n"
+          "  for (var key in value) {\n"
+          "    map.set(key, $value$.deserializeJsonFromReader(\n"
+          "        new $value$(), value[key], reader));\n"
+          "  }\n",
+          "value",
+          GetMessagePath(options, file->FindMessageTypeByName("Value")));
+      return true;
+    case kJsonValue:
+      printer->Print(
+          "  if (value === null) {\n"
+          "    msg.setNullValue($null$.NULL_VALUE);\n"
+          "  } else if (typeof value == 'number') {\n"
+          "    msg.setNumberValue(value);\n"
+          "  } else if (typeof value == 'string') {\n"
+          "    msg.setStringValue(value);\n"
+          "  } else if (typeof value == 'boolean') {\n"
+          "    msg.setBoolValue(value);\n"
+          "  } else if (Array.isArray(value)) {\n"
+          "    msg.setListValue($list$.deserializeJsonFromReader(\n"
+          "        new $list$(), value, reader));\n"
+          "  } else {\n"
+          "    msg.setStructValue($struct$.deserializeJsonFromReader(\n"
+          "        new $struct$(), value, reader));\n"
+          "  }\n",
+          "null", GetEnumPath(options, file->FindEnumTypeByName("NullValue")),
+          "struct",
+          GetMessagePath(options, file->FindMessageTypeByName("Struct")),
+          "list",
+          GetMessagePath(options, file->FindMessageTypeByName("ListValue")));
+      return true;
+    case kJsonWrapper:
+      printer->Print("  msg.setValue($value$);\n", "value",
+                     JSJsonReadExpression(
+                         options, desc->FindFieldByName("value"), "value"));
+      return true;
+  }
+  return false;
+}
 
+void Generator::GenerateClassMapEntryReader(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field) const {
+  const FieldDescriptor* key_field = MapFieldKey(field);
+  const FieldDescriptor* value_field = MapFieldValue(field);
+  const bool message_value =
+      value_field->type() == FieldDescriptor::TYPE_MESSAGE;
+  // Entries are read into locals and stored with a single Map.set(), so that
+  // no closure is created per entry and the default value message is only
+  // allocated when the entry has no value.
   printer->Print(
       "/**\n"
-      " * Deserializes binary data (in protobuf wire format).\n"
-      " * @param {jspb.ByteSource} bytes The bytes to deserialize.\n"
-      " * @return {!$class$}\n"
-      " */\n"
-      "$class$.deserializeBinary = function(bytes) {\n"
-      "  var reader = new jspb.BinaryReader(bytes);\n"
-      "  var msg = new $class$;\n"
-      "  return $class$.deserializeBinaryFromReader(msg, reader);\n"
-      "};\n"
-      "\n"
-      "\n"
-      "/**\n"
-      " * Deserializes binary data (in protobuf wire format) from the\n"
-      " * given reader into the given message object.\n"
-      " * @param {!$class$} msg The message object to deserialize into.\n"
-      " * @param {!jspb.BinaryReader} reader The BinaryReader to use.\n"
-      " * @return {!$class$}\n"
+      " * Reads one entry of the map field $name$ into the given map.\n"
+      " * @param {!jspb.Map<$keytype$,$valuetype$>} map\n"
+      " * @param {!jspb.BinaryReader} reader\n"
+      " * @private\n"
       " */\n"
-      "$class$.deserializeBinaryFromReader = function(msg, reader) {\n"
-      "  while (reader.nextField()) {\n",
-      "class", GetMessagePath(options, desc));
-  printer->Print(
+      "$class$.read$gettername$Entry_ = function(map, reader) {\n"
+      "  var key = $keydefault$;\n"
+      "  var value = $valuedefault$;\n"
+      "  while (reader.nextField()) {\n"
       "    if (reader.isEndGroup()) {\n"
       "      break;\n"
       "    }\n"
-      "    var field = reader.getFieldNumber();\n"
-      "    switch (field) {\n");
-
-  for (int i = 0; i < desc->field_count(); i++) {
-    if (!IgnoreField(desc->field(i))) {
-      GenerateClassDeserializeBinaryField(options, printer, desc->field(i));
-    }
-  }
-
-  printer->Print("    default:\n");
-  if (IsExtendable(desc)) {
+      "    switch (reader.getFieldNumber()) {\n"
+      "    case 1:\n"
+      "      key = reader.read$keyreader$();\n"
+      "      break;\n"
+      "    case 2:\n",
+      "name", field->name(), "keytype",
+      JSFieldTypeAnnotation(options, key_field,
+                            /* is_setter_argument = */ false,
+                            /* force_present = */ true,
+                            /* singular_if_not_packed = */ false),
+      "valuetype",
+      JSFieldTypeAnnotation(options, value_field,
+                            /* is_setter_argument = */ false,
+                            /* force_present = */ true,
+                            /* singular_if_not_packed = */ false),
+      "class", GetMessagePath(options, field->containing_type()),
+      "gettername", JSGetterName(options, field), "keydefault",
+      JSFieldDefault(options, key_field), "valuedefault",
+      message_value ? "null" : JSFieldDefault(options, value_field),
+      "keyreader",
+      JSBinaryReadWriteMethodName(options, key_field, /* is_writer = */ false));
+  if (message_value) {
     printer->Print(
-        "      jspb.Message.readBinaryExtension(msg, reader,\n"
-        "        $extobj$Binary,\n"
-        "        $class$.prototype.getExtension,\n"
-        "        $class$.prototype.setExtension);\n"
-        "      break;\n"
-        "    }\n",
-        "extobj", JSExtensionsObjectName(options, desc->file(), desc), "class",
-        GetMessagePath(options, desc));
+        "      if (value == null) {\n"
+        "        value = new $valuetype$();\n"
+        "      }\n"
+        "      reader.readMessage(value, "
+        "$valuetype$.deserializeBinaryFromReader);\n",
+        "valuetype", GetMessagePath(options, value_field->message_type()));
   } else {
+    printer->Print("      value = reader.read$valuereader$();\n",
+                   "valuereader",
+                   JSBinaryReadWriteMethodName(options, value_field,
+                                               /* is_writer = */ false));
+  }
+  printer->Print(
+      "      break;\n"
+      "    default:\n"
+      "      reader.skipField();\n"
+      "      break;\n"
+      "    }\n"
+      "  }\n");
+  if (message_value) {
     printer->Print(
-        "      reader.skipField();\n"
-        "      break;\n"
-        "    }\n");
+        "  map.set(key, value == null ? new $valuetype$() : value);\n",
+        "valuetype", GetMessagePath(options, value_field->message_type()));
+  } else {
+    printer->Print("  map.set(key, value);\n");
   }
+  printer->Print(
+      "};\n"
+      "\n"
+      "\n");
+}
 
+void Generator::GenerateClassMapEntryWriter(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field) const {
+  const FieldDescriptor* key_field = MapFieldKey(field);
+  const FieldDescriptor* value_field = MapFieldValue(field);
+  printer->Print(
+      "/**\n"
+      " * Writes the key and value of one entry of the map field $name$.\n"
+      " * @param {!jspb.BinaryWriter} writer\n"
+      " * @param {$keytype$} key\n"
+      " * @param {$valuetype$} value\n"
+      " * @private\n"
+      " */\n"
+      "$class$.write$gettername$Entry_ = function(writer, key, value) {\n"
+      "  writer.write$keywriter$(1, key);\n",
+      "name", field->name(), "keytype",
+      JSFieldTypeAnnotation(options, key_field,
+                            /* is_setter_argument = */ false,
+                            /* force_present = */ true,
+                            /* singular_if_not_packed = */ false),
+      "valuetype",
+      JSFieldTypeAnnotation(options, value_field,
+                            /* is_setter_argument = */ false,
+                            /* force_present = */ true,
+                            /* singular_if_not_packed = */ false),
+      "class", GetMessagePath(options, field->containing_type()),
+      "gettername", JSGetterName(options, field), "keywriter",
+      JSBinaryReadWriteMethodName(options, key_field, /* is_writer = */ true));
+  if (value_field->type() == FieldDescriptor::TYPE_MESSAGE) {
+    printer->Print(
+        "  writer.writeMessage(2, value, "
+        "$valuetype$.serializeBinaryToWriter);\n",
+        "valuetype", GetMessagePath(options, value_field->message_type()));
+  } else {
+    printer->Print("  writer.write$valuewriter$(2, value);\n", "valuewriter",
+                   JSBinaryReadWriteMethodName(options, value_field,
+                                               /* is_writer = */ true));
+  }
   printer->Print(
-      "  }\n"
-      "  return msg;\n"
       "};\n"
       "\n"
       "\n");
@@ -3078,61 +6191,75 @@ void Generator::GenerateClassDeserializeBinary(const GeneratorOptions& options,
 
 void Generator::GenerateClassDeserializeBinaryField(
     const GeneratorOptions& options, io::Printer* printer,
-    const FieldDescriptor* field) const {
+    const FieldDescriptor* field, const FieldDescriptor* next_field) const {
   printer->Print("    case $num$:\n", "num", StrCat(field->number()));
 
-  if (field->is_map()) {
-    const FieldDescriptor* key_field = MapFieldKey(field);
-    const FieldDescriptor* value_field = MapFieldValue(field);
-    printer->Print(
-        "      var value = msg.get$name$();\n"
-        "      reader.readMessage(value, function(message, reader) {\n",
-        "name", JSGetterName(options, field));
+  // With expected_tags, the values of an unpacked repeated field are read in
+  // a loop for as long as the input repeats the field. The early break of
+  // lazy fields must leave the switch, so they are not looped.
+  const bool lazy = IsLazyField(options, field);
+  const int tag = options.expected_tags ? ExpectedTag(field) : -1;
+  const bool loop =
+      tag >= 0 && !lazy && field->is_repeated() && !field->is_packed();
+  if (loop) {
+    printer->Print("      do {\n");
+    printer->Indent();
+  }
 
+  if (lazy) {
     printer->Print(
-        "        jspb.Map.deserializeBinary(message, reader, "
-        "$keyReaderFn$, $valueReaderFn$",
-        "keyReaderFn", JSBinaryReaderMethodName(options, key_field),
-        "valueReaderFn", JSBinaryReaderMethodName(options, value_field));
+        "      if (jspb.Message.readLazyField(msg, reader,\n"
+        "          $class$.deserializeBinaryFromReader$repeated$)) {\n"
+        "        break;\n"
+        "      }\n",
+        "class", GetMessagePath(options, field->containing_type()),
+        "repeated", field->is_repeated() ? ", true" : "");
+  }
 
-    if (value_field->type() == FieldDescriptor::TYPE_MESSAGE) {
-      printer->Print(", $messageType$.deserializeBinaryFromReader",
-                     "messageType",
-                     GetMessagePath(options, value_field->message_type()));
-    } else {
-      printer->Print(", null");
-    }
-    printer->Print(", $defaultKey$", "defaultKey", JSFieldDefault(key_field));
-    if (value_field->type() == FieldDescriptor::TYPE_MESSAGE) {
-      printer->Print(", new $messageType$()", "messageType",
-                     GetMessagePath(options, value_field->message_type()));
-    } else {
-      printer->Print(", $defaultValue$", "defaultValue",
-                     JSFieldDefault(value_field));
-    }
-    printer->Print(");\n");
-    printer->Print("         });\n");
+  if (field->is_map()) {
+    printer->Print(
+        "      var value = msg.get$name$();\n"
+        "      reader.readMessage(value, $class$.read$name$Entry_);\n",
+        "name", JSGetterName(options, field), "class",
+        GetMessagePath(options, field->containing_type()));
   } else {
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      if (options.reuse) {
+        printer->Print(
+            "      var value = jspb.Message.reuseWrapperField(msg, $index$, "
+            "$fieldclass$);\n",
+            "fieldclass", SubmessageTypeRef(options, field), "index",
+            JSFieldIndex(options, field));
+      } else {
+        printer->Print("      var value = new $fieldclass$;\n", "fieldclass",
+                       SubmessageTypeRef(options, field));
+      }
       printer->Print(
-          "      var value = new $fieldclass$;\n"
           "      reader.read$msgOrGroup$($grpfield$value,"
-          "$fieldclass$.deserializeBinaryFromReader);\n",
+          "$fieldclass$.deserializeBinaryFromReader$projection$);\n",
           "fieldclass", SubmessageTypeRef(options, field), "msgOrGroup",
           (field->type() == FieldDescriptor::TYPE_GROUP) ? "Group" : "Message",
           "grpfield",
           (field->type() == FieldDescriptor::TYPE_GROUP)
               ? (StrCat(field->number()) + ", ")
+              : "",
+          "projection",
+          options.field_masks
+              ? StrCat(", opt_projection && opt_projection.child(",
+                       field->number(), ")")
               : "");
     } else if (field->is_packable()) {
       printer->Print(
           "      var values = /** @type {$fieldtype$} */ "
           "(reader.isDelimited() "
-          "? reader.readPacked$reader$() : [reader.read$reader$()]);\n",
+          "? reader.readPacked$packedreader$() : [reader.read$reader$()]);\n",
           "fieldtype",
           JSFieldTypeAnnotation(options, field, false, true,
                                 /* singular_if_not_packed */ false, BYTES_U8),
-          "reader", JSBinaryReaderMethodType(field));
+          "packedreader",
+          JSBinaryReaderMethodType(options, field) +
+              (JSTypedArrayType(options, field).empty() ? "" : "TypedArray"),
+          "reader", JSBinaryReaderMethodType(options, field));
     } else {
       printer->Print(
           "      var value = /** @type {$fieldtype$} */ "
@@ -3141,16 +6268,15 @@ void Generator::GenerateClassDeserializeBinaryField(
           JSFieldTypeAnnotation(options, field, false, true,
                                 /* singular_if_not_packed */ true, BYTES_U8),
           "reader",
-          JSBinaryReadWriteMethodName(field, /* is_writer = */ false));
+          JSBinaryReadWriteMethodName(options, field, /* is_writer = */ false));
     }
 
     if (field->is_packable()) {
+      // Append the decoded values in one go, rather than through an add$name$
+      // call per value.
       printer->Print(
-          "      for (var i = 0; i < values.length; i++) {\n"
-          "        msg.add$name$(values[i]);\n"
-          "      }\n",
-          "name",
-          JSGetterName(options, field, BYTES_DEFAULT, /* drop_list = */ true));
+          "      jspb.Message.addAllToRepeatedField(msg, $index$, values);\n",
+          "index", JSFieldIndex(options, field));
     } else if (field->is_repeated()) {
       printer->Print(
           "      msg.add$name$(value);\n", "name",
@@ -3164,12 +6290,41 @@ void Generator::GenerateClassDeserializeBinaryField(
     }
   }
 
-  printer->Print("      break;\n");
+  if (loop) {
+    printer->Outdent();
+    printer->Print("      } while (reader.nextFieldIf($tag$));\n", "tag",
+                   StrCat(tag));
+  }
+  const int next_tag = options.expected_tags && next_field != nullptr
+                           ? ExpectedTag(next_field)
+                           : -1;
+  if (next_tag >= 0) {
+    // Continue with the case of the next field if the input holds it next.
+    // Partial decodes go through the projection check for every field.
+    printer->Print(
+        "      if ($projection$!reader.nextFieldIf($tag$)) {\n"
+        "        break;\n"
+        "      }\n"
+        "      // Falls through.\n",
+        "projection", options.field_masks ? "opt_projection || " : "", "tag",
+        StrCat(next_tag));
+  } else {
+    printer->Print("      break;\n");
+  }
 }
 
 void Generator::GenerateClassSerializeBinary(const GeneratorOptions& options,
                                              io::Printer* printer,
                                              const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileSerializeBinary);
+  if (options.codec != GeneratorOptions::kCodecTable) {
+    for (int i = 0; i < desc->field_count(); i++) {
+      if (!IgnoreField(desc->field(i)) && desc->field(i)->is_map()) {
+        GenerateClassMapEntryWriter(options, printer, desc->field(i));
+      }
+    }
+  }
+
   printer->Print(
       "/**\n"
       " * Serializes the message to binary data (in protobuf wire format).\n"
@@ -3181,22 +6336,115 @@ void Generator::GenerateClassSerializeBinary(const GeneratorOptions& options,
       "  return writer.getResultBuffer();\n"
       "};\n"
       "\n"
-      "\n"
+      "\n",
+      "class", GetMessagePath(options, desc));
+  if (options.sizing) {
+    printer->Print(
+        "/**\n"
+        " * Returns the size of the message in binary data (in protobuf wire\n"
+        " * format), without serializing it.\n"
+        " * @return {number}\n"
+        " */\n"
+        "$class$.prototype.computeSerializedSize = function() {\n"
+        "  var sizer = new jspb.BinarySizingWriter();\n"
+        "  $class$.serializeBinaryToWriter(this, sizer);\n"
+        "  return sizer.getLength();\n"
+        "};\n"
+        "\n"
+        "\n"
+        "/**\n"
+        " * Serializes the message to binary data (in protobuf wire format)\n"
+        " * directly into the given buffer, which must have room for\n"
+        " * computeSerializedSize() bytes at the given offset.\n"
+        " * @param {!Uint8Array} buffer The buffer to write to.\n"
+        " * @param {number=} opt_offset The offset to write at, or 0.\n"
+        " * @return {number} The offset after the serialized message.\n"
+        " */\n"
+        "$class$.prototype.serializeBinaryTo = function(buffer, opt_offset) {\n"
+        "  var sizer = new jspb.BinarySizingWriter();\n"
+        "  $class$.serializeBinaryToWriter(this, sizer);\n"
+        "  var writer = new jspb.BinaryPresizedWriter(sizer, buffer, "
+        "opt_offset);\n"
+        "  $class$.serializeBinaryToWriter(this, writer);\n"
+        "  return writer.getCursor();\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, desc));
+  }
+
+  if (options.writer_reuse) {
+    printer->Print(
+        "/**\n"
+        " * Serializes the message to binary data (in protobuf wire format)\n"
+        " * with the given reusable writer, e.g. a jspb.BinaryBufferWriter.\n"
+        " * @param {!jspb.BinaryWriter} writer\n"
+        " * @return {!Uint8Array}\n"
+        " */\n"
+        "$class$.prototype.serializeBinaryWith = function(writer) {\n"
+        "  return writer.serialize(this, $class$.serializeBinaryToWriter);\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, desc));
+  }
+
+  if (options.delimited) {
+    printer->Print(
+        "/**\n"
+        " * Serializes the message to binary data prefixed by its length, as\n"
+        " * one record of a stream read by deserializeDelimitedStream().\n"
+        " * @param {!jspb.BinaryWriter=} opt_writer The writer to use, e.g. a\n"
+        " *     reusable jspb.BinaryBufferWriter.\n"
+        " * @return {!Uint8Array}\n"
+        " */\n"
+        "$class$.prototype.serializeDelimited = function(opt_writer) {\n"
+        "  return (opt_writer || new jspb.BinaryWriter())"
+        ".serializeDelimited(\n"
+        "      this, $class$.serializeBinaryToWriter);\n"
+        "};\n"
+        "\n"
+        "\n",
+        "class", GetMessagePath(options, desc));
+  }
+
+  printer->Print(
       "/**\n"
       " * Serializes the given message to binary data (in protobuf wire\n"
       " * format), writing to the given BinaryWriter.\n"
       " * @param {!$class$} message\n"
-      " * @param {!jspb.BinaryWriter} writer\n"
+      " * @param {!jspb.BinaryWriter} writer\n",
+      "class", GetMessagePath(options, desc));
+  if (options.codec == GeneratorOptions::kCodecTable) {
+    printer->Print(
+        " */\n"
+        "$class$.serializeBinaryToWriter = function(message, writer) {\n",
+        "class", GetMessagePath(options, desc));
+    GenerateInstrumentationBeginEncode(options, printer);
+    printer->Print(
+        "  jspb.BinaryCodec.serialize(message, writer, "
+        "$class$.binaryCodecTable_);\n",
+        "class", GetMessagePath(options, desc));
+    GenerateInstrumentationEndEncode(options, printer, desc);
+    printer->Print(
+        "};\n"
+        "\n"
+        "\n");
+    return;
+  }
+
+  printer->Print(
       " * @suppress {unusedLocalVariables} f is only used for nested messages\n"
       " */\n"
       "$class$.serializeBinaryToWriter = function(message, "
       "writer) {\n"
       "  var f = undefined;\n",
       "class", GetMessagePath(options, desc));
+  GenerateInstrumentationBeginEncode(options, printer);
 
-  for (int i = 0; i < desc->field_count(); i++) {
-    if (!IgnoreField(desc->field(i))) {
-      GenerateClassSerializeBinaryField(options, printer, desc->field(i));
+  for (const FieldDescriptor* field : OrderedFields(options, desc)) {
+    if (!IgnoreField(field)) {
+      GenerateClassSerializeBinaryField(options, printer, field);
     }
   }
 
@@ -3208,6 +6456,7 @@ void Generator::GenerateClassSerializeBinary(const GeneratorOptions& options,
         GetMessagePath(options, desc));
   }
 
+  GenerateInstrumentationEndEncode(options, printer, desc);
   printer->Print(
       "};\n"
       "\n"
@@ -3217,97 +6466,32 @@ void Generator::GenerateClassSerializeBinary(const GeneratorOptions& options,
 void Generator::GenerateClassSerializeBinaryField(
     const GeneratorOptions& options, io::Printer* printer,
     const FieldDescriptor* field) const {
-  if (HasFieldPresence(options, field) &&
-      field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
-    std::string typed_annotation =
-        JSFieldTypeAnnotation(options, field,
-                              /* is_setter_argument = */ false,
-                              /* force_present = */ false,
-                              /* singular_if_not_packed = */ false,
-                              /* bytes_mode = */ BYTES_DEFAULT);
-    printer->Print(
-        "  f = /** @type {$type$} */ "
-        "(jspb.Message.getField(message, $index$));\n",
-        "index", JSFieldIndex(field), "type", typed_annotation);
-  } else {
+  // Lazy fields that were not decoded are written back from their wire bytes.
+  const bool lazy = IsLazyField(options, field);
+  if (lazy) {
     printer->Print(
-        "  f = message.get$name$($nolazy$);\n", "name",
-        JSGetterName(options, field, BYTES_U8),
-        // No lazy creation for maps containers -- fastpath the empty case.
-        "nolazy", field->is_map() ? "true" : "");
-  }
-
-  // Print an `if (condition)` statement that evaluates to true if the field
-  // goes on the wire.
-  if (field->is_map()) {
-    printer->Print("  if (f && f.getLength() > 0) {\n");
-  } else if (field->is_repeated()) {
-    printer->Print("  if (f.length > 0) {\n");
-  } else {
-    if (HasFieldPresence(options, field)) {
-      printer->Print("  if (f != null) {\n");
-    } else {
-      // No field presence: serialize onto the wire only if value is
-      // non-default.  Defaults are documented here:
-      // https://goto.google.com/lhdfm
-      switch (field->cpp_type()) {
-        case FieldDescriptor::CPPTYPE_INT32:
-        case FieldDescriptor::CPPTYPE_INT64:
-        case FieldDescriptor::CPPTYPE_UINT32:
-        case FieldDescriptor::CPPTYPE_UINT64: {
-          if (IsIntegralFieldWithStringJSType(field)) {
-            // We can use `parseInt` here even though it will not be precise for
-            // 64-bit quantities because we are only testing for zero/nonzero,
-            // and JS numbers (64-bit floating point values, i.e., doubles) are
-            // integer-precise in the range that includes zero.
-            printer->Print("  if (parseInt(f, 10) !== 0) {\n");
-          } else {
-            printer->Print("  if (f !== 0) {\n");
-          }
-          break;
-        }
-
-        case FieldDescriptor::CPPTYPE_ENUM:
-        case FieldDescriptor::CPPTYPE_FLOAT:
-        case FieldDescriptor::CPPTYPE_DOUBLE:
-          printer->Print("  if (f !== 0.0) {\n");
-          break;
-        case FieldDescriptor::CPPTYPE_BOOL:
-          printer->Print("  if (f) {\n");
-          break;
-        case FieldDescriptor::CPPTYPE_STRING:
-          printer->Print("  if (f.length > 0) {\n");
-          break;
-        default:
-          assert(false);
-          break;
-      }
-    }
+        "  if (!jspb.Message.serializeLazyField(message, $num$, writer)) {\n",
+        "num", StrCat(field->number()));
+    printer->Indent();
   }
 
+  GenerateSerializedFieldCheck(options, printer, field, BYTES_U8);
+
   // Write the field on the wire.
   if (field->is_map()) {
-    const FieldDescriptor* key_field = MapFieldKey(field);
-    const FieldDescriptor* value_field = MapFieldValue(field);
     printer->Print(
-        "    f.serializeBinary($index$, writer, "
-        "$keyWriterFn$, $valueWriterFn$",
-        "index", StrCat(field->number()), "keyWriterFn",
-        JSBinaryWriterMethodName(options, key_field), "valueWriterFn",
-        JSBinaryWriterMethodName(options, value_field));
-
-    if (value_field->type() == FieldDescriptor::TYPE_MESSAGE) {
-      printer->Print(", $messageType$.serializeBinaryToWriter", "messageType",
-                     GetMessagePath(options, value_field->message_type()));
-    }
-
-    printer->Print(");\n");
+        "    f.serializeBinaryEntries($index$, writer, "
+        "$class$.write$name$Entry_);\n",
+        "index", StrCat(field->number()), "class",
+        GetMessagePath(options, field->containing_type()), "name",
+        JSGetterName(options, field));
   } else {
     printer->Print(
         "    writer.write$method$(\n"
         "      $index$,\n"
         "      f",
-        "method", JSBinaryReadWriteMethodName(field, /* is_writer = */ true),
+        "method",
+        JSBinaryReadWriteMethodName(options, field, /* is_writer = */ true),
         "index", StrCat(field->number()));
 
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
@@ -3325,11 +6509,17 @@ void Generator::GenerateClassSerializeBinaryField(
 
   // Close the `if`.
   printer->Print("  }\n");
+
+  if (lazy) {
+    printer->Outdent();
+    printer->Print("  }\n");
+  }
 }
 
 void Generator::GenerateEnum(const GeneratorOptions& options,
                              io::Printer* printer,
                              const EnumDescriptor* enumdesc) const {
+  ScopedProfilePhase profile_phase(kProfileEnums);
   printer->Print(
       "/**\n"
       " * @enum {number}\n"
@@ -3338,7 +6528,40 @@ void Generator::GenerateEnum(const GeneratorOptions& options,
       "enumprefix", GetEnumPathPrefix(options, enumdesc), "name",
       enumdesc->name());
   printer->Annotate("name", enumdesc);
+  GenerateEnumValues(printer, enumdesc);
+  printer->Print(
+      "};\n"
+      "\n");
+
+  if (options.json) {
+    printer->Print(
+        "/**\n"
+        " * The names of the values of $enumprefix$$name$ by number, for\n"
+        " * proto3 JSON.\n"
+        " * @const {!Object<number, string>}\n"
+        " */\n"
+        "$enumprefix$$name$$$JsonNames = {",
+        "enumprefix", GetEnumPathPrefix(options, enumdesc), "name",
+        enumdesc->name());
+    // With aliases, the first name of a number is the one written.
+    std::set<int> numbers;
+    for (int i = 0; i < enumdesc->value_count(); i++) {
+      const EnumValueDescriptor* value = enumdesc->value(i);
+      if (numbers.insert(value->number()).second) {
+        printer->Print("$sep$\n  $number$: '$name$'", "sep",
+                       numbers.size() > 1 ? "," : "", "number",
+                       StrCat(value->number()), "name", value->name());
+      }
+    }
+    printer->Print(
+        "\n"
+        "};\n"
+        "\n");
+  }
+}
 
+void Generator::GenerateEnumValues(io::Printer* printer,
+                                   const EnumDescriptor* enumdesc) const {
   std::set<std::string> used_name;
   std::vector<int> valid_index;
   for (int i = 0; i < enumdesc->value_count(); i++) {
@@ -3355,88 +6578,569 @@ void Generator::GenerateEnum(const GeneratorOptions& options,
                    "comma", (i == valid_index.back()) ? "" : ",");
     printer->Annotate("name", value);
   }
-
-  printer->Print(
-      "};\n"
-      "\n");
 }
 
 void Generator::GenerateExtension(const GeneratorOptions& options,
                                   io::Printer* printer,
                                   const FieldDescriptor* field) const {
+  ScopedProfilePhase profile_phase(kProfileExtensions);
   std::string extension_scope =
       (field->extension_scope()
            ? GetMessagePath(options, field->extension_scope())
            : GetNamespace(options, field->file()));
 
   const std::string extension_object_name = JSObjectFieldName(options, field);
+  if (options.lazy_init) {
+    printer->Print(
+        "\n"
+        "jspb.Message.defineLazy($class$, '$name$', function() {",
+        "class", extension_scope, "name", extension_object_name);
+    printer->Indent();
+  }
+  printer->Print(
+      "\n"
+      "/**\n"
+      " * A tuple of {field number, class constructor} for the extension\n"
+      " * field named `$nameInComment$`.\n"
+      " * @type {!jspb.ExtensionFieldInfo<$extensionType$>}\n"
+      " */\n"
+      "$class$.$name$ = new jspb.ExtensionFieldInfo(\n",
+      "nameInComment", extension_object_name, "name", extension_object_name,
+      "class", extension_scope, "extensionType",
+      JSFieldTypeAnnotation(options, field,
+                            /* is_setter_argument = */ false,
+                            /* force_present = */ true,
+                            /* singular_if_not_packed = */ false));
+  printer->Annotate("name", field);
+  printer->Print(
+      "    $index$,\n"
+      "    {$name$: 0},\n"
+      "    $ctor$,\n"
+      "     /** @type {?function((boolean|undefined),!jspb.Message=): "
+      "!Object} */ (\n"
+      "         $toObject$),\n"
+      "    $repeated$);\n",
+      "index", StrCat(field->number()), "name", extension_object_name, "ctor",
+      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
+           ? SubmessageTypeRef(options, field)
+           : std::string("null")),
+      "toObject",
+      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
+           ? (SubmessageTypeRef(options, field) + ".toObject")
+           : std::string("null")),
+      "repeated", (field->is_repeated() ? "1" : "0"));
+
+  if (options.lazy_init) {
+    // Registered by GenerateFile(), once the extended message is installed.
+    printer->Outdent();
+    printer->Print("});\n");
+    return;
+  }
+  GenerateExtensionRegistration(options, printer, field);
+}
+
+void Generator::GenerateLazyExtensionRegistration(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field) const {
+  const Descriptor* extendee = field->containing_type();
+  if (extendee->full_name() == "google.protobuf.bridge.MessageSet") {
+    GenerateExtensionRegistration(options, printer, field);
+    return;
+  }
+  // Nested messages are installed along with their top-level message.
+  while (extendee->containing_type() != nullptr) {
+    extendee = extendee->containing_type();
+  }
+  std::string path = MaybeCrossFileRef(options, field->file(), extendee);
+  size_t dot = path.rfind('.');
+  printer->Print(
+      "\n"
+      "jspb.Message.onLazyInit($namespace$, '$name$', function() {",
+      "namespace", path.substr(0, dot), "name", path.substr(dot + 1));
+  printer->Indent();
+  GenerateExtensionRegistration(options, printer, field);
+  printer->Outdent();
+  printer->Print("});\n");
+}
+
+void Generator::GenerateExtensionRegistration(
+    const GeneratorOptions& options, io::Printer* printer,
+    const FieldDescriptor* field) const {
+  std::string extension_scope =
+      (field->extension_scope()
+           ? GetMessagePath(options, field->extension_scope())
+           : GetNamespace(options, field->file()));
+  const std::string extension_object_name = JSObjectFieldName(options, field);
+  printer->Print(
+      "\n"
+      "$extendName$Binary[$index$] = new jspb.ExtensionFieldBinaryInfo(\n"
+      "    $class$.$name$,\n"
+      "    $binaryReaderFn$,\n"
+      "    $binaryWriterFn$,\n"
+      "    $binaryMessageSerializeFn$,\n"
+      "    $binaryMessageDeserializeFn$,\n",
+      "extendName",
+      JSExtensionsObjectName(options, field->file(), field->containing_type()),
+      "index", StrCat(field->number()), "class", extension_scope, "name",
+      extension_object_name, "binaryReaderFn",
+      JSBinaryReaderMethodName(options, field), "binaryWriterFn",
+      JSBinaryWriterMethodName(options, field), "binaryMessageSerializeFn",
+      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE)
+          ? (SubmessageTypeRef(options, field) + ".serializeBinaryToWriter")
+          : "undefined",
+      "binaryMessageDeserializeFn",
+      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE)
+          ? (SubmessageTypeRef(options, field) + ".deserializeBinaryFromReader")
+          : "undefined");
+
+  printer->Print("    $isPacked$);\n", "isPacked",
+                 (field->is_packed() ? "true" : "false"));
+
+  printer->Print(
+      "// This registers the extension field with the extended class, so that\n"
+      "// toObject() will function correctly.\n"
+      "$extendName$[$index$] = $class$.$name$;\n"
+      "\n",
+      "extendName",
+      JSExtensionsObjectName(options, field->file(), field->containing_type()),
+      "index", StrCat(field->number()), "class", extension_scope, "name",
+      extension_object_name);
+}
+
+void Generator::GenerateKernelFile(const GeneratorOptions& options,
+                                   io::Printer* printer,
+                                   const FileDescriptor* file) const {
+  GenerateHeader(options, file, printer);
+  printer->Print("goog.module('$module$');\n\n", "module",
+                 GetKernelModuleName(options, file));
+
+  {
+    ScopedProfilePhase profile_phase(kProfileRequires);
+    // Sorted by alias; the runtime classes come first, as module aliases are
+    // lower case.
+    std::map<std::string, std::string> requires;
+    for (int i = 0; i < file->message_type_count(); i++) {
+      FindKernelRequires(options, file->message_type(i), &requires);
+    }
+    for (const auto& require : requires) {
+      printer->Print("const $alias$ = goog.require('$module$');\n", "alias",
+                     require.first, "module", require.second);
+    }
+    if (!requires.empty()) {
+      printer->Print("\n");
+    }
+  }
+
+  for (int i = 0; i < file->message_type_count(); i++) {
+    GenerateKernelClass(options, printer, file->message_type(i));
+  }
+  for (int i = 0; i < file->enum_type_count(); i++) {
+    GenerateKernelEnum(options, printer, file->enum_type(i));
+  }
+
+  printer->Print("exports = {");
+  for (int i = 0; i < file->message_type_count(); i++) {
+    printer->Print("\n  $name$,", "name", file->message_type(i)->name());
+  }
+  for (int i = 0; i < file->enum_type_count(); i++) {
+    printer->Print("\n  $name$,", "name", file->enum_type(i)->name());
+  }
+  printer->Print(
+      file->message_type_count() + file->enum_type_count() > 0 ? "\n};\n"
+                                                                : "};\n");
+}
+
+void Generator::GenerateKernelClass(const GeneratorOptions& options,
+                                    io::Printer* printer,
+                                    const Descriptor* desc) const {
+  ScopedProfilePhase profile_phase(kProfileClasses);
+  const std::string classname = KernelTypeRef(desc->file(), desc);
+  const std::string pivot = KernelPivot(desc);
+  printer->Print(
+      "/**\n"
+      " * Generated by JsPbCodeGenerator for the binary Kernel runtime.\n"
+      " * @implements {InternalMessage}\n"
+      " * @final\n"
+      " */\n");
+  if (desc->containing_type() == nullptr) {
+    printer->Print("class $name$ {\n", "name", classname);
+  } else {
+    printer->Print("$name$ = class {\n", "name", classname);
+  }
+  printer->Annotate("name", desc);
+  printer->Print(
+      "  /**\n"
+      "   * @param {!Kernel=} kernel\n"
+      "   * @private\n"
+      "   */\n"
+      "  constructor(kernel = Kernel.createEmpty($pivot$)) {\n"
+      "    /** @private @const {!Kernel} */\n"
+      "    this.kernel_ = kernel;\n"
+      "  }\n"
+      "\n"
+      "  /**\n"
+      "   * @return {!$class$}\n"
+      "   */\n"
+      "  static createEmpty() {\n"
+      "    return new $class$();\n"
+      "  }\n"
+      "\n"
+      "  /**\n"
+      "   * Creates a message for the given binary data (in protobuf wire\n"
+      "   * format), which is only decoded as its fields are accessed. The\n"
+      "   * bytes are kept by the message; don't modify them.\n"
+      "   * @param {!ArrayBuffer} bytes\n"
+      "   * @return {!$class$}\n"
+      "   */\n"
+      "  static deserialize(bytes) {\n"
+      "    return new $class$(Kernel.fromArrayBuffer(bytes$pivotarg$));\n"
+      "  }\n"
+      "\n"
+      "  /**\n"
+      "   * @param {!Kernel} kernel\n"
+      "   * @return {!$class$}\n"
+      "   */\n"
+      "  static instanceCreator(kernel) {\n"
+      "    return new $class$(kernel);\n"
+      "  }\n"
+      "\n"
+      "  /**\n"
+      "   * @override\n"
+      "   * @return {!Kernel}\n"
+      "   */\n"
+      "  internalGetKernel() {\n"
+      "    return this.kernel_;\n"
+      "  }\n"
+      "\n"
+      "  /**\n"
+      "   * Serializes the message to binary data (in protobuf wire format).\n"
+      "   * @return {!ArrayBuffer}\n"
+      "   */\n"
+      "  serialize() {\n"
+      "    return this.kernel_.serialize();\n"
+      "  }\n",
+      "class", classname, "pivot", pivot, "pivotarg",
+      pivot.empty() ? "" : ", " + pivot);
+
+  printer->Indent();
+  for (int i = 0; i < desc->oneof_decl_count(); i++) {
+    if (!IgnoreOneof(desc->oneof_decl(i))) {
+      GenerateKernelOneofCaseGetter(options, printer, desc->oneof_decl(i));
+    }
+  }
+  for (int i = 0; i < desc->field_count(); i++) {
+    GenerateKernelField(options, printer, desc->field(i));
+  }
+  printer->Outdent();
+  printer->Print(desc->containing_type() == nullptr ? "}\n\n" : "};\n\n");
+
+  for (int i = 0; i < desc->oneof_decl_count(); i++) {
+    if (!IgnoreOneof(desc->oneof_decl(i))) {
+      printer->Print(
+          "/**\n"
+          " * @enum {number}\n"
+          " */\n"
+          "$class$.$oneof$Case = {\n"
+          "  $upcase$_NOT_SET: 0",
+          "class", classname, "oneof", JSOneofName(desc->oneof_decl(i)),
+          "upcase", ToEnumCase(desc->oneof_decl(i)->name()));
+      for (int j = 0; j < desc->oneof_decl(i)->field_count(); j++) {
+        const FieldDescriptor* field = desc->oneof_decl(i)->field(j);
+        printer->Print(",\n  $upcase$: $number$", "upcase",
+                       ToEnumCase(field->name()), "number",
+                       StrCat(field->number()));
+      }
+      printer->Print("\n};\n\n");
+    }
+  }
+  for (int i = 0; i < desc->enum_type_count(); i++) {
+    GenerateKernelEnum(options, printer, desc->enum_type(i));
+  }
+  for (int i = 0; i < desc->nested_type_count(); i++) {
+    GenerateKernelClass(options, printer, desc->nested_type(i));
+  }
+}
+
+void Generator::GenerateKernelOneofCaseGetter(
+    const GeneratorOptions& options, io::Printer* printer,
+    const OneofDescriptor* oneof) const {
+  const std::string casename =
+      KernelTypeRef(oneof->file(), oneof->containing_type()) + "." +
+      JSOneofName(oneof) + "Case";
+  printer->Print(
+      "\n"
+      "/**\n"
+      " * @return {!$case$}\n"
+      " */\n"
+      "get$oneof$Case() {\n",
+      "case", casename, "oneof", JSOneofName(oneof));
+  for (int i = 0; i < oneof->field_count(); i++) {
+    printer->Print(
+        "  if (this.kernel_.hasFieldNumber($number$)) {\n"
+        "    return $case$.$upcase$;\n"
+        "  }\n",
+        "number", StrCat(oneof->field(i)->number()), "case", casename,
+        "upcase", ToEnumCase(oneof->field(i)->name()));
+  }
+  printer->Print(
+      "  return $case$.$upcase$_NOT_SET;\n"
+      "}\n",
+      "case", casename, "upcase", ToEnumCase(oneof->name()));
+}
+
+void Generator::GenerateKernelField(const GeneratorOptions& options,
+                                    io::Printer* printer,
+                                    const FieldDescriptor* field) const {
+  ScopedProfilePhase profile_phase(kProfileAccessors);
+  const bool is_message =
+      field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE;
+  const bool is_enum = field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM;
+  const std::string type = KernelValueType(field);
+  const std::string number = StrCat(field->number());
+  const std::string kernel_type = KernelTypeName(field);
+  // Enum values are read as int32 values, and need a cast.
+  const std::string cast = is_enum ? "/** @type {" + type + "} */ (" : "";
+  const std::string iterable_cast =
+      is_enum ? "/** @type {!Iterable<" + type + ">} */ (" : "";
+  const std::string end_cast = is_enum ? ")" : "";
+
+  std::map<std::string, std::string> vars;
+  vars["fielddef"] = FieldDefinition(options, field);
+  vars["name"] = JSGetterName(options, field, BYTES_DEFAULT,
+                              /* drop_list = */ true);
+  vars["type"] = type;
+  vars["number"] = number;
+
+  if (!field->is_repeated()) {
+    if (is_message) {
+      const std::string creator = KernelInstanceCreatorArguments(field);
+      vars["nullable_type"] = "?" + type.substr(1);
+      vars["get"] =
+          KernelStatement("return this.kernel_.get" + kernel_type,
+                          number + ", " + creator);
+      vars["get_or_null"] =
+          KernelStatement("return this.kernel_.get" + kernel_type + "OrNull",
+                          number + ", " + creator);
+      vars["get_attach"] =
+          KernelStatement("return this.kernel_.get" + kernel_type + "Attach",
+                          number + ", " + creator);
+      printer->Print(
+          vars,
+          "\n"
+          "/**\n"
+          " * $fielddef$\n"
+          " * Returns an empty message if the field is unset; changes to it\n"
+          " * are then not reflected in this message, see get$name$Attach().\n"
+          " * @return {$type$}\n"
+          " */\n"
+          "get$name$() {\n"
+          "$get$\n"
+          "}\n"
+          "\n"
+          "/**\n"
+          " * @return {$nullable_type$}\n"
+          " */\n"
+          "get$name$OrNull() {\n"
+          "$get_or_null$\n"
+          "}\n"
+          "\n"
+          "/**\n"
+          " * Returns the field, first setting it to an empty message if it\n"
+          " * is unset.\n"
+          " * @return {$type$}\n"
+          " */\n"
+          "get$name$Attach() {\n"
+          "$get_attach$\n"
+          "}\n");
+    } else {
+      vars["get"] = KernelStatement(
+          "return " + cast + "this.kernel_.get" + kernel_type + "WithDefault",
+          number + KernelDefaultArgument(options, field), end_cast);
+      printer->Print(
+          vars,
+          "\n"
+          "/**\n"
+          " * $fielddef$\n"
+          " * @return {$type$}\n"
+          " */\n"
+          "get$name$() {\n"
+          "$get$\n"
+          "}\n");
+    }
+
+    // Setting a field of a oneof clears the other fields of the oneof.
+    std::string set;
+    if (InRealOneof(field)) {
+      const OneofDescriptor* oneof = field->containing_oneof();
+      for (int i = 0; i < oneof->field_count(); i++) {
+        if (oneof->field(i) != field) {
+          set += KernelStatement("this.kernel_.clearField",
+                                 StrCat(oneof->field(i)->number())) +
+                 "\n  ";
+        }
+      }
+    }
+    set += KernelStatement("this.kernel_.set" + kernel_type,
+                           number + ", value");
+    vars["set"] = set;
+    printer->Print(
+        vars,
+        "\n"
+        "/**\n"
+        " * @param {$type$} value\n"
+        " */\n"
+        "set$name$(value) {\n"
+        "$set$\n"
+        "}\n");
+    if (field->has_presence()) {
+      printer->Print(
+          vars,
+          "\n"
+          "/**\n"
+          " * @return {boolean}\n"
+          " */\n"
+          "has$name$() {\n"
+          "  return this.kernel_.hasFieldNumber($number$);\n"
+          "}\n"
+          "\n"
+          "clear$name$() {\n"
+          "  this.kernel_.clearField($number$);\n"
+          "}\n");
+    }
+    return;
+  }
+
+  if (is_message) {
+    const std::string creator = KernelInstanceCreatorArguments(field);
+    const std::string creator_at_index =
+        KernelInstanceCreatorArguments(field, "index");
+    const std::string prefix = "this.kernel_.";
+    const std::string repeated = "Repeated" + kernel_type;
+    vars["get_list"] =
+        KernelStatement("return " + prefix + "get" + repeated + "Iterable",
+                        number + ", " + creator);
+    vars["get_size"] =
+        KernelStatement("return " + prefix + "get" + repeated + "Size",
+                        number + ", " + creator);
+    vars["get_element"] =
+        KernelStatement("return " + prefix + "get" + repeated + "Element",
+                        number + ", " + creator_at_index);
+    vars["set_list"] = KernelStatement(prefix + "set" + repeated + "Iterable",
+                                       number + ", values");
+    vars["set_element"] =
+        KernelStatement(prefix + "set" + repeated + "Element",
+                        number + ", value, " + creator_at_index);
+    vars["add"] = KernelStatement(prefix + "add" + repeated + "Element",
+                                  number + ", value, " + creator);
+    vars["add_all"] = KernelStatement(prefix + "add" + repeated + "Iterable",
+                                      number + ", values, " + creator);
+  } else {
+    // Strings and bytes are never packed.
+    const std::string kind =
+        (field->type() == FieldDescriptor::TYPE_STRING ||
+         field->type() == FieldDescriptor::TYPE_BYTES)
+            ? "Repeated"
+            : (field->is_packed() ? "Packed" : "Unpacked");
+    const std::string prefix = "this.kernel_.";
+    vars["get_list"] =
+        KernelStatement("return " + iterable_cast + prefix + "getRepeated" +
+                            kernel_type + "Iterable",
+                        number, end_cast);
+    vars["get_size"] = KernelStatement(
+        "return " + prefix + "getRepeated" + kernel_type + "Size", number);
+    vars["get_element"] =
+        KernelStatement("return " + cast + prefix + "getRepeated" +
+                            kernel_type + "Element",
+                        number + ", index", end_cast);
+    vars["set_list"] =
+        KernelStatement(prefix + "set" + kind + kernel_type + "Iterable",
+                        number + ", values");
+    vars["set_element"] =
+        KernelStatement(prefix + "set" + kind + kernel_type + "Element",
+                        number + ", index, value");
+    vars["add"] =
+        KernelStatement(prefix + "add" + kind + kernel_type + "Element",
+                        number + ", value");
+    vars["add_all"] =
+        KernelStatement(prefix + "add" + kind + kernel_type + "Iterable",
+                        number + ", values");
+  }
   printer->Print(
+      vars,
+      "\n"
+      "/**\n"
+      " * $fielddef$\n"
+      " * @return {!Iterable<$type$>}\n"
+      " */\n"
+      "get$name$List() {\n"
+      "$get_list$\n"
+      "}\n"
+      "\n"
+      "/**\n"
+      " * @return {number}\n"
+      " */\n"
+      "get$name$Size() {\n"
+      "$get_size$\n"
+      "}\n"
+      "\n"
+      "/**\n"
+      " * @param {number} index\n"
+      " * @return {$type$}\n"
+      " */\n"
+      "get$name$Element(index) {\n"
+      "$get_element$\n"
+      "}\n"
+      "\n"
+      "/**\n"
+      " * @param {!Iterable<$type$>} values\n"
+      " */\n"
+      "set$name$List(values) {\n"
+      "$set_list$\n"
+      "}\n"
       "\n"
       "/**\n"
-      " * A tuple of {field number, class constructor} for the extension\n"
-      " * field named `$nameInComment$`.\n"
-      " * @type {!jspb.ExtensionFieldInfo<$extensionType$>}\n"
+      " * @param {number} index\n"
+      " * @param {$type$} value\n"
       " */\n"
-      "$class$.$name$ = new jspb.ExtensionFieldInfo(\n",
-      "nameInComment", extension_object_name, "name", extension_object_name,
-      "class", extension_scope, "extensionType",
-      JSFieldTypeAnnotation(options, field,
-                            /* is_setter_argument = */ false,
-                            /* force_present = */ true,
-                            /* singular_if_not_packed = */ false));
-  printer->Annotate("name", field);
-  printer->Print(
-      "    $index$,\n"
-      "    {$name$: 0},\n"
-      "    $ctor$,\n"
-      "     /** @type {?function((boolean|undefined),!jspb.Message=): "
-      "!Object} */ (\n"
-      "         $toObject$),\n"
-      "    $repeated$);\n",
-      "index", StrCat(field->number()), "name", extension_object_name, "ctor",
-      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
-           ? SubmessageTypeRef(options, field)
-           : std::string("null")),
-      "toObject",
-      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
-           ? (SubmessageTypeRef(options, field) + ".toObject")
-           : std::string("null")),
-      "repeated", (field->is_repeated() ? "1" : "0"));
-
-  printer->Print(
+      "set$name$Element(index, value) {\n"
+      "$set_element$\n"
+      "}\n"
       "\n"
-      "$extendName$Binary[$index$] = new jspb.ExtensionFieldBinaryInfo(\n"
-      "    $class$.$name$,\n"
-      "    $binaryReaderFn$,\n"
-      "    $binaryWriterFn$,\n"
-      "    $binaryMessageSerializeFn$,\n"
-      "    $binaryMessageDeserializeFn$,\n",
-      "extendName",
-      JSExtensionsObjectName(options, field->file(), field->containing_type()),
-      "index", StrCat(field->number()), "class", extension_scope, "name",
-      extension_object_name, "binaryReaderFn",
-      JSBinaryReaderMethodName(options, field), "binaryWriterFn",
-      JSBinaryWriterMethodName(options, field), "binaryMessageSerializeFn",
-      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE)
-          ? (SubmessageTypeRef(options, field) + ".serializeBinaryToWriter")
-          : "undefined",
-      "binaryMessageDeserializeFn",
-      (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE)
-          ? (SubmessageTypeRef(options, field) + ".deserializeBinaryFromReader")
-          : "undefined");
-
-  printer->Print("    $isPacked$);\n", "isPacked",
-                 (field->is_packed() ? "true" : "false"));
+      "/**\n"
+      " * @param {$type$} value\n"
+      " */\n"
+      "add$name$(value) {\n"
+      "$add$\n"
+      "}\n"
+      "\n"
+      "/**\n"
+      " * @param {!Iterable<$type$>} values\n"
+      " */\n"
+      "addAll$name$(values) {\n"
+      "$add_all$\n"
+      "}\n"
+      "\n"
+      "clear$name$List() {\n"
+      "  this.kernel_.clearField($number$);\n"
+      "}\n");
+}
 
+void Generator::GenerateKernelEnum(const GeneratorOptions& options,
+                                   io::Printer* printer,
+                                   const EnumDescriptor* enumdesc) const {
+  ScopedProfilePhase profile_phase(kProfileEnums);
   printer->Print(
-      "// This registers the extension field with the extended class, so that\n"
-      "// toObject() will function correctly.\n"
-      "$extendName$[$index$] = $class$.$name$;\n"
-      "\n",
-      "extendName",
-      JSExtensionsObjectName(options, field->file(), field->containing_type()),
-      "index", StrCat(field->number()), "class", extension_scope, "name",
-      extension_object_name);
+      "/**\n"
+      " * @enum {number}\n"
+      " */\n"
+      "$const$$name$ = {\n",
+      "const", enumdesc->containing_type() == nullptr ? "const " : "", "name",
+      KernelTypeRef(enumdesc->file(), enumdesc));
+  printer->Annotate("name", enumdesc);
+  GenerateEnumValues(printer, enumdesc);
+  printer->Print(
+      "};\n"
+      "\n");
 }
 
 bool GeneratorOptions::ParseFromOptions(
@@ -3495,11 +7199,183 @@ bool GeneratorOptions::ParseFromOptions(
       }
       one_output_file_per_input_file = true;
     } else if (option.first == "annotate_code") {
-      if (!option.second.empty()) {
-        *error = "Unexpected option value for annotate_code";
+      if (option.second.empty() || option.second == "embedded") {
+        annotations = kAnnotationsEmbedded;
+      } else if (option.second == "sidecar") {
+        annotations = kAnnotationsSidecar;
+      } else {
+        *error = "Unknown annotate_code mode " + option.second +
+                 ", expected one of: embedded, sidecar.";
         return false;
       }
       annotate_code = true;
+    } else if (option.first == "typed_arrays") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for typed_arrays";
+        return false;
+      }
+      typed_arrays = true;
+    } else if (option.first == "bigint") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for bigint";
+        return false;
+      }
+      bigint = true;
+    } else if (option.first == "field_masks") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for field_masks";
+        return false;
+      }
+      field_masks = true;
+    } else if (option.first == "compact") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for compact";
+        return false;
+      }
+      compact = true;
+    } else if (option.first == "json") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for json";
+        return false;
+      }
+      json = true;
+    } else if (option.first == "instrument") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for instrument";
+        return false;
+      }
+      instrument = true;
+    } else if (option.first == "sizing") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for sizing";
+        return false;
+      }
+      sizing = true;
+    } else if (option.first == "writer_reuse") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for writer_reuse";
+        return false;
+      }
+      writer_reuse = true;
+    } else if (option.first == "reuse") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for reuse";
+        return false;
+      }
+      reuse = true;
+    } else if (option.first == "delimited") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for delimited";
+        return false;
+      }
+      delimited = true;
+    } else if (option.first == "batch") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for batch";
+        return false;
+      }
+      batch = true;
+    } else if (option.first == "lazy_init") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for lazy_init";
+        return false;
+      }
+      lazy_init = true;
+    } else if (option.first == "roots") {
+      if (option.second.empty()) {
+        *error = "Expected a message, enum or extension name for roots";
+        return false;
+      }
+      roots.push_back(option.second);
+    } else if (option.first == "inline_accessors") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for inline_accessors";
+        return false;
+      }
+      inline_accessors = true;
+    } else if (option.first == "direct_object") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for direct_object";
+        return false;
+      }
+      direct_object = true;
+    } else if (option.first == "parallel") {
+      int32_t value;
+      if (!safe_strto32(option.second, &value) || value < 1) {
+        *error = "Expected a positive number of threads for parallel, got " +
+                 option.second;
+        return false;
+      }
+      parallel = value;
+    } else if (option.first == "cache_dir") {
+      if (option.second.empty()) {
+        *error = "Expected a directory for cache_dir";
+        return false;
+      }
+      cache_dir = option.second;
+    } else if (option.first == "profile") {
+      if (option.second.empty()) {
+        *error = "Expected a file name for profile";
+        return false;
+      }
+      profile = option.second;
+    } else if (option.first == "field_order") {
+      if (option.second == "declaration") {
+        field_order = kFieldOrderDeclaration;
+      } else if (option.second == "number") {
+        field_order = kFieldOrderNumber;
+      } else {
+        *error = "Unknown field_order " + option.second + ", expected " +
+                 "one of: declaration, number.";
+        return false;
+      }
+    } else if (option.first == "field_profile") {
+      if (option.second.empty()) {
+        *error = "Expected a file name for field_profile";
+        return false;
+      }
+      field_profile = option.second;
+      if (!ReadFieldProfile(field_profile, &field_counts, error)) {
+        return false;
+      }
+    } else if (option.first == "expected_tags") {
+      if (!option.second.empty()) {
+        *error = "Unexpected option value for expected_tags";
+        return false;
+      }
+      expected_tags = true;
+    } else if (option.first == "codec") {
+      if (option.second == "switch") {
+        codec = kCodecSwitch;
+      } else if (option.second == "table") {
+        codec = kCodecTable;
+      } else {
+        *error = "Unknown codec " + option.second + ", expected " +
+                 "one of: switch, table.";
+        return false;
+      }
+    } else if (option.first == "runtime") {
+      if (option.second == "jspb") {
+        runtime = kRuntimeJspb;
+      } else if (option.second == "kernel") {
+        runtime = kRuntimeKernel;
+      } else {
+        *error = "Unknown runtime " + option.second + ", expected " +
+                 "one of: jspb, kernel.";
+        return false;
+      }
+    } else if (option.first == "lazy") {
+      if (option.second == "none") {
+        lazy = kLazyNone;
+      } else if (option.second == "annotated") {
+        lazy = kLazyAnnotated;
+      } else if (option.second == "all") {
+        lazy = kLazyAll;
+      } else {
+        *error = "Unknown lazy mode " + option.second + ", expected " +
+                 "one of: none, annotated, all.";
+        return false;
+      }
     } else {
       // Assume any other option is an output directory, as long as it is a bare
       // `key` rather than a `key=value` option.
@@ -3521,13 +7397,59 @@ bool GeneratorOptions::ParseFromOptions(
     return false;
   }
 
+  if (runtime == kRuntimeKernel &&
+      (import_style != kImportClosure || !library.empty())) {
+    *error =
+        "The runtime=kernel option requires import_style=closure, and cannot "
+        "be used with the library option";
+    return false;
+  }
+
+  if (compact && (import_style == kImportClosure || annotate_code)) {
+    *error =
+        "The compact option drops the JSDoc that import_style=closure relies "
+        "on, and cannot be used with it or with annotate_code";
+    return false;
+  }
+
+  if (lazy_init && import_style != kImportCommonJs &&
+      import_style != kImportCommonJsStrict) {
+    *error =
+        "The lazy_init option requires import_style=commonjs or "
+        "commonjs_strict";
+    return false;
+  }
+
+  if (runtime == kRuntimeKernel && json) {
+    *error = "The json option cannot be used with runtime=kernel";
+    return false;
+  }
+
+  if (runtime == kRuntimeKernel && instrument) {
+    *error = "The instrument option cannot be used with runtime=kernel";
+    return false;
+  }
+
+  if (runtime == kRuntimeKernel && !roots.empty()) {
+    *error = "The roots option cannot be used with runtime=kernel";
+    return false;
+  }
+
+  if (runtime == kRuntimeKernel && bigint) {
+    *error =
+        "The runtime=kernel option represents 64-bit fields as Int64, and "
+        "cannot be used with the bigint option";
+    return false;
+  }
+
   return true;
 }
 
 GeneratorOptions::OutputMode GeneratorOptions::output_mode() const {
   // We use one output file per input file if we are not using Closure or if
   // this is explicitly requested.
-  if (import_style != kImportClosure || one_output_file_per_input_file) {
+  if (import_style != kImportClosure || one_output_file_per_input_file ||
+      runtime == kRuntimeKernel) {
     return kOneOutputFilePerInputFile;
   }
 
@@ -3577,36 +7499,6 @@ void Generator::GenerateFileAndDeps(
   }
 }
 
-bool Generator::GenerateFile(const FileDescriptor* file,
-                             const GeneratorOptions& options,
-                             GeneratorContext* context,
-                             bool use_short_name) const {
-  std::string filename =
-      options.output_dir + "/" +
-      GetJSFilename(options, use_short_name
-                                 ? file->name().substr(file->name().rfind('/'))
-                                 : file->name());
-  std::unique_ptr<io::ZeroCopyOutputStream> output(context->Open(filename));
-  GOOGLE_CHECK(output);
-  GeneratedCodeInfo annotations;
-  io::AnnotationProtoCollector<GeneratedCodeInfo> annotation_collector(
-      &annotations);
-  io::Printer printer(output.get(), '$',
-                      options.annotate_code ? &annotation_collector : nullptr);
-
-  GenerateFile(options, &printer, file);
-
-  if (printer.failed()) {
-    return false;
-  }
-
-  if (options.annotate_code) {
-    EmbedCodeAnnotations(annotations, &printer);
-  }
-
-  return true;
-}
-
 void Generator::GenerateFile(const GeneratorOptions& options,
                              io::Printer* printer,
                              const FileDescriptor* file) const {
@@ -3648,23 +7540,26 @@ void Generator::GenerateFile(const GeneratorOptions& options,
       const std::string& name = file->dependency(i)->name();
       printer->Print(
           "var $alias$ = require('$file$');\n"
-          "goog.object.extend(proto, $alias$);\n",
+          "$extend$(proto, $alias$);\n",
           "alias", ModuleAlias(name), "file",
-          GetRootPath(file->name(), name) + GetJSFilename(options, name));
+          GetRootPath(file->name(), name) + GetJSFilename(options, name),
+          "extend", ExtendFunction(options));
     }
   }
 
-  std::set<std::string> provided;
+  SymbolTable symbols;
+  SymbolSet provided(&symbols);
   std::set<const FieldDescriptor*> extensions;
   for (int i = 0; i < file->extension_count(); i++) {
     // We honor the jspb::ignore option here only when working with
     // Closure-style imports. Use of this option is discouraged and so we want
     // to avoid adding new support for it.
-    if (options.import_style == GeneratorOptions::kImportClosure &&
-        IgnoreField(file->extension(i))) {
+    if ((options.import_style == GeneratorOptions::kImportClosure &&
+         IgnoreField(file->extension(i))) ||
+        !IsReachable(options, file->extension(i))) {
       continue;
     }
-    provided.insert(GetNamespace(options, file) + "." +
+    provided.Insert(GetNamespace(options, file) + "." +
                     JSObjectFieldName(options, file->extension(i)));
     extensions.insert(file->extension(i));
   }
@@ -3686,18 +7581,37 @@ void Generator::GenerateFile(const GeneratorOptions& options,
     GenerateExtension(options, printer, *it);
   }
 
+  if (options.lazy_init) {
+    // All extensions of the file, nested ones included, register with the
+    // messages they extend once those are installed.
+    std::vector<const FieldDescriptor*> registered;
+    for (int i = 0; i < file->message_type_count(); i++) {
+      if (!IgnoreMessage(file->message_type(i)) &&
+          IsReachable(options, file->message_type(i))) {
+        FindNestedExtensions(file->message_type(i), &registered);
+      }
+    }
+    registered.insert(registered.end(), extensions.begin(), extensions.end());
+    for (auto extension : registered) {
+      GenerateLazyExtensionRegistration(options, printer, extension);
+    }
+  }
+
   // if provided is empty, do not export anything
   if (options.import_style == GeneratorOptions::kImportCommonJs &&
       !provided.empty()) {
-    printer->Print("goog.object.extend(exports, $package$);\n", "package",
+    printer->Print("$extend$(exports, $package$);\n", "extend",
+                   ExtendFunction(options), "package",
                    GetNamespace(options, file));
   } else if (options.import_style == GeneratorOptions::kImportCommonJsStrict) {
-    printer->Print("goog.object.extend(exports, proto);\n", "package",
+    printer->Print("$extend$(exports, proto);\n", "extend",
+                   ExtendFunction(options), "package",
                    GetNamespace(options, file));
   }
 
   // Emit well-known type methods.
-  for (FileToc* toc = well_known_types_js; toc->name != NULL; toc++) {
+  for (FileToc* toc = well_known_types_js;
+       toc->name != NULL && HasReachableMessages(options, file); toc++) {
     std::string name = std::string("google/protobuf/") + toc->name;
     if (name == StripProto(file->name()) + ".js") {
       printer->Print(toc->data);
@@ -3715,73 +7629,112 @@ bool Generator::GenerateAll(const std::vector<const FileDescriptor*>& files,
   if (!options.ParseFromOptions(option_pairs, error)) {
     return false;
   }
+  auto run_start = std::chrono::steady_clock::now();
+  RunProfile run_profile;
 
-  if (options.output_mode() == GeneratorOptions::kEverythingInOneFile) {
-    // All output should go in a single file.
-    std::string filename = options.output_dir + "/" + options.library +
-                           options.GetFileNameExtension();
-    std::unique_ptr<io::ZeroCopyOutputStream> output(context->Open(filename));
-    GOOGLE_CHECK(output.get());
-    GeneratedCodeInfo annotations;
-    io::AnnotationProtoCollector<GeneratedCodeInfo> annotation_collector(
-        &annotations);
-    io::Printer printer(
-        output.get(), '$',
-        options.annotate_code ? &annotation_collector : nullptr);
+  // Compute the names of all descriptors once, before any code is generated.
+  auto start = std::chrono::steady_clock::now();
+  NamingContext naming;
+  for (auto file : files) {
+    naming.AddFile(options, file);
+  }
+  options.naming = &naming;
+  run_profile.emplace_back("naming", MillisecondsSince(start));
 
-    // Pull out all extensions -- we need these to generate all
-    // provides/requires.
-    std::vector<const FieldDescriptor*> extensions;
-    for (auto file : files) {
-      for (int j = 0; j < file->extension_count(); j++) {
-        const FieldDescriptor* extension = file->extension(j);
-        extensions.push_back(extension);
-      }
+  std::set<const void*> reachable;
+  if (!options.roots.empty()) {
+    start = std::chrono::steady_clock::now();
+    if (!FindReachableDescriptors(options, files, &reachable, error)) {
+      return false;
     }
+    options.reachable = &reachable;
+    run_profile.emplace_back("reachability", MillisecondsSince(start));
+  }
 
-    if (files.size() == 1) {
-      GenerateHeader(options, files[0], &printer);
-    } else {
-      GenerateHeader(options, nullptr, &printer);
+  // Identifies the generator and its options in the cache keys of all output
+  // files.
+  std::string options_key;
+  if (!options.cache_dir.empty()) {
+    options_key = GetOptionsCacheKey(options, option_pairs);
+    if (options.reachable != nullptr) {
+      AddReachableToCacheKey(options, files, &options_key);
     }
+  }
+
+  // Decide on the set of output files first; the files themselves are
+  // generated afterwards by RunOutputJobs().
+  std::vector<OutputJob> jobs;
+  // Owns the SCCs that the jobs refer to.
+  SCCAnalyzer<DepsGenerator> analyzer;
+  if (options.output_mode() == GeneratorOptions::kEverythingInOneFile) {
+    // All output should go in a single file.
+    std::string filename = options.output_dir + "/" + options.library +
+                           options.GetFileNameExtension();
+    jobs.emplace_back(
+        "library", options.library, filename,
+        [this, &options, &files](io::Printer* printer) {
+          // Pull out all extensions -- we need these to generate all
+          // provides/requires.
+          std::vector<const FieldDescriptor*> extensions;
+          for (auto file : files) {
+            for (int j = 0; j < file->extension_count(); j++) {
+              const FieldDescriptor* extension = file->extension(j);
+              if (IsReachable(options, extension)) {
+                extensions.push_back(extension);
+              }
+            }
+          }
 
-    std::set<std::string> provided;
-    FindProvides(options, &printer, files, &provided);
-    FindProvidesForFields(options, &printer, extensions, &provided);
-    GenerateProvides(options, &printer, &provided);
-    GenerateTestOnly(options, &printer);
-    GenerateRequiresForLibrary(options, &printer, files, &provided);
+          if (files.size() == 1) {
+            GenerateHeader(options, files[0], printer);
+          } else {
+            GenerateHeader(options, nullptr, printer);
+          }
 
-    GenerateFilesInDepOrder(options, &printer, files);
+          SymbolTable symbols;
+          SymbolSet provided(&symbols);
+          FindProvides(options, printer, files, &provided);
+          FindProvidesForFields(options, printer, extensions, &provided);
+          GenerateProvides(options, printer, &provided);
+          GenerateTestOnly(options, printer);
+          GenerateRequiresForLibrary(options, printer, files, &provided);
 
-    for (auto extension : extensions) {
-      if (ShouldGenerateExtension(extension)) {
-        GenerateExtension(options, &printer, extension);
-      }
-    }
+          GenerateFilesInDepOrder(options, printer, files);
 
-    if (printer.failed()) {
-      return false;
-    }
-    if (options.annotate_code) {
-      EmbedCodeAnnotations(annotations, &printer);
+          for (auto extension : extensions) {
+            if (ShouldGenerateExtension(extension)) {
+              GenerateExtension(options, printer, extension);
+            }
+          }
+        });
+    if (!options.cache_dir.empty()) {
+      jobs.back().cache_key = GetFilesCacheKey(options_key, filename, files);
     }
   } else if (options.output_mode() == GeneratorOptions::kOneOutputFilePerSCC) {
     std::set<const Descriptor*> have_printed;
-    SCCAnalyzer<DepsGenerator> analyzer;
     std::map<const void*, std::string> allowed_map;
+    start = std::chrono::steady_clock::now();
     if (!GenerateJspbAllowedMap(options, files, &allowed_map, &analyzer)) {
       return false;
     }
+    run_profile.emplace_back("scc_analysis", MillisecondsSince(start));
 
-    bool generated = false;
     for (auto file : files) {
       // Force well known type to generate in a whole file.
       if (IsWellKnownTypeFile(file)) {
-        if (!GenerateFile(file, options, context, true)) {
-          return false;
+        if (!HasReachableMessages(options, file)) {
+          continue;
+        }
+        jobs.emplace_back(
+            "file", file->name(),
+            GetFileOutputName(options, file, /* use_short_name = */ true),
+            [this, &options, file](io::Printer* printer) {
+              GenerateFile(options, printer, file);
+            });
+        if (!options.cache_dir.empty()) {
+          jobs.back().cache_key = GetFilesCacheKey(
+              options_key, jobs.back().filename, {file});
         }
-        generated = true;
         continue;
       }
       for (int j = 0; j < file->message_type_count(); j++) {
@@ -3791,53 +7744,44 @@ bool Generator::GenerateAll(const std::vector<const FileDescriptor*>& files,
           continue;
         }
 
-        generated = true;
         const SCC* scc = analyzer.GetSCC(desc);
-        const std::string& filename = allowed_map[scc];
-        std::unique_ptr<io::ZeroCopyOutputStream> output(
-            context->Open(filename));
-        GOOGLE_CHECK(output.get());
-        GeneratedCodeInfo annotations;
-        io::AnnotationProtoCollector<GeneratedCodeInfo> annotation_collector(
-            &annotations);
-        io::Printer printer(
-            output.get(), '$',
-            options.annotate_code ? &annotation_collector : nullptr);
-
-        GenerateHeader(options, file, &printer);
-
-        std::set<std::string> provided;
-        for (auto one_desc : scc->descriptors) {
-          if (one_desc->containing_type() == nullptr) {
-            FindProvidesForMessage(options, &printer, one_desc, &provided);
-          }
-        }
-        GenerateProvides(options, &printer, &provided);
-        GenerateTestOnly(options, &printer);
-        GenerateRequiresForSCC(options, &printer, scc, &provided);
-
-        for (auto one_desc : scc->descriptors) {
-          if (one_desc->containing_type() == nullptr) {
-            GenerateClassConstructorAndDeclareExtensionFieldInfo(
-                options, &printer, one_desc);
-          }
-        }
-        for (auto one_desc : scc->descriptors) {
-          if (one_desc->containing_type() == nullptr) {
-            GenerateClass(options, &printer, one_desc);
-          }
+        jobs.emplace_back(
+            "scc", scc->GetRepresentative()->full_name(), allowed_map[scc],
+            [this, &options, file, scc](io::Printer* printer) {
+              GenerateHeader(options, file, printer);
+
+              SymbolTable symbols;
+              SymbolSet provided(&symbols);
+              for (auto one_desc : scc->descriptors) {
+                if (one_desc->containing_type() == nullptr) {
+                  FindProvidesForMessage(options, printer, one_desc,
+                                         &provided);
+                }
+              }
+              GenerateProvides(options, printer, &provided);
+              GenerateTestOnly(options, printer);
+              GenerateRequiresForSCC(options, printer, scc, &provided);
+
+              for (auto one_desc : scc->descriptors) {
+                if (one_desc->containing_type() == nullptr) {
+                  GenerateClassConstructorAndDeclareExtensionFieldInfo(
+                      options, printer, one_desc);
+                }
+              }
+              for (auto one_desc : scc->descriptors) {
+                if (one_desc->containing_type() == nullptr) {
+                  GenerateClass(options, printer, one_desc);
+                }
+              }
+            });
+        if (!options.cache_dir.empty()) {
+          jobs.back().cache_key =
+              GetSCCCacheKey(options_key, jobs.back().filename, file, scc);
         }
 
         for (auto one_desc : scc->descriptors) {
           have_printed.insert(one_desc);
         }
-
-        if (printer.failed()) {
-          return false;
-        }
-        if (options.annotate_code) {
-          EmbedCodeAnnotations(annotations, &printer);
-        }
       }
       for (int j = 0; j < file->enum_type_count(); j++) {
         const EnumDescriptor* enumdesc = file->enum_type(j);
@@ -3845,90 +7789,95 @@ bool Generator::GenerateAll(const std::vector<const FileDescriptor*>& files,
           continue;
         }
 
-        generated = true;
-        const std::string& filename = allowed_map[enumdesc];
-        std::unique_ptr<io::ZeroCopyOutputStream> output(
-            context->Open(filename));
-        GOOGLE_CHECK(output.get());
-        GeneratedCodeInfo annotations;
-        io::AnnotationProtoCollector<GeneratedCodeInfo> annotation_collector(
-            &annotations);
-        io::Printer printer(
-            output.get(), '$',
-            options.annotate_code ? &annotation_collector : nullptr);
-
-        GenerateHeader(options, file, &printer);
-
-        std::set<std::string> provided;
-        FindProvidesForEnum(options, &printer, enumdesc, &provided);
-        GenerateProvides(options, &printer, &provided);
-        GenerateTestOnly(options, &printer);
-
-        GenerateEnum(options, &printer, enumdesc);
-
-        if (printer.failed()) {
-          return false;
-        }
-        if (options.annotate_code) {
-          EmbedCodeAnnotations(annotations, &printer);
+        jobs.emplace_back(
+            "enum", enumdesc->full_name(), allowed_map[enumdesc],
+            [this, &options, file, enumdesc](io::Printer* printer) {
+              GenerateHeader(options, file, printer);
+
+              SymbolTable symbols;
+              SymbolSet provided(&symbols);
+              FindProvidesForEnum(options, printer, enumdesc, &provided);
+              GenerateProvides(options, printer, &provided);
+              GenerateTestOnly(options, printer);
+
+              GenerateEnum(options, printer, enumdesc);
+            });
+        if (!options.cache_dir.empty()) {
+          jobs.back().cache_key =
+              GetEnumCacheKey(options_key, jobs.back().filename, enumdesc);
         }
       }
       // File-level extensions (message-level extensions are generated under
       // the enclosing message).
       if (allowed_map.count(file) == 1) {
-        generated = true;
-        const std::string& filename = allowed_map[file];
-
-        std::unique_ptr<io::ZeroCopyOutputStream> output(
-            context->Open(filename));
-        GOOGLE_CHECK(output.get());
-        GeneratedCodeInfo annotations;
-        io::AnnotationProtoCollector<GeneratedCodeInfo> annotation_collector(
-            &annotations);
-        io::Printer printer(
-            output.get(), '$',
-            options.annotate_code ? &annotation_collector : nullptr);
-
-        GenerateHeader(options, file, &printer);
-
-        std::set<std::string> provided;
         std::vector<const FieldDescriptor*> fields;
-
         for (int j = 0; j < file->extension_count(); j++) {
-          if (ShouldGenerateExtension(file->extension(j))) {
+          if (ShouldGenerateExtension(file->extension(j)) &&
+              IsReachable(options, file->extension(j))) {
             fields.push_back(file->extension(j));
           }
         }
 
-        FindProvidesForFields(options, &printer, fields, &provided);
-        GenerateProvides(options, &printer, &provided);
-        GenerateTestOnly(options, &printer);
-        GenerateRequiresForExtensions(options, &printer, fields, &provided);
-
-        for (int j = 0; j < file->extension_count(); j++) {
-          if (ShouldGenerateExtension(file->extension(j))) {
-            GenerateExtension(options, &printer, file->extension(j));
-          }
-        }
-        if (options.annotate_code) {
-          EmbedCodeAnnotations(annotations, &printer);
+        jobs.emplace_back(
+            "extensions", file->name(), allowed_map[file],
+            [this, &options, file, fields](io::Printer* printer) {
+              GenerateHeader(options, file, printer);
+
+              SymbolTable symbols;
+              SymbolSet provided(&symbols);
+              FindProvidesForFields(options, printer, fields, &provided);
+              GenerateProvides(options, printer, &provided);
+              GenerateTestOnly(options, printer);
+              GenerateRequiresForExtensions(options, printer, fields,
+                                            &provided);
+
+              for (auto field : fields) {
+                GenerateExtension(options, printer, field);
+              }
+            });
+        if (!options.cache_dir.empty()) {
+          jobs.back().cache_key = GetExtensionsCacheKey(
+              options_key, jobs.back().filename, file, fields);
         }
       }
     }
-    if (!generated) {
-      std::string filename = options.output_dir + "/" +
-                             "empty_no_content_void_file" +
-                             options.GetFileNameExtension();
-      std::unique_ptr<io::ZeroCopyOutputStream> output(context->Open(filename));
-    }
   } else /* options.output_mode() == kOneOutputFilePerInputFile */ {
     // Generate one output file per input (.proto) file.
-
     for (auto file : files) {
-      if (!GenerateFile(file, options, context, false)) {
-        return false;
+      jobs.emplace_back(
+          "file", file->name(),
+          GetFileOutputName(options, file, /* use_short_name = */ false),
+          [this, &options, file](io::Printer* printer) {
+            if (options.runtime == GeneratorOptions::kRuntimeKernel) {
+              GenerateKernelFile(options, printer, file);
+            } else {
+              GenerateFile(options, printer, file);
+            }
+          });
+      if (!options.cache_dir.empty()) {
+        jobs.back().cache_key =
+            GetFilesCacheKey(options_key, jobs.back().filename, {file});
       }
     }
+
+  }
+
+  if (!RunOutputJobs(options, &jobs, context, &run_profile)) {
+    return false;
+  }
+
+  if (options.output_mode() == GeneratorOptions::kOneOutputFilePerSCC &&
+      jobs.empty()) {
+    std::string filename = options.output_dir + "/" +
+                           "empty_no_content_void_file" +
+                           options.GetFileNameExtension();
+    std::unique_ptr<io::ZeroCopyOutputStream> output(context->Open(filename));
+  }
+
+  if (!options.profile.empty() &&
+      !WriteProfile(options, parameter, MillisecondsSince(run_start),
+                    run_profile, jobs, context)) {
+    return false;
   }
   return true;
 }
@@ -33,6 +33,8 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_JS_GENERATOR_H__
 #define GOOGLE_PROTOBUF_COMPILER_JS_GENERATOR_H__
 
+#include <cstdint>
+#include <map>
 #include <set>
 #include <string>
 
@@ -59,6 +61,9 @@ class Printer;
 namespace compiler {
 namespace js {
 
+class NamingContext;
+class SymbolSet;
+
 struct GeneratorOptions {
   // Output path.
   std::string output_dir;
@@ -85,7 +90,33 @@ struct GeneratorOptions {
         library(""),
         extension(".js"),
         one_output_file_per_input_file(false),
-        annotate_code(false) {}
+        annotate_code(false),
+        annotations(kAnnotationsEmbedded),
+        parallel(1),
+        cache_dir(""),
+        profile(""),
+        codec(kCodecSwitch),
+        typed_arrays(false),
+        lazy(kLazyNone),
+        direct_object(false),
+        inline_accessors(false),
+        bigint(false),
+        field_order(kFieldOrderDeclaration),
+        field_profile(""),
+        expected_tags(false),
+        field_masks(false),
+        lazy_init(false),
+        compact(false),
+        json(false),
+        instrument(false),
+        sizing(false),
+        writer_reuse(false),
+        reuse(false),
+        delimited(false),
+        batch(false),
+        runtime(kRuntimeJspb),
+        naming(nullptr),
+        reachable(nullptr) {}
 
   bool ParseFromOptions(
       const std::vector<std::pair<std::string, std::string> >& options,
@@ -128,6 +159,179 @@ struct GeneratorOptions {
   // are encoded as base64 proto of GeneratedCodeInfo message (see
   // descriptor.proto).
   bool annotate_code;
+  // Where the annotations of annotate_code go, set by its value.
+  enum Annotations {
+    // annotate_code or annotate_code=embedded: in a trailing comment, once
+    // the whole file has been generated.
+    kAnnotationsEmbedded,
+    // annotate_code=sidecar: in a <output file>.meta file next to each output
+    // file, holding the binary GeneratedCodeInfo. Each annotation is written
+    // out as soon as its code is printed, so that the memory used does not
+    // grow with the size of the output, e.g. of a large library.
+    kAnnotationsSidecar,
+  } annotations;
+  // Number of worker threads used to generate independent output files
+  // (one per SCC, enum or extension file, or one per input file). Outputs are
+  // always committed to the GeneratorContext in the same order as with a
+  // single thread, so the result does not depend on this value.
+  int parallel;
+  // If set, generated files are cached in this (existing) directory, keyed by
+  // the descriptors, options and generator build they were generated from.
+  // Files whose inputs have not changed since an earlier run are then copied
+  // from the cache instead of being generated again.
+  std::string cache_dir;
+  // If set, timings and counters of each generation phase, for every output
+  // file, are written as JSON to this file (relative to the output location
+  // given to protoc).
+  std::string profile;
+  // How the binary serialization code of messages is generated.
+  enum Codec {
+    // Unrolled serializeBinaryToWriter() and deserializeBinaryFromReader()
+    // loops for each message.
+    kCodecSwitch,
+    // A compact field table for each message, interpreted by the shared
+    // encode and decode loops of jspb.BinaryCodec.
+    kCodecTable,
+  } codec;
+  // If true, packed repeated double, float and 32-bit integer fields are
+  // decoded into Float64Array, Float32Array, Int32Array or Uint32Array values,
+  // copied from the wire bytes in one block where possible. Their getters may
+  // then return such typed arrays instead of plain Arrays, until the field is
+  // modified.
+  bool typed_arrays;
+  // Which singular message fields and packed repeated fields are decoded
+  // lazily: deserializeBinaryFromReader() then keeps a view of their wire
+  // bytes, and decodes them when the field is first accessed. Fields that are
+  // not accessed are written back from their original bytes. Oneof fields and
+  // extensions are always decoded eagerly.
+  enum Lazy {
+    // No fields are decoded lazily.
+    kLazyNone,
+    // Only fields with the [lazy = true] option.
+    kLazyAnnotated,
+    // All singular message fields and packed repeated fields.
+    kLazyAll,
+  } lazy;
+  // If true, toObject() and fromObject() read and write the underlying array
+  // of a message directly for its scalar fields below the pivot, instead of
+  // calling a jspb.Message accessor per field. Messages that are not
+  // extendable then also no longer support the deprecated includeInstance
+  // argument of toObject().
+  bool direct_object;
+  // If true, the getters, setters, clearers and hazzers of singular scalar
+  // fields below the pivot of messages that are not extendable read and write
+  // the underlying array of the message directly, instead of calling the
+  // jspb.Message helpers. Setters of oneof fields still use the helpers, as
+  // they also clear the other fields of the oneof.
+  bool inline_accessors;
+  // If true, 64-bit integer fields without a jstype option are represented as
+  // BigInt instead of number, and read and written without loss of precision.
+  // Fields with jstype = JS_STRING or JS_NUMBER are unchanged.
+  bool bigint;
+  // The order in which the binary serialization code of each message writes
+  // its fields, and lists them in its decoding switch (or the field table of
+  // codec=table).
+  enum FieldOrder {
+    // The order of the fields in the .proto file.
+    kFieldOrderDeclaration,
+    // Ascending field numbers.
+    kFieldOrderNumber,
+  } field_order;
+  // If set, a field frequency profile read from this file: each line holds
+  // the full name of a field (e.g. "pkg.Message.field") and a count, and
+  // empty lines and lines starting with '#' are skipped. Fields with higher
+  // counts are then ordered first, and fields with equal (or no) counts keep
+  // the field_order. Serialized fields are written in this order.
+  std::string field_profile;
+  // The counts read from field_profile, by full field name.
+  std::map<std::string, int64_t> field_counts;
+  // If true, each case of the decoding switch of codec=switch checks whether
+  // the next field in the input is the one that follows it in the field
+  // order (or, for repeated fields, the field itself), and if so continues
+  // with it directly, without going through the switch. This pays off for
+  // inputs written in the same field order.
+  bool expected_tags;
+  // If true, messages get deserializeBinaryPartial(), which decodes only the
+  // fields selected by a field mask and skips all others, recursing into
+  // partially selected message fields. Masks are compiled once, with
+  // compileFieldMask(), into jspb.BinaryProjection bitsets of field numbers,
+  // which deserializeBinaryFromReader() then checks for each field it reads.
+  bool field_masks;
+  // If set, only the types reachable from these messages, enums or extensions
+  // (given by full name, with one roots= option for each) are generated: the
+  // messages their fields refer to, in turn, along with the messages nesting
+  // or nested in them, and the file-level extensions of reachable messages.
+  // All other top-level messages, enums and extensions are dropped, and the
+  // well-known type helpers of files without reachable messages are left out.
+  // Cannot be used with runtime=kernel, which generates all types.
+  std::vector<std::string> roots;
+  // If true, which requires import_style=commonjs or commonjs_strict, loading
+  // a generated file only defines its top-level messages, and the file-level
+  // extensions, as lazy properties (see jspb.Message.defineLazy): the
+  // constructor, prototype and static methods of a message, along with those
+  // of its nested messages, are installed when it is first accessed. Extension
+  // field info is created on first access too, and extensions register with
+  // the message they extend once that message is installed.
+  bool lazy_init;
+  // If true, which cannot be used with import_style=closure or annotate_code,
+  // the output is stripped of its JSDoc and line comments, and the accessors
+  // of the primitive fields of each message (other than bytes, oneof and
+  // inline_accessors fields) are installed from a table by
+  // jspb.Message.installAccessors() instead of being generated one by one.
+  bool compact;
+  // If true, messages get toJsonString() and fromJsonString(), which write
+  // and read the canonical proto3 JSON mapping directly from and to their
+  // fields, with the jspb.JsonWriter and jspb.JsonReader of json.js, rather
+  // than through toObject(). The well-known types get their special JSON
+  // forms, provided that their files are generated with this option too.
+  bool json;
+  // If true, deserializeBinaryFromReader() and serializeBinaryToWriter()
+  // report the type, bytes, unknown fields and optionally the time of each
+  // message they decode or encode to the sink of jspb.BinaryInstrumentation.
+  // The hooks are guarded by the jspb.BinaryInstrumentation.ENABLED define,
+  // so that they compile away when it is off.
+  bool instrument;
+  // If true, messages get computeSerializedSize(), which measures their
+  // binary form with a jspb.BinarySizingWriter without serializing them, and
+  // serializeBinaryTo(), which then writes it into a caller's buffer with a
+  // jspb.BinaryPresizedWriter.
+  bool sizing;
+  // If true, messages get serializeBinaryWith(), which serializes them with a
+  // reusable writer such as jspb.BinaryBufferWriter.
+  bool writer_reuse;
+  // If true, messages get clear() and resetFrom(), which decodes into an
+  // existing message, and the decoder of codec=switch takes the submessages
+  // it reads from those that clear() set aside (see
+  // jspb.Message.reuseWrapperField) instead of constructing new ones.
+  bool reuse;
+  // If true, messages get serializeDelimited(), which prefixes their binary
+  // form with its length, and deserializeDelimitedStream(), which decodes a
+  // stream of such records from sync or async chunks with
+  // jspb.BinaryDelimitedReader.
+  bool delimited;
+  // If true, messages get deserializeBinaryBatch(), which decodes a batch of
+  // messages, optionally on the workers of a jspb.BinaryBatchPool.
+  bool batch;
+  // Which runtime the generated message classes are built on.
+  enum Runtime {
+    // Subclasses of jspb.Message, storing their fields in an array.
+    kRuntimeJspb,
+    // Wrappers of the experimental binary Kernel
+    // (experimental/runtime/kernel), which indexes the wire bytes of a
+    // message and decodes each field on its first access. One goog.module is
+    // generated per input file, exporting its top-level messages and enums.
+    // Map fields are accessed as repeated entry messages, and extensions are
+    // not generated. The other options of the jspb runtime have no effect.
+    kRuntimeKernel,
+  } runtime;
+
+  // Names precomputed for the descriptors being generated, shared by all
+  // output files. Set by Generator::GenerateAll(); not an actual option.
+  const NamingContext* naming;
+  // The messages, enums and file-level extensions reachable from roots, or
+  // null to generate everything. Set by Generator::GenerateAll(); not an
+  // actual option.
+  const std::set<const void*>* reachable;
 };
 
 // CodeGenerator implementation which generates a JavaScript source file and
@@ -162,24 +366,24 @@ class PROTOC_EXPORT Generator : public CodeGenerator {
   // Generate goog.provides() calls.
   void FindProvides(const GeneratorOptions& options, io::Printer* printer,
                     const std::vector<const FileDescriptor*>& file,
-                    std::set<std::string>* provided) const;
+                    SymbolSet* provided) const;
   void FindProvidesForFile(const GeneratorOptions& options,
                            io::Printer* printer, const FileDescriptor* file,
-                           std::set<std::string>* provided) const;
+                           SymbolSet* provided) const;
   void FindProvidesForMessage(const GeneratorOptions& options,
                               io::Printer* printer, const Descriptor* desc,
-                              std::set<std::string>* provided) const;
+                              SymbolSet* provided) const;
   void FindProvidesForEnum(const GeneratorOptions& options,
                            io::Printer* printer, const EnumDescriptor* enumdesc,
-                           std::set<std::string>* provided) const;
+                           SymbolSet* provided) const;
   // For extension fields at file scope.
   void FindProvidesForFields(const GeneratorOptions& options,
                              io::Printer* printer,
                              const std::vector<const FieldDescriptor*>& fields,
-                             std::set<std::string>* provided) const;
+                             SymbolSet* provided) const;
   // Print the goog.provides() found by the methods above.
   void GenerateProvides(const GeneratorOptions& options, io::Printer* printer,
-                        std::set<std::string>* provided) const;
+                        SymbolSet* provided) const;
 
   // Generate goog.setTestOnly() if indicated.
   void GenerateTestOnly(const GeneratorOptions& options,
@@ -189,39 +393,35 @@ class PROTOC_EXPORT Generator : public CodeGenerator {
   void GenerateRequiresForLibrary(
       const GeneratorOptions& options, io::Printer* printer,
       const std::vector<const FileDescriptor*>& files,
-      std::set<std::string>* provided) const;
+      SymbolSet* provided) const;
   void GenerateRequiresForSCC(const GeneratorOptions& options,
                               io::Printer* printer, const SCC* scc,
-                              std::set<std::string>* provided) const;
+                              SymbolSet* provided) const;
   // For extension fields at file scope.
   void GenerateRequiresForExtensions(
       const GeneratorOptions& options, io::Printer* printer,
       const std::vector<const FieldDescriptor*>& fields,
-      std::set<std::string>* provided) const;
+      SymbolSet* provided) const;
   void GenerateRequiresImpl(const GeneratorOptions& options,
                             io::Printer* printer,
-                            std::set<std::string>* required,
-                            std::set<std::string>* forwards,
-                            std::set<std::string>* provided, bool require_jspb,
+                            SymbolSet* required,
+                            SymbolSet* forwards,
+                            SymbolSet* provided, bool require_jspb,
                             bool require_extension, bool require_map) const;
   void FindRequiresForMessage(const GeneratorOptions& options,
                               const Descriptor* desc,
-                              std::set<std::string>* required,
-                              std::set<std::string>* forwards,
+                              SymbolSet* required,
+                              SymbolSet* forwards,
                               bool* have_message) const;
   void FindRequiresForField(const GeneratorOptions& options,
                             const FieldDescriptor* field,
-                            std::set<std::string>* required,
-                            std::set<std::string>* forwards) const;
+                            SymbolSet* required,
+                            SymbolSet* forwards) const;
   void FindRequiresForExtension(const GeneratorOptions& options,
                                 const FieldDescriptor* field,
-                                std::set<std::string>* required,
-                                std::set<std::string>* forwards) const;
+                                SymbolSet* required,
+                                SymbolSet* forwards) const;
   // Generate all things in a proto file into one file.
-  // If use_short_name is true, the generated file's name will only be short
-  // name that without directory, otherwise filename equals file->name()
-  bool GenerateFile(const FileDescriptor* file, const GeneratorOptions& options,
-                    GeneratorContext* context, bool use_short_name) const;
   void GenerateFile(const GeneratorOptions& options, io::Printer* printer,
                     const FileDescriptor* file) const;
 
@@ -241,7 +441,8 @@ class PROTOC_EXPORT Generator : public CodeGenerator {
                                io::Printer* printer,
                                const FileDescriptor* file) const;
 
-  void GenerateFieldValueExpression(io::Printer* printer,
+  void GenerateFieldValueExpression(const GeneratorOptions& options,
+                                    io::Printer* printer,
                                     const char* obj_reference,
                                     const FieldDescriptor* field,
                                     bool use_default) const;
@@ -294,9 +495,48 @@ class PROTOC_EXPORT Generator : public CodeGenerator {
   void GenerateClassDeserializeBinary(const GeneratorOptions& options,
                                       io::Printer* printer,
                                       const Descriptor* desc) const;
-  void GenerateClassDeserializeBinaryField(const GeneratorOptions& options,
-                                           io::Printer* printer,
-                                           const FieldDescriptor* field) const;
+  void GenerateClassBinaryCodecTable(const GeneratorOptions& options,
+                                     io::Printer* printer,
+                                     const Descriptor* desc) const;
+  void GenerateClassBinaryCodecTableField(const GeneratorOptions& options,
+                                          io::Printer* printer,
+                                          const FieldDescriptor* field) const;
+  // Generate getFieldMaskFields(), compileFieldMask() and
+  // deserializeBinaryPartial() for the field_masks option.
+  void GenerateClassFieldMask(const GeneratorOptions& options,
+                              io::Printer* printer,
+                              const Descriptor* desc) const;
+  // Generate toJsonString(), fromJsonString(), serializeJsonToWriter() and
+  // deserializeJsonFromReader() for the json option.
+  void GenerateClassJson(const GeneratorOptions& options, io::Printer* printer,
+                         const Descriptor* desc) const;
+  void GenerateClassSerializeJsonField(const GeneratorOptions& options,
+                                       io::Printer* printer,
+                                       const FieldDescriptor* field) const;
+  void GenerateClassDeserializeJsonField(const GeneratorOptions& options,
+                                         io::Printer* printer,
+                                         const FieldDescriptor* field) const;
+  // Generate the bodies of serializeJsonToWriter() and
+  // deserializeJsonFromReader() for the well-known types with a special JSON
+  // form. Returns false for the other types.
+  bool GenerateClassSerializeJsonWellKnownType(const GeneratorOptions& options,
+                                               io::Printer* printer,
+                                               const Descriptor* desc) const;
+  bool GenerateClassDeserializeJsonWellKnownType(
+      const GeneratorOptions& options, io::Printer* printer,
+      const Descriptor* desc) const;
+  // Generate the functions reading and writing one entry of a map field,
+  // which the binary serialization code of codec=switch uses.
+  void GenerateClassMapEntryReader(const GeneratorOptions& options,
+                                   io::Printer* printer,
+                                   const FieldDescriptor* field) const;
+  void GenerateClassMapEntryWriter(const GeneratorOptions& options,
+                                   io::Printer* printer,
+                                   const FieldDescriptor* field) const;
+  // `next_field` is the field of the next case of the switch, if any.
+  void GenerateClassDeserializeBinaryField(
+      const GeneratorOptions& options, io::Printer* printer,
+      const FieldDescriptor* field, const FieldDescriptor* next_field) const;
   void GenerateClassSerializeBinary(const GeneratorOptions& options,
                                     io::Printer* printer,
                                     const Descriptor* desc) const;
@@ -307,10 +547,36 @@ class PROTOC_EXPORT Generator : public CodeGenerator {
   // Generate definition for one enum.
   void GenerateEnum(const GeneratorOptions& options, io::Printer* printer,
                     const EnumDescriptor* enumdesc) const;
+  void GenerateEnumValues(io::Printer* printer,
+                          const EnumDescriptor* enumdesc) const;
+
+  // Generate the goog.module of a file with runtime=kernel.
+  void GenerateKernelFile(const GeneratorOptions& options,
+                          io::Printer* printer,
+                          const FileDescriptor* file) const;
+  void GenerateKernelClass(const GeneratorOptions& options,
+                           io::Printer* printer, const Descriptor* desc) const;
+  void GenerateKernelOneofCaseGetter(const GeneratorOptions& options,
+                                     io::Printer* printer,
+                                     const OneofDescriptor* oneof) const;
+  void GenerateKernelField(const GeneratorOptions& options,
+                           io::Printer* printer,
+                           const FieldDescriptor* field) const;
+  void GenerateKernelEnum(const GeneratorOptions& options,
+                          io::Printer* printer,
+                          const EnumDescriptor* enumdesc) const;
 
   // Generate an extension definition.
   void GenerateExtension(const GeneratorOptions& options, io::Printer* printer,
                          const FieldDescriptor* field) const;
+  // Generate the registration of an extension with the message it extends.
+  void GenerateExtensionRegistration(const GeneratorOptions& options,
+                                     io::Printer* printer,
+                                     const FieldDescriptor* field) const;
+  // Same, deferred until the extended message is installed, for lazy_init.
+  void GenerateLazyExtensionRegistration(const GeneratorOptions& options,
+                                         io::Printer* printer,
+                                         const FieldDescriptor* field) const;
 
   // Generate addFoo() method for repeated primitive fields.
   void GenerateRepeatedPrimitiveHelperMethods(const GeneratorOptions& options,
@@ -0,0 +1,452 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Benchmark for the JavaScript code generator.
+//
+// Builds a synthetic descriptor pool whose shape is controlled by flags, then
+// times Generator::GenerateAll() for every output mode and import style:
+//
+//   bazel run -c opt //generator:js_generator_benchmark -- \
+//       --files=200 --messages=20 --fields=30 --depth=3
+//
+// Flags (all optional):
+//   --files=N         Number of .proto files; each imports the previous one.
+//   --messages=N      Top-level messages per file.
+//   --fields=N        Fields per top-level message, cycling through all types.
+//   --depth=N         Levels of nested messages below each top-level message.
+//   --oneof_fields=N  Fields in a oneof of each top-level message.
+//   --maps=N          Map fields per top-level message.
+//   --extensions=N    File-level extensions per file, extending a message of
+//                     the imported file.
+//   --iterations=N    Timed runs per configuration.
+//   --parameter=P     Extra generator options, e.g. "parallel=8".
+//   --filter=S        Only run configurations whose name contains S.
+//
+// For each configuration this reports the average wall time of GenerateAll(),
+// the number and size of heap allocations it made, the size of the generated
+// code and the peak resident set size of the process so far.
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/stubs/logging.h>
+#include <google/protobuf/stubs/strutil.h>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "generator/js_generator.h"
+
+namespace {
+
+std::atomic<uint64_t> allocation_count(0);
+std::atomic<uint64_t> allocation_bytes(0);
+
+void* CountedAlloc(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+// Count every heap allocation made through operator new.
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace js {
+namespace {
+
+struct SchemaShape {
+  int files = 50;
+  int messages = 10;
+  int fields = 20;
+  int depth = 2;
+  int oneof_fields = 4;
+  int maps = 2;
+  int extensions = 4;
+};
+
+// Field types used for the fields of synthetic messages, in order.
+const FieldDescriptorProto::Type kFieldTypes[] = {
+    FieldDescriptorProto::TYPE_INT32,   FieldDescriptorProto::TYPE_INT64,
+    FieldDescriptorProto::TYPE_UINT32,  FieldDescriptorProto::TYPE_SINT64,
+    FieldDescriptorProto::TYPE_FIXED32, FieldDescriptorProto::TYPE_DOUBLE,
+    FieldDescriptorProto::TYPE_FLOAT,   FieldDescriptorProto::TYPE_BOOL,
+    FieldDescriptorProto::TYPE_STRING,  FieldDescriptorProto::TYPE_BYTES,
+    FieldDescriptorProto::TYPE_ENUM,    FieldDescriptorProto::TYPE_MESSAGE,
+};
+const int kNumFieldTypes = sizeof(kFieldTypes) / sizeof(kFieldTypes[0]);
+
+std::string FileName(int file) { return StrCat("bench/file", file, ".proto"); }
+
+std::string PackageName(int file) { return StrCat("bench.f", file); }
+
+FieldDescriptorProto* AddField(DescriptorProto* message,
+                               const std::string& name, int number,
+                               FieldDescriptorProto::Type type) {
+  FieldDescriptorProto* field = message->add_field();
+  field->set_name(name);
+  field->set_number(number);
+  field->set_type(type);
+  field->set_label(FieldDescriptorProto::LABEL_OPTIONAL);
+  return field;
+}
+
+// Adds `count` fields cycling through kFieldTypes. Message fields refer to
+// `message_type`, enum fields to the enum of the file.
+void AddFields(DescriptorProto* message, int count, int first_number,
+               const std::string& package, const std::string& message_type) {
+  for (int i = 0; i < count; i++) {
+    FieldDescriptorProto::Type type = kFieldTypes[i % kNumFieldTypes];
+    FieldDescriptorProto* field =
+        AddField(message, StrCat("field_", i), first_number + i, type);
+    if (type == FieldDescriptorProto::TYPE_ENUM) {
+      field->set_type_name("." + package + ".Kind");
+    } else if (type == FieldDescriptorProto::TYPE_MESSAGE) {
+      field->set_type_name(message_type);
+    }
+    // Every other lap through the types, make the fields repeated.
+    if ((i / kNumFieldTypes) % 2 == 1) {
+      field->set_label(FieldDescriptorProto::LABEL_REPEATED);
+      if (type != FieldDescriptorProto::TYPE_STRING &&
+          type != FieldDescriptorProto::TYPE_BYTES &&
+          type != FieldDescriptorProto::TYPE_MESSAGE) {
+        field->mutable_options()->set_packed(true);
+      }
+    }
+  }
+}
+
+FileDescriptorProto BuildFile(const SchemaShape& shape, int file) {
+  std::string package = PackageName(file);
+  FileDescriptorProto proto;
+  proto.set_name(FileName(file));
+  proto.set_package(package);
+  proto.set_syntax("proto2");
+  if (file > 0) {
+    proto.add_dependency(FileName(file - 1));
+  }
+
+  EnumDescriptorProto* kind = proto.add_enum_type();
+  kind->set_name("Kind");
+  for (int i = 0; i < 8; i++) {
+    EnumValueDescriptorProto* value = kind->add_value();
+    value->set_name(StrCat("KIND_", file, "_", i));
+    value->set_number(i);
+  }
+
+  for (int m = 0; m < shape.messages; m++) {
+    DescriptorProto* message = proto.add_message_type();
+    message->set_name(StrCat("Message", m));
+    std::string path = "." + package + "." + message->name();
+
+    // Message fields refer to the next message of the file, or to a message
+    // of the imported file, so that messages form both SCCs and cross-file
+    // references.
+    std::string message_type = path;
+    if (m + 1 < shape.messages) {
+      message_type = StrCat(".", package, ".Message", m + 1);
+    } else if (file > 0) {
+      message_type = StrCat(".", PackageName(file - 1), ".Message0");
+    }
+    AddFields(message, shape.fields, 1, package, message_type);
+    int number = shape.fields + 1;
+
+    for (int i = 0; i < shape.oneof_fields; i++) {
+      if (i == 0) {
+        message->add_oneof_decl()->set_name("choice");
+      }
+      FieldDescriptorProto* field = AddField(
+          message, StrCat("choice_", i), number++,
+          i % 2 == 0 ? FieldDescriptorProto::TYPE_STRING
+                     : FieldDescriptorProto::TYPE_MESSAGE);
+      if (field->type() == FieldDescriptorProto::TYPE_MESSAGE) {
+        field->set_type_name(path);
+      }
+      field->set_oneof_index(0);
+    }
+
+    for (int i = 0; i < shape.maps; i++) {
+      DescriptorProto* entry = message->add_nested_type();
+      entry->set_name(StrCat("Map", i, "Entry"));
+      entry->mutable_options()->set_map_entry(true);
+      AddField(entry, "key", 1,
+               i % 2 == 0 ? FieldDescriptorProto::TYPE_STRING
+                          : FieldDescriptorProto::TYPE_INT32);
+      FieldDescriptorProto* value =
+          AddField(entry, "value", 2,
+                   i % 2 == 0 ? FieldDescriptorProto::TYPE_MESSAGE
+                              : FieldDescriptorProto::TYPE_ENUM);
+      value->set_type_name(i % 2 == 0 ? path : "." + package + ".Kind");
+      FieldDescriptorProto* field =
+          AddField(message, StrCat("map", i), number++,
+                   FieldDescriptorProto::TYPE_MESSAGE);
+      field->set_label(FieldDescriptorProto::LABEL_REPEATED);
+      field->set_type_name(path + "." + entry->name());
+    }
+
+    // A chain of nested messages, the innermost of which refers back to the
+    // top-level message.
+    DescriptorProto* parent = message;
+    std::string parent_path = path;
+    for (int d = 1; d <= shape.depth; d++) {
+      DescriptorProto* nested = parent->add_nested_type();
+      nested->set_name(StrCat("Nested", d));
+      std::string nested_path = parent_path + "." + nested->name();
+      FieldDescriptorProto* field =
+          AddField(parent, StrCat("nested_", d), number++,
+                   FieldDescriptorProto::TYPE_MESSAGE);
+      field->set_type_name(nested_path);
+      AddFields(nested, std::max(1, shape.fields / 4), 1, package, path);
+      parent = nested;
+      parent_path = nested_path;
+      number = std::max(1, shape.fields / 4) + 1;
+    }
+
+    if (m == 0) {
+      DescriptorProto::ExtensionRange* range = message->add_extension_range();
+      range->set_start(1000);
+      range->set_end(536870912);
+    }
+  }
+
+  if (file > 0) {
+    std::string extendee = StrCat(".", PackageName(file - 1), ".Message0");
+    for (int i = 0; i < shape.extensions; i++) {
+      FieldDescriptorProto* extension = proto.add_extension();
+      extension->set_name(StrCat("ext_", i));
+      extension->set_number(1000 + i);
+      extension->set_label(FieldDescriptorProto::LABEL_OPTIONAL);
+      extension->set_extendee(extendee);
+      if (i % 2 == 0) {
+        extension->set_type(FieldDescriptorProto::TYPE_INT64);
+      } else {
+        extension->set_type(FieldDescriptorProto::TYPE_MESSAGE);
+        extension->set_type_name(StrCat(".", package, ".Message0"));
+      }
+    }
+  }
+  return proto;
+}
+
+// Keeps all generated files in memory.
+class MemoryGeneratorContext : public GeneratorContext {
+ public:
+  io::ZeroCopyOutputStream* Open(const std::string& filename) override {
+    return new io::StringOutputStream(&files_[filename]);
+  }
+
+  size_t TotalSize() const {
+    size_t size = 0;
+    for (const auto& file : files_) {
+      size += file.second.size();
+    }
+    return size;
+  }
+
+  size_t FileCount() const { return files_.size(); }
+
+ private:
+  std::map<std::string, std::string> files_;
+};
+
+// Returns the peak resident set size of the process, in KiB.
+long PeakRssKb() {
+#if defined(_WIN32)
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+struct Configuration {
+  const char* name;
+  const char* parameter;
+};
+
+const Configuration kConfigurations[] = {
+    {"closure/per_scc", "binary"},
+    {"closure/per_input_file", "binary,one_output_file_per_input_file"},
+    {"closure/library", "binary,library=bench_lib"},
+    {"commonjs", "binary,import_style=commonjs"},
+    {"commonjs_strict", "binary,import_style=commonjs_strict"},
+    {"es6", "binary,import_style=es6"},
+    {"browser", "binary,import_style=browser"},
+};
+
+bool ParseFlag(const std::string& arg, const char* name, int* value) {
+  std::string prefix = StrCat("--", name, "=");
+  if (!HasPrefixString(arg, prefix)) {
+    return false;
+  }
+  if (!safe_strto32(arg.substr(prefix.size()), value) || *value < 0) {
+    GOOGLE_LOG(FATAL) << "Invalid value for --" << name << ": " << arg;
+  }
+  return true;
+}
+
+int Run(int argc, char** argv) {
+  SchemaShape shape;
+  int iterations = 3;
+  std::string extra_parameter;
+  std::string filter;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (ParseFlag(arg, "files", &shape.files) ||
+        ParseFlag(arg, "messages", &shape.messages) ||
+        ParseFlag(arg, "fields", &shape.fields) ||
+        ParseFlag(arg, "depth", &shape.depth) ||
+        ParseFlag(arg, "oneof_fields", &shape.oneof_fields) ||
+        ParseFlag(arg, "maps", &shape.maps) ||
+        ParseFlag(arg, "extensions", &shape.extensions) ||
+        ParseFlag(arg, "iterations", &iterations)) {
+      continue;
+    }
+    if (HasPrefixString(arg, "--parameter=")) {
+      extra_parameter = arg.substr(strlen("--parameter="));
+    } else if (HasPrefixString(arg, "--filter=")) {
+      filter = arg.substr(strlen("--filter="));
+    } else {
+      std::fprintf(stderr, "Unknown flag: %s\n", arg.c_str());
+      return 1;
+    }
+  }
+  if (shape.files < 1 || shape.messages < 1 || iterations < 1) {
+    std::fprintf(stderr, "--files, --messages and --iterations must be >= 1\n");
+    return 1;
+  }
+
+  DescriptorPool pool;
+  std::vector<const FileDescriptor*> files;
+  for (int i = 0; i < shape.files; i++) {
+    const FileDescriptor* file = pool.BuildFile(BuildFile(shape, i));
+    GOOGLE_CHECK(file != nullptr) << "Invalid synthetic file " << FileName(i);
+    files.push_back(file);
+  }
+
+  std::printf(
+      "files=%d messages=%d fields=%d depth=%d oneof_fields=%d maps=%d "
+      "extensions=%d iterations=%d\n\n",
+      shape.files, shape.messages, shape.fields, shape.depth,
+      shape.oneof_fields, shape.maps, shape.extensions, iterations);
+  std::printf("%-24s %10s %12s %12s %8s %12s %12s\n", "configuration",
+              "wall_ms", "allocs", "alloc_kb", "outputs", "output_kb",
+              "peak_rss_kb");
+
+  Generator generator;
+  for (const Configuration& configuration : kConfigurations) {
+    if (!filter.empty() &&
+        std::string(configuration.name).find(filter) == std::string::npos) {
+      continue;
+    }
+    std::string parameter = configuration.parameter;
+    if (!extra_parameter.empty()) {
+      parameter += "," + extra_parameter;
+    }
+
+    double total_ms = 0;
+    uint64_t total_allocs = 0;
+    uint64_t total_alloc_bytes = 0;
+    size_t outputs = 0;
+    size_t output_bytes = 0;
+    for (int i = 0; i < iterations; i++) {
+      MemoryGeneratorContext context;
+      std::string error;
+      uint64_t allocs_before = allocation_count.load();
+      uint64_t bytes_before = allocation_bytes.load();
+      auto start = std::chrono::steady_clock::now();
+      bool ok = generator.GenerateAll(files, parameter, &context, &error);
+      auto end = std::chrono::steady_clock::now();
+      if (!ok) {
+        std::fprintf(stderr, "%s: %s\n", configuration.name, error.c_str());
+        return 1;
+      }
+      total_ms +=
+          std::chrono::duration<double, std::milli>(end - start).count();
+      total_allocs += allocation_count.load() - allocs_before;
+      total_alloc_bytes += allocation_bytes.load() - bytes_before;
+      outputs = context.FileCount();
+      output_bytes = context.TotalSize();
+    }
+
+    std::printf("%-24s %10.1f %12llu %12llu %8zu %12zu %12ld\n",
+                configuration.name, total_ms / iterations,
+                static_cast<unsigned long long>(total_allocs / iterations),
+                static_cast<unsigned long long>(total_alloc_bytes / iterations /
+                                                1024),
+                outputs, output_bytes / 1024, PeakRssKb());
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace js
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+int main(int argc, char** argv) {
+  return google::protobuf::compiler::js::Run(argc, argv);
+}
@@ -28,12 +28,259 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// protoc-gen-js is normally run by protoc once per invocation, as a plugin
+// that reads one CodeGeneratorRequest from stdin and writes one
+// CodeGeneratorResponse to stdout.
+//
+// With --batch, it instead reads a stream of requests, each preceded by its
+// size as a varint, and writes a response in the same way for each of them,
+// until stdin is closed. This lets a build system keep one plugin process
+// alive for many generation actions. Files are built into a DescriptorPool
+// that is shared between requests, so that the imports common to many
+// requests (e.g. the well-known types) are only built once.
+
+#include <google/protobuf/compiler/code_generator.h>
 #include <google/protobuf/compiler/plugin.h>
+#include <google/protobuf/compiler/plugin.pb.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/delimited_message_util.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "generator/js_generator.h"
 
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace js {
+namespace {
+
+// The number of files after which the shared pool is replaced by a new one,
+// so that a long-lived process does not keep every file it ever built.
+const size_t kMaxPoolFiles = 4096;
+
+// Adds the files opened by the generator to a CodeGeneratorResponse.
+class ResponseContext : public GeneratorContext {
+ public:
+  ResponseContext(const Version& compiler_version,
+                  CodeGeneratorResponse* response,
+                  const std::vector<const FileDescriptor*>& parsed_files)
+      : compiler_version_(compiler_version),
+        response_(response),
+        parsed_files_(parsed_files) {}
+
+  io::ZeroCopyOutputStream* Open(const std::string& filename) override {
+    CodeGeneratorResponse::File* file = response_->add_file();
+    file->set_name(filename);
+    return new io::StringOutputStream(file->mutable_content());
+  }
+
+  io::ZeroCopyOutputStream* OpenForInsert(
+      const std::string& filename,
+      const std::string& insertion_point) override {
+    CodeGeneratorResponse::File* file = response_->add_file();
+    file->set_name(filename);
+    file->set_insertion_point(insertion_point);
+    return new io::StringOutputStream(file->mutable_content());
+  }
+
+  void ListParsedFiles(std::vector<const FileDescriptor*>* output) override {
+    *output = parsed_files_;
+  }
+
+  void GetCompilerVersion(Version* version) const override {
+    *version = compiler_version_;
+  }
+
+ private:
+  const Version& compiler_version_;
+  CodeGeneratorResponse* response_;
+  const std::vector<const FileDescriptor*>& parsed_files_;
+};
+
+// Serves CodeGeneratorRequests, keeping the files built for earlier requests.
+class BatchGenerator {
+ public:
+  explicit BatchGenerator(const CodeGenerator* generator)
+      : generator_(generator), pool_(new DescriptorPool) {}
+
+  // Generates the code for one request. Returns false, and sets *error, if
+  // the request is malformed; errors of the generator itself are returned in
+  // the response.
+  bool Generate(const CodeGeneratorRequest& request,
+                CodeGeneratorResponse* response, std::string* error);
+
+ private:
+  // Builds the files of the request that are not yet in the pool. If the
+  // pool holds a file of the same name with different contents, e.g. because
+  // the .proto file was edited between builds, or has grown past
+  // kMaxPoolFiles, it is replaced by a new pool. If a file fails to build
+  // in a pool that holds files of earlier requests, which may conflict with
+  // it, the request is built once more in a new pool.
+  bool BuildFiles(const CodeGeneratorRequest& request, std::string* error);
+  // Builds the files of the request, whose serialized forms are given, that
+  // are not yet in the pool.
+  bool BuildNewFiles(const CodeGeneratorRequest& request,
+                     const std::vector<std::string>& contents,
+                     std::string* error);
+  void ResetPool();
+
+  const CodeGenerator* generator_;
+  std::unique_ptr<DescriptorPool> pool_;
+  // The serialized FileDescriptorProto of every file in pool_, by name.
+  std::map<std::string, std::string> built_files_;
+};
+
+void BatchGenerator::ResetPool() {
+  pool_.reset(new DescriptorPool);
+  built_files_.clear();
+}
+
+bool BatchGenerator::BuildFiles(const CodeGeneratorRequest& request,
+                                std::string* error) {
+  std::vector<std::string> contents(request.proto_file_size());
+  for (int i = 0; i < request.proto_file_size(); i++) {
+    request.proto_file(i).SerializeToString(&contents[i]);
+    auto it = built_files_.find(request.proto_file(i).name());
+    if (it != built_files_.end() && it->second != contents[i]) {
+      ResetPool();
+      break;
+    }
+  }
+  if (built_files_.size() >= kMaxPoolFiles) {
+    ResetPool();
+  }
+
+  bool fresh = built_files_.empty();
+  if (BuildNewFiles(request, contents, error)) {
+    return true;
+  }
+  if (fresh) {
+    return false;
+  }
+  // A file of an earlier request may clash with one of this request, e.g. by
+  // defining the same symbol under another file name.
+  ResetPool();
+  return BuildNewFiles(request, contents, error);
+}
+
+bool BatchGenerator::BuildNewFiles(const CodeGeneratorRequest& request,
+                                   const std::vector<std::string>& contents,
+                                   std::string* error) {
+  for (int i = 0; i < request.proto_file_size(); i++) {
+    const FileDescriptorProto& file = request.proto_file(i);
+    if (built_files_.count(file.name())) {
+      continue;
+    }
+    if (pool_->BuildFile(file) == nullptr) {
+      *error = "Failed to build descriptor for " + file.name();
+      return false;
+    }
+    built_files_[file.name()] = contents[i];
+  }
+  return true;
+}
+
+bool BatchGenerator::Generate(const CodeGeneratorRequest& request,
+                              CodeGeneratorResponse* response,
+                              std::string* error) {
+  if (!BuildFiles(request, error)) {
+    return false;
+  }
+
+  std::vector<const FileDescriptor*> parsed_files;
+  for (int i = 0; i < request.file_to_generate_size(); i++) {
+    const FileDescriptor* file =
+        pool_->FindFileByName(request.file_to_generate(i));
+    if (file == nullptr) {
+      *error =
+          "protoc asked plugin to generate a file but did not provide a "
+          "descriptor for the file: " +
+          request.file_to_generate(i);
+      return false;
+    }
+    parsed_files.push_back(file);
+  }
+
+  ResponseContext context(request.compiler_version(), response, parsed_files);
+  std::string generator_error;
+  bool succeeded = generator_->GenerateAll(parsed_files, request.parameter(),
+                                           &context, &generator_error);
+  response->set_supported_features(generator_->GetSupportedFeatures());
+  if (!succeeded && generator_error.empty()) {
+    generator_error =
+        "Code generator returned false but provided no error description.";
+  }
+  if (!generator_error.empty()) {
+    response->set_error(generator_error);
+  }
+  return true;
+}
+
+int BatchMain(const CodeGenerator* generator) {
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  BatchGenerator batch(generator);
+  io::FileInputStream input(STDIN_FILENO);
+  io::FileOutputStream output(STDOUT_FILENO);
+  while (true) {
+    CodeGeneratorRequest request;
+    bool clean_eof = false;
+    if (!util::ParseDelimitedFromZeroCopyStream(&request, &input,
+                                                &clean_eof)) {
+      if (clean_eof) {
+        return 0;
+      }
+      std::cerr << "protoc-gen-js: protoc sent unparseable request to plugin."
+                << std::endl;
+      return 1;
+    }
+
+    // A malformed request only fails its own response, so that the process
+    // can go on serving the requests after it.
+    CodeGeneratorResponse response;
+    std::string error;
+    if (!batch.Generate(request, &response, &error)) {
+      response.Clear();
+      response.set_error(error);
+    }
+    if (!util::SerializeDelimitedToZeroCopyStream(response, &output) ||
+        !output.Flush()) {
+      std::cerr << "protoc-gen-js: Error writing to stdout." << std::endl;
+      return 1;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace js
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
 int main(int argc, char** argv) {
   std::unique_ptr<google::protobuf::compiler::CodeGenerator> generator(
       new google::protobuf::compiler::js::Generator());
+  if (argc == 2 && std::strcmp(argv[1], "--batch") == 0) {
+    return google::protobuf::compiler::js::BatchMain(generator.get());
+  }
   return google::protobuf::compiler::PluginMain(argc, argv, generator.get());
 }
@@ -36,11 +36,32 @@ struct FileToc well_known_types_js[] = {
      " * google/protobuf/any.proto. */\n"
      "\n"
      "/**\n"
+     " * The type URL getTypeName() last parsed, and the type name in it. "
+     "Most\n"
+     " * programs unpack a few types over and over, so this saves parsing the\n"
+     " * same URL on every call.\n"
+     " * @private {string}\n"
+     " */\n"
+     "proto.google.protobuf.Any.typeNameCacheUrl_ = '';\n"
+     "\n"
+     "\n"
+     "/** @private {string} */\n"
+     "proto.google.protobuf.Any.typeNameCacheName_ = '';\n"
+     "\n"
+     "\n"
+     "/**\n"
      " * Returns the type name contained in this instance, if any.\n"
      " * @return {string|undefined}\n"
      " */\n"
      "proto.google.protobuf.Any.prototype.getTypeName = function() {\n"
-     "  return this.getTypeUrl().split('/').pop();\n"
+     "  var Any = proto.google.protobuf.Any;\n"
+     "  var typeUrl = this.getTypeUrl();\n"
+     "  if (typeUrl !== Any.typeNameCacheUrl_) {\n"
+     "    Any.typeNameCacheName_ =\n"
+     "        typeUrl.substring(typeUrl.lastIndexOf('/') + 1);\n"
+     "    Any.typeNameCacheUrl_ = typeUrl;\n"
+     "  }\n"
+     "  return Any.typeNameCacheName_;\n"
      "};\n"
      "\n"
      "\n"
@@ -86,8 +107,7 @@ struct FileToc well_known_types_js[] = {
      "  } else {\n"
      "    return null;\n"
      "  }\n"
-     "};\n"
-    },
+     "};\n"},
     {"timestamp.js",
      "/* This code will be inserted into generated code for\n"
      " * google/protobuf/timestamp.proto. */\n"
@@ -105,12 +125,38 @@ struct FileToc well_known_types_js[] = {
      "\n"
      "\n"
      "/**\n"
+     " * Returns the time of this Timestamp in milliseconds since the Unix "
+     "epoch,\n"
+     " * rounded down. Unlike toDate(), this does not allocate a Date.\n"
+     " * @return {number}\n"
+     " */\n"
+     "proto.google.protobuf.Timestamp.prototype.toMillis = function() {\n"
+     "  return (this.getSeconds() * 1000) + Math.floor(this.getNanos() / "
+     "1000000);\n"
+     "};\n"
+     "\n"
+     "\n"
+     "/**\n"
      " * Sets the value of this Timestamp object to be the given Date.\n"
      " * @param {!Date} value The value to set.\n"
      " */\n"
      "proto.google.protobuf.Timestamp.prototype.fromDate = function(value) {\n"
-     "  this.setSeconds(Math.floor(value.getTime() / 1000));\n"
-     "  this.setNanos(value.getMilliseconds() * 1000000);\n"
+     "  this.fromMillis(value.getTime());\n"
+     "};\n"
+     "\n"
+     "\n"
+     "/**\n"
+     " * Sets the value of this Timestamp object to be the given time, without "
+     "the\n"
+     " * Date that fromDate() needs.\n"
+     " * @param {number} millis A whole number of milliseconds since the Unix "
+     "epoch.\n"
+     " */\n"
+     "proto.google.protobuf.Timestamp.prototype.fromMillis = function(millis) "
+     "{\n"
+     "  var seconds = Math.floor(millis / 1000);\n"
+     "  this.setSeconds(seconds);\n"
+     "  this.setNanos((millis - (seconds * 1000)) * 1000000);\n"
      "};\n"
      "\n"
      "\n"
@@ -124,6 +170,20 @@ struct FileToc well_known_types_js[] = {
      "  var timestamp = new proto.google.protobuf.Timestamp();\n"
      "  timestamp.fromDate(value);\n"
      "  return timestamp;\n"
+     "};\n"
+     "\n"
+     "\n"
+     "/**\n"
+     " * Factory method that returns a Timestamp object with value equal to\n"
+     " * the given time.\n"
+     " * @param {number} millis A whole number of milliseconds since the Unix "
+     "epoch.\n"
+     " * @return {!proto.google.protobuf.Timestamp}\n"
+     " */\n"
+     "proto.google.protobuf.Timestamp.fromMillis = function(millis) {\n"
+     "  var timestamp = new proto.google.protobuf.Timestamp();\n"
+     "  timestamp.fromMillis(millis);\n"
+     "  return timestamp;\n"
      "};\n"},
     {"struct.js",
      "/* This code will be inserted into generated code for\n"
@@ -138,25 +198,38 @@ struct FileToc well_known_types_js[] = {
      "\n"
      "\n"
      "/**\n"
-     " * Converts this Value object to a plain JavaScript value.\n"
-     " * @return {?proto.google.protobuf.JavaScriptValue} a plain JavaScript\n"
-     " *     value representing this Struct.\n"
+     " * Converts a Value to a plain JavaScript value. A struct or list value "
+     "is\n"
+     " * converted to a new, empty object or array, which is pushed onto the "
+     "given\n"
+     " * stack with its Struct or ListValue, for fillJavaScript_() to fill in. "
+     "This\n"
+     " * keeps deeply nested values from growing the call stack.\n"
+     " * @param {!proto.google.protobuf.Value} value\n"
+     " * @param {!Array} stack\n"
+     " * @return {?proto.google.protobuf.JavaScriptValue}\n"
+     " * @private\n"
      " */\n"
-     "proto.google.protobuf.Value.prototype.toJavaScript = function() {\n"
+     "proto.google.protobuf.Value.kindToJavaScript_ = function(value, stack) "
+     "{\n"
      "  var kindCase = proto.google.protobuf.Value.KindCase;\n"
-     "  switch (this.getKindCase()) {\n"
+     "  switch (value.getKindCase()) {\n"
      "    case kindCase.NULL_VALUE:\n"
      "      return null;\n"
      "    case kindCase.NUMBER_VALUE:\n"
-     "      return this.getNumberValue();\n"
+     "      return value.getNumberValue();\n"
      "    case kindCase.STRING_VALUE:\n"
-     "      return this.getStringValue();\n"
+     "      return value.getStringValue();\n"
      "    case kindCase.BOOL_VALUE:\n"
-     "      return this.getBoolValue();\n"
+     "      return value.getBoolValue();\n"
      "    case kindCase.STRUCT_VALUE:\n"
-     "      return this.getStructValue().toJavaScript();\n"
+     "      var object = {};\n"
+     "      stack.push(value.getStructValue(), object);\n"
+     "      return object;\n"
      "    case kindCase.LIST_VALUE:\n"
-     "      return this.getListValue().toJavaScript();\n"
+     "      var array = [];\n"
+     "      stack.push(value.getListValue(), array);\n"
+     "      return array;\n"
      "    default:\n"
      "      throw new Error('Unexpected struct type');\n"
      "  }\n"
@@ -164,38 +237,126 @@ struct FileToc well_known_types_js[] = {
      "\n"
      "\n"
      "/**\n"
-     " * Converts this JavaScript value to a new Value proto.\n"
-     " * @param {!proto.google.protobuf.JavaScriptValue} value The value to\n"
-     " *     convert.\n"
-     " * @return {!proto.google.protobuf.Value} The newly constructed value.\n"
+     " * Fills in the objects and arrays on the stack, as pairs of a Struct "
+     "or\n"
+     " * ListValue and its JavaScript value, until the stack is empty.\n"
+     " * @param {!Array} stack\n"
+     " * @private\n"
      " */\n"
-     "proto.google.protobuf.Value.fromJavaScript = function(value) {\n"
+     "proto.google.protobuf.Value.fillJavaScript_ = function(stack) {\n"
+     "  var Value = proto.google.protobuf.Value;\n"
+     "  var fill = function(value, key) {\n"
+     "    this[key] = Value.kindToJavaScript_(value, stack);\n"
+     "  };\n"
+     "  while (stack.length) {\n"
+     "    var target = stack.pop();\n"
+     "    var source = stack.pop();\n"
+     "    if (source instanceof proto.google.protobuf.Struct) {\n"
+     "      source.getFieldsMap().forEach(fill, target);\n"
+     "    } else {\n"
+     "      var values = source.getValuesList();\n"
+     "      for (var i = 0; i < values.length; i++) {\n"
+     "        target[i] = Value.kindToJavaScript_(values[i], stack);\n"
+     "      }\n"
+     "    }\n"
+     "  }\n"
+     "};\n"
+     "\n"
+     "\n"
+     "/**\n"
+     " * Converts this Value object to a plain JavaScript value.\n"
+     " * @return {?proto.google.protobuf.JavaScriptValue} a plain JavaScript\n"
+     " *     value representing this Struct.\n"
+     " */\n"
+     "proto.google.protobuf.Value.prototype.toJavaScript = function() {\n"
+     "  var stack = [];\n"
+     "  var ret = proto.google.protobuf.Value.kindToJavaScript_(this, stack);\n"
+     "  proto.google.protobuf.Value.fillJavaScript_(stack);\n"
+     "  return ret;\n"
+     "};\n"
+     "\n"
+     "\n"
+     "/**\n"
+     " * Converts a plain JavaScript value to a new Value proto. An object or "
+     "array\n"
+     " * is converted to a Value holding a new, empty Struct or ListValue, "
+     "which is\n"
+     " * pushed onto the given stack with the object or array, for\n"
+     " * fillFromJavaScript_() to fill in.\n"
+     " * @param {?proto.google.protobuf.JavaScriptValue} value\n"
+     " * @param {!Array} stack\n"
+     " * @return {!proto.google.protobuf.Value}\n"
+     " * @private\n"
+     " */\n"
+     "proto.google.protobuf.Value.kindFromJavaScript_ = function(value, stack) "
+     "{\n"
      "  var ret = new proto.google.protobuf.Value();\n"
-     "  switch (goog.typeOf(value)) {\n"
+     "  switch (typeof value) {\n"
      "    case 'string':\n"
      "      ret.setStringValue(/** @type {string} */ (value));\n"
-     "      break;\n"
+     "      return ret;\n"
      "    case 'number':\n"
      "      ret.setNumberValue(/** @type {number} */ (value));\n"
-     "      break;\n"
+     "      return ret;\n"
      "    case 'boolean':\n"
      "      ret.setBoolValue(/** @type {boolean} */ (value));\n"
-     "      break;\n"
-     "    case 'null':\n"
-     "      ret.setNullValue(proto.google.protobuf.NullValue.NULL_VALUE);\n"
-     "      break;\n"
-     "    case 'array':\n"
-     "      ret.setListValue(proto.google.protobuf.ListValue.fromJavaScript(\n"
-     "          /** @type{!Array} */ (value)));\n"
-     "      break;\n"
+     "      return ret;\n"
      "    case 'object':\n"
-     "      ret.setStructValue(proto.google.protobuf.Struct.fromJavaScript(\n"
-     "          /** @type{!Object} */ (value)));\n"
-     "      break;\n"
+     "      if (value === null) {\n"
+     "        ret.setNullValue(proto.google.protobuf.NullValue.NULL_VALUE);\n"
+     "      } else if (Array.isArray(value)) {\n"
+     "        var list = new proto.google.protobuf.ListValue();\n"
+     "        ret.setListValue(list);\n"
+     "        stack.push(value, list);\n"
+     "      } else {\n"
+     "        var struct = new proto.google.protobuf.Struct();\n"
+     "        ret.setStructValue(struct);\n"
+     "        stack.push(value, struct);\n"
+     "      }\n"
+     "      return ret;\n"
      "    default:\n"
      "      throw new Error('Unexpected struct type.');\n"
      "  }\n"
+     "};\n"
      "\n"
+     "\n"
+     "/**\n"
+     " * Fills in the Structs and ListValues on the stack, as pairs of a\n"
+     " * JavaScript object or array and its proto, until the stack is empty.\n"
+     " * @param {!Array} stack\n"
+     " * @private\n"
+     " */\n"
+     "proto.google.protobuf.Value.fillFromJavaScript_ = function(stack) {\n"
+     "  var Value = proto.google.protobuf.Value;\n"
+     "  while (stack.length) {\n"
+     "    var target = stack.pop();\n"
+     "    var source = stack.pop();\n"
+     "    if (target instanceof proto.google.protobuf.Struct) {\n"
+     "      var map = target.getFieldsMap();\n"
+     "      for (var property in source) {\n"
+     "        map.set(property, Value.kindFromJavaScript_(source[property], "
+     "stack));\n"
+     "      }\n"
+     "    } else {\n"
+     "      for (var i = 0; i < source.length; i++) {\n"
+     "        target.addValues(Value.kindFromJavaScript_(source[i], stack));\n"
+     "      }\n"
+     "    }\n"
+     "  }\n"
+     "};\n"
+     "\n"
+     "\n"
+     "/**\n"
+     " * Converts this JavaScript value to a new Value proto.\n"
+     " * @param {!proto.google.protobuf.JavaScriptValue} value The value to\n"
+     " *     convert.\n"
+     " * @return {!proto.google.protobuf.Value} The newly constructed value.\n"
+     " */\n"
+     "proto.google.protobuf.Value.fromJavaScript = function(value) {\n"
+     "  var stack = [];\n"
+     "  var ret = proto.google.protobuf.Value.kindFromJavaScript_(value, "
+     "stack);\n"
+     "  proto.google.protobuf.Value.fillFromJavaScript_(stack);\n"
      "  return ret;\n"
      "};\n"
      "\n"
@@ -206,12 +367,7 @@ struct FileToc well_known_types_js[] = {
      " */\n"
      "proto.google.protobuf.ListValue.prototype.toJavaScript = function() {\n"
      "  var ret = [];\n"
-     "  var values = this.getValuesList();\n"
-     "\n"
-     "  for (var i = 0; i < values.length; i++) {\n"
-     "    ret[i] = values[i].toJavaScript();\n"
-     "  }\n"
-     "\n"
+     "  proto.google.protobuf.Value.fillJavaScript_([this, ret]);\n"
      "  return ret;\n"
      "};\n"
      "\n"
@@ -223,12 +379,7 @@ struct FileToc well_known_types_js[] = {
      " */\n"
      "proto.google.protobuf.ListValue.fromJavaScript = function(array) {\n"
      "  var ret = new proto.google.protobuf.ListValue();\n"
-     "\n"
-     "  for (var i = 0; i < array.length; i++) {\n"
-     "    "
-     "ret.addValues(proto.google.protobuf.Value.fromJavaScript(array[i]));\n"
-     "  }\n"
-     "\n"
+     "  proto.google.protobuf.Value.fillFromJavaScript_([array, ret]);\n"
      "  return ret;\n"
      "};\n"
      "\n"
@@ -241,11 +392,7 @@ struct FileToc well_known_types_js[] = {
      " */\n"
      "proto.google.protobuf.Struct.prototype.toJavaScript = function() {\n"
      "  var ret = {};\n"
-     "\n"
-     "  this.getFieldsMap().forEach(function(value, key) {\n"
-     "    ret[key] = value.toJavaScript();\n"
-     "  });\n"
-     "\n"
+     "  proto.google.protobuf.Value.fillJavaScript_([this, ret]);\n"
      "  return ret;\n"
      "};\n"
      "\n"
@@ -257,13 +404,7 @@ struct FileToc well_known_types_js[] = {
      " */\n"
      "proto.google.protobuf.Struct.fromJavaScript = function(obj) {\n"
      "  var ret = new proto.google.protobuf.Struct();\n"
-     "  var map = ret.getFieldsMap();\n"
-     "\n"
-     "  for (var property in obj) {\n"
-     "    var val = obj[property];\n"
-     "    map.set(property, proto.google.protobuf.Value.fromJavaScript(val));\n"
-     "  }\n"
-     "\n"
+     "  proto.google.protobuf.Value.fillFromJavaScript_([obj, ret]);\n"
      "  return ret;\n"
      "};\n"},
     {NULL, NULL}  // Terminate the list.
@@ -1,5 +1,6 @@
 const {series} = require('gulp');
 const execFile = require('child_process').execFile;
+const fs = require('fs');
 const glob = require('glob');
 
 function exec(command, cb) {
@@ -59,6 +60,37 @@ const group3Protos = [
   'protos/test10.proto'
 ];
 
+// The options the test protos are generated with.
+const testProtoOptions =
+    'binary,sizing,writer_reuse,reuse,delimited,batch,field_masks,json,' +
+    'lazy=annotated';
+
+// Variants of the Closure test run: each runs the same suites as
+// test_closure, against test protos generated into variants_out/<name> with
+// its options added to testProtoOptions.
+const closureTestVariants = {
+  'codec_table': 'codec=table',
+  'inline_accessors': 'inline_accessors',
+  'expected_tags': 'expected_tags',
+};
+
+// Variants of the CommonJS test run: each runs the same suites as
+// test_commonjs, along with its own tests from commonjs/, in
+// commonjs_out/variants/<name> against test protos generated there with its
+// options added to testProtoOptions.
+const commonjsTestVariants = {
+  'lazy_init': {
+    options: 'lazy_init',
+    tests: ['commonjs/lazy_init_test.js'],
+  },
+  'compact': {
+    options: 'compact',
+    tests: [],
+  },
+};
+
+const throughputProto = 'experimental/benchmarks/throughput/throughput.proto';
+
 function make_exec_logging_callback(cb) {
   return (err, stdout, stderr) => {
     console.log(stdout);
@@ -78,12 +110,12 @@ function enableSimpleOptimizations(cb) {
 }
 
 function genproto_well_known_types_closure(cb) {
-  exec(protoc + ' --js_out=one_output_file_per_input_file,binary:. -I ' + protocInc + ' -I . ' + wellKnownTypes.join(' '),
+  exec(protoc + ' --js_out=one_output_file_per_input_file,binary,json:. -I ' + protocInc + ' -I . ' + wellKnownTypes.join(' '),
        make_exec_logging_callback(cb));
 }
 
 function genproto_group1_closure(cb) {
-  exec(protoc + ' --js_out=library=testproto_libs1,binary:.  -I ' + protocInc + ' -I . ' + group1Protos.join(' '),
+  exec(protoc + ' --js_out=library=testproto_libs1,' + testProtoOptions + ':.  -I ' + protocInc + ' -I . ' + group1Protos.join(' '),
        make_exec_logging_callback(cb));
 }
 
@@ -91,31 +123,70 @@ function genproto_group2_closure(cb) {
   exec(
       protoc +
         ' --experimental_allow_proto3_optional' +
-        ' --js_out=library=testproto_libs2,binary:.  -I ' + protocInc + ' -I . -I commonjs ' +
+        ' --js_out=library=testproto_libs2,' + testProtoOptions + ':.  -I ' + protocInc + ' -I . -I commonjs ' +
         group2Protos.join(' '),
       make_exec_logging_callback(cb));
 }
 
+function genproto_kernel_closure(cb) {
+  exec(
+      'mkdir -p kernel_out && ' + protoc +
+        ' --js_out=runtime=kernel:kernel_out -I . protos/testbinary.proto',
+      make_exec_logging_callback(cb));
+}
+
+function genproto_closure_variants(cb) {
+  const commands = Object.keys(closureTestVariants).map((name) => {
+    const out = 'variants_out/' + name;
+    const options = testProtoOptions + ',' + closureTestVariants[name];
+    return 'mkdir -p ' + out + ' && ' +
+        protoc + ' --js_out=library=testproto_libs1,' + options + ':' + out +
+        ' -I ' + protocInc + ' -I . ' + group1Protos.join(' ') + ' && ' +
+        protoc + ' --experimental_allow_proto3_optional' +
+        ' --js_out=library=testproto_libs2,' + options + ':' + out +
+        ' -I ' + protocInc + ' -I . -I commonjs ' + group2Protos.join(' ');
+  });
+  exec(commands.join(' && ') || 'true', make_exec_logging_callback(cb));
+}
+
+// Writes the Jasmine config of each Closure test variant: that of
+// test_closure, with the test protos of the variant as helpers.
+function closure_variants_config(cb) {
+  const config = JSON.parse(fs.readFileSync('jasmine.json', 'utf8'));
+  for (const name of Object.keys(closureTestVariants)) {
+    const out = 'variants_out/' + name;
+    const variantConfig = Object.assign({}, config, {
+      helpers: config.helpers.map(
+          (helper) => helper.startsWith('testproto_libs') ?
+              out + '/' + helper :
+              helper),
+    });
+    fs.writeFileSync(
+        out + '/jasmine.json', JSON.stringify(variantConfig, null, 4) + '\n');
+  }
+  cb();
+}
+
 function genproto_well_known_types_commonjs(cb) {
-            exec('mkdir -p commonjs_out && ' + protoc + ' --js_out=import_style=commonjs,binary:commonjs_out -I ' + protocInc + ' ' + wellKnownTypes.join(' '),
+            exec('mkdir -p commonjs_out && ' + protoc + ' --js_out=import_style=commonjs,binary,json:commonjs_out -I ' + protocInc + ' ' + wellKnownTypes.join(' '),
                  make_exec_logging_callback(cb));
 }
 
 function genproto_group1_commonjs(cb) {
-            exec('mkdir -p commonjs_out && ' + protoc + ' --js_out=import_style=commonjs,binary:commonjs_out -I ' + protocInc + ' -I commonjs -I . ' + group1Protos.join(' '),
+            exec('mkdir -p commonjs_out && ' + protoc + ' --js_out=import_style=commonjs,' + testProtoOptions + ':commonjs_out -I ' + protocInc + ' -I commonjs -I . ' + group1Protos.join(' '),
                  make_exec_logging_callback(cb));
 }
 
 function genproto_group2_commonjs(cb) {
   exec(
       'mkdir -p commonjs_out && ' + protoc +
-        ' --experimental_allow_proto3_optional --js_out=import_style=commonjs,binary:commonjs_out -I ' + protocInc + ' -I commonjs -I . ' +
+        ' --experimental_allow_proto3_optional --js_out=import_style=commonjs,' + testProtoOptions + ':commonjs_out -I ' + protocInc + ' -I commonjs -I . ' +
         group2Protos.join(' '),
       make_exec_logging_callback(cb));
 }
 
 function genproto_commonjs_wellknowntypes(cb) {
-            exec('mkdir -p commonjs_out/node_modules/google-protobuf && ' + protoc + ' --js_out=import_style=commonjs,binary:commonjs_out/node_modules/google-protobuf -I ' + protocInc + ' ' + wellKnownTypes.join(' '),
+            exec('mkdir -p commonjs_out/node_modules/google-protobuf && ' + protoc + ' --js_out=import_style=commonjs,binary,json:commonjs_out/node_modules/google-protobuf -I ' + protocInc + ' ' + wellKnownTypes.join(' '),
                  make_exec_logging_callback(cb));
 }
 
@@ -124,6 +195,21 @@ function genproto_wellknowntypes(cb) {
                  make_exec_logging_callback(cb));
 }
 
+function genproto_commonjs_variants(cb) {
+  const commands = Object.keys(commonjsTestVariants).map((name) => {
+    const out = 'commonjs_out/variants/' + name;
+    const options = 'import_style=commonjs,' + testProtoOptions + ',' +
+        commonjsTestVariants[name].options;
+    return 'mkdir -p ' + out + ' && ' +
+        protoc + ' --js_out=' + options + ':' + out + ' -I ' + protocInc +
+        ' -I commonjs -I . ' + group1Protos.join(' ') + ' && ' +
+        protoc + ' --experimental_allow_proto3_optional' +
+        ' --js_out=' + options + ':' + out + ' -I ' + protocInc +
+        ' -I commonjs -I . ' + group2Protos.join(' ');
+  });
+  exec(commands.join(' && ') || 'true', make_exec_logging_callback(cb));
+}
+
 function genproto_group3_commonjs_strict(cb) {
             exec('mkdir -p commonjs_out && ' + protoc + ' --js_out=import_style=commonjs_strict,binary:commonjs_out -I ' + protocInc + ' -I commonjs -I . ' + group3Protos.join(' '),
                  make_exec_logging_callback(cb));
@@ -138,12 +224,16 @@ function getClosureCompilerCommand(exportsFile, outputFile) {
     `--js=${closureLib}/third_party/closure/goog/**.js`,
     '--js=asserts.js',
     '--js=debug.js',
+    '--js=json.js',
     '--js=map.js',
     '--js=message.js',
     '--js=binary/arith.js',
+    '--js=binary/batch.js',
+    '--js=binary/codec.js',
     '--js=binary/constants.js',
     '--js=binary/decoder.js',
     '--js=binary/encoder.js',
+    '--js=binary/instrumentation.js',
     '--js=binary/reader.js',
     '--js=binary/utils.js',
     '--js=binary/writer.js',
@@ -192,9 +282,35 @@ function commonjs_out(cb) {
 
 
 
+// Sets up each CommonJS test variant like commonjs_out(), sharing the
+// well-known types and test_node_modules of commonjs_out.
+function commonjs_variants_out(cb) {
+  let cmd = '';
+  for (const name of Object.keys(commonjsTestVariants)) {
+    const out = 'commonjs_out/variants/' + name;
+    cmd += 'mkdir -p ' + out + '/binary && ' +
+        'cp -r commonjs_out/google commonjs_out/node_modules ' + out + ' && ';
+    glob.sync('*_test.js').concat(glob.sync('binary/*_test.js'))
+        .forEach((file) => {
+          cmd += 'node commonjs/rewrite_tests_for_commonjs.js < ' + file +
+              ' > ' + out + '/' + file + ' && ';
+        });
+    commonjsTestVariants[name].tests.forEach((file) => {
+      cmd += 'cp ' + file + ' ' + out + ' && ';
+    });
+    cmd += 'cp commonjs/jasmine.json ' + out + '/jasmine.json && ';
+  }
+  exec(cmd + 'true', make_exec_logging_callback(cb));
+}
+
 function closure_make_deps(cb) {
+  const kernelFiles = [].concat(
+      glob.sync('experimental/runtime/**/*.js',
+                {ignore: 'experimental/runtime/**/*_test*.js'}),
+      glob.sync('kernel_out/**/*.js'));
   exec(
-      './node_modules/.bin/closure-make-deps --closure-path=. --file=node_modules/google-closure-library/closure/goog/deps.js binary/arith.js binary/constants.js binary/decoder.js binary/encoder.js binary/reader.js binary/utils.js binary/writer.js asserts.js debug.js map.js message.js node_loader.js test_bootstrap.js > deps.js',
+      './node_modules/.bin/closure-make-deps --closure-path=. --file=node_modules/google-closure-library/closure/goog/deps.js binary/arith.js binary/batch.js binary/codec.js binary/constants.js binary/decoder.js binary/encoder.js binary/instrumentation.js binary/reader.js binary/utils.js binary/writer.js asserts.js debug.js json.js map.js message.js node_loader.js test_bootstrap.js ' +
+          kernelFiles.join(' ') + ' > deps.js',
       make_exec_logging_callback(cb));
 }
 
@@ -204,13 +320,58 @@ function test_closure(cb) {
       make_exec_logging_callback(cb));
 }
 
+function test_closure_variants(cb) {
+  const commands = Object.keys(closureTestVariants).map(
+      (name) => 'JASMINE_CONFIG_PATH=variants_out/' + name +
+          '/jasmine.json ./node_modules/.bin/jasmine');
+  exec(commands.join(' && ') || 'true', make_exec_logging_callback(cb));
+}
+
 function test_commonjs(cb) {
   exec('cd commonjs_out && JASMINE_CONFIG_PATH=jasmine.json NODE_PATH=test_node_modules ../node_modules/.bin/jasmine',
        make_exec_logging_callback(cb));
 }
 
+function test_commonjs_variants(cb) {
+  const commands = Object.keys(commonjsTestVariants).map(
+      (name) => '(cd commonjs_out/variants/' + name +
+          ' && JASMINE_CONFIG_PATH=jasmine.json' +
+          ' NODE_PATH=../../test_node_modules' +
+          ' ../../../node_modules/.bin/jasmine)');
+  exec(commands.join(' && ') || 'true', make_exec_logging_callback(cb));
+}
+
+function genproto_throughput_benchmark(cb) {
+  exec('mkdir -p benchmark_out && ' + protoc +
+           ' --js_out=library=benchmark_out/throughput_jspb,binary:. -I . ' +
+           throughputProto + ' && ' + protoc +
+           ' --js_out=runtime=kernel:benchmark_out -I . ' + throughputProto,
+       make_exec_logging_callback(cb));
+}
+
+function throughput_make_deps(cb) {
+  const files = [
+    'asserts.js', 'debug.js', 'json.js', 'map.js', 'message.js',
+    'node_loader.js',
+  ].concat(glob.sync('binary/*.js', {ignore: 'binary/*_test.js'}),
+           glob.sync('experimental/runtime/**/*.js',
+                     {ignore: 'experimental/runtime/**/*_test*.js'}),
+           glob.sync('benchmark_out/**/*.js', {ignore: 'benchmark_out/deps.js'}),
+           glob.sync('experimental/benchmarks/throughput/*.js',
+                     {ignore: '**/run_throughput.js'}));
+  exec(
+      './node_modules/.bin/closure-make-deps --closure-path=. --file=node_modules/google-closure-library/closure/goog/deps.js ' +
+          files.join(' ') + ' > benchmark_out/deps.js',
+      make_exec_logging_callback(cb));
+}
+
+function run_throughput_benchmark(cb) {
+  exec('node --expose-gc --max-semi-space-size=64 experimental/benchmarks/throughput/run_throughput.js',
+       make_exec_logging_callback(cb));
+}
+
 function remove_gen_files(cb) {
-  exec('rm -rf commonjs_out google-protobuf.js deps.js',
+  exec('rm -rf benchmark_out commonjs_out google-protobuf.js deps.js kernel_out variants_out',
        make_exec_logging_callback(cb));
 }
 
@@ -231,17 +392,21 @@ exports.build_commonjs = series(
     genproto_group1_commonjs, genproto_group2_commonjs,
     genproto_commonjs_wellknowntypes,
     commonjs_testdeps, genproto_group3_commonjs_strict,
-    commonjs_out);
+    commonjs_out, genproto_commonjs_variants, commonjs_variants_out);
 
 exports.build_closure = series(exports.build_protoc_plugin,
                                genproto_well_known_types_closure,
                                genproto_group1_closure,
                                genproto_group2_closure,
+                               genproto_kernel_closure,
+                               genproto_closure_variants,
+                               closure_variants_config,
                                closure_make_deps);
 
 const test_closure_series = series(
     exports.build_closure,
-    test_closure);
+    test_closure,
+    test_closure_variants);
 
 exports.test_closure = series(enableSimpleOptimizations,
                               test_closure_series);
@@ -252,7 +417,8 @@ exports.test_closure_opt = series(enableAdvancedOptimizations,
 
 const test_commonjs_series = series(
     exports.build_commonjs,
-    test_commonjs);
+    test_commonjs,
+    test_commonjs_variants);
 
 
 exports.test_commonjs = series(enableSimpleOptimizations,
@@ -269,4 +435,12 @@ exports.test = series(enableSimpleOptimizations,
 exports.test_opt = series(enableAdvancedOptimizations,
                           test_series);
 
+// Measures the throughput of the code generated for the classic
+// jspb.Message runtime and for the Kernel runtime, see
+// experimental/benchmarks/throughput.
+exports.benchmark_throughput = series(exports.build_protoc_plugin,
+                                      genproto_throughput_benchmark,
+                                      throughput_make_deps,
+                                      run_throughput_benchmark);
+
 exports.clean = series(remove_gen_files);
@@ -0,0 +1,990 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @fileoverview This file contains the runtime support of the canonical
+ * proto3 JSON mapping, for messages generated with the `json` option of
+ * protoc-gen-js.
+ *
+ * Such messages get toJsonString() and fromJsonString(), which are built on a
+ * generated serializeJsonToWriter() and deserializeJsonFromReader() per
+ * message, like their binary counterparts. jspb.JsonWriter appends the JSON
+ * text of each field directly to its result, without building an object tree
+ * first, and jspb.JsonReader converts the values of parsed JSON into field
+ * values, checking them against the mapping.
+ *
+ * Enum values are written by name, using the names the generator emits next
+ * to each enum as `<Enum>$JsonNames`. google.protobuf.Any is written with the
+ * JSON of the message it holds, so its type must be in the type registry of
+ * the jspb.JsonOptions.
+ */
+
+goog.provide('jspb.JsonOptions');
+goog.provide('jspb.JsonReader');
+goog.provide('jspb.JsonWriter');
+
+goog.require('jspb.Message');
+
+
+/**
+ * Options of toJsonString() and fromJsonString():
+ *  - ignoreUnknownFields: whether fromJsonString() skips the fields that are
+ *    not in the message, instead of throwing an error.
+ *  - typeRegistry: the message constructors by full type name (e.g.
+ *    'google.protobuf.Duration'), for the types held by google.protobuf.Any.
+ * @typedef {{
+ *   ignoreUnknownFields: (boolean|undefined),
+ *   typeRegistry: (!Object<string, !Function>|undefined)
+ * }}
+ */
+jspb.JsonOptions;
+
+
+/**
+ * Builds the proto3 JSON text of messages, for their generated
+ * serializeJsonToWriter().
+ * @param {!jspb.JsonOptions=} opt_options
+ * @constructor
+ * @struct
+ * @export
+ */
+jspb.JsonWriter = function(opt_options) {
+  /**
+   * The JSON written so far.
+   * @private {string}
+   */
+  this.out_ = '';
+
+  /**
+   * What is written before the next value or property name: a comma after a
+   * value, and nothing at the start of an object or array or after a name.
+   * @private {string}
+   */
+  this.separator_ = '';
+
+  /**
+   * Whether the next beginObject() continues the object that writeAny() has
+   * opened with its "@type" property, rather than opening another one.
+   * @private {boolean}
+   */
+  this.continueObject_ = false;
+
+  /**
+   * @private {?Object<string, !Function>}
+   */
+  this.typeRegistry_ = (opt_options && opt_options.typeRegistry) || null;
+};
+
+
+/**
+ * The types held by google.protobuf.Any as a JSON value in the "value"
+ * property, rather than as the properties of the Any object itself.
+ * @const {!Object<string, boolean>}
+ * @private
+ */
+jspb.JsonWriter.VALUE_TYPES_ = {
+  'google.protobuf.Any': true,
+  'google.protobuf.BoolValue': true,
+  'google.protobuf.BytesValue': true,
+  'google.protobuf.DoubleValue': true,
+  'google.protobuf.Duration': true,
+  'google.protobuf.FieldMask': true,
+  'google.protobuf.FloatValue': true,
+  'google.protobuf.Int32Value': true,
+  'google.protobuf.Int64Value': true,
+  'google.protobuf.ListValue': true,
+  'google.protobuf.StringValue': true,
+  'google.protobuf.Struct': true,
+  'google.protobuf.Timestamp': true,
+  'google.protobuf.UInt32Value': true,
+  'google.protobuf.UInt64Value': true,
+  'google.protobuf.Value': true
+};
+
+
+/**
+ * The range of the seconds of google.protobuf.Timestamp, from
+ * 0001-01-01T00:00:00Z to 9999-12-31T23:59:59Z.
+ * @const {number}
+ * @private
+ */
+jspb.JsonWriter.MIN_TIMESTAMP_SECONDS_ = -62135596800;
+
+
+/**
+ * @const {number}
+ * @private
+ */
+jspb.JsonWriter.MAX_TIMESTAMP_SECONDS_ = 253402300799;
+
+
+/**
+ * The range of the seconds of google.protobuf.Duration, about 10000 years.
+ * @const {number}
+ * @private
+ */
+jspb.JsonWriter.MAX_DURATION_SECONDS_ = 315576000000;
+
+
+/**
+ * Returns the message constructor registered for the type of the given
+ * google.protobuf.Any type URL.
+ * @param {?Object<string, !Function>} typeRegistry
+ * @param {string} typeUrl
+ * @return {?} The constructor, with the static methods of generated messages.
+ * @private
+ */
+jspb.JsonWriter.findType_ = function(typeRegistry, typeUrl) {
+  var typeName = typeUrl.substr(typeUrl.lastIndexOf('/') + 1);
+  var type = typeRegistry && typeRegistry[typeName];
+  if (!type) {
+    throw new Error(
+        'No type named ' + typeName + ' in the JSON type registry, for ' +
+        'google.protobuf.Any');
+  }
+  return type;
+};
+
+
+/**
+ * Returns the digits of the fraction of a second for the given nanoseconds:
+ * none, or 3, 6 or 9 digits, as required for Timestamp and Duration.
+ * @param {number} nanos Between 0 and 999999999.
+ * @return {string}
+ * @private
+ */
+jspb.JsonWriter.formatNanos_ = function(nanos) {
+  if (nanos == 0) {
+    return '';
+  }
+  var digits = String(1000000000 + nanos).substr(1);
+  if (nanos % 1000000 == 0) {
+    return '.' + digits.substr(0, 3);
+  }
+  if (nanos % 1000 == 0) {
+    return '.' + digits.substr(0, 6);
+  }
+  return '.' + digits;
+};
+
+
+/**
+ * Returns the JSON written so far.
+ * @return {string}
+ * @export
+ */
+jspb.JsonWriter.prototype.getResultString = function() {
+  return this.out_;
+};
+
+
+/**
+ * Appends the JSON text of a value.
+ * @param {string} json
+ * @private
+ */
+jspb.JsonWriter.prototype.writeValue_ = function(json) {
+  this.out_ += this.separator_ + json;
+  this.separator_ = ',';
+};
+
+
+/**
+ * Opens an object.
+ * @export
+ */
+jspb.JsonWriter.prototype.beginObject = function() {
+  if (this.continueObject_) {
+    this.continueObject_ = false;
+    return;
+  }
+  this.out_ += this.separator_ + '{';
+  this.separator_ = '';
+};
+
+
+/**
+ * Closes the innermost object.
+ * @export
+ */
+jspb.JsonWriter.prototype.endObject = function() {
+  this.out_ += '}';
+  this.separator_ = ',';
+};
+
+
+/**
+ * Writes the name of the next property of the innermost object.
+ * @param {string} name
+ * @export
+ */
+jspb.JsonWriter.prototype.writeName = function(name) {
+  this.out_ += this.separator_ + JSON.stringify(name) + ':';
+  this.separator_ = '';
+};
+
+
+/**
+ * Writes an array, with the given method writing each of its values.
+ * @param {!ArrayLike<T>} values
+ * @param {function(this:jspb.JsonWriter, T, ?=)} writeValue A method of
+ *     jspb.JsonWriter.
+ * @param {?=} opt_writeArg The second argument of writeValue, for enums and
+ *     messages.
+ * @template T
+ * @export
+ */
+jspb.JsonWriter.prototype.writeArray = function(
+    values, writeValue, opt_writeArg) {
+  this.out_ += this.separator_ + '[';
+  this.separator_ = '';
+  for (var i = 0; i < values.length; i++) {
+    writeValue.call(this, values[i], opt_writeArg);
+  }
+  this.out_ += ']';
+  this.separator_ = ',';
+};
+
+
+/**
+ * Writes a value of an int32, sint32 or sfixed32 field.
+ * @param {number} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeInt32 = function(value) {
+  this.writeValue_(String(value));
+};
+
+
+/**
+ * Writes a value of a uint32 or fixed32 field.
+ * @param {number} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeUint32 = jspb.JsonWriter.prototype.writeInt32;
+
+
+/**
+ * Writes a value of a 64-bit integer field, which proto3 JSON writes as a
+ * string of its decimal value.
+ * @param {number|string|bigint} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeInt64 = function(value) {
+  this.writeValue_('"' + String(value) + '"');
+};
+
+
+/**
+ * Writes a value of an unsigned 64-bit integer field.
+ * @param {number|string|bigint} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeUint64 = jspb.JsonWriter.prototype.writeInt64;
+
+
+/**
+ * Writes a value of a double field, with the non-finite values as the strings
+ * "NaN", "Infinity" and "-Infinity".
+ * @param {number|string} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeDouble = function(value) {
+  var number = Number(value);
+  this.writeValue_(isFinite(number) ? String(number) : '"' + number + '"');
+};
+
+
+/**
+ * Writes a value of a float field like writeDouble(), with the fewest digits
+ * that read back as the same 32-bit float: 0.1 rather than the
+ * 0.10000000149011612 that a float field holds after binary decoding.
+ * @param {number|string} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeFloat = function(value) {
+  var number = Math.fround(Number(value));
+  if (!isFinite(number)) {
+    this.writeDouble(number);
+    return;
+  }
+  // Nine significant digits always suffice.
+  for (var precision = 1; precision < 9; precision++) {
+    var shortest = Number(number.toPrecision(precision));
+    if (Math.fround(shortest) == number) {
+      this.writeDouble(shortest);
+      return;
+    }
+  }
+  this.writeDouble(Number(number.toPrecision(9)));
+};
+
+
+/**
+ * Writes a value of a bool field.
+ * @param {boolean} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeBool = function(value) {
+  this.writeValue_(value ? 'true' : 'false');
+};
+
+
+/**
+ * Writes a value of a string field.
+ * @param {string} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeString = function(value) {
+  this.writeValue_(JSON.stringify(value));
+};
+
+
+/**
+ * Writes a value of a bytes field, as a string of its base 64 encoding.
+ * @param {string|!Uint8Array} value
+ * @export
+ */
+jspb.JsonWriter.prototype.writeBytes = function(value) {
+  this.writeValue_('"' + jspb.Message.bytesAsB64(value) + '"');
+};
+
+
+/**
+ * Writes a value of an enum field, as the name of the value, or as its number
+ * if it has no name.
+ * @param {number} value
+ * @param {!Object<number, string>} names The names of the enum values by
+ *     number, as generated next to the enum.
+ * @export
+ */
+jspb.JsonWriter.prototype.writeEnum = function(value, names) {
+  var name = names[value];
+  this.writeValue_(name != null ? '"' + name + '"' : String(value));
+};
+
+
+/**
+ * Writes google.protobuf.NullValue, whose only value is written as null.
+ * @export
+ */
+jspb.JsonWriter.prototype.writeNullValue = function() {
+  this.writeValue_('null');
+};
+
+
+/**
+ * Writes a message, with its generated serializeJsonToWriter().
+ * @param {T} message
+ * @param {function(T, !jspb.JsonWriter)} serialize
+ * @template T
+ * @export
+ */
+jspb.JsonWriter.prototype.writeMessage = function(message, serialize) {
+  serialize(message, this);
+};
+
+
+/**
+ * Writes google.protobuf.Timestamp as an RFC 3339 date, e.g.
+ * "1972-01-01T10:00:20.021Z".
+ * @param {number|string|bigint} seconds Seconds since the Unix epoch.
+ * @param {number} nanos
+ * @export
+ */
+jspb.JsonWriter.prototype.writeTimestamp = function(seconds, nanos) {
+  seconds = Number(seconds);
+  if (!(seconds >= jspb.JsonWriter.MIN_TIMESTAMP_SECONDS_ &&
+        seconds <= jspb.JsonWriter.MAX_TIMESTAMP_SECONDS_ && nanos >= 0 &&
+        nanos <= 999999999)) {
+    throw new Error(
+        'Timestamp out of range for JSON: ' + seconds + 's ' + nanos + 'ns');
+  }
+  // toISOString() always writes milliseconds, which are replaced.
+  var date = new Date(seconds * 1000).toISOString();
+  this.writeValue_(
+      '"' + date.substr(0, 19) + jspb.JsonWriter.formatNanos_(nanos) + 'Z"');
+};
+
+
+/**
+ * Writes google.protobuf.Duration as seconds with the suffix "s", e.g.
+ * "1.000340012s".
+ * @param {number|string|bigint} seconds
+ * @param {number} nanos Of the same sign as seconds.
+ * @export
+ */
+jspb.JsonWriter.prototype.writeDuration = function(seconds, nanos) {
+  seconds = Number(seconds);
+  if (!(Math.abs(seconds) <= jspb.JsonWriter.MAX_DURATION_SECONDS_ &&
+        Math.abs(nanos) <= 999999999 &&
+        (seconds <= 0 && nanos <= 0 || seconds >= 0 && nanos >= 0))) {
+    throw new Error(
+        'Duration out of range for JSON: ' + seconds + 's ' + nanos + 'ns');
+  }
+  var sign = seconds < 0 || nanos < 0 ? '-' : '';
+  this.writeValue_(
+      '"' + sign + Math.abs(seconds) +
+      jspb.JsonWriter.formatNanos_(Math.abs(nanos)) + 's"');
+};
+
+
+/**
+ * Writes google.protobuf.FieldMask as its paths in lowerCamelCase, separated
+ * by commas, e.g. "user.displayName,photo".
+ * @param {!Array<string>} paths
+ * @export
+ */
+jspb.JsonWriter.prototype.writeFieldMask = function(paths) {
+  var json = [];
+  for (var i = 0; i < paths.length; i++) {
+    var path = paths[i];
+    if (/[A-Z]|_(?![a-z])/.test(path)) {
+      throw new Error('FieldMask path cannot be written as JSON: ' + path);
+    }
+    json.push(path.replace(/_([a-z])/g, function(match, letter) {
+      return letter.toUpperCase();
+    }));
+  }
+  this.writeString(json.join(','));
+};
+
+
+/**
+ * Writes google.protobuf.Any as the JSON of the message it holds, with its
+ * type URL in the "@type" property. The JSON of the well-known types which
+ * are not written as objects goes in the "value" property.
+ * @param {string} typeUrl
+ * @param {!Uint8Array} value The serialized message.
+ * @export
+ */
+jspb.JsonWriter.prototype.writeAny = function(typeUrl, value) {
+  if (typeUrl == '' && value.length == 0) {
+    this.beginObject();
+    this.endObject();
+    return;
+  }
+  var type = jspb.JsonWriter.findType_(this.typeRegistry_, typeUrl);
+  var message = type.deserializeBinary(value);
+  var typeName = typeUrl.substr(typeUrl.lastIndexOf('/') + 1);
+  this.beginObject();
+  this.writeName('@type');
+  this.writeString(typeUrl);
+  if (jspb.JsonWriter.VALUE_TYPES_[typeName]) {
+    this.writeName('value');
+    type.serializeJsonToWriter(message, this);
+    this.endObject();
+  } else {
+    this.continueObject_ = true;
+    type.serializeJsonToWriter(message, this);
+  }
+};
+
+
+
+/**
+ * Converts the values of parsed proto3 JSON into field values, for the
+ * generated deserializeJsonFromReader() of messages. All methods throw an
+ * error for values that are not valid for the field.
+ * @param {!jspb.JsonOptions=} opt_options
+ * @constructor
+ * @struct
+ * @export
+ */
+jspb.JsonReader = function(opt_options) {
+  /**
+   * @private {boolean}
+   */
+  this.ignoreUnknownFields_ =
+      !!(opt_options && opt_options.ignoreUnknownFields);
+
+  /**
+   * @private {?Object<string, !Function>}
+   */
+  this.typeRegistry_ = (opt_options && opt_options.typeRegistry) || null;
+};
+
+
+/**
+ * The largest magnitudes of 64-bit integers, as decimal strings.
+ * @const {string}
+ * @private
+ */
+jspb.JsonReader.MAX_INT64_ = '9223372036854775807';
+
+
+/**
+ * @const {string}
+ * @private
+ */
+jspb.JsonReader.MIN_INT64_ = '9223372036854775808';
+
+
+/**
+ * @const {string}
+ * @private
+ */
+jspb.JsonReader.MAX_UINT64_ = '18446744073709551615';
+
+
+/**
+ * Integers as numbers, or as strings in decimal or exponent notation.
+ * @const {!RegExp}
+ * @private
+ */
+jspb.JsonReader.NUMBER_ = /^-?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?$/;
+
+
+/**
+ * An RFC 3339 date: the date, the time, the fraction of a second and the
+ * sign, hours and minutes of the time zone offset, unless it is Z.
+ * @const {!RegExp}
+ * @private
+ */
+jspb.JsonReader.TIMESTAMP_ = new RegExp(
+    '^([0-9]{4})-([0-9]{2})-([0-9]{2})[Tt]([0-9]{2}):([0-9]{2}):([0-9]{2})' +
+    '(?:\\.([0-9]{1,9}))?(?:[Zz]|([-+])([0-9]{2}):([0-9]{2}))$');
+
+
+/**
+ * Throws the error for an invalid value.
+ * @param {string} expected What the value should have been.
+ * @param {*} value
+ * @private
+ */
+jspb.JsonReader.fail_ = function(expected, value) {
+  throw new Error(
+      'Invalid proto3 JSON: expected ' + expected + ', got ' +
+      JSON.stringify(value));
+};
+
+
+/**
+ * Checks that the given value is a JSON object.
+ * @param {*} value
+ * @export
+ */
+jspb.JsonReader.prototype.checkObject = function(value) {
+  if (value === null || typeof value != 'object' || Array.isArray(value)) {
+    jspb.JsonReader.fail_('an object', value);
+  }
+};
+
+
+/**
+ * Checks that the given value is a JSON array.
+ * @param {*} value
+ * @export
+ */
+jspb.JsonReader.prototype.checkArray = function(value) {
+  if (!Array.isArray(value)) {
+    jspb.JsonReader.fail_('an array', value);
+  }
+};
+
+
+/**
+ * Handles a property that is not a field of the message: an error, unless
+ * unknown fields are ignored.
+ * @param {string} name
+ * @export
+ */
+jspb.JsonReader.prototype.unknownField = function(name) {
+  if (!this.ignoreUnknownFields_) {
+    throw new Error('Invalid proto3 JSON: unknown field ' + name);
+  }
+};
+
+
+/**
+ * Returns the integer value of a number or of a string, or NaN.
+ * @param {*} value
+ * @return {number}
+ * @private
+ */
+jspb.JsonReader.toInteger_ = function(value) {
+  var number = typeof value == 'number' ? value :
+      typeof value == 'string' && jspb.JsonReader.NUMBER_.test(value) ?
+                                          Number(value) :
+                                          NaN;
+  return number === Math.floor(number) ? number : NaN;
+};
+
+
+/**
+ * Reads a value of an int32, sint32 or sfixed32 field.
+ * @param {*} value
+ * @return {number}
+ * @export
+ */
+jspb.JsonReader.prototype.readInt32 = function(value) {
+  var number = jspb.JsonReader.toInteger_(value);
+  if (!(number >= -2147483648 && number <= 2147483647)) {
+    jspb.JsonReader.fail_('an int32', value);
+  }
+  return number;
+};
+
+
+/**
+ * Reads a value of a uint32 or fixed32 field.
+ * @param {*} value
+ * @return {number}
+ * @export
+ */
+jspb.JsonReader.prototype.readUint32 = function(value) {
+  var number = jspb.JsonReader.toInteger_(value);
+  if (!(number >= 0 && number <= 4294967295)) {
+    jspb.JsonReader.fail_('a uint32', value);
+  }
+  return number;
+};
+
+
+/**
+ * Returns the decimal string of a 64-bit integer value, given as a number or
+ * as a string.
+ * @param {*} value
+ * @param {boolean} unsigned
+ * @return {string}
+ * @private
+ */
+jspb.JsonReader.toInt64String_ = function(value, unsigned) {
+  var decimal = null;
+  if (typeof value == 'string' && /^-?[0-9]+$/.test(value)) {
+    // Exact, unlike the conversion of larger values to numbers below.
+    decimal = value.replace(/^(-?)0+(?=[0-9])/, '$1');
+  } else {
+    var number = jspb.JsonReader.toInteger_(value);
+    if (number === number && Math.abs(number) < 1e21) {
+      decimal = String(number);
+    }
+  }
+  if (decimal == '-0') {
+    decimal = '0';
+  }
+  var negative = decimal != null && decimal.charAt(0) == '-';
+  var digits = negative ? decimal.substr(1) : decimal;
+  var max = unsigned ? jspb.JsonReader.MAX_UINT64_ :
+      negative       ? jspb.JsonReader.MIN_INT64_ :
+                       jspb.JsonReader.MAX_INT64_;
+  if (digits == null || (negative && unsigned) || digits.length > max.length ||
+      (digits.length == max.length && digits > max)) {
+    jspb.JsonReader.fail_(unsigned ? 'a uint64' : 'an int64', value);
+  }
+  return /** @type {string} */ (decimal);
+};
+
+
+/**
+ * Reads a value of an int64, sint64 or sfixed64 field stored as a number.
+ * @param {*} value
+ * @return {number}
+ * @export
+ */
+jspb.JsonReader.prototype.readInt64 = function(value) {
+  return Number(jspb.JsonReader.toInt64String_(value, false));
+};
+
+
+/**
+ * Reads a value of a 64-bit integer field stored as a decimal string.
+ * @param {*} value
+ * @return {string}
+ * @export
+ */
+jspb.JsonReader.prototype.readInt64String = function(value) {
+  return jspb.JsonReader.toInt64String_(value, false);
+};
+
+
+/**
+ * Reads a value of a 64-bit integer field stored as a BigInt.
+ * @param {*} value
+ * @return {bigint}
+ * @export
+ */
+jspb.JsonReader.prototype.readInt64BigInt = function(value) {
+  return BigInt(jspb.JsonReader.toInt64String_(value, false));
+};
+
+
+/**
+ * Reads a value of a uint64 or fixed64 field stored as a number.
+ * @param {*} value
+ * @return {number}
+ * @export
+ */
+jspb.JsonReader.prototype.readUint64 = function(value) {
+  return Number(jspb.JsonReader.toInt64String_(value, true));
+};
+
+
+/**
+ * Reads a value of an unsigned 64-bit integer field stored as a decimal
+ * string.
+ * @param {*} value
+ * @return {string}
+ * @export
+ */
+jspb.JsonReader.prototype.readUint64String = function(value) {
+  return jspb.JsonReader.toInt64String_(value, true);
+};
+
+
+/**
+ * Reads a value of an unsigned 64-bit integer field stored as a BigInt.
+ * @param {*} value
+ * @return {bigint}
+ * @export
+ */
+jspb.JsonReader.prototype.readUint64BigInt = function(value) {
+  return BigInt(jspb.JsonReader.toInt64String_(value, true));
+};
+
+
+/**
+ * Reads a value of a float or double field: a number, a string of a number,
+ * or one of "NaN", "Infinity" and "-Infinity".
+ * @param {*} value
+ * @return {number}
+ * @export
+ */
+jspb.JsonReader.prototype.readFloat = function(value) {
+  if (typeof value == 'number') {
+    return value;
+  }
+  if (typeof value == 'string' &&
+      (jspb.JsonReader.NUMBER_.test(value) || value == 'NaN' ||
+       value == 'Infinity' || value == '-Infinity')) {
+    return Number(value);
+  }
+  jspb.JsonReader.fail_('a number', value);
+  return 0;
+};
+
+
+/**
+ * Reads a value of a bool field.
+ * @param {*} value
+ * @return {boolean}
+ * @export
+ */
+jspb.JsonReader.prototype.readBool = function(value) {
+  if (typeof value != 'boolean') {
+    jspb.JsonReader.fail_('a boolean', value);
+  }
+  return /** @type {boolean} */ (value);
+};
+
+
+/**
+ * Reads a bool map key, which JSON writes as "true" or "false".
+ * @param {string} key
+ * @return {boolean}
+ * @export
+ */
+jspb.JsonReader.prototype.readBoolKey = function(key) {
+  if (key != 'true' && key != 'false') {
+    jspb.JsonReader.fail_('a boolean', key);
+  }
+  return key == 'true';
+};
+
+
+/**
+ * Reads a value of a string field.
+ * @param {*} value
+ * @return {string}
+ * @export
+ */
+jspb.JsonReader.prototype.readString = function(value) {
+  if (typeof value != 'string') {
+    jspb.JsonReader.fail_('a string', value);
+  }
+  return /** @type {string} */ (value);
+};
+
+
+/**
+ * Reads a value of a bytes field, in the standard or the URL-safe base 64
+ * encoding, with or without padding.
+ * @param {*} value
+ * @return {!Uint8Array}
+ * @export
+ */
+jspb.JsonReader.prototype.readBytes = function(value) {
+  if (typeof value != 'string' || !/^[-_+/A-Za-z0-9]*=*$/.test(value)) {
+    jspb.JsonReader.fail_('a base64 string', value);
+  }
+  return /** @type {!Uint8Array} */ (
+      jspb.Message.bytesAsU8(/** @type {string} */ (value)));
+};
+
+
+/**
+ * Reads a value of an enum field, given by name or by number.
+ * @param {*} value
+ * @param {!Object<number, string>} names The names of the enum values by
+ *     number, as generated next to the enum.
+ * @return {number}
+ * @export
+ */
+jspb.JsonReader.prototype.readEnum = function(value, names) {
+  if (typeof value == 'string') {
+    for (var number in names) {
+      if (names[number] === value) {
+        return Number(number);
+      }
+    }
+    jspb.JsonReader.fail_('an enum value name', value);
+  }
+  return this.readInt32(value);
+};
+
+
+/**
+ * Reads a value of a google.protobuf.NullValue field: null, or the name of
+ * its only value.
+ * @param {*} value
+ * @return {number}
+ * @export
+ */
+jspb.JsonReader.prototype.readNullValue = function(value) {
+  if (value !== null && value !== 'NULL_VALUE') {
+    jspb.JsonReader.fail_('null', value);
+  }
+  return 0;
+};
+
+
+/**
+ * Reads google.protobuf.Timestamp from an RFC 3339 date, which may have a
+ * time zone offset.
+ * @param {*} value
+ * @return {!Array<number>} The seconds since the Unix epoch and the nanos.
+ * @export
+ */
+jspb.JsonReader.prototype.readTimestamp = function(value) {
+  var match =
+      typeof value == 'string' && jspb.JsonReader.TIMESTAMP_.exec(value);
+  if (!match) {
+    jspb.JsonReader.fail_('an RFC 3339 date', value);
+  }
+  // Date.UTC() would map the years 0 to 99 to 1900 to 1999.
+  var date = new Date(0);
+  date.setUTCFullYear(+match[1], +match[2] - 1, +match[3]);
+  date.setUTCHours(+match[4], +match[5], +match[6]);
+  var seconds = date.getTime() / 1000;
+  if (match[8]) {
+    var offset = (+match[9] * 60 + +match[10]) * 60;
+    seconds += match[8] == '-' ? offset : -offset;
+  }
+  if (!(seconds >= jspb.JsonWriter.MIN_TIMESTAMP_SECONDS_ &&
+        seconds <= jspb.JsonWriter.MAX_TIMESTAMP_SECONDS_)) {
+    jspb.JsonReader.fail_('a date in the Timestamp range', value);
+  }
+  return [seconds, match[7] ? +(match[7] + '00000000').substr(0, 9) : 0];
+};
+
+
+/**
+ * Reads google.protobuf.Duration from seconds with the suffix "s".
+ * @param {*} value
+ * @return {!Array<number>} The seconds and the nanos, of the same sign.
+ * @export
+ */
+jspb.JsonReader.prototype.readDuration = function(value) {
+  var match = typeof value == 'string' &&
+      /^(-?)([0-9]+)(?:\.([0-9]{1,9}))?s$/.exec(value);
+  if (!match || +match[2] > jspb.JsonWriter.MAX_DURATION_SECONDS_) {
+    jspb.JsonReader.fail_('a duration', value);
+  }
+  var seconds = +match[2];
+  var nanos = match[3] ? +(match[3] + '00000000').substr(0, 9) : 0;
+  return match[1] ? [-seconds || 0, -nanos || 0] : [seconds, nanos];
+};
+
+
+/**
+ * Reads google.protobuf.FieldMask from paths in lowerCamelCase, separated by
+ * commas.
+ * @param {*} value
+ * @return {!Array<string>} The paths in snake_case.
+ * @export
+ */
+jspb.JsonReader.prototype.readFieldMask = function(value) {
+  if (typeof value != 'string' || /_/.test(value)) {
+    jspb.JsonReader.fail_('field mask paths in lowerCamelCase', value);
+  }
+  if (value == '') {
+    return [];
+  }
+  return value.split(',').map(function(path) {
+    return path.replace(/[A-Z]/g, function(letter) {
+      return '_' + letter.toLowerCase();
+    });
+  });
+};
+
+
+/**
+ * Reads google.protobuf.Any from the JSON of the message it holds.
+ * @param {*} value
+ * @return {!Array<string|!Uint8Array>} The type URL and the serialized
+ *     message.
+ * @export
+ */
+jspb.JsonReader.prototype.readAny = function(value) {
+  this.checkObject(value);
+  var object = /** @type {!Object} */ (value);
+  var typeUrl = object['@type'];
+  if (typeUrl === undefined && Object.keys(object).length == 0) {
+    return ['', new Uint8Array(0)];
+  }
+  if (typeof typeUrl != 'string') {
+    jspb.JsonReader.fail_('an "@type" string', typeUrl);
+  }
+  var type = jspb.JsonWriter.findType_(this.typeRegistry_, typeUrl);
+  var typeName = typeUrl.substr(typeUrl.lastIndexOf('/') + 1);
+  var json;
+  if (jspb.JsonWriter.VALUE_TYPES_[typeName]) {
+    json = object['value'];
+  } else {
+    json = {};
+    for (var key in object) {
+      if (key != '@type') {
+        json[key] = object[key];
+      }
+    }
+  }
+  var message = type.deserializeJsonFromReader(new type(), json, this);
+  return [typeUrl, message.serializeBinary()];
+};
@@ -0,0 +1,286 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// Test suite is written using Jasmine -- see http://jasmine.github.io/
+
+goog.require('jspb.JsonReader');
+goog.require('jspb.JsonWriter');
+goog.require('jspb.Map');
+
+// CommonJS-LoadFromFile: google/protobuf/struct_pb proto.google.protobuf
+goog.require('proto.google.protobuf.Struct');
+
+// CommonJS-LoadFromFile: google/protobuf/timestamp_pb proto.google.protobuf
+goog.require('proto.google.protobuf.Timestamp');
+
+// CommonJS-LoadFromFile: protos/proto3_test_pb proto.jspb.test
+goog.require('proto.jspb.test.TestWellKnownTypeFields');
+
+// CommonJS-LoadFromFile: protos/testbinary_pb proto.jspb.test
+goog.require('proto.jspb.test.ForeignEnum');
+goog.require('proto.jspb.test.ForeignMessage');
+goog.require('proto.jspb.test.MapValueMessage');
+goog.require('proto.jspb.test.TestAllTypes');
+goog.require('proto.jspb.test.TestMapFields');
+
+
+describe('Json test suite', () => {
+  /**
+   * Writes a single value with the given method of jspb.JsonWriter.
+   * @param {string} method
+   * @param {...*} var_args
+   * @return {string}
+   */
+  function write(method, var_args) {
+    const writer = new jspb.JsonWriter();
+    writer[method].apply(writer, Array.prototype.slice.call(arguments, 1));
+    return writer.getResultString();
+  }
+
+  it('testWriteObject', () => {
+    const writer = new jspb.JsonWriter();
+    writer.beginObject();
+    writer.writeName('a"b');
+    writer.writeInt32(1);
+    writer.writeName('list');
+    writer.writeArray([true, false], writer.writeBool);
+    writer.writeName('empty');
+    writer.beginObject();
+    writer.endObject();
+    writer.endObject();
+    expect(writer.getResultString())
+        .toEqual('{"a\\"b":1,"list":[true,false],"empty":{}}');
+  });
+
+  it('testWriteScalars', () => {
+    expect(write('writeInt32', -5)).toEqual('-5');
+    expect(write('writeInt64', 123)).toEqual('"123"');
+    expect(write('writeUint64', '18446744073709551615'))
+        .toEqual('"18446744073709551615"');
+    expect(write('writeFloat', 1.5)).toEqual('1.5');
+    expect(write('writeFloat', 0.10000000149011612)).toEqual('0.1');
+    expect(write('writeFloat', 3.4028234663852886e38))
+        .toEqual('3.4028235e+38');
+    expect(write('writeDouble', 0.10000000149011612))
+        .toEqual('0.10000000149011612');
+    expect(write('writeFloat', NaN)).toEqual('"NaN"');
+    expect(write('writeFloat', -Infinity)).toEqual('"-Infinity"');
+    expect(write('writeString', 'a\nb')).toEqual('"a\\nb"');
+    expect(write('writeBytes', new Uint8Array([0xfb, 0xff])))
+        .toEqual('"+/8="');
+    expect(write('writeNullValue')).toEqual('null');
+  });
+
+  it('testWriteEnum', () => {
+    const names = {0: 'ZERO', 1: 'ONE'};
+    expect(write('writeEnum', 1, names)).toEqual('"ONE"');
+    expect(write('writeEnum', 7, names)).toEqual('7');
+  });
+
+  it('testWriteMap', () => {
+    const map = new jspb.Map([[2, 'b'], [1, 'a']]);
+    const writer = new jspb.JsonWriter();
+    map.serializeJson(writer, writer.writeString);
+    expect(writer.getResultString()).toEqual('{"1":"a","2":"b"}');
+  });
+
+  it('testWriteWellKnownTypes', () => {
+    expect(write('writeTimestamp', 0, 0))
+        .toEqual('"1970-01-01T00:00:00Z"');
+    expect(write('writeTimestamp', 1e9, 10000000))
+        .toEqual('"2001-09-09T01:46:40.010Z"');
+    expect(write('writeTimestamp', 1, 123456789))
+        .toEqual('"1970-01-01T00:00:01.123456789Z"');
+    expect(write('writeDuration', 3, 1000)).toEqual('"3.000001s"');
+    expect(write('writeDuration', -1, -500000000)).toEqual('"-1.500s"');
+    expect(write('writeDuration', 0, -20000000)).toEqual('"-0.020s"');
+    expect(write('writeFieldMask', ['foo_bar', 'baz.qux_quux']))
+        .toEqual('"fooBar,baz.quxQuux"');
+    expect(() => write('writeFieldMask', ['Foo'])).toThrow();
+    expect(() => write('writeTimestamp', 253402300800, 0)).toThrow();
+  });
+
+  it('testReadScalars', () => {
+    const reader = new jspb.JsonReader();
+    expect(reader.readInt32(-5)).toEqual(-5);
+    expect(reader.readInt32('12')).toEqual(12);
+    expect(reader.readInt32(1e2)).toEqual(100);
+    expect(() => reader.readInt32(1.5)).toThrow();
+    expect(() => reader.readInt32(2147483648)).toThrow();
+    expect(() => reader.readUint32(-1)).toThrow();
+    expect(reader.readInt64String('-9223372036854775808'))
+        .toEqual('-9223372036854775808');
+    expect(() => reader.readInt64String('9223372036854775808')).toThrow();
+    expect(reader.readUint64String('18446744073709551615'))
+        .toEqual('18446744073709551615');
+    expect(reader.readInt64('42')).toEqual(42);
+    expect(reader.readFloat('NaN')).toBeNaN();
+    expect(reader.readFloat('-Infinity')).toEqual(-Infinity);
+    expect(reader.readFloat('2.5')).toEqual(2.5);
+    expect(() => reader.readFloat('abc')).toThrow();
+    expect(reader.readBool(true)).toBe(true);
+    expect(() => reader.readBool('true')).toThrow();
+    expect(reader.readBoolKey('false')).toBe(false);
+    expect(() => reader.readString(1)).toThrow();
+    expect(Array.from(reader.readBytes('-_8'))).toEqual([0xfb, 0xff]);
+    expect(Array.from(reader.readBytes('+/8='))).toEqual([0xfb, 0xff]);
+    expect(() => reader.readBytes('a*b')).toThrow();
+    expect(reader.readNullValue(null)).toEqual(0);
+  });
+
+  it('testReadEnum', () => {
+    const reader = new jspb.JsonReader();
+    const names = {0: 'ZERO', 1: 'ONE'};
+    expect(reader.readEnum('ONE', names)).toEqual(1);
+    expect(reader.readEnum(7, names)).toEqual(7);
+    expect(() => reader.readEnum('TWO', names)).toThrow();
+  });
+
+  it('testReadWellKnownTypes', () => {
+    const reader = new jspb.JsonReader();
+    expect(reader.readTimestamp('1970-01-01T00:00:01.5Z'))
+        .toEqual([1, 500000000]);
+    expect(reader.readTimestamp('1970-01-01T01:00:00+01:00'))
+        .toEqual([0, 0]);
+    expect(reader.readTimestamp('0001-01-01T00:00:00Z'))
+        .toEqual([-62135596800, 0]);
+    expect(() => reader.readTimestamp('1970-01-01 00:00:00Z')).toThrow();
+    expect(reader.readDuration('-1.5s')).toEqual([-1, -500000000]);
+    expect(reader.readDuration('0.000000001s')).toEqual([0, 1]);
+    expect(() => reader.readDuration('1')).toThrow();
+    expect(reader.readFieldMask('fooBar,baz.quxQuux'))
+        .toEqual(['foo_bar', 'baz.qux_quux']);
+    expect(reader.readFieldMask('')).toEqual([]);
+  });
+
+  it('testUnknownFields', () => {
+    expect(() => new jspb.JsonReader().unknownField('x')).toThrow();
+    new jspb.JsonReader({ignoreUnknownFields: true}).unknownField('x');
+    expect(() => new jspb.JsonReader().checkObject([])).toThrow();
+    expect(() => new jspb.JsonReader().checkArray({})).toThrow();
+  });
+
+  /**
+   * Checks that the given JSON is read and written back unchanged by the
+   * generated class.
+   * @param {function(new:jspb.Message)} ctor
+   * @param {string} json
+   * @return {!jspb.Message} The message read from the JSON.
+   */
+  function checkRoundTrip(ctor, json) {
+    const msg = ctor.fromJsonString(json);
+    expect(msg.toJsonString()).toEqual(json);
+    expect(ctor.fromJsonString(msg.toJsonString()).toObject())
+        .toEqual(msg.toObject());
+    return msg;
+  }
+
+  it('testGeneratedScalars', () => {
+    const msg = checkRoundTrip(
+        proto.jspb.test.TestAllTypes,
+        '{"optionalInt32":-42,"optionalInt64":"-9007199254740991",' +
+            '"optionalUint64":"1234567890123","optionalFloat":0.1,' +
+            '"optionalDouble":-1.25,"optionalBool":true,' +
+            '"optionalString":"hello","optionalBytes":"AQL/",' +
+            '"optionalForeignEnum":"FOREIGN_BAR",' +
+            '"repeatedInt64":["1","-2"]}');
+    expect(msg.getOptionalInt64()).toEqual(-9007199254740991);
+    expect(Array.from(msg.getOptionalBytes_asU8())).toEqual([1, 2, 0xff]);
+    expect(msg.getOptionalForeignEnum())
+        .toEqual(proto.jspb.test.ForeignEnum.FOREIGN_BAR);
+    expect(msg.getRepeatedInt64List()).toEqual([1, -2]);
+
+    // Numbers are accepted for 64-bit integers, and the proto field names
+    // and enum numbers are accepted too.
+    const other = proto.jspb.test.TestAllTypes.fromJsonString(
+        '{"optional_int64":5,"optionalForeignEnum":4}');
+    expect(other.getOptionalInt64()).toEqual(5);
+    expect(other.getOptionalForeignEnum())
+        .toEqual(proto.jspb.test.ForeignEnum.FOREIGN_FOO);
+    expect(() => proto.jspb.test.TestAllTypes.fromJsonString('{"x":1}'))
+        .toThrow();
+  });
+
+  it('testGeneratedFloatAfterBinary', () => {
+    const msg = new proto.jspb.test.TestAllTypes();
+    msg.setOptionalFloat(0.1);
+    const copy = proto.jspb.test.TestAllTypes.deserializeBinary(
+        msg.serializeBinary());
+    expect(copy.getOptionalFloat()).toEqual(Math.fround(0.1));
+    expect(copy.toJsonString()).toEqual('{"optionalFloat":0.1}');
+  });
+
+  it('testGeneratedMessagesAndOneofs', () => {
+    const msg = checkRoundTrip(
+        proto.jspb.test.TestAllTypes,
+        '{"optionalForeignMessage":{"c":7},' +
+            '"repeatedForeignMessage":[{"c":1},{}],"oneofString":"oneof"}');
+    expect(msg.getOptionalForeignMessage().getC()).toEqual(7);
+    expect(msg.getRepeatedForeignMessageList().length).toEqual(2);
+    expect(msg.getOneofFieldCase())
+        .toEqual(proto.jspb.test.TestAllTypes.OneofFieldCase.ONEOF_STRING);
+
+    checkRoundTrip(proto.jspb.test.TestAllTypes, '{"oneofBytes":""}');
+    checkRoundTrip(
+        proto.jspb.test.TestAllTypes, '{"oneofForeignMessage":{}}');
+  });
+
+  it('testGeneratedMaps', () => {
+    const msg = checkRoundTrip(
+        proto.jspb.test.TestMapFields,
+        '{"mapStringString":{"a":"x","b":"y"},' +
+            '"mapStringInt64":{"k":"-5"},' +
+            '"mapStringBool":{"t":true},' +
+            '"mapStringEnum":{"e":"MAP_VALUE_BAZ"},' +
+            '"mapStringMsg":{"m":{"foo":3}},' +
+            '"mapInt32String":{"-1":"neg","2":"two"},' +
+            '"mapBoolString":{"false":"f"}}');
+    expect(msg.getMapStringStringMap().get('b')).toEqual('y');
+    expect(msg.getMapStringInt64Map().get('k')).toEqual(-5);
+    expect(msg.getMapStringMsgMap().get('m').getFoo()).toEqual(3);
+    expect(msg.getMapInt32StringMap().get(-1)).toEqual('neg');
+    expect(msg.getMapBoolStringMap().get(false)).toEqual('f');
+  });
+
+  it('testGeneratedWellKnownTypes', () => {
+    const msg = checkRoundTrip(
+        proto.jspb.test.TestWellKnownTypeFields,
+        '{"timestamp":"1970-01-01T00:00:01.500Z",' +
+            '"timestamps":["2001-09-09T01:46:40Z"]}');
+    expect(msg.getTimestamp().getSeconds()).toEqual(1);
+    expect(msg.getTimestamp().getNanos()).toEqual(500000000);
+    expect(msg.getTimestampsList()[0].getSeconds()).toEqual(1e9);
+
+    const struct = checkRoundTrip(
+        proto.google.protobuf.Struct,
+        '{"list":[1.5,"x",null,true,{}],"obj":{"n":null}}');
+    expect(struct.toJavaScript())
+        .toEqual({'list': [1.5, 'x', null, true, {}], 'obj': {'n': null}});
+  });
+});
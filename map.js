@@ -39,6 +39,7 @@ goog.require('jspb.asserts');
 
 goog.requireType('jspb.BinaryReader');
 goog.requireType('jspb.BinaryWriter');
+goog.requireType('jspb.JsonWriter');
 
 
 
@@ -462,6 +463,54 @@ jspb.Map.prototype.serializeBinary = function(
 };
 
 
+/**
+ * Write this Map field in wire format to a BinaryWriter, using the given field
+ * number and a function writing the key and the value of one entry.
+ * @param {number} fieldNumber
+ * @param {!jspb.BinaryWriter} writer
+ * @param {function(!jspb.BinaryWriter,K,V)} entryWriterFn
+ *     Writes the key as field 1 and the value as field 2 of an entry.
+ * @export
+ */
+jspb.Map.prototype.serializeBinaryEntries = function(
+    fieldNumber, writer, entryWriterFn) {
+  var strKeys = this.stringKeys_();
+  strKeys.sort();
+  for (var i = 0; i < strKeys.length; i++) {
+    var entry = this.map_[strKeys[i]];
+    writer.beginSubMessage(fieldNumber);
+    entryWriterFn(writer, entry.key, this.wrapEntry_(entry));
+    writer.endSubMessage();
+  }
+};
+
+
+/**
+ * Write this Map field as a proto3 JSON object to a JsonWriter, with the keys
+ * as property names and the values written by the given method.
+ * @param {!jspb.JsonWriter} writer
+ * @param {function(this:jspb.JsonWriter, V, ?=)} valueWriterFn The method of
+ *     JsonWriter writing type V.
+ * @param {?=} opt_valueWriterArg The second argument of valueWriterFn: the
+ *     enum value names for enums, or serializeJsonToWriter for messages.
+ * @export
+ */
+jspb.Map.prototype.serializeJson = function(
+    writer, valueWriterFn, opt_valueWriterArg) {
+  var strKeys = this.stringKeys_();
+  strKeys.sort();
+  writer.beginObject();
+  for (var i = 0; i < strKeys.length; i++) {
+    var entry = this.map_[strKeys[i]];
+    writer.writeName(String(entry.key));
+    valueWriterFn.call(
+        writer, this.valueCtor_ ? this.wrapEntry_(entry) : entry.value,
+        opt_valueWriterArg);
+  }
+  writer.endObject();
+};
+
+
 /**
  * Read one key/value message from the given BinaryReader. Compatible as the
  * `reader` callback parameter to jspb.BinaryReader.readMessage, to be called
@@ -527,6 +576,10 @@ jspb.Map.deserializeBinary = function(map, reader, keyReaderFn, valueReaderFn,
     }
   }
 
+  if (map.valueCtor_ && !value) {
+    // Only allocate the default value message if the entry has no value.
+    value = new map.valueCtor_();
+  }
   jspb.asserts.assert(key != undefined);
   jspb.asserts.assert(value != undefined);
   map.set(key, value);
@@ -29,6 +29,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 goog.require('goog.userAgent');
+goog.require('jspb.BinaryWriter');
 
 // CommonJS-LoadFromFile: protos/testbinary_pb proto.jspb.test
 goog.require('proto.jspb.test.MapValueEnum');
@@ -335,6 +336,33 @@ function makeTests(msgInfo, submessageCtor, suffix) {
       checkMapEquals(deserializedMessage.getMapStringEnumMap(), [['f', 0]]);
       checkMapEquals(deserializedMessage.getMapStringMsgMap(), [['g', []]]);
     });
+
+    /**
+     * Tests that unknown fields of map entries are skipped and that entries
+     * without a value each get their own default value message.
+     */
+    it('testMapDeserializationSkipsUnknownEntryFields' + suffix, () => {
+      const writer = new jspb.BinaryWriter();
+      writer.beginSubMessage(7);  // map_string_msg
+      writer.writeString(1, 'a');
+      writer.writeInt32(3, 42);  // unknown field of the entry
+      writer.beginSubMessage(2);
+      writer.writeInt32(1, 5);
+      writer.endSubMessage();
+      writer.endSubMessage();
+      writer.beginSubMessage(7);
+      writer.writeString(1, 'b');
+      writer.endSubMessage();
+      writer.beginSubMessage(7);
+      writer.writeString(1, 'c');
+      writer.endSubMessage();
+      const msg = msgInfo.deserializeBinary(writer.getResultBuffer());
+      const map = msg.getMapStringMsgMap();
+      expect(map.getLength()).toEqual(3);
+      expect(map.get('a').getFoo()).toEqual(5);
+      expect(map.get('b').getFoo()).toEqual(0);
+      expect(map.get('b') === map.get('c')).toBeFalse();
+    });
   }
 
 
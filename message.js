@@ -43,6 +43,7 @@ goog.require('goog.array');
 goog.require('goog.crypt.base64');
 
 goog.require('jspb.asserts');
+goog.require('jspb.BinaryInstrumentation');
 goog.require('jspb.BinaryReader');
 goog.require('jspb.Map');
 
@@ -258,6 +259,24 @@ jspb.Message.prototype.wrappers_;
 jspb.Message.prototype.extensionObject_;
 
 
+/**
+ * Fields that were read by a lazy binary decode and have not been decoded yet,
+ * indexed by field number. See jspb.Message.LazyField_.
+ * @type {?Object<number, !jspb.Message.LazyField_>}
+ * @private
+ */
+jspb.Message.prototype.lazyFields_;
+
+
+/**
+ * The wrappers of the message before its last jspb.Message.clear, which the
+ * next decode reuses for the same fields. Indexed by field number.
+ * @type {?Object}
+ * @private
+ */
+jspb.Message.prototype.recycledWrappers_;
+
+
 /**
  * Non-extension fields with a field number at or above the pivot are
  * stored in the extension object (in addition to all extension fields).
@@ -360,6 +379,7 @@ jspb.Message.getFieldNumber_ = function(msg, index) {
 jspb.Message.initialize = function(
     msg, data, messageId, suggestedPivot, repeatedFields, opt_oneofFields) {
   msg.wrappers_ = null;
+  msg.lazyFields_ = null;
   if (!data) {
     data = messageId ? [messageId] : [];
   }
@@ -416,6 +436,235 @@ jspb.Message.EMPTY_LIST_SENTINEL_ =
     goog.DEBUG && Object.freeze ? Object.freeze([]) : [];
 
 
+/**
+ * Clears all fields of the message in place, so that it can be decoded into
+ * again with few allocations, e.g. by the generated resetFrom(). The arrays of
+ * repeated fields and the maps are kept and emptied. The submessages are kept
+ * aside and handed out again, cleared, by jspb.Message.reuseWrapperField.
+ * Values previously obtained from the message must thus not be used after it
+ * was cleared.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @param {?Array<number>} repeatedFields The repeated fields of the message,
+ *     as passed to jspb.Message.initialize.
+ * @export
+ */
+jspb.Message.clear = function(msg, repeatedFields) {
+  var array = msg.array;
+  var extensionObject = msg.extensionObject_;
+  var wrappers = msg.wrappers_;
+  // The array is replaced rather than truncated: fields of groups can have
+  // negative indices, which are properties rather than elements of the array.
+  msg.array = msg.messageId_ !== undefined ? [msg.messageId_] : [];
+  msg.extensionObject_ = null;
+  msg.wrappers_ = null;
+  msg.recycledWrappers_ = wrappers;
+  msg.lazyFields_ = null;
+  for (var converted in msg.convertedPrimitiveFields_) {
+    msg.convertedPrimitiveFields_ = {};
+    break;
+  }
+
+  if (repeatedFields) {
+    for (var i = 0; i < repeatedFields.length; i++) {
+      var fieldNumber = repeatedFields[i];
+      var inArray = fieldNumber < msg.pivot_;
+      var value = inArray ? array[jspb.Message.getIndex_(msg, fieldNumber)] :
+                            extensionObject && extensionObject[fieldNumber];
+      if (jspb.Message.isArray_(value) &&
+          value !== jspb.Message.EMPTY_LIST_SENTINEL_) {
+        value.length = 0;
+      } else {
+        value = jspb.Message.EMPTY_LIST_SENTINEL_;
+      }
+      if (inArray) {
+        msg.array[jspb.Message.getIndex_(msg, fieldNumber)] = value;
+      } else {
+        jspb.Message.maybeInitEmptyExtensionObject_(msg);
+        msg.extensionObject_[fieldNumber] = value;
+      }
+    }
+  }
+
+  if (wrappers) {
+    // Maps stay in place: getMapField() would create an empty one anyway.
+    for (var key in wrappers) {
+      var wrapper = wrappers[key];
+      if (wrapper instanceof jspb.Map) {
+        wrapper.clear();
+        jspb.Message.setWrapperField(msg, Number(key), wrapper);
+      }
+    }
+  }
+};
+
+
+/**
+ * Returns the submessage that the given field of the message held before it
+ * was last cleared with jspb.Message.clear, cleared in turn, or a new instance
+ * if there is none left. For repeated fields, each call returns one of the
+ * previous elements.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @param {number} fieldNumber The field number.
+ * @param {function(new:T)} ctor The constructor of the submessage type.
+ * @return {T}
+ * @template T
+ * @export
+ */
+jspb.Message.reuseWrapperField = function(msg, fieldNumber, ctor) {
+  var recycled = msg.recycledWrappers_;
+  if (recycled) {
+    var wrapper = recycled[fieldNumber];
+    if (jspb.Message.isArray_(wrapper)) {
+      wrapper = wrapper.pop();
+    } else {
+      recycled[fieldNumber] = undefined;
+    }
+    // Classes generated without the reuse option have no clear().
+    if (wrapper instanceof ctor && typeof wrapper.clear == 'function') {
+      return wrapper.clear();
+    }
+  }
+  return new ctor();
+};
+
+
+/**
+ * Drops the submessages that jspb.Message.clear set aside and that the decode
+ * which followed did not take again, in the message and in the submessages it
+ * took, so that they do not keep the previous contents alive. Called by the
+ * generated resetFrom() once it has decoded into the message.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @export
+ */
+jspb.Message.endReuse = function(msg) {
+  if (!msg.recycledWrappers_) {
+    // Neither the message nor its submessages were cleared.
+    return;
+  }
+  msg.recycledWrappers_ = null;
+  var wrappers = msg.wrappers_;
+  for (var key in wrappers) {
+    var wrapper = wrappers[key];
+    if (wrapper instanceof jspb.Message) {
+      jspb.Message.endReuse(wrapper);
+    } else if (jspb.Message.isArray_(wrapper)) {
+      for (var i = 0; i < wrapper.length; i++) {
+        jspb.Message.endReuse(wrapper[i]);
+      }
+    }
+  }
+};
+
+
+/**
+ * Defines obj[name] as a property whose value is installed on first access,
+ * as generated with the lazy_init option: reading it calls init(), which
+ * assigns the actual value to obj[name], and then the callbacks queued with
+ * jspb.Message.onLazyInit. Until then, the module defining the value only
+ * pays for this definition.
+ * @param {!Object} obj
+ * @param {string} name
+ * @param {function()} init
+ * @export
+ */
+jspb.Message.defineLazy = function(obj, name, init) {
+  var value;
+  var get = function() {
+    var callbacks = get.callbacks_;
+    if (callbacks && !get.initializing_) {
+      // Reentrant reads, while init() refers to the value it assigned, or
+      // through a cycle of lazy values, see the value assigned so far.
+      get.initializing_ = true;
+      try {
+        init();
+      } catch (e) {
+        // The next read tries again.
+        get.initializing_ = false;
+        throw e;
+      }
+      get.callbacks_ = null;
+      for (var i = 0; i < callbacks.length; i++) {
+        callbacks[i]();
+      }
+    }
+    return value;
+  };
+  /** @type {?Array<function()>} */
+  get.callbacks_ = [];
+  get.initializing_ = false;
+  Object.defineProperty(obj, name, {
+    get: get,
+    set: function(newValue) {
+      value = newValue;
+      // Later reads of obj[name] are plain property reads.
+      Object.defineProperty(obj, name, {
+        value: newValue,
+        writable: true,
+        enumerable: true,
+        configurable: true
+      });
+    },
+    enumerable: true,
+    configurable: true
+  });
+};
+
+
+/**
+ * Calls callback() once the lazy value of obj[name] is installed, or right
+ * away if it is not lazy or already installed. Extensions register with
+ * their extended message in this way, without installing it.
+ * @param {!Object} obj
+ * @param {string} name
+ * @param {function()} callback
+ * @export
+ */
+jspb.Message.onLazyInit = function(obj, name, callback) {
+  var descriptor = Object.getOwnPropertyDescriptor(obj, name);
+  var callbacks = descriptor && descriptor.get && descriptor.get.callbacks_;
+  if (callbacks) {
+    callbacks.push(callback);
+  } else {
+    callback();
+  }
+};
+
+
+/**
+ * Copies the properties of source to target like goog.object.extend, but
+ * without reading lazy values defined with jspb.Message.defineLazy, which
+ * stay lazy (and shared with source) in target.
+ * @param {!Object} target
+ * @param {!Object} source
+ * @export
+ */
+jspb.Message.extendLazy = function(target, source) {
+  for (var key in source) {
+    if (!Object.prototype.hasOwnProperty.call(source, key)) {
+      continue;
+    }
+    Object.defineProperty(
+        target, key, /** @type {!ObjectPropertyDescriptor} */ (
+            Object.getOwnPropertyDescriptor(source, key)));
+  }
+};
+
+
+/**
+ * Returns true if the provided argument is one of the typed arrays backing
+ * packed numeric fields decoded with the typed_arrays option of the code
+ * generator.
+ * @param {*} o The object to classify.
+ * @return {boolean}
+ * @private
+ */
+jspb.Message.isNumericTypedArray_ = function(o) {
+  return jspb.Message.SUPPORTS_UINT8ARRAY_ &&
+      (o instanceof Float64Array || o instanceof Float32Array ||
+       o instanceof Int32Array || o instanceof Uint32Array);
+};
+
+
 /**
  * Returns true if the provided argument is an array.
  * @param {*} o The object to classify as array or not.
@@ -640,6 +889,9 @@ jspb.Message.readBinaryExtension = function(
     msg, reader, extensions, getExtensionFn, setExtensionFn) {
   var binaryFieldInfo = extensions[reader.getFieldNumber()];
   if (!binaryFieldInfo) {
+    if (jspb.BinaryInstrumentation.ENABLED) {
+      jspb.BinaryInstrumentation.countUnknownField();
+    }
     reader.skipField();
     return;
   }
@@ -673,6 +925,133 @@ jspb.Message.readBinaryExtension = function(
 };
 
 
+/**
+ * The wire bytes of a lazy field, tags included, as views into the buffer the
+ * message was read from, and the generated deserializeBinaryFromReader()
+ * function decoding them.
+ * @typedef {{
+ *   chunks: !Array<!Uint8Array>,
+ *   decode: function(!jspb.Message, !jspb.BinaryReader)
+ * }}
+ * @private
+ */
+jspb.Message.LazyField_;
+
+
+/**
+ * The message whose lazy fields are currently being decoded, if any. Fields
+ * of this message are read eagerly by readLazyField().
+ * @private {?jspb.Message}
+ */
+jspb.Message.decodingLazyFields_ = null;
+
+
+/**
+ * Called by the generated deserializeBinaryFromReader() of lazy message and
+ * packed fields. If the field is still unset, this skips over it and keeps a
+ * view of its wire bytes, which are decoded when the field is first accessed.
+ * The buffer being read must therefore not be modified afterwards.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @param {!jspb.BinaryReader} reader Positioned at the field to read.
+ * @param {function(?, !jspb.BinaryReader)} decode The generated
+ *     deserializeBinaryFromReader() function of the message.
+ * @param {boolean=} opt_repeated True if the wire bytes of repeated occurrences
+ *     of the field are to be concatenated rather than replaced.
+ * @return {boolean} False if the field must be decoded eagerly instead.
+ * @export
+ */
+jspb.Message.readLazyField = function(msg, reader, decode, opt_repeated) {
+  if (!reader.isDelimited() || msg === jspb.Message.decodingLazyFields_) {
+    return false;
+  }
+  var fieldNumber = reader.getFieldNumber();
+  if (fieldNumber >= msg.pivot_) {
+    return false;
+  }
+  var lazyField = msg.lazyFields_ && msg.lazyFields_[fieldNumber];
+  if (!lazyField) {
+    var value = msg.array[jspb.Message.getIndex_(msg, fieldNumber)];
+    if (value != null && !(opt_repeated && value.length == 0)) {
+      return false;
+    }
+  }
+
+  var start = reader.getFieldCursor();
+  reader.skipField();
+  var bytes = reader.getBuffer().subarray(start, reader.getCursor());
+  if (!msg.lazyFields_) {
+    msg.lazyFields_ = {};
+  }
+  if (lazyField && opt_repeated) {
+    lazyField.chunks.push(bytes);
+  } else {
+    msg.lazyFields_[fieldNumber] = {chunks: [bytes], decode: decode};
+  }
+  return true;
+};
+
+
+/**
+ * Called by the generated serializeBinaryToWriter() of lazy message and packed
+ * fields. If the field has not been decoded since it was read, this writes its
+ * original wire bytes.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @param {number} fieldNumber The field number.
+ * @param {!jspb.BinaryWriter} writer
+ * @return {boolean} False if the field must be serialized normally instead.
+ * @export
+ */
+jspb.Message.serializeLazyField = function(msg, fieldNumber, writer) {
+  var lazyField = msg.lazyFields_ && msg.lazyFields_[fieldNumber];
+  if (!lazyField) {
+    return false;
+  }
+  var chunks = lazyField.chunks;
+  for (var i = 0; i < chunks.length; i++) {
+    writer.writeSerializedMessage(chunks[i], 0, chunks[i].length);
+  }
+  return true;
+};
+
+
+/**
+ * Decodes the wire bytes kept for a lazy field into the message.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @param {number} fieldNumber The field number.
+ * @private
+ */
+jspb.Message.decodeLazyField_ = function(msg, fieldNumber) {
+  var lazyField = msg.lazyFields_[fieldNumber];
+  var chunks = lazyField.chunks;
+  delete msg.lazyFields_[fieldNumber];
+  var decoding = jspb.Message.decodingLazyFields_;
+  jspb.Message.decodingLazyFields_ = msg;
+  try {
+    for (var i = 0; i < chunks.length; i++) {
+      var reader = jspb.BinaryReader.alloc(chunks[i]);
+      lazyField.decode(msg, reader);
+      reader.free();
+    }
+  } finally {
+    jspb.Message.decodingLazyFields_ = decoding;
+  }
+};
+
+
+/**
+ * Decodes all remaining lazy fields of the message.
+ * @private
+ */
+jspb.Message.prototype.decodeLazyFields_ = function() {
+  if (this.lazyFields_) {
+    for (var fieldNumber in this.lazyFields_) {
+      jspb.Message.decodeLazyField_(this, Number(fieldNumber));
+    }
+    this.lazyFields_ = null;
+  }
+};
+
+
 /**
  * Gets the value of a non-extension field.
  * @param {!jspb.Message} msg A jspb proto.
@@ -682,6 +1061,9 @@ jspb.Message.readBinaryExtension = function(
  * @export
  */
 jspb.Message.getField = function(msg, fieldNumber) {
+  if (msg.lazyFields_ && msg.lazyFields_[fieldNumber]) {
+    jspb.Message.decodeLazyField_(msg, fieldNumber);
+  }
   if (fieldNumber < msg.pivot_) {
     var index = jspb.Message.getIndex_(msg, fieldNumber);
     var val = msg.array[index];
@@ -715,6 +1097,37 @@ jspb.Message.getRepeatedField = function(msg, fieldNumber) {
 };
 
 
+/**
+ * Returns an array holding the values of the non-extension fields stored up to
+ * the given index, for the toObject() methods generated with the direct_object
+ * option to read them as getField() would. Lazy fields are decoded, and empty
+ * repeated fields replaced with new arrays first. This is the message's own
+ * array, unless its data had an extension object holding some of these fields.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @param {number} maxIndex The largest index read from the returned array.
+ * @return {!Array} The array to read the fields from.
+ * @export
+ */
+jspb.Message.getDirectFieldArray = function(msg, maxIndex) {
+  msg.decodeLazyFields_();
+  var array = msg.array;
+  if (jspb.Message.getFieldNumber_(msg, maxIndex) >= msg.pivot_) {
+    var fields = [];
+    for (var i = 0; i <= maxIndex; i++) {
+      fields[i] =
+          jspb.Message.getField(msg, jspb.Message.getFieldNumber_(msg, i));
+    }
+    return fields;
+  }
+  for (var i = 0; i < array.length; i++) {
+    if (array[i] === jspb.Message.EMPTY_LIST_SENTINEL_) {
+      array[i] = [];
+    }
+  }
+  return array;
+};
+
+
 /**
  * Gets the value of an optional float or double field.
  * @param {!jspb.Message} msg A jspb proto.
@@ -999,7 +1412,8 @@ jspb.Message.getMapField = function(
  * Sets the value of a non-extension field.
  * @param {T} msg A jspb proto.
  * @param {number} fieldNumber The field number.
- * @param {string|number|boolean|Uint8Array|Array|undefined} value New value
+ * @param {string|number|bigint|boolean|Uint8Array|Array|undefined} value New
+ *     value
  * @return {T} return msg
  * @template T
  * @export
@@ -1007,6 +1421,9 @@ jspb.Message.getMapField = function(
 jspb.Message.setField = function(msg, fieldNumber, value) {
   // TODO(b/35241823): replace this with a bounded generic when available
   jspb.asserts.assertInstanceof(msg, jspb.Message);
+  if (msg.lazyFields_) {
+    delete msg.lazyFields_[fieldNumber];
+  }
   if (fieldNumber < msg.pivot_) {
     msg.array[jspb.Message.getIndex_(msg, fieldNumber)] = value;
   } else {
@@ -1115,14 +1532,143 @@ jspb.Message.setProto3StringIntField = function(msg, fieldNumber, value) {
   return jspb.Message.setFieldIgnoringDefault_(msg, fieldNumber, value, '0');
 };
 
+
+/**
+ * Sets the value of a non-extension int field of a proto3 that is represented
+ * as a BigInt.
+ * @param {T} msg A jspb proto.
+ * @param {number} fieldNumber The field number.
+ * @param {bigint} value New value
+ * @return {T} return msg
+ * @template T
+ * @export
+ */
+jspb.Message.setProto3BigIntField = function(msg, fieldNumber, value) {
+  return jspb.Message.setFieldIgnoringDefault_(
+      msg, fieldNumber, value, BigInt(0));
+};
+
+
+/**
+ * Flags of the fields in the accessor tables of jspb.Message.installAccessors.
+ * @enum {number}
+ */
+jspb.Message.AccessorFlags = {
+  // A repeated field: the table holds the name of its adder after its flags.
+  REPEATED: 1,
+  // Float or double values, read with the floating point getters.
+  FLOATING_POINT: 2,
+  // Boolean values, read with the boolean getters.
+  BOOLEAN: 4,
+  // The getter returns the default value, given after the flags, if unset.
+  WITH_DEFAULT: 8,
+  // The field has presence, and gets a hazzer and a clearer.
+  PRESENCE: 16
+};
+
+
+/**
+ * Installs the accessors of primitive fields on the prototype of a message
+ * class, as generated with the compact option instead of one function per
+ * accessor. The same getters, setters, adders, clearers and hazzers as without
+ * it are installed. Each field takes five elements of the table: the name of
+ * the field as in its accessor names (e.g. 'FooList' for getFooList()), its
+ * field number, its jspb.Message.AccessorFlags, its default value (for
+ * singular fields) or the name in its adder (for repeated fields), and the
+ * setProto3*Field function setting it, or null to use setField.
+ * @param {function(new:jspb.Message, ...?)} ctor The message class.
+ * @param {!Array<*>} table
+ * @export
+ */
+jspb.Message.installAccessors = function(ctor, table) {
+  var proto = ctor.prototype;
+  for (var i = 0; i < table.length; i += 5) {
+    jspb.Message.installAccessors_(
+        proto, /** @type {string} */ (table[i]),
+        /** @type {number} */ (table[i + 1]),
+        /** @type {number} */ (table[i + 2]), table[i + 3],
+        /** @type {?function(!jspb.Message, number, ?): !jspb.Message} */ (
+            table[i + 4]));
+  }
+};
+
+
+/**
+ * Installs the accessors of one field for jspb.Message.installAccessors.
+ * @param {!Object} proto The prototype of the message class.
+ * @param {string} name
+ * @param {number} fieldNumber
+ * @param {number} flags
+ * @param {*} extra The default value, or the name in the adder.
+ * @param {?function(!jspb.Message, number, ?): !jspb.Message} proto3Setter
+ * @private
+ */
+jspb.Message.installAccessors_ = function(
+    proto, name, fieldNumber, flags, extra, proto3Setter) {
+  var Flags = jspb.Message.AccessorFlags;
+  var setterName = 'set' + name;
+  if (flags & Flags.REPEATED) {
+    var getRepeated = (flags & Flags.FLOATING_POINT) ?
+        jspb.Message.getRepeatedFloatingPointField :
+        (flags & Flags.BOOLEAN) ? jspb.Message.getRepeatedBooleanField :
+                                  jspb.Message.getRepeatedField;
+    proto['get' + name] = function() {
+      return getRepeated(this, fieldNumber);
+    };
+    proto[setterName] = function(value) {
+      return jspb.Message.setField(this, fieldNumber, value || []);
+    };
+    proto['add' + extra] = function(value, opt_index) {
+      return jspb.Message.addToRepeatedField(
+          this, fieldNumber, value, opt_index);
+    };
+    proto['clear' + name] = function() {
+      return this[setterName]([]);
+    };
+    return;
+  }
+
+  if (flags & Flags.WITH_DEFAULT) {
+    var getWithDefault = (flags & Flags.FLOATING_POINT) ?
+        jspb.Message.getFloatingPointFieldWithDefault :
+        (flags & Flags.BOOLEAN) ? jspb.Message.getBooleanFieldWithDefault :
+                                  jspb.Message.getFieldWithDefault;
+    proto['get' + name] = function() {
+      return getWithDefault(this, fieldNumber, extra);
+    };
+  } else {
+    var get = (flags & Flags.FLOATING_POINT) ?
+        jspb.Message.getOptionalFloatingPointField :
+        (flags & Flags.BOOLEAN) ? jspb.Message.getBooleanField :
+                                  jspb.Message.getField;
+    proto['get' + name] = function() {
+      return get(this, fieldNumber);
+    };
+  }
+  proto[setterName] = proto3Setter ? function(value) {
+    return proto3Setter(this, fieldNumber, value);
+  } : function(value) {
+    return jspb.Message.setField(this, fieldNumber, value);
+  };
+  if (flags & Flags.PRESENCE) {
+    proto['clear' + name] = function() {
+      return jspb.Message.setField(this, fieldNumber, undefined);
+    };
+    proto['has' + name] = function() {
+      return jspb.Message.getField(this, fieldNumber) != null;
+    };
+  }
+};
+
 /**
  * Sets the value of a non-extension primitive field, with proto3 (non-nullable
  * primitives) semantics of ignoring values that are equal to the type's
  * default.
  * @param {T} msg A jspb proto.
  * @param {number} fieldNumber The field number.
- * @param {!Uint8Array|string|number|boolean|undefined} value New value
- * @param {!Uint8Array|string|number|boolean} defaultValue The default value.
+ * @param {!Uint8Array|string|number|bigint|boolean|undefined} value New value
+ * @param {!Uint8Array|string|number|bigint|boolean} defaultValue The default
+ *     value.
  * @return {T} return msg
  * @template T
  * @private
@@ -1156,7 +1702,7 @@ jspb.Message.setFieldIgnoringDefault_ = function(
 jspb.Message.addToRepeatedField = function(msg, fieldNumber, value, opt_index) {
   // TODO(b/35241823): replace this with a bounded generic when available
   jspb.asserts.assertInstanceof(msg, jspb.Message);
-  var arr = jspb.Message.getRepeatedField(msg, fieldNumber);
+  var arr = jspb.Message.getMutableRepeatedField_(msg, fieldNumber);
   if (opt_index != undefined) {
     arr.splice(opt_index, 0, value);
   } else {
@@ -1166,6 +1712,55 @@ jspb.Message.addToRepeatedField = function(msg, fieldNumber, value, opt_index) {
 };
 
 
+/**
+ * Appends all the given values to a repeated, primitive field. This is used
+ * when decoding packed fields: if the field is still empty, the decoded array
+ * is adopted as the field's value instead of being copied.
+ * @param {T} msg A jspb proto.
+ * @param {number} fieldNumber The field number.
+ * @param {!IArrayLike<string|number|boolean>} values The values to append.
+ *     The field may keep a reference to this array, so it must not be
+ *     modified afterwards.
+ * @return {T} return msg
+ * @template T
+ * @export
+ */
+jspb.Message.addAllToRepeatedField = function(msg, fieldNumber, values) {
+  // TODO(b/35241823): replace this with a bounded generic when available
+  jspb.asserts.assertInstanceof(msg, jspb.Message);
+  var arr = jspb.Message.getRepeatedField(msg, fieldNumber);
+  if (arr.length == 0) {
+    jspb.Message.setField(msg, fieldNumber, /** @type {?} */ (values));
+    return msg;
+  }
+  arr = jspb.Message.getMutableRepeatedField_(msg, fieldNumber);
+  for (var i = 0; i < values.length; i++) {
+    arr.push(values[i]);
+  }
+  return msg;
+};
+
+
+/**
+ * Gets the value of a repeated field as an Array that can be modified in
+ * place. Packed numeric fields decoded with the typed_arrays option of the
+ * code generator are backed by typed arrays, which are converted to a plain
+ * Array here.
+ * @param {!jspb.Message} msg A jspb proto.
+ * @param {number} fieldNumber The field number.
+ * @return {!Array} The field's value.
+ * @private
+ */
+jspb.Message.getMutableRepeatedField_ = function(msg, fieldNumber) {
+  var arr = jspb.Message.getRepeatedField(msg, fieldNumber);
+  if (!jspb.Message.isArray_(arr)) {
+    arr = Array.prototype.slice.call(arr);
+    jspb.Message.setField(msg, fieldNumber, arr);
+  }
+  return arr;
+};
+
+
 /**
  * Sets the value of a field in a oneof union and clears all other fields in
  * the union.
@@ -1245,6 +1840,9 @@ jspb.Message.computeOneofCase = function(msg, oneof) {
  */
 jspb.Message.getWrapperField = function(msg, ctor, fieldNumber, opt_required) {
   // TODO(mwr): Consider copying data and/or arrays.
+  if (msg.lazyFields_ && msg.lazyFields_[fieldNumber]) {
+    jspb.Message.decodeLazyField_(msg, fieldNumber);
+  }
   if (!msg.wrappers_) {
     msg.wrappers_ = {};
   }
@@ -1299,6 +1897,23 @@ jspb.Message.wrapRepeatedField_ = function(msg, ctor, fieldNumber) {
 };
 
 
+/**
+ * Returns the array of a message set as a field of another message, to store
+ * in the array of the latter. A message whose lazy fields are not all decoded
+ * yet, e.g. one read by the decoding of a lazy field of its parent, keeps them
+ * that way: its array is stored as is, and toArray() of the parent decodes
+ * them later through its wrappers, as it syncs their maps.
+ * @param {!jspb.Message|!jspb.Map} value
+ * @return {!Array}
+ * @private
+ */
+jspb.Message.getWrapperArray_ = function(value) {
+  return value instanceof jspb.Message && value.lazyFields_ ?
+      value.array :
+      value.toArray();
+};
+
+
 /**
  * Sets a proto field and syncs it to the backing array.
  * @param {T} msg A jspb proto.
@@ -1315,7 +1930,7 @@ jspb.Message.setWrapperField = function(msg, fieldNumber, value) {
   if (!msg.wrappers_) {
     msg.wrappers_ = {};
   }
-  var data = value ? value.toArray() : value;
+  var data = value ? jspb.Message.getWrapperArray_(value) : value;
   msg.wrappers_[fieldNumber] = value;
   return jspb.Message.setField(msg, fieldNumber, data);
 };
@@ -1338,7 +1953,7 @@ jspb.Message.setOneofWrapperField = function(msg, fieldNumber, oneof, value) {
   if (!msg.wrappers_) {
     msg.wrappers_ = {};
   }
-  var data = value ? value.toArray() : value;
+  var data = value ? jspb.Message.getWrapperArray_(value) : value;
   msg.wrappers_[fieldNumber] = value;
   return jspb.Message.setOneofField(msg, fieldNumber, oneof, data);
 };
@@ -1361,7 +1976,7 @@ jspb.Message.setRepeatedWrapperField = function(msg, fieldNumber, value) {
   }
   value = value || [];
   for (var data = [], i = 0; i < value.length; i++) {
-    data[i] = value[i].toArray();
+    data[i] = jspb.Message.getWrapperArray_(value[i]);
   }
   msg.wrappers_[fieldNumber] = value;
   return jspb.Message.setField(msg, fieldNumber, data);
@@ -1401,10 +2016,10 @@ jspb.Message.addToRepeatedWrapperField = function(
   var array = jspb.Message.getRepeatedField(msg, fieldNumber);
   if (index != undefined) {
     wrapperArray.splice(index, 0, insertedValue);
-    array.splice(index, 0, insertedValue.toArray());
+    array.splice(index, 0, jspb.Message.getWrapperArray_(insertedValue));
   } else {
     wrapperArray.push(insertedValue);
-    array.push(insertedValue.toArray());
+    array.push(jspb.Message.getWrapperArray_(insertedValue));
   }
   return insertedValue;
 };
@@ -1482,6 +2097,7 @@ jspb.Message.prototype.syncMapFields_ = function() {
  * @export
  */
 jspb.Message.prototype.toArray = function() {
+  this.decodeLazyFields_();
   this.syncMapFields_();
   return this.array;
 };
@@ -1497,6 +2113,7 @@ if (jspb.Message.GENERATE_TO_STRING) {
    * @export
    */
   jspb.Message.prototype.toString = function() {
+    this.decodeLazyFields_();
     this.syncMapFields_();
     return this.array.toString();
   };
@@ -1697,6 +2314,15 @@ jspb.Message.compareFields = function(field1, field2) {
     return false;
   }
 
+  // Packed numeric fields decoded with the typed_arrays option are equal to
+  // the same values in a plain Array.
+  if (jspb.Message.isNumericTypedArray_(field1)) {
+    field1 = Array.prototype.slice.call(field1);
+  }
+  if (jspb.Message.isNumericTypedArray_(field2)) {
+    field2 = Array.prototype.slice.call(field2);
+  }
+
   // We have two objects. If they're different types, they're not equal.
   field1 = /** @type {!Object} */ (field1);
   field2 = /** @type {!Object} */ (field2);
@@ -1846,6 +2472,7 @@ jspb.Message.copyInto = function(fromMessage, toMessage) {
 
   // This is either null or empty for a fresh copy.
   toMessage.wrappers_ = copyOfFrom.wrappers_;
+  toMessage.lazyFields_ = null;
   // Just a reference into the shared array.
   toMessage.extensionObject_ = copyOfFrom.extensionObject_;
 };
@@ -1878,6 +2505,10 @@ jspb.Message.clone_ = function(obj) {
   if (jspb.Message.SUPPORTS_UINT8ARRAY_ && obj instanceof Uint8Array) {
     return new Uint8Array(obj);
   }
+  if (jspb.Message.isNumericTypedArray_(obj)) {
+    // Packed numeric fields decoded with the typed_arrays option.
+    return /** @type {?} */ (obj).slice();
+  }
   var clone = {};
   for (var key in obj) {
     o = obj[key];
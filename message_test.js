@@ -448,6 +448,56 @@ describe('Message test suite', () => {
     expect(jspb.Message.compareFields(NaN, undefined)).toEqual(false);
   });
 
+  it('testCompareFields_typedArrays', () => {
+    expect(jspb.Message.compareFields(new Int32Array([1, -2]), [1, -2]))
+        .toEqual(true);
+    expect(jspb.Message.compareFields([0.5], new Float64Array([0.5])))
+        .toEqual(true);
+    expect(jspb.Message.compareFields(
+               new Uint32Array([1, 2]), new Uint32Array([1, 3])))
+        .toEqual(false);
+  });
+
+  it('testAddAllToRepeatedField', () => {
+    const message = new proto.jspb.test.Simple1(['k']);
+    const values = ['a', 'b'];
+    jspb.Message.addAllToRepeatedField(message, 2, values);
+    expect(message.getARepeatedStringList()).toBe(values);
+    jspb.Message.addAllToRepeatedField(message, 2, ['c']);
+    expect(message.getARepeatedStringList()).toEqual(['a', 'b', 'c']);
+  });
+
+  it('testAddToRepeatedField_typedArray', () => {
+    const message = new proto.jspb.test.Simple1(['k']);
+    const values = new Int32Array([1, 2]);
+    jspb.Message.addAllToRepeatedField(message, 2, values);
+    jspb.Message.addToRepeatedField(message, 2, 3);
+    // Adding to a typed array replaces it with a plain Array.
+    expect(Array.isArray(message.getARepeatedStringList())).toEqual(true);
+    expect(message.getARepeatedStringList()).toEqual([1, 2, 3]);
+    expect(Array.from(values)).toEqual([1, 2]);
+    jspb.Message.addAllToRepeatedField(message, 2, new Int32Array([4]));
+    expect(message.getARepeatedStringList()).toEqual([1, 2, 3, 4]);
+  });
+
+  it('testGetDirectFieldArray', () => {
+    const message = new proto.jspb.test.Simple1(['k']);
+    const array = jspb.Message.getDirectFieldArray(message, 2);
+    expect(array).toBe(message.array);
+    // The empty repeated field is materialized as a modifiable array.
+    array[1].push('v');
+    expect(message.getARepeatedStringList()).toEqual(['v']);
+  });
+
+  it('testGetDirectFieldArray_extensionObject', () => {
+    const message =
+        new proto.jspb.test.Simple1(['k', ['v'], {3: true, 4: 'ignored'}]);
+    const array = jspb.Message.getDirectFieldArray(message, 2);
+    expect(array).toEqual(['k', ['v'], true]);
+    expect(message.toObject())
+        .toEqual({aString: 'k', aRepeatedStringList: ['v'], aBoolean: true});
+  });
+
   it('testToMap', () => {
     const p1 = new proto.jspb.test.Simple1(['k', ['v']]);
     const p2 = new proto.jspb.test.Simple1(['k1', ['v1', 'v2']]);
@@ -1070,4 +1120,123 @@ describe('Message test suite', () => {
     message.setAInt(42);
     expect(message.getAInt()).toEqual(42);
   });
+
+
+  it('testDefineLazy', () => {
+    const namespace = {};
+    const events = [];
+    jspb.Message.defineLazy(namespace, 'Value', () => {
+      events.push('init');
+      namespace.Value = {name: 'value'};
+      // Rereading the value while it is installed does not init it again.
+      events.push(namespace.Value.name);
+    });
+    jspb.Message.onLazyInit(namespace, 'Value', () => {
+      events.push('registered ' + namespace.Value.name);
+    });
+
+    const exported = {};
+    jspb.Message.extendLazy(exported, namespace);
+    expect(events).toEqual([]);
+
+    expect(exported.Value.name).toEqual('value');
+    expect(namespace.Value).toBe(exported.Value);
+    expect(events).toEqual(['init', 'value', 'registered value']);
+
+    // Later registrations run right away.
+    jspb.Message.onLazyInit(namespace, 'Value', () => {
+      events.push('late');
+    });
+    expect(events.length).toEqual(4);
+    expect(Object.getOwnPropertyDescriptor(namespace, 'Value').value)
+        .toBe(exported.Value);
+  });
+
+  it('testDefineLazyRetriesFailedInit', () => {
+    const namespace = {};
+    let attempts = 0;
+    jspb.Message.defineLazy(namespace, 'Value', () => {
+      if (++attempts == 1) {
+        throw new Error('init failed');
+      }
+      namespace.Value = attempts;
+    });
+
+    expect(() => namespace.Value).toThrowError('init failed');
+    expect(namespace.Value).toEqual(2);
+    expect(namespace.Value).toEqual(2);
+  });
+
+  it('testInstallAccessors', () => {
+    const Flags = jspb.Message.AccessorFlags;
+    const TestMessage = function(opt_data) {
+      jspb.Message.initialize(this, opt_data, 0, -1, [3], null);
+    };
+    goog.inherits(TestMessage, jspb.Message);
+    jspb.Message.installAccessors(TestMessage, [
+      'Name', 1, Flags.WITH_DEFAULT | Flags.PRESENCE, 'none', null,
+      'Ratio', 2, Flags.FLOATING_POINT | Flags.WITH_DEFAULT, 0.0,
+      jspb.Message.setProto3FloatField,
+      'ValueList', 3, Flags.REPEATED | Flags.BOOLEAN, 'Value', null,
+    ]);
+
+    const message = new TestMessage();
+    expect(message.getName()).toEqual('none');
+    expect(message.hasName()).toBe(false);
+    expect(message.setName('name')).toBe(message);
+    expect(message.hasName()).toBe(true);
+    message.clearName();
+    expect(message.hasName()).toBe(false);
+
+    message.setRatio(0.5);
+    expect(message.getRatio()).toEqual(0.5);
+    message.setRatio(0);
+    expect(message.toArray()[1]).toBeNull();
+
+    message.addValue(true);
+    message.addValue(false, 0);
+    expect(message.getValueList()).toEqual([false, true]);
+    message.clearValueList();
+    expect(message.getValueList()).toEqual([]);
+  });
+
+  it('testDeserializeBinaryPartial', () => {
+    const createSimple = (suffix) => {
+      const simple = new proto.jspb.test.Simple1();
+      simple.setAString('a' + suffix);
+      simple.setARepeatedStringList(['b' + suffix]);
+      simple.setABoolean(true);
+      return simple;
+    };
+    const original = new proto.jspb.test.TestClone();
+    original.setStr('str');
+    original.setSimple1(createSimple('1'));
+    original.setSimple2List([createSimple('2'), createSimple('3')]);
+    original.setBytesField('AQI=');
+    original.setUnused('unused');
+    const bytes = original.serializeBinary();
+
+    const mask = proto.jspb.test.TestClone.compileFieldMask(
+        ['str', 'simple1.a_boolean', 'simple2.a_string']);
+    const partial =
+        proto.jspb.test.TestClone.deserializeBinaryPartial(bytes, mask);
+    expect(partial.getStr()).toEqual('str');
+    expect(partial.hasBytesField()).toBeFalse();
+    expect(partial.hasUnused()).toBeFalse();
+    expect(partial.getSimple1().hasAString()).toBeFalse();
+    expect(partial.getSimple1().getARepeatedStringList()).toEqual([]);
+    expect(partial.getSimple1().getABoolean()).toBeTrue();
+    const simple2 = partial.getSimple2List();
+    expect(simple2.map((simple) => simple.getAString())).toEqual(['a2', 'a3']);
+    expect(simple2[0].hasABoolean()).toBeFalse();
+    expect(simple2[1].getARepeatedStringList()).toEqual([]);
+
+    // Selecting a message field selects all of its fields.
+    const whole =
+        proto.jspb.test.TestClone.deserializeBinaryPartial(bytes, ['simple1']);
+    expect(whole.hasStr()).toBeFalse();
+    expect(whole.getSimple1().toObject())
+        .toEqual(original.getSimple1().toObject());
+    expect(whole.getSimple2List()).toEqual([]);
+  });
 });
@@ -34,6 +34,7 @@ goog.require('proto.jspb.test.ForeignMessage');
 // CommonJS-LoadFromFile: protos/proto3_test_pb proto.jspb.test
 goog.require('proto.jspb.test.Proto3Enum');
 goog.require('proto.jspb.test.TestProto3');
+goog.require('proto.jspb.test.TestWellKnownTypeFields');
 // CommonJS-LoadFromFile: google/protobuf/any_pb proto.google.protobuf
 goog.require('proto.google.protobuf.Any');
 // CommonJS-LoadFromFile: google/protobuf/timestamp_pb proto.google.protobuf
@@ -413,6 +414,67 @@ describe('proto3Test', () => {
     expect(serialized.length).toEqual(0);
   });
 
+  /**
+   * Test that resetFrom() replaces all fields and reuses submessages.
+   */
+  it('testResetFrom', () => {
+    const first = new proto.jspb.test.TestProto3();
+    first.setSingularInt32(1);
+    first.setSingularForeignMessage(new proto.jspb.test.ForeignMessage());
+    first.getSingularForeignMessage().setC(2);
+    first.setRepeatedInt32List([3, 4]);
+    const second = new proto.jspb.test.TestProto3();
+    second.setSingularString('x');
+    second.setSingularForeignMessage(new proto.jspb.test.ForeignMessage());
+    second.setRepeatedInt32List([5]);
+
+    const msg = new proto.jspb.test.TestProto3();
+    msg.resetFrom(first.serializeBinary());
+    expect(msg.getSingularInt32()).toEqual(1);
+    expect(msg.getSingularForeignMessage().getC()).toEqual(2);
+    const foreign = msg.getSingularForeignMessage();
+
+    expect(msg.resetFrom(second.serializeBinary())).toBe(msg);
+    expect(msg.getSingularInt32()).toEqual(0);
+    expect(msg.getSingularString()).toEqual('x');
+    expect(msg.getSingularForeignMessage()).toBe(foreign);
+    expect(foreign.getC()).toEqual(0);
+    expect(msg.getRepeatedInt32List()).toEqual([5]);
+
+    msg.clear();
+    expect(msg.serializeBinary().length).toEqual(0);
+    expect(msg.hasSingularForeignMessage()).toBeFalse();
+    expect(msg.getRepeatedInt32List()).toEqual([]);
+  });
+
+  /**
+   * Test resetFrom() on fields of a well-known type, whose classes are
+   * generated without clear(): their submessages are not reused.
+   */
+  it('testResetFromWellKnownTypeFields', () => {
+    const first = new proto.jspb.test.TestWellKnownTypeFields();
+    first.setTimestamp(new proto.google.protobuf.Timestamp());
+    first.getTimestamp().setSeconds(1);
+    first.addTimestamps(new proto.google.protobuf.Timestamp()).setSeconds(2);
+    first.addTimestamps(new proto.google.protobuf.Timestamp()).setNanos(3);
+    const second = new proto.jspb.test.TestWellKnownTypeFields();
+    second.setTimestamp(new proto.google.protobuf.Timestamp());
+    second.getTimestamp().setNanos(4);
+    second.addTimestamps(new proto.google.protobuf.Timestamp()).setSeconds(5);
+
+    const msg = new proto.jspb.test.TestWellKnownTypeFields();
+    msg.resetFrom(first.serializeBinary());
+    expect(msg.getTimestamp().getSeconds()).toEqual(1);
+    expect(msg.getTimestampsList().length).toEqual(2);
+
+    msg.resetFrom(second.serializeBinary());
+    expect(msg.getTimestamp().getSeconds()).toEqual(0);
+    expect(msg.getTimestamp().getNanos()).toEqual(4);
+    expect(msg.getTimestampsList().length).toEqual(1);
+    expect(msg.getTimestampsList()[0].getSeconds()).toEqual(5);
+    expect(msg.toObject()).toEqual(second.toObject());
+  });
+
   /**
    * Test that base64 string and Uint8Array are interchangeable in bytes fields.
    */
@@ -472,4 +534,41 @@ describe('proto3Test', () => {
     expect('bar').toEqual(jsObj2.structKey.foo);
     expect(4).toEqual(jsObj2.complicatedKey[0].xyz.abc[1]);
   });
+
+  it('testTimestampMillis', () => {
+    const msg = proto.google.protobuf.Timestamp.fromMillis(-1500);
+    expect(msg.getSeconds()).toEqual(-2);
+    expect(msg.getNanos()).toEqual(500000000);
+    expect(msg.toMillis()).toEqual(-1500);
+    msg.setNanos(500999999);
+    expect(msg.toMillis()).toEqual(-1500);
+    msg.fromMillis(123456789);
+    expect(msg.getSeconds()).toEqual(123456);
+    expect(msg.getNanos()).toEqual(789000000);
+  });
+
+  it('testStructWellKnownTypeDeeplyNested', () => {
+    let jsValue = 'leaf';
+    for (let i = 0; i < 20000; i++) {
+      jsValue = i % 2 ? {key: jsValue} : [jsValue];
+    }
+
+    let jsValue2 = proto.google.protobuf.Value.fromJavaScript(jsValue)
+                       .toJavaScript();
+    for (let i = 20000 - 1; i >= 0; i--) {
+      jsValue2 = i % 2 ? jsValue2.key : jsValue2[0];
+    }
+    expect(jsValue2).toEqual('leaf');
+  });
+
+  it('testAnyTypeName', () => {
+    const any = new proto.google.protobuf.Any();
+    any.setTypeUrl('type.googleapis.com/jspb.test.TestProto3');
+    expect(any.getTypeName()).toEqual('jspb.test.TestProto3');
+    expect(any.getTypeName()).toEqual('jspb.test.TestProto3');
+    any.setTypeUrl('example.com/a/jspb.test.ForeignMessage');
+    expect(any.getTypeName()).toEqual('jspb.test.ForeignMessage');
+    any.setTypeUrl('jspb.test.ForeignMessage');
+    expect(any.getTypeName()).toEqual('jspb.test.ForeignMessage');
+  });
 });